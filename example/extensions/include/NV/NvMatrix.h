@@ -59,10 +59,31 @@
 #define NV_MATRIX_H
 
 #include <NvFoundation.h>
+#include "NvVector.h"
 
 /// \file
 /// Basic matrix classes with math operations
 
+// matrix4<float> multiply, inverse, transpose and vector transforms use SSE
+// (and AVX for the multiply) when the compiler targets it.  Define
+// NV_MATH_NO_SIMD to build the generic scalar versions instead.
+#if !defined(NV_MATH_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1)))
+#define NV_MATH_SSE 1
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define NV_MATH_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(NV_MATH_AVX)
+#define NV_MATH_SIMD_NAME "avx"
+#elif defined(NV_MATH_SSE)
+#define NV_MATH_SIMD_NAME "sse"
+#else
+#define NV_MATH_SIMD_NAME "scalar"
+#endif
+
 namespace nv {
 
 template <class T> class vec2;
@@ -182,24 +203,29 @@ public:
     }
 
     matrix4 & operator *= ( const matrix4 & rhs ) {
-        matrix4 mt(*this);
-        set_value(T(0));
-
-        for(int32_t i=0; i < 4; i++)
-            for(int32_t j=0; j < 4; j++)
-                for(int32_t c=0; c < 4; c++)
-                    element(i,j) += mt(i,c) * rhs(c,j);
+        multiply(*this, *this, rhs);
         return *this;
     }
 
     friend matrix4 operator * ( const matrix4 & lhs, const matrix4 & rhs ) {
         matrix4 r(T(0));
+        multiply(r, lhs, rhs);
+        return r;
+    }
+
+    // r = lhs * rhs; r may be the same matrix as lhs or rhs
+    static void multiply( matrix4 & r, const matrix4 & lhs, const matrix4 & rhs ) {
+        T t[16];
 
         for(int32_t i=0; i < 4; i++)
-            for(int32_t j=0; j < 4; j++)
+            for(int32_t j=0; j < 4; j++) {
+                T sum = T(0);
                 for(int32_t c=0; c < 4; c++)
-                    r.element(i,j) += lhs(i,c) * rhs(c,j);
-        return r;
+                    sum += lhs(i,c) * rhs(c,j);
+                t[i | (j<<2)] = sum;
+            }
+        for(int32_t i=0; i < 16; i++)
+            r._array[i] = t[i];
     }
 
     // dst = M * src
@@ -302,7 +328,7 @@ matrix4<T> inverse( const matrix4<T> & m) {
     s[2] = &r3[0];
     s[3] = &r4[0];
 
-    register int32_t i,j,p,jj;
+    int32_t i,j,p,jj;
     for(i=0;i<4;i++) {
         for(j=0;j<4;j++) {
             s[i][j] = m.element(i,j);
@@ -400,6 +426,262 @@ matrix4<T> transpose( const matrix4<T> & m) {
     return mtrans;
 }
 
+//
+// Batch transforms
+//
+//   dst may be the same array as src
+////////////////////////////////////////////////////////////
+
+// dst[i] = m * (src[i], 1), dropping w; for affine transforms of points
+template<class T>
+void transformPoints( const matrix4<T> & m, const vec3<T> * src, vec3<T> * dst, int32_t count)
+{
+    for (int32_t i = 0; i < count; i++)
+        dst[i] = vec3<T>(m * vec4<T>(src[i], T(1)));
+}
+
+// dst[i] = m * src[i]
+template<class T>
+void transformVectors( const matrix4<T> & m, const vec4<T> * src, vec4<T> * dst, int32_t count)
+{
+    for (int32_t i = 0; i < count; i++)
+        dst[i] = m * src[i];
+}
+
+// dst[i] = lhs * src[i], e.g. the view-projection times each object's world matrix
+template<class T>
+void multiplyMatrices( const matrix4<T> & lhs, const matrix4<T> * src, matrix4<T> * dst, int32_t count)
+{
+    for (int32_t i = 0; i < count; i++)
+        matrix4<T>::multiply(dst[i], lhs, src[i]);
+}
+
+#ifdef NV_MATH_SSE
+////////////////////////////////////////////////////////////////////////////////
+//
+//  SSE specializations for matrix4<float>
+//
+//   Columns are loaded unaligned, since matrices are not necessarily 16-byte
+//   aligned.  Sums are accumulated in the same order as the scalar code.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define NV_SSE_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(w, z, y, x))
+#define NV_SSE_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE(w, z, y, x))
+
+namespace sse {
+
+// c0 * v.x + c1 * v.y + c2 * v.z + c3 * v.w
+inline __m128 combine( __m128 c0, __m128 c1, __m128 c2, __m128 c3, __m128 v)
+{
+    __m128 r = _mm_mul_ps(c0, NV_SSE_SWIZZLE(v, 0, 0, 0, 0));
+    r = _mm_add_ps(r, _mm_mul_ps(c1, NV_SSE_SWIZZLE(v, 1, 1, 1, 1)));
+    r = _mm_add_ps(r, _mm_mul_ps(c2, NV_SSE_SWIZZLE(v, 2, 2, 2, 2)));
+    r = _mm_add_ps(r, _mm_mul_ps(c3, NV_SSE_SWIZZLE(v, 3, 3, 3, 3)));
+    return r;
+}
+
+// 2x2 matrices are packed (m00, m01, m10, m11)
+// A * B
+inline __m128 mat2Mul( __m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, NV_SSE_SWIZZLE(b, 0, 3, 0, 3)),
+        _mm_mul_ps(NV_SSE_SWIZZLE(a, 1, 0, 3, 2), NV_SSE_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adjugate(A) * B
+inline __m128 mat2AdjMul( __m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(NV_SSE_SWIZZLE(a, 3, 3, 0, 0), b),
+        _mm_mul_ps(NV_SSE_SWIZZLE(a, 1, 1, 2, 2), NV_SSE_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adjugate(B)
+inline __m128 mat2MulAdj( __m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, NV_SSE_SWIZZLE(b, 3, 0, 3, 0)),
+        _mm_mul_ps(NV_SSE_SWIZZLE(a, 1, 0, 3, 2), NV_SSE_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+};
+
+template<>
+inline void matrix4<float>::multiply( matrix4<float> & r, const matrix4<float> & lhs, const matrix4<float> & rhs )
+{
+    const __m128 a0 = _mm_loadu_ps(lhs._array);
+    const __m128 a1 = _mm_loadu_ps(lhs._array + 4);
+    const __m128 a2 = _mm_loadu_ps(lhs._array + 8);
+    const __m128 a3 = _mm_loadu_ps(lhs._array + 12);
+#ifdef NV_MATH_AVX
+    // each 128-bit lane computes one result column, two columns per op
+    const __m256 a0x2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a0), a0, 1);
+    const __m256 a1x2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a1), a1, 1);
+    const __m256 a2x2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a2), a2, 1);
+    const __m256 a3x2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a3), a3, 1);
+    const __m256 b01 = _mm256_loadu_ps(rhs._array);
+    const __m256 b23 = _mm256_loadu_ps(rhs._array + 8);
+
+    __m256 r01 = _mm256_mul_ps(a0x2, _mm256_shuffle_ps(b01, b01, 0x00));
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1x2, _mm256_shuffle_ps(b01, b01, 0x55)));
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2x2, _mm256_shuffle_ps(b01, b01, 0xaa)));
+    r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3x2, _mm256_shuffle_ps(b01, b01, 0xff)));
+
+    __m256 r23 = _mm256_mul_ps(a0x2, _mm256_shuffle_ps(b23, b23, 0x00));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1x2, _mm256_shuffle_ps(b23, b23, 0x55)));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2x2, _mm256_shuffle_ps(b23, b23, 0xaa)));
+    r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3x2, _mm256_shuffle_ps(b23, b23, 0xff)));
+
+    _mm256_storeu_ps(r._array, r01);
+    _mm256_storeu_ps(r._array + 8, r23);
+#else
+    // load all of rhs first, in case r is rhs
+    const __m128 b0 = _mm_loadu_ps(rhs._array);
+    const __m128 b1 = _mm_loadu_ps(rhs._array + 4);
+    const __m128 b2 = _mm_loadu_ps(rhs._array + 8);
+    const __m128 b3 = _mm_loadu_ps(rhs._array + 12);
+
+    _mm_storeu_ps(r._array, sse::combine(a0, a1, a2, a3, b0));
+    _mm_storeu_ps(r._array + 4, sse::combine(a0, a1, a2, a3, b1));
+    _mm_storeu_ps(r._array + 8, sse::combine(a0, a1, a2, a3, b2));
+    _mm_storeu_ps(r._array + 12, sse::combine(a0, a1, a2, a3, b3));
+#endif
+}
+
+template<>
+inline vec4<float> matrix4<float>::operator *( const vec4<float> &src) const
+{
+    vec4<float> r;
+    _mm_storeu_ps(r._array, sse::combine(_mm_loadu_ps(_array), _mm_loadu_ps(_array + 4),
+        _mm_loadu_ps(_array + 8), _mm_loadu_ps(_array + 12), _mm_loadu_ps(src._array)));
+    return r;
+}
+
+template<>
+inline matrix4<float> transpose( const matrix4<float> & m)
+{
+    __m128 c0 = _mm_loadu_ps(m._array);
+    __m128 c1 = _mm_loadu_ps(m._array + 4);
+    __m128 c2 = _mm_loadu_ps(m._array + 8);
+    __m128 c3 = _mm_loadu_ps(m._array + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    matrix4<float> mtrans(0.0f);
+    _mm_storeu_ps(mtrans._array, c0);
+    _mm_storeu_ps(mtrans._array + 4, c1);
+    _mm_storeu_ps(mtrans._array + 8, c2);
+    _mm_storeu_ps(mtrans._array + 12, c3);
+    return mtrans;
+}
+
+//
+// inverse
+//
+//   Block-wise inverse from 2x2 sub-matrices,
+//
+//       M = | A B |     inverse(M) = 1/|M| | X Y |
+//           | C D |                        | Z W |
+//
+//   The block formulas hold equally for the transpose, so the column-major
+//   array is treated as row-major throughout.  Returns the identity if the
+//   matrix is singular, as the generic version does.
+////////////////////////////////////////////////////////////
+template<>
+inline matrix4<float> inverse( const matrix4<float> & m)
+{
+    const __m128 c0 = _mm_loadu_ps(m._array);
+    const __m128 c1 = _mm_loadu_ps(m._array + 4);
+    const __m128 c2 = _mm_loadu_ps(m._array + 8);
+    const __m128 c3 = _mm_loadu_ps(m._array + 12);
+
+    // sub-matrices
+    const __m128 A = _mm_movelh_ps(c0, c1);
+    const __m128 B = _mm_movehl_ps(c1, c0);
+    const __m128 C = _mm_movelh_ps(c2, c3);
+    const __m128 D = _mm_movehl_ps(c3, c2);
+
+    // (|A|, |B|, |C|, |D|)
+    const __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(NV_SSE_SHUFFLE(c0, c2, 0, 2, 0, 2), NV_SSE_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+        _mm_mul_ps(NV_SSE_SHUFFLE(c0, c2, 1, 3, 1, 3), NV_SSE_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+    const __m128 detA = NV_SSE_SWIZZLE(detSub, 0, 0, 0, 0);
+    const __m128 detB = NV_SSE_SWIZZLE(detSub, 1, 1, 1, 1);
+    const __m128 detC = NV_SSE_SWIZZLE(detSub, 2, 2, 2, 2);
+    const __m128 detD = NV_SSE_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    const __m128 D_C = sse::mat2AdjMul(D, C);
+    const __m128 A_B = sse::mat2AdjMul(A, B);
+
+    // adjugates of the result blocks
+    __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), sse::mat2Mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), sse::mat2Mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), sse::mat2MulAdj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), sse::mat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(A_B, NV_SSE_SWIZZLE(D_C, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, NV_SSE_SWIZZLE(tr, 1, 0, 3, 2));
+    tr = _mm_add_ps(tr, NV_SSE_SWIZZLE(tr, 2, 3, 0, 1));
+    __m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+    detM = _mm_sub_ps(detM, tr);
+
+    matrix4<float> minv;
+    if (_mm_cvtss_f32(detM) == 0.0f)
+        return minv; // singular matrix!
+
+    // 1/|M| with the signs of a 2x2 adjugate
+    const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X = _mm_mul_ps(X, rDetM);
+    Y = _mm_mul_ps(Y, rDetM);
+    Z = _mm_mul_ps(Z, rDetM);
+    W = _mm_mul_ps(W, rDetM);
+
+    // the final adjugate swizzle, merged with the store
+    _mm_storeu_ps(minv._array, NV_SSE_SHUFFLE(X, Y, 3, 1, 3, 1));
+    _mm_storeu_ps(minv._array + 4, NV_SSE_SHUFFLE(X, Y, 2, 0, 2, 0));
+    _mm_storeu_ps(minv._array + 8, NV_SSE_SHUFFLE(Z, W, 3, 1, 3, 1));
+    _mm_storeu_ps(minv._array + 12, NV_SSE_SHUFFLE(Z, W, 2, 0, 2, 0));
+    return minv;
+}
+
+template<>
+inline void transformPoints( const matrix4<float> & m, const vec3<float> * src, vec3<float> * dst, int32_t count)
+{
+    const __m128 c0 = _mm_loadu_ps(m._array);
+    const __m128 c1 = _mm_loadu_ps(m._array + 4);
+    const __m128 c2 = _mm_loadu_ps(m._array + 8);
+    const __m128 c3 = _mm_loadu_ps(m._array + 12);
+
+    for (int32_t i = 0; i < count; i++) {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(src[i].x));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(src[i].y)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(src[i].z)));
+        r = _mm_add_ps(r, c3);
+
+        float t[4];
+        _mm_storeu_ps(t, r);
+        dst[i].x = t[0];
+        dst[i].y = t[1];
+        dst[i].z = t[2];
+    }
+}
+
+template<>
+inline void transformVectors( const matrix4<float> & m, const vec4<float> * src, vec4<float> * dst, int32_t count)
+{
+    const __m128 c0 = _mm_loadu_ps(m._array);
+    const __m128 c1 = _mm_loadu_ps(m._array + 4);
+    const __m128 c2 = _mm_loadu_ps(m._array + 8);
+    const __m128 c3 = _mm_loadu_ps(m._array + 12);
+
+    for (int32_t i = 0; i < count; i++)
+        _mm_storeu_ps(dst[i]._array, sse::combine(c0, c1, c2, c3, _mm_loadu_ps(src[i]._array)));
+}
+
+#undef NV_SSE_SWIZZLE
+#undef NV_SSE_SHUFFLE
+
+#endif // NV_MATH_SSE
+
 //
 // Rotation matrix creation
 // From rotation angle around X axis [radians]
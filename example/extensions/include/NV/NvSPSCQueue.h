@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------------------
+// File:        NV/NvSPSCQueue.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_SPSC_QUEUE_H
+#define NV_SPSC_QUEUE_H
+
+#include <NvFoundation.h>
+
+/// \file
+/// Lock-free single-producer, single-consumer ring of fixed-size slots
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReadWriteBarrier)
+// x86/x64 loads and stores are already ordered; only the compiler must not move them
+inline uint32_t NvLoadAcquire(const volatile uint32_t* p) { uint32_t v = *p; _ReadWriteBarrier(); return v; }
+inline void NvStoreRelease(volatile uint32_t* p, uint32_t v) { _ReadWriteBarrier(); *p = v; }
+#else
+inline uint32_t NvLoadAcquire(const volatile uint32_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+inline void NvStoreRelease(volatile uint32_t* p, uint32_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#endif
+
+/// A ring of N slots of type T shared by exactly one producer thread and one
+/// consumer thread.  Slots are filled and drained in place, so a slot handed
+/// out by #beginWrite or #beginRead stays valid and unshared until the matching
+/// #endWrite or #endRead.  Neither side ever blocks; callers that need to wait
+/// pair the queue with an #NvSignal.
+template <class T, uint32_t N>
+class NvSPSCQueue
+{
+public:
+    NvSPSCQueue() : m_written(0), m_read(0) { }
+
+    /// Producer: get the next free slot
+    /// \return the slot to fill, or NULL if all slots are in use
+    T* beginWrite() {
+        const uint32_t read = NvLoadAcquire(&m_read);
+        if (m_written - read >= N)
+            return NULL;
+        return &m_slots[m_written % N];
+    }
+
+    /// Producer: publish the slot returned by #beginWrite
+    void endWrite() {
+        NvStoreRelease(&m_written, m_written + 1);
+    }
+
+    /// Consumer: get the oldest published slot
+    /// \return the slot, or NULL if none has been published
+    T* beginRead() {
+        const uint32_t written = NvLoadAcquire(&m_written);
+        if (written == m_read)
+            return NULL;
+        return &m_slots[m_read % N];
+    }
+
+    /// Consumer: hand the slot returned by #beginRead back to the producer
+    void endRead() {
+        NvStoreRelease(&m_read, m_read + 1);
+    }
+
+    /// \return the index in [0, N) of the slot #beginWrite would return
+    uint32_t getWriteSlot() const { return m_written % N; }
+
+    /// Drop everything; only valid while neither thread is using the queue
+    void clear() { m_written = m_read = 0; }
+
+private:
+    T m_slots[N];
+    // each counter is written by one side only
+    volatile uint32_t m_written;
+    volatile uint32_t m_read;
+};
+
+#endif
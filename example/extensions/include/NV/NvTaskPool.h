@@ -0,0 +1,92 @@
+//----------------------------------------------------------------------------------
+// File:        NV/NvTaskPool.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_TASK_POOL_H
+#define NV_TASK_POOL_H
+
+#include <NvFoundation.h>
+
+/// \file
+/// Fixed-size worker thread pool for data-parallel loops
+
+/// Function run for each index of a #NvTaskPool::parallelFor
+/// \param[in] data the user pointer passed to parallelFor
+/// \param[in] index the index of the task, in [0, count)
+typedef void (*NvTaskFunction)(void* data, int32_t index);
+
+/// Cross-platform pool of worker threads.
+/// The pool runs batches of independent tasks; the calling thread works on
+/// the batch as well and returns once every task has completed.  Batches
+/// submitted while another batch is running (including from inside a task)
+/// are run serially on the calling thread, so tasks may safely nest.
+class NvTaskPool
+{
+public:
+    /// Constructor
+    /// \param[in] threadCount the number of worker threads to start.  Zero
+    /// starts one thread less than the number of available processors
+    NvTaskPool(int32_t threadCount = 0);
+
+    /// Destructor; waits for the worker threads to exit
+    ~NvTaskPool();
+
+    /// Number of worker threads, not counting the calling thread
+    /// \return the number of threads started by the pool
+    int32_t getThreadCount() const { return m_threadCount; }
+
+    /// Runs a batch of tasks and waits for all of them to complete
+    /// \param[in] count the number of tasks; fn is called once for each index
+    /// \param[in] fn the task function
+    /// \param[in] data user pointer passed to every call of fn
+    void parallelFor(int32_t count, NvTaskFunction fn, void* data);
+
+    /// Gets the pool shared by the framework libraries.
+    /// The pool is created on first use; any thread may make that first call.
+    /// \return the shared pool
+    static NvTaskPool& getShared();
+
+    /// Number of processors available to the process
+    /// \return the processor count, at least 1
+    static int32_t getProcessorCount();
+
+private:
+    NvTaskPool(const NvTaskPool&);
+    NvTaskPool& operator=(const NvTaskPool&);
+
+    struct Impl;
+    Impl* m_impl;
+    int32_t m_threadCount;
+};
+
+#endif
@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------------------
+// File:        NV/NvThread.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_THREAD_H
+#define NV_THREAD_H
+
+#include <NvFoundation.h>
+
+/// \file
+/// Minimal cross-platform thread and wake-up signal
+
+/// Function run by a #NvThread
+/// \param[in] data the user pointer passed to NvThread::start
+typedef void (*NvThreadFunction)(void* data);
+
+/// A single joinable thread.
+class NvThread
+{
+public:
+    /// Constructor; no thread is started until #start
+    NvThread();
+
+    /// Destructor; joins the thread if it is still running
+    ~NvThread();
+
+    /// Starts the thread
+    /// \param[in] fn the function to run on the new thread
+    /// \param[in] data user pointer passed to fn
+    /// \return true if the thread was started
+    bool start(NvThreadFunction fn, void* data);
+
+    /// Waits for the thread function to return.  Does nothing if the
+    /// thread was never started or has already been joined
+    void join();
+
+    /// \return true between a successful #start and #join
+    bool isStarted() const { return m_started; }
+
+    /// Suspends the calling thread
+    /// \param[in] secs the minimum time to sleep in seconds; the OS may
+    /// sleep for up to a scheduler quantum longer
+    static void sleep(float secs);
+
+    /// Gives up the rest of the calling thread's time slice
+    static void yield();
+
+private:
+    NvThread(const NvThread&);
+    NvThread& operator=(const NvThread&);
+
+    struct Impl;
+    Impl* m_impl;
+    bool m_started;
+};
+
+/// Auto-reset wake-up signal.
+/// #wait blocks until #set has been called since the last wait returned;
+/// several sets before a wait wake it once.  Meant for sleeping while a
+/// lock-free queue is empty or full, not for protecting data
+class NvSignal
+{
+public:
+    NvSignal();
+    ~NvSignal();
+
+    /// Wakes the waiting thread, or the next thread to wait
+    void set();
+
+    /// Blocks until the signal is set, then clears it
+    void wait();
+
+private:
+    NvSignal(const NvSignal&);
+    NvSignal& operator=(const NvSignal&);
+
+    struct Impl;
+    Impl* m_impl;
+};
+
+#endif
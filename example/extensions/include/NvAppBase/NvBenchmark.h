@@ -0,0 +1,184 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvBenchmark.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Per-frame benchmark statistics */
+
+#ifndef NVBENCHMARK_H
+#define NVBENCHMARK_H
+
+#include <NvFoundation.h>
+
+#include <string>
+#include <vector>
+
+/// \file
+/// Frame time recording with percentile statistics, for test and benchmark runs
+
+/// Records the CPU and GPU time of every frame, plus any app-registered counters,
+/// into a ring buffer that is allocated up front, so recording never allocates.
+/// A run is divided into cases (e.g. one per setting of a swept variable); each
+/// case skips a number of warm-up frames and then reduces the recorded frames to
+/// mean, standard deviation, min, max and p50/p95/p99.
+class NvBenchmark
+{
+public:
+    /// Maximum number of metrics per frame, including CPU and GPU time.
+    static const int32_t MAX_METRICS = 16;
+
+    /// Statistics for one metric over the recorded frames of a case.
+    struct Stats {
+        int32_t count; ///< number of frames with a valid value
+        float mean;
+        float stddev;
+        float min;
+        float p50;
+        float p95;
+        float p99;
+        float max;
+    };
+
+    /// The result of a finished case.
+    struct CaseResult {
+        std::string label;
+        int32_t frames; ///< recorded frames, excluding warm-up
+        Stats stats[MAX_METRICS];
+    };
+
+    /// Constructor.
+    /// \param[in] capacity the number of frames the ring buffer holds; if a case runs
+    /// for longer, its statistics cover the last capacity frames
+    /// \param[in] warmupFrames the number of frames at the start of each case that are
+    /// not recorded
+    NvBenchmark(int32_t capacity, int32_t warmupFrames);
+
+    /// Destructor.
+    ~NvBenchmark();
+
+    /// Add a per-frame counter, e.g. draw calls or triangles.
+    /// Counters must be added before the first frame is recorded.
+    /// \param[in] name the name of the counter, used as a column/key in the output
+    /// \return the index to pass to #setCounter, or -1 if the counter could not be added
+    int32_t addCounter(const char* name);
+
+    /// Set a counter's value for the current frame.  Counters keep their value
+    /// until set again.
+    /// \param[in] counter the index returned by #addCounter
+    /// \param[in] value the value
+    void setCounter(int32_t counter, float value) {
+        if (counter >= 0 && counter < m_metricCount)
+            m_current[counter] = value;
+    }
+
+    /// Start a new case, discarding any frames recorded but not ended.
+    /// \param[in] label the name of the case in the output
+    void beginCase(const std::string& label);
+
+    /// Record one frame.
+    /// \param[in] cpuMs the CPU time of the frame in milliseconds
+    /// \param[in] gpuMs the GPU time of the frame in milliseconds, or a negative
+    /// value if it is not known for this frame
+    /// \param[in] frame the index of the frame, increasing by one per frame, for
+    /// #setGPUTime to find it by later
+    /// \return true once the ring buffer is full, i.e. the case has recorded
+    /// capacity frames after its warm-up
+    bool recordFrame(float cpuMs, float gpuMs, int32_t frame = -1);
+
+    /// Set the GPU time of a frame recorded earlier in the current case, for
+    /// GPU timers whose results arrive a few frames late.  Frames that were
+    /// not recorded, belong to an ended case or have left the ring buffer are
+    /// ignored.
+    /// \param[in] frame the index the frame was recorded with
+    /// \param[in] gpuMs the GPU time of the frame in milliseconds
+    void setGPUTime(int32_t frame, float gpuMs);
+
+    /// Keep every recorded frame, not only the ring buffer, for #writeFrameLog.
+    /// \param[in] keep true to keep the frames recorded from now on
+    void setKeepFrameLog(bool keep) { m_keepLog = keep; }
+
+    /// End the current case and compute its statistics.
+    void endCase();
+
+    /// \return the results of all ended cases
+    const std::vector<CaseResult>& getResults() const { return m_results; }
+
+    /// \return the name of a metric; 0 is CPU time, 1 is GPU time, then the counters
+    const char* getMetricName(int32_t metric) const { return m_names[metric].c_str(); }
+
+    /// \return the number of metrics, including CPU and GPU time
+    int32_t getMetricCount() const { return m_metricCount; }
+
+    /// Write the results as JSON.
+    /// \param[in] path the file to write
+    /// \return true on success
+    bool writeJSON(const std::string& path) const;
+
+    /// Write the results as CSV, one row per case and one column per statistic.
+    /// \param[in] path the file to write
+    /// \return true on success
+    bool writeCSV(const std::string& path) const;
+
+    /// Write the frames kept since #setKeepFrameLog as text, one line per frame
+    /// with its case, index and every metric.
+    /// \param[in] path the file to write
+    /// \return true on success
+    bool writeFrameLog(const std::string& path) const;
+
+protected:
+    /// \privatesection
+    void computeStats(int32_t metric, Stats& stats);
+
+    int32_t m_capacity;
+    int32_t m_warmupFrames;
+    int32_t m_metricCount;
+    std::string m_names[MAX_METRICS];
+    float m_current[MAX_METRICS];
+
+    float* m_samples; // m_capacity frames of each metric, metric-major
+    float* m_scratch; // m_capacity values, sorted for percentiles
+    int32_t* m_frameTags; // the frame index of each ring buffer slot
+    int32_t m_head;
+    int32_t m_count;
+    int32_t m_warmupLeft;
+    bool m_started;
+
+    std::string m_label;
+    std::vector<CaseResult> m_results;
+
+    // case and frame index, and the metrics, of every frame when kept
+    bool m_keepLog;
+    std::vector<int32_t> m_logTags;
+    std::vector<float> m_log;
+};
+
+#endif
@@ -0,0 +1,66 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvFramePacket.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_FRAME_PACKET_H
+#define NV_FRAME_PACKET_H
+
+#include <NvFoundation.h>
+#include "NvAppBase/NvInputTransformer.h"
+
+/// \file
+/// Per-frame simulation results handed from simulation to rendering
+
+/// The output of one simulation step.
+/// In the threaded update model (-threaded), #NvSampleApp::simulate fills one of
+/// these on the simulation thread while the render thread draws the previous
+/// one, and the packet is not modified again until the render thread is done
+/// with it.  Apps keep any other per-frame render state in arrays indexed by
+/// #slot, so the two threads never touch the same copy.
+struct NvFramePacket {
+    /// Number of packets in flight: one being drawn, one being simulated
+    static const int32_t SLOT_COUNT = 2;
+
+    int64_t frame; ///< simulation step number, starting at 1
+    int32_t slot; ///< the packet's index in [0, SLOT_COUNT)
+    float delta; ///< simulated time step in seconds
+    double time; ///< total simulated time in seconds
+
+    /// Camera state at the end of the step.  Before draw() is called, the
+    /// framework copies this into the app's transformer, so draw() code that
+    /// reads the transformer sees the simulated camera.  Only filled in the
+    /// threaded model; in the serial model the transformer is updated in place
+    NvInputTransformer transformer;
+};
+
+#endif
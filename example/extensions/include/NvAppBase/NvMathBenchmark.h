@@ -0,0 +1,60 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvMathBenchmark.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Microbenchmarks for the matrix library */
+
+#ifndef NVMATHBENCHMARK_H
+#define NVMATHBENCHMARK_H
+
+#include <NvFoundation.h>
+
+class NvBenchmark;
+class NvStopWatch;
+
+/// \file
+/// Timing of the nv::matrix4f hot paths
+
+/// Times each nv::matrix4f operation (multiply, inverse, transpose, vector
+/// transform and the batch transforms) over arrays of inputs.  Each operation
+/// is one benchmark case, labelled with the instruction set the math library
+/// was built for (see NV_MATH_SIMD_NAME), and each recorded frame is the CPU
+/// time of one batch.  A per-operation summary is logged as each case ends.
+/// To compare against the scalar code, run a build with NV_MATH_NO_SIMD defined.
+/// \param[in] bench receives one case per operation; its capacity sets the
+/// number of batches timed per case
+/// \param[in] timer the stopwatch used to time each batch
+/// \param[in] batchSize the number of operations per batch
+void NvRunMathBenchmarks(NvBenchmark& bench, NvStopWatch* timer, int32_t batchSize);
+
+#endif
@@ -46,11 +46,15 @@
 #include "NvUI/NvUI.h"
 #include "NvUI/NvTweakVar.h"
 #include <map>
+#include <vector>
 
 /// \file
 /// Sample app base class.
 
+class NvBenchmark;
 class NvFramerateCounter;
+class NvGPUFrameTimer;
+struct NvFramePacket;
 class NvInputTransformer;
 class NvSimpleFBO;
 class NvTweakBar;
@@ -80,6 +84,28 @@ public:
     /// Called to request the app render any UI elements over the frame.
     virtual void drawUI(void) { }
 
+    /// Simulation callback.
+    /// Advances the app's simulation by one step.  Normally this is called on the
+    /// main thread before each frame is drawn.  In the threaded update model
+    /// (see #supportsThreadedUpdate) it is called on a simulation thread, one frame
+    /// ahead of the render thread.  The default implementation calls update()
+    /// \param[in,out] packet the step being simulated; per-frame state that draw()
+    /// reads should be written to app storage selected by packet.slot
+    virtual void simulate(NvFramePacket& packet) { update(); }
+
+    /// Threaded update support.
+    /// Apps return true if #simulate may run on a simulation thread: it must make
+    /// no GL calls, must not touch the UI, and draw() must only read simulation
+    /// results through the packet returned by #getFramePacket.  Input handlers,
+    /// reactions and draw() stay on the render thread.  The threaded model is
+    /// used when this returns true and the app is run with -threaded
+    /// \return true if the app supports the threaded update model
+    virtual bool supportsThreadedUpdate() { return false; }
+
+    /// Current frame packet.
+    /// \return the packet that draw() should render
+    const NvFramePacket* getFramePacket() const { return mFramePacket; }
+
     /// The base class provides an implementation of the mainloop that
     /// calls the virtual "callbacks" .  Leaving this function as implemented in the
     /// App base class allows the application to simply override the individual
@@ -192,6 +218,19 @@ protected:
     /// \return true if the app is running in a timed test harness
     bool isTestMode() { return mTestMode; }
 
+    /// Benchmark counter registration.
+    /// Adds a per-frame value (e.g. draw calls or triangles) to the statistics
+    /// recorded in test and benchmark runs.  Call from the constructor or initRendering.
+    /// \param[in] name the name of the counter in the output
+    /// \return the index to pass to #setBenchmarkCounter, or -1 if the app is not
+    /// recording statistics
+    int32_t addBenchmarkCounter(const char* name);
+
+    /// Set a benchmark counter's value for the current frame.
+    /// \param[in] counter the index returned by #addBenchmarkCounter
+    /// \param[in] value the value
+    void setBenchmarkCounter(int32_t counter, float value);
+
     // Do not override these virtuals - overide the "handle" ones above
     bool pointerInput(NvInputDeviceType::Enum device, NvPointerActionType::Enum action, 
         uint32_t modifiers, int32_t count, NvPointerEvent* points, int64_t timestamp=0); // we have base impl.
@@ -236,12 +275,26 @@ protected:
     void baseDrawUI(void);
     void baseHandleReaction(void);
     void logTestResults(float frameRate, int32_t frames);
+    void captureFrame(int32_t frame);
+    bool beginBenchmarkCase(int32_t index);
+    void readBenchmarkGPUTimes(bool flush);
+    void finishBenchmark();
+    void runMathBenchmark();
+    void runDXTBenchmark();
+    bool startSimulation();
+    void stopSimulation();
+    void paceFrame(NvStopWatch* paceTimer);
 
     void SwapBuffers();
 
 private:
     bool handleGestureEvents();
 
+    struct Simulation;
+    struct SimulationInput;
+    static void simulationThread(void* data);
+    bool queueSimulationInput(const SimulationInput& input);
+
     GLuint mMainFBO;
     bool mUseFBOPair;
     int32_t mCurrentFBOIndex;
@@ -258,6 +311,31 @@ private:
     float mTestDuration;
     int32_t mTestRepeatFrames;
     std::string mTestName;
+    bool mHeadless; // -headless: nothing is presented, render to the FBO pair
+    int32_t mFrameLimit; // -frames N: run exactly N fixed-step frames, then exit
+    std::string mCaptureDir; // -capture dir: write each frame as an image, and the frame times, into dir
+
+    struct BenchmarkSweep {
+        std::string name;
+        std::vector<std::string> values;
+    };
+
+    NvBenchmark* mBenchmark; // per-frame statistics, for -testmode, -frames and -bench
+    NvGPUFrameTimer* mBenchGPUTimer;
+    int32_t mBenchFrames; // -bench N: record N frames per case, then move to the next
+    int32_t mBenchWarmup; // -warmup N: frames skipped at the start of each case
+    std::string mBenchOut; // -benchout path: write path.json and path.csv
+    std::vector<BenchmarkSweep> mBenchSweeps; // -sweep var=a,b,...: one case per combination
+    int32_t mBenchCase;
+    int32_t mBenchCaseCount;
+    bool mMathBench; // -mathbench: time the matrix library before initializing
+    bool mDXTBench; // -benchmarkdxt: time software DXT expansion before initializing
+
+    bool mThreaded; // -threaded: simulate one frame ahead on a separate thread
+    float mPaceInterval; // -targetfps N: start frames no more often than 1/N seconds
+    Simulation* mSimulation; // the running simulation thread, or NULL
+    NvFramePacket* mSerialPacket; // the packet used when simulating on the main thread
+    const NvFramePacket* mFramePacket;
     float mSumDrawTime;
     int32_t mDrawTimeFrames;
     float mDrawRate;
@@ -270,6 +348,11 @@ private:
     uint32_t m_testModeIssues;
 
     const static int32_t TESTMODE_WARMUP_FRAMES = 10;
+    const static int32_t BENCHMARK_RING_FRAMES = 4096;
+    const static int32_t MATH_BENCHMARK_BATCHES = 256;
+    const static int32_t MATH_BENCHMARK_BATCH_SIZE = 1024;
+    const static int32_t DXT_BENCHMARK_BATCHES = 64;
+    const static int32_t DXT_BENCHMARK_SIZE = 1024;
 };
 
 #endif
@@ -59,6 +59,11 @@
 ///
 /// On Android, the file opened is always <filepath>, since the "assets"
 /// directory is known (it is the APK's assets).
+///
+/// On Windows and Linux, asset packs (see NvAssetPack.h) mounted with
+/// #NvAssetLoaderAddSearchPath are searched before any of the above,
+/// so assets deployed in a pack are found without touching the
+/// file system.
 
 
 /// Initializes the loader at application start.
@@ -86,10 +91,17 @@ bool NvAssetLoaderShutdown();
 /// \param[in] The relative path to add to the set of paths used to
 /// find the "assets" tree.  See the package description for the
 /// file search methods
+///
+/// If the path ends in ".nvpk", it names an asset pack instead.  The
+/// pack is located by walking up the directory tree the same way as
+/// the "assets" tree and is mapped into memory once; later reads of
+/// the assets it contains never touch the file system.  Packs are
+/// ignored on Android.
 /// \return true on success and false on failure
 bool NvAssetLoaderAddSearchPath(const char *path);
 
 /// Removes a search path from the lists.
+/// Removing the path of a mounted asset pack unmounts it.
 /// \param[in] the path to remove
 /// \return true on success and false on failure (not finding the path
 /// on the list is considered success)
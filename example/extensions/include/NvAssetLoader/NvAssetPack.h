@@ -0,0 +1,196 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetPack.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_ASSET_PACK_H
+#define NV_ASSET_PACK_H
+
+#include <NvFoundation.h>
+#include <string>
+#include <vector>
+
+/// \file
+/// Single-file asset packs for the asset loader.
+/// An asset pack is one file holding a sorted hash index and a set of
+/// aligned data blobs.  A mounted pack is mapped into memory once, so
+/// finding an asset is a lookup in the in-memory index instead of a
+/// series of failed file opens up the directory tree.
+///
+/// Packs are mounted by passing their path (ending in ".nvpk") to
+/// #NvAssetLoaderAddSearchPath.  Entries are named by the same partial
+/// path (below "assets") that is passed to #NvAssetLoaderRead.
+///
+/// Layout of a pack file:
+/// - #NvAssetPackHeader
+/// - #NvAssetPackEntry[entryCount], sorted by ascending hash
+/// - the entry names, not null-terminated
+/// - the entry data, each blob aligned to NvAssetPackHeader::alignment
+
+#define NV_ASSET_PACK_MAGIC     0x4b50564e // 'NVPK'
+#define NV_ASSET_PACK_VERSION   1
+#define NV_ASSET_PACK_EXTENSION ".nvpk"
+
+/// Compression applied to a single pack entry
+enum NvAssetPackCompression {
+    NV_ASSET_PACK_STORED = 0, ///< Raw bytes
+    NV_ASSET_PACK_LZ4 = 1,    ///< LZ4 block format (no frame header)
+    NV_ASSET_PACK_ZSTD = 2    ///< Reserved for zstd; not decoded by this build
+};
+
+/// File header of an asset pack
+struct NvAssetPackHeader {
+    uint32_t magic;        ///< #NV_ASSET_PACK_MAGIC
+    uint32_t version;      ///< #NV_ASSET_PACK_VERSION
+    uint32_t entryCount;   ///< number of entries in the index
+    uint32_t alignment;    ///< alignment of every data blob in bytes
+    uint64_t indexOffset;  ///< file offset of the entry index
+    uint64_t namesOffset;  ///< file offset of the name table
+};
+
+/// Index entry describing one asset in a pack
+struct NvAssetPackEntry {
+    uint64_t hash;         ///< #NvAssetPackHash of the entry name
+    uint64_t offset;       ///< file offset of the data blob
+    uint32_t storedSize;   ///< size of the blob in the pack
+    uint32_t size;         ///< size of the asset once decompressed
+    uint32_t nameOffset;   ///< offset of the name in the name table
+    uint16_t nameLength;   ///< length of the name in bytes
+    uint16_t compression;  ///< #NvAssetPackCompression
+};
+
+/// Hashes an asset name for the pack index.
+/// Names are hashed with 64-bit FNV-1a; backslashes are treated as
+/// forward slashes so that Windows-style paths find the same entry.
+/// \param[in] name the partial asset path
+/// \param[in] length the length of the name in bytes
+/// \return the hash of the name
+uint64_t NvAssetPackHash(const char* name, size_t length);
+
+/// A read-only, memory-mapped asset pack
+class NvAssetPack {
+public:
+    NvAssetPack();
+    ~NvAssetPack();
+
+    /// Maps a pack file into memory and validates its header and index.
+    /// \param[in] path the path to the pack file
+    /// \return true on success, false if the file is missing or invalid
+    bool open(const char* path);
+
+    /// Unmaps the pack.  Called by the destructor.
+    void close();
+
+    /// The path the pack was opened from
+    /// \return the path passed to #open
+    const std::string& getPath() const { return m_path; }
+
+    /// Finds an entry by asset name.
+    /// \param[in] name the partial path (below "assets") of the asset
+    /// \return the entry or NULL if the pack does not contain the asset
+    const NvAssetPackEntry* find(const char* name) const;
+
+    /// Gets a pointer to the raw stored bytes of an entry inside the mapping.
+    /// \param[in] entry an entry returned by #find
+    /// \return a pointer to NvAssetPackEntry::storedSize bytes
+    const uint8_t* getStoredData(const NvAssetPackEntry* entry) const
+    { return m_base + entry->offset; }
+
+    /// Copies or decompresses an entry into a caller-provided buffer.
+    /// \param[in] entry an entry returned by #find
+    /// \param[out] dst a buffer of at least NvAssetPackEntry::size bytes
+    /// \return true on success, false on corrupt or unsupported data
+    bool read(const NvAssetPackEntry* entry, uint8_t* dst) const;
+
+private:
+    NvAssetPack(const NvAssetPack&);
+    NvAssetPack& operator=(const NvAssetPack&);
+
+    std::string m_path;
+    const uint8_t* m_base;
+    size_t m_size;
+    const NvAssetPackEntry* m_entries;
+    uint32_t m_entryCount;
+    const char* m_names;
+#ifdef WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+/// Builds asset pack files.
+/// Collects named assets in memory and writes them as a single pack.
+/// This is meant for offline tools and build steps that bundle a
+/// sample's assets tree into one file for deployment.
+class NvAssetPackWriter {
+public:
+    /// \param[in] alignment the alignment of data blobs in the written pack
+    NvAssetPackWriter(uint32_t alignment = 16);
+
+    /// Adds an asset from memory.
+    /// \param[in] name the partial path (below "assets") to store the asset under
+    /// \param[in] data the asset bytes
+    /// \param[in] size the size of the asset in bytes
+    /// \param[in] compression the requested compression; the asset is stored
+    /// raw if compressing does not make it smaller
+    /// \return true on success, false if the name already exists or the
+    /// compression is not supported
+    bool addAsset(const char* name, const void* data, size_t size,
+        NvAssetPackCompression compression = NV_ASSET_PACK_STORED);
+
+    /// Adds an asset by reading a file from disk.
+    /// \param[in] name the partial path (below "assets") to store the asset under
+    /// \param[in] filePath the path of the file to read
+    /// \param[in] compression the requested compression
+    /// \return true on success, false on failure
+    bool addFile(const char* name, const char* filePath,
+        NvAssetPackCompression compression = NV_ASSET_PACK_STORED);
+
+    /// Writes all added assets to a pack file.
+    /// \param[in] path the output path
+    /// \return true on success, false on failure
+    bool write(const char* path) const;
+
+private:
+    struct Asset {
+        std::string name;
+        uint64_t hash;
+        uint32_t size;
+        uint16_t compression;
+        std::vector<uint8_t> data;
+    };
+
+    uint32_t m_alignment;
+    std::vector<Asset> m_assets;
+};
+
+#endif
@@ -37,10 +37,15 @@
 
 #include <NvFoundation.h>
 #include "NV/NvPlatformGL.h"
+#include "KHR/khrplatform.h"
+#include <string>
+#include <vector>
 
 /// \file
 /// GLSL shader program wrapper
 
+class NvGLExtensionsAPI;
+
 /// Convenience wrapper for GLSL shader programs.
 /// Wraps shader programs and simplifies creation, setting uniforms and setting
 /// vertex attributes.  Supports all forms of shaders, but has simple paths for
@@ -65,7 +70,7 @@ public:
     ~NvGLSLProgram();
 
     /// Creates and returns a shader object from a pair of filenames/paths
-    /// Uses #NvAssetLoaderRead to load the files.  Convenience function.
+    /// Uses #loadSourceFromFile to load the files.  Convenience function.
     /// \param[in] vertFilename the filename and partial path to the text file containing the vertex shader source
     /// \param[in] fragFilename the filename and partial path to the text file containing the fragment shader source
     /// \param[in] strict if set to true, then later calls to retrieve the locations of non-
@@ -101,8 +106,28 @@ public:
     /// disables the feature as desired.  String is not copied or destroyed.
     static void setGlobalShaderHeader(const char* header) { ms_shaderHeader = header; }
 
+    /// Reads a shader source file and expands its #include "file" directives.
+    /// Included names are resolved relative to the directory of the including file.
+    /// Each file is included at most once per source, so shared headers need no
+    /// include guards.  A #line directive surrounds every expansion so that compiler
+    /// messages keep the line numbers of the file they refer to; the source string
+    /// number of a file is its position in include order, 0 being the top file.
+    /// Files and expanded sources are cached by name, so shaders shared between
+    /// programs and headers shared between shaders are read and expanded only once.
+    /// Uses #NvAssetLoaderRead to load the files.
+    /// \param[in] filename the filename and partial path to the text file containing the shader source
+    /// \return the expanded null-terminated source, or NULL if the file or one of its
+    /// includes could not be read.  The string is owned by the cache and remains valid
+    /// until #clearSourceCache is called
+    static const char* loadSourceFromFile(const char* filename);
+
+    /// Releases the sources cached by #loadSourceFromFile.  Call it once all programs
+    /// are built, or to pick up edited shader files.
+    static void clearSourceCache();
+
     /// Initializes an existing shader object from a pair of filenames/paths
-    /// Uses #NvAssetLoaderRead to load the files.  Convenience function.
+    /// Uses #loadSourceFromFile to load the files, so they may contain #include directives.
+    /// Convenience function.
     /// \param[in] vertFilename the filename and partial path to the text file containing the vertex shader source
     /// \param[in] fragFilename the filename and partial path to the text file containing the fragment shader source
     /// \param[in] strict if set to true, then later calls to retrieve the locations of non-
@@ -138,6 +163,29 @@ public:
     /// \return true on success and false on failure
     bool setSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict = false);
 
+    /// Submits an array of #ShaderSourceItem sources without waiting for them to build.
+    /// The shaders are compiled and the program is linked, but compile and link status
+    /// are only queried when the program is first used (#enable, #getProgram, uniform and
+    /// attribute lookups) or when #finishBuild is called.  Submitting all programs before
+    /// using any of them lets the driver compile them concurrently, in the background
+    /// where GL_KHR_parallel_shader_compile is supported.
+    /// \param[in] src an array of #ShaderSourceItem objects containing the shaders sources
+    /// \param[in] count the number of elements in #src array
+    /// \param[in] strict if set to true, then later calls to retrieve the locations of non-
+    /// existent uniforms and vertex attributes will log a warning to the output
+    /// \return true if the sources were submitted; build errors are reported by #finishBuild
+    bool submitSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict = false);
+
+    /// Checks whether a submitted program has finished building without blocking.
+    /// Without GL_KHR_parallel_shader_compile the state is unknown and true is returned.
+    /// \return true if using the program will not wait for the compiler
+    bool isBuildComplete();
+
+    /// Waits for a submitted program to build and checks its compile and link status.
+    /// Called implicitly on first use; does nothing for programs that are not pending.
+    /// \return true if the program is usable
+    bool finishBuild();
+
     /// Binds the given shader program as current in the GL context
     void enable();
 
@@ -309,13 +357,60 @@ public:
     /// \param[in] transpose if true, the matrices are transposed on input
     void setUniformMatrix4fv(GLint index, GLfloat *m, int32_t count=1, bool transpose=false);
 
+    /// A uniform of the linked program, as recorded by the program reflection
+    struct UniformInfo {
+        std::string name; ///< the uniform name, without the "[0]" suffix of arrays
+        GLenum type; ///< the GL type of the uniform, e.g. GL_FLOAT_VEC4
+        GLint size; ///< the number of array elements, 1 for non-arrays
+        GLint location; ///< the uniform location, or -1 for members of uniform blocks
+        GLint block; ///< the index of the containing block in the uniform block table, or -1
+        GLint offset; ///< the byte offset in the containing block, or -1
+    };
+
+    /// A uniform block of the linked program, as recorded by the program reflection
+    struct UniformBlockInfo {
+        std::string name; ///< the block name
+        GLint binding; ///< the uniform buffer binding point of the block
+        GLint dataSize; ///< the size in bytes of the buffer range the block reads
+    };
+
+    /// \return the number of active uniforms of the program
+    int32_t getUniformCount() { if (m_pending) finishBuild(); return (int32_t)m_uniforms.size(); }
+
+    /// Returns an active uniform from the reflection table
+    /// \param[in] index the index of the uniform, in [0, #getUniformCount)
+    /// \return the uniform description
+    const UniformInfo& getUniform(int32_t index) const { return m_uniforms[index]; }
+
+    /// Finds an active uniform in the reflection table.  The returned index stays
+    /// valid until the program is rebuilt, so it can be looked up once and reused.
+    /// \param[in] name the null-terminated string name of the uniform
+    /// \return the index of the uniform for #getUniform, or -1 if not found
+    int32_t findUniform(const char* name);
+
+    /// \return the number of active uniform blocks of the program
+    int32_t getUniformBlockCount() { if (m_pending) finishBuild(); return (int32_t)m_uniformBlocks.size(); }
+
+    /// Returns an active uniform block from the reflection table.  The index is the
+    /// GL uniform block index.
+    /// \param[in] index the index of the block, in [0, #getUniformBlockCount)
+    /// \return the uniform block description
+    const UniformBlockInfo& getUniformBlock(int32_t index) const { return m_uniformBlocks[index]; }
+
+    /// Finds an active uniform block in the reflection table
+    /// \param[in] name the null-terminated string name of the block
+    /// \return the index of the block for #getUniformBlock, or -1 if not found
+    int32_t findUniformBlock(const char* name);
+
     /// Returns the index containing the named vertex attribute
     /// \param[in] uniform the null-terminated string name of the attribute
     /// \param[in] isOptional if true, the function logs an error if the attribute is not found
     /// \return the non-negative index of the attribute if found.  -1 if not found
     GLint getAttribLocation(const char* attribute, bool isOptional = false);
 
-    /// Returns the index containing the named uniform
+    /// Returns the index containing the named uniform.
+    /// Looks the uniform up in the reflection table; only array elements other than
+    /// the first are queried from the GL.
     /// \param[in] uniform the null-terminated string name of the uniform
     /// \param[in] isOptional if true, the function logs an error if the uniform is not found
     /// \return the non-negative index of the uniform if found.  -1 if not found
@@ -323,11 +418,59 @@ public:
 
     /// Returns the GL program object for the shader
     /// \return the GL shader object ID
-    GLuint getProgram() { return m_program; }
+    GLuint getProgram() { if (m_pending) finishBuild(); return m_program; }
 
     /// Relinks an existing shader program to update based on external changes
     bool relink();
 
+    /// Enables the on-disk program binary cache.
+    /// Programs are looked up by a hash of their shader sources, the global shader
+    /// header and the GL vendor, renderer and version strings.  A hit restores the
+    /// program with glProgramBinary instead of compiling and linking it; a miss, or
+    /// a binary the driver rejects, falls back to a full compile whose result is
+    /// then written to the cache.  Requires program binary support (see #globalInit).
+    /// Programs restored from the cache have no shaders attached and cannot be relinked.
+    /// \param[in] path the directory holding the cached binaries; it is created if
+    /// missing.  NULL disables the cache, which is the default
+    static void setProgramCacheDirectory(const char* path);
+
+    /// Static initialization of the program binary, parallel compile and uniform block query entry points.  Must be called with the
+    /// intended OpenGL context bound, after #NvImage::setAPIVersion.
+    /// \param[in] api the OpenGL extensions retrieval interface object
+    static void globalInit(NvGLExtensionsAPI& api);
+
+    /// \return true if the driver compiles shaders in the background
+    static bool isParallelCompileSupported() { return m_glMaxShaderCompilerThreads != NULL; }
+
+    /// \return true if program binaries can be retrieved and restored
+    static bool isProgramBinarySupported() { return m_glGetProgramBinary != NULL && m_glProgramBinary != NULL; }
+
+    /// \return true if the current program was restored from the program binary cache
+    bool isFromCache() const { return m_fromCache; }
+
+    /// Describes where the application stores a member of a uniform block
+    struct UniformBlockMember {
+        const char* name; ///< the uniform name as reported by the GL, e.g. "sceneData.depthScale"
+        GLint offset; ///< the byte offset of the member in the application-side struct
+    };
+
+    /// Validates the std140 layout of a uniform block against the struct the application uploads.
+    /// The offset of every member in the reflection table is compared with the offset
+    /// in the application-side struct, and the block must fit in the struct.
+    /// Members the program does not use are skipped, since the GL does not report them.
+    /// Mismatches are logged as errors.  Requires uniform block queries (see #globalInit).
+    /// \param[in] blockName the name of the uniform block, e.g. "sceneBuffer"
+    /// \param[in] members the members to check
+    /// \param[in] count the number of elements in members
+    /// \param[in] size the size in bytes of the application-side struct
+    /// \return false if a member or the size of the block does not match.  True if the
+    /// layout matches, if the program does not use the block, or if the queries are unsupported
+    bool checkUniformBlockLayout(const char* blockName, const UniformBlockMember* members,
+        int32_t count, GLint size);
+
+    /// \return true if uniform block layouts can be queried
+    static bool isUniformBlockQuerySupported() { return m_glGetActiveUniformsiv != NULL; }
+
     /// Enables logging of missing uniforms even for non-strict shaders
     /// \param[in] logMissing if set to true, missing uniforms are logged when set,
     /// even if the shader was not created with the strict flag
@@ -340,11 +483,55 @@ protected:
         const char** fragSrcArray, int32_t fragSrcCount);
     GLuint compileProgram(ShaderSourceItem* src, int32_t count);
 
+    static uint64_t computeCacheKey(const ShaderSourceItem* src, int32_t count);
+    static GLuint loadCachedProgram(const ShaderSourceItem* src, int32_t count, uint64_t& key);
+    static void storeCachedProgram(GLuint program, uint64_t key);
+    static void setBinaryRetrievableHint(GLuint program);
+    void releasePending();
+    void reflect();
+
     bool m_strict;
     GLuint m_program;
+    bool m_fromCache;
+
+    // state of a program submitted with submitSourceFromStrings
+    bool m_pending;
+    uint64_t m_cacheKey;
+    std::vector<GLuint> m_pendingShaders;
+
+    // reflection of the linked program; uniforms are sorted by name
+    std::vector<UniformInfo> m_uniforms;
+    std::vector<UniformBlockInfo> m_uniformBlocks;
 
     static bool ms_logAllMissing;
     static const char* ms_shaderHeader;
+
+    const static unsigned int NV_PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+    const static unsigned int NV_PROGRAM_BINARY_LENGTH = 0x8741;
+    const static unsigned int NV_NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+    const static unsigned int NV_COMPLETION_STATUS = 0x91B1;
+    const static unsigned int NV_UNIFORM_BLOCK_INDEX = 0x8A3A;
+    const static unsigned int NV_UNIFORM_OFFSET = 0x8A3B;
+    const static unsigned int NV_UNIFORM_BLOCK_BINDING = 0x8A3F;
+    const static unsigned int NV_UNIFORM_BLOCK_DATA_SIZE = 0x8A40;
+    const static unsigned int NV_UNIFORM_BLOCK_NAME_LENGTH = 0x8A41;
+    const static unsigned int NV_ACTIVE_UNIFORM_BLOCKS = 0x8A36;
+
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLGETPROGRAMBINARYPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLPROGRAMBINARYPROC) (GLuint program, GLenum binaryFormat, const void *binary, GLint length);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLPROGRAMPARAMETERIPROC) (GLuint program, GLenum pname, GLint value);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLMAXSHADERCOMPILERTHREADSPROC) (GLuint count);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLGETACTIVEUNIFORMSIVPROC) (GLuint program, GLsizei uniformCount, const GLuint *uniformIndices, GLenum pname, GLint *params);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLGETACTIVEUNIFORMBLOCKIVPROC) (GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint *params);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC) (GLuint program, GLuint uniformBlockIndex, GLsizei bufSize, GLsizei *length, GLchar *uniformBlockName);
+
+    static NV_PFNGLGETPROGRAMBINARYPROC m_glGetProgramBinary;
+    static NV_PFNGLPROGRAMBINARYPROC m_glProgramBinary;
+    static NV_PFNGLPROGRAMPARAMETERIPROC m_glProgramParameteri;
+    static NV_PFNGLMAXSHADERCOMPILERTHREADSPROC m_glMaxShaderCompilerThreads;
+    static NV_PFNGLGETACTIVEUNIFORMSIVPROC m_glGetActiveUniformsiv;
+    static NV_PFNGLGETACTIVEUNIFORMBLOCKIVPROC m_glGetActiveUniformBlockiv;
+    static NV_PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC m_glGetActiveUniformBlockName;
 };
 
 /// Convenience class to automatically push and pop a shader prefix
@@ -46,13 +46,34 @@
 class NvImage;
 
 /// GL-based image loading, representation and handling
-/// Support loading of images from DDS files and data, including
+/// Support loading of images from DDS and KTX/KTX2 files and data, including
 /// cube maps, arrays mipmap levels, formats, etc.
 /// The class does NOT encapsulate a GL texture object, only the
 /// client side pixel data that could be used to create such a texture
 class NvImage {
 public:
 
+    /// Receives the surfaces of an image while it is being loaded.
+    /// Allows consumers such as texture uploaders to start using the first
+    /// surfaces while the rest of the image is still being decoded.  The
+    /// methods are called on the thread that loads the image.
+    class SurfaceListener {
+    public:
+        virtual ~SurfaceListener() { }
+
+        /// Called once the format and dimensions of the image are known,
+        /// before any surface has been decoded
+        /// \param[in] image the image being loaded
+        /// \return false to abort loading
+        virtual bool imageReady(NvImage& image) = 0;
+
+        /// Called when a surface has been decoded and may be read
+        /// \param[in] image the image being loaded
+        /// \param[in] level the mipmap level of the surface
+        /// \param[in] layer the cubemap face or array layer of the surface
+        virtual void surfaceReady(NvImage& image, int32_t level, int32_t layer) = 0;
+    };
+
     /// Sets the image origin to top or bottom.
     /// Sets the origin to be assumed when loading image data from file or data block
     /// By default, the image library places the origin of images at the
@@ -87,6 +108,20 @@ public:
     /// \return a pointer to the NvImage representing the file or null on failure
     static NvImage* CreateFromDDSFile(const char* filename);
 
+    /// Create a new GL texture directly from an image file of any supported type
+    /// The reader is chosen from the file extension.  Uses #NvAssetLoaderRead
+    /// for opening the file.
+    /// \param[in] filename the image filename (and path) to load
+    /// \return the GL texture ID on success, 0 on failure
+    static uint32_t UploadTextureFromFile(const char* filename);
+
+    /// Create a new NvImage (no texture) directly from an image file of any supported type
+    /// The reader is chosen from the file extension.  Uses #NvAssetLoaderRead
+    /// for opening the file.
+    /// \param[in] filename the image filename (and path) to load
+    /// \return a pointer to the NvImage representing the file or null on failure
+    static NvImage* CreateFromFile(const char* filename);
+
     NvImage();
     virtual ~NvImage();
 
@@ -179,12 +214,18 @@ public:
     ///@}
 
     /// Loads an image from file-formatted data.
-    /// Initialize an image from file-formatted memory; only DDS files are supported
+    /// Initialize an image from file-formatted memory; DDS, KTX and KTX2 files
+    /// are supported.  KTX2 files may be zstd supercompressed when the library
+    /// is built with NV_USE_ZSTD; formats the target API cannot sample are
+    /// expanded as for DDS files
     /// \param[in] fileData the block of memory representing the entire image file
     /// \param[in] size the size of the data block in bytes
-    /// \param[in] fileExt the file extension string; must be "dds"
+    /// \param[in] fileExt the file extension string; "dds", "ktx" or "ktx2"
+    /// \param[in] listener optional listener that is handed each surface as
+    /// soon as it has been decoded
     /// \return true on success, false on failure
-    bool loadImageFromFileData(const uint8_t* fileData, size_t size, const char* fileExt);
+    bool loadImageFromFileData(const uint8_t* fileData, size_t size, const char* fileExt,
+        SurfaceListener* listener = NULL);
 
     /// Convert a flat "cross" image to  a cubemap
     /// Convert a suitable image from a cubemap cross to a cubemap
@@ -212,6 +253,22 @@ public:
     /// \return true if DXT images will be expanded, false if they will be passed through
     static bool getDXTExpansion() { return m_expandDXT; }
 
+    /// Measures the speed of software DXT expansion.
+    /// Expands a generated image of the given format repeatedly and returns the
+    /// throughput.  NvSampleApp runs it for every format under -benchmarkdxt.
+    /// \param[in] format the compressed GL format (DXT1/3/5, RGTC1/2 or LATC1/2, unsigned)
+    /// \param[in] width the width of the generated image in pixels
+    /// \param[in] height the height of the generated image in pixels
+    /// \param[in] iterations the number of times the image is expanded
+    /// \return the expansion rate in megapixels per second, or 0 if the format
+    /// cannot be expanded
+    static float BenchmarkDXTExpansion(uint32_t format, int32_t width = 1024,
+        int32_t height = 1024, int32_t iterations = 16);
+
+    /// The instruction set the software DXT decoder was built for.
+    /// \return a short name such as "SSE2", for labelling benchmark results
+    static const char* GetDXTExpansionPath();
+
 protected:
     /// \privatesection
 
@@ -230,10 +287,15 @@ protected:
     //pointers to the levels
     std::vector<uint8_t*> _data;
 
+    //single allocation holding all levels, or NULL if each level is allocated separately
+    uint8_t* _arena;
+
     void freeData();
     void flipSurface(uint8_t *surf, int32_t width, int32_t height, int32_t depth);
     void componentSwapSurface(uint8_t *surf, int32_t width, int32_t height, int32_t depth);
     uint8_t* expandDXT(uint8_t *surf, int32_t width, int32_t height, int32_t depth);
+    bool decodeSurfaces(const std::vector<const uint8_t*>& sources, bool compressed, bool flip,
+        SurfaceListener* listener);
 
     //
     // Static elements used to dispatch to proper sub-readers
@@ -241,7 +303,7 @@ protected:
     //////////////////////////////////////////////////////////////
     struct FormatInfo {
         const char* extension;
-        bool (*reader)(const uint8_t* fileData, size_t size, NvImage& i);
+        bool (*reader)(const uint8_t* fileData, size_t size, NvImage& i, SurfaceListener* listener);
         bool (*writer)(uint8_t* fileData, size_t size, NvImage& i);
     };
 
@@ -249,7 +311,10 @@ protected:
     static bool upperLeftOrigin;
     static bool m_expandDXT;
 
-    static bool readDDS(const uint8_t* fileData, size_t size, NvImage& i);
+    static bool readDDS(const uint8_t* fileData, size_t size, NvImage& i, SurfaceListener* listener);
+    static bool readKTX(const uint8_t* fileData, size_t size, NvImage& i, SurfaceListener* listener);
+    static bool readKTX2(const uint8_t* fileData, size_t size, NvImage& i, SurfaceListener* listener);
+    static void decodeSurfaceBand(void* job, int32_t index);
 
     static void flip_blocks_dxtc1(uint8_t *ptr, uint32_t numBlocks);
     static void flip_blocks_dxtc3(uint8_t *ptr, uint32_t numBlocks);
@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvTextureUploader.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_TEXTURE_UPLOADER_H
+#define NV_TEXTURE_UPLOADER_H
+
+#include "NV/NvPlatformGL.h"
+#include "NvGLUtils/NvImage.h"
+#include "KHR/khrplatform.h"
+
+/// \file
+/// Texture upload through immutable storage and a persistently mapped
+/// pixel unpack buffer ring.
+
+class NvGLExtensionsAPI;
+
+/// Uploads images to GL textures without per-level re-specification.
+/// All levels are allocated at once with glTexStorage2D (glTexStorage3D for
+/// volumes, arrays and cube map arrays), and the level
+/// data is copied into a persistently mapped pixel unpack buffer from
+/// which the driver transfers it asynchronously.  The buffer is used as
+/// a ring of fenced segments, so the CPU only waits when it catches up
+/// with transfers that are still in flight.  Large levels are split into
+/// bands of rows that fit a segment.
+///
+/// When uploading DDS data, each surface is handed to the GL as soon as
+/// it has been decoded, so the transfer of one surface overlaps the
+/// decoding of the next.
+///
+/// Features that the context lacks are skipped: without immutable storage
+/// the upload falls back to #NvImage::UploadTexture, and without buffer
+/// storage the level data is passed straight from client memory.
+///
+/// An uploader holds GL objects and must be created, used and destroyed
+/// with the same context bound.
+class NvTextureUploader : public NvImage::SurfaceListener
+{
+public:
+    /// Upload options
+    enum Flags {
+        IMMUTABLE_STORAGE = 0x1, ///< allocate all levels up front with glTexStorage2D/3D
+        STREAM = 0x2,            ///< copy level data through the pixel unpack ring
+        BINDLESS = 0x4,          ///< create a bindless handle and make it resident
+        DEFAULT = IMMUTABLE_STORAGE | STREAM
+    };
+
+    /// Creates an uploader; the ring is allocated on first use
+    /// \param[in] ringSize the size of the pixel unpack ring in bytes
+    /// \param[in] ringSegments the number of fenced segments in the ring [1, 8]
+    NvTextureUploader(uint32_t ringSize = 16 * 1024 * 1024, int32_t ringSegments = 4);
+
+    /// Releases the ring.  The textures created by the uploader are not deleted
+    ~NvTextureUploader();
+
+    /// Sets the filtering applied to the textures uploaded afterwards.
+    /// The state must be set at upload time for bindless textures, since it
+    /// becomes immutable once a handle is created
+    /// \param[in] minFilter the minification filter, or 0 to pick linear
+    /// filtering with or without mipmaps based on the image
+    /// \param[in] magFilter the magnification filter
+    void setFilter(uint32_t minFilter, uint32_t magFilter) { m_minFilter = minFilter; m_magFilter = magFilter; }
+
+    /// Sets the wrap mode applied to all coordinates of the textures uploaded afterwards
+    /// \param[in] wrap the wrap mode (GL_REPEAT, GL_CLAMP_TO_EDGE, ...)
+    void setWrap(uint32_t wrap) { m_wrap = wrap; }
+
+    /// Creates a texture from a loaded image
+    /// \param[in] image the image to upload
+    /// \param[in] flags a combination of #Flags
+    /// \param[out] bindlessHandle if non-NULL and #BINDLESS is set, receives the
+    /// resident texture handle, or 0 if bindless textures are not supported
+    /// \return the GL texture ID on success, 0 on failure
+    uint32_t upload(NvImage* image, uint32_t flags = DEFAULT, uint64_t* bindlessHandle = NULL);
+
+    /// Creates a texture from DDS file-formatted data, uploading each surface
+    /// as soon as it has been decoded
+    /// \param[in] ddsData the pointer to the DDS file data
+    /// \param[in] length the size in bytes of the file block
+    /// \param[in] flags a combination of #Flags
+    /// \param[out] bindlessHandle see #upload
+    /// \return the GL texture ID on success, 0 on failure
+    uint32_t uploadDDSData(const char* ddsData, int32_t length, uint32_t flags = DEFAULT,
+        uint64_t* bindlessHandle = NULL);
+
+    /// Creates a texture from a DDS file.
+    /// Uses #NvAssetLoaderRead for opening the file.
+    /// \param[in] filename the image filename (and path) to load
+    /// \param[in] flags a combination of #Flags
+    /// \param[out] bindlessHandle see #upload
+    /// \return the GL texture ID on success, 0 on failure
+    uint32_t uploadDDSFile(const char* filename, uint32_t flags = DEFAULT,
+        uint64_t* bindlessHandle = NULL);
+
+    /// Makes a handle non-resident and deletes the texture
+    /// \param[in] texID the texture to delete
+    /// \param[in] bindlessHandle the handle returned at upload, or 0
+    static void deleteTexture(uint32_t texID, uint64_t bindlessHandle);
+
+    /// Static initialization of the upload extensions.  Must be called with the
+    /// intended OpenGL context bound, after #NvImage::setAPIVersion.
+    /// \param[in] api the OpenGL extensions retrieval interface object
+    static void globalInit(NvGLExtensionsAPI& api);
+
+    /// \return true if glTexStorage2D is available
+    static bool isImmutableStorageSupported() { return m_glTexStorage2D != NULL; }
+
+    /// \return true if persistently mapped buffers are available
+    static bool isStreamingSupported() { return m_glBufferStorage != NULL && m_glMapBufferRange != NULL && m_glFenceSync != NULL; }
+
+    /// \return true if bindless texture handles are available
+    static bool isBindlessSupported() { return m_glGetTextureHandle != NULL; }
+
+    /// \privatesection
+    virtual bool imageReady(NvImage& image);
+    virtual void surfaceReady(NvImage& image, int32_t level, int32_t layer);
+
+protected:
+    /// \privatesection
+    static GLenum getStorageTarget(const NvImage& image);
+    static bool isLayeredTarget(GLenum target);
+    bool createStorage(NvImage& image);
+    void uploadSurface(NvImage& image, int32_t level, int32_t layer);
+    uint32_t finishTexture(NvImage& image, uint64_t* bindlessHandle);
+
+    bool initRing();
+    void releaseRing();
+    bool allocRing(uint32_t size, uint32_t& offset);
+    void waitSegment(int32_t segment);
+
+    const static unsigned int NV_PIXEL_UNPACK_BUFFER = 0x88EC;
+    const static unsigned int NV_MAP_WRITE_BIT = 0x0002;
+    const static unsigned int NV_MAP_PERSISTENT_BIT = 0x0040;
+    const static unsigned int NV_MAP_COHERENT_BIT = 0x0080;
+    const static unsigned int NV_SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+    const static unsigned int NV_SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+    const static unsigned int NV_TIMEOUT_EXPIRED = 0x911B;
+    const static unsigned int NV_WAIT_FAILED = 0x911D;
+    const static unsigned int NV_TEXTURE_WRAP_R = 0x8072;
+    const static unsigned int NV_TEXTURE_3D = 0x806F;
+    const static unsigned int NV_TEXTURE_2D_ARRAY = 0x8C1A;
+    const static unsigned int NV_TEXTURE_CUBE_MAP_ARRAY = 0x9009;
+
+    typedef void* NV_GLsync;
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLTEXSTORAGE2DPROC) (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLTEXSTORAGE3DPROC) (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLTEXSUBIMAGE3DPROC) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    typedef void* (KHRONOS_APIENTRY* NV_PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    typedef GLboolean (KHRONOS_APIENTRY* NV_PFNGLUNMAPBUFFERPROC) (GLenum target);
+    typedef NV_GLsync (KHRONOS_APIENTRY* NV_PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+    typedef GLenum (KHRONOS_APIENTRY* NV_PFNGLCLIENTWAITSYNCPROC) (NV_GLsync sync, GLbitfield flags, uint64_t timeout);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLDELETESYNCPROC) (NV_GLsync sync);
+    typedef uint64_t (KHRONOS_APIENTRY* NV_PFNGLGETTEXTUREHANDLEPROC) (GLuint texture);
+    typedef void (KHRONOS_APIENTRY* NV_PFNGLTEXTUREHANDLERESIDENTPROC) (uint64_t handle);
+
+    static NV_PFNGLTEXSTORAGE2DPROC          m_glTexStorage2D;
+    static NV_PFNGLTEXSTORAGE3DPROC          m_glTexStorage3D;
+    static NV_PFNGLTEXSUBIMAGE3DPROC         m_glTexSubImage3D;
+    static NV_PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC m_glCompressedTexSubImage3D;
+    static NV_PFNGLBUFFERSTORAGEPROC         m_glBufferStorage;
+    static NV_PFNGLMAPBUFFERRANGEPROC        m_glMapBufferRange;
+    static NV_PFNGLUNMAPBUFFERPROC           m_glUnmapBuffer;
+    static NV_PFNGLFENCESYNCPROC             m_glFenceSync;
+    static NV_PFNGLCLIENTWAITSYNCPROC        m_glClientWaitSync;
+    static NV_PFNGLDELETESYNCPROC            m_glDeleteSync;
+    static NV_PFNGLGETTEXTUREHANDLEPROC      m_glGetTextureHandle;
+    static NV_PFNGLTEXTUREHANDLERESIDENTPROC m_glMakeTextureHandleResident;
+    static NV_PFNGLTEXTUREHANDLERESIDENTPROC m_glMakeTextureHandleNonResident;
+
+    const static int32_t MAX_RING_SEGMENTS = 8;
+
+    // ring state
+    GLuint m_ringBuffer;
+    uint8_t* m_ringData;
+    uint32_t m_segmentSize;
+    int32_t m_segmentCount;
+    int32_t m_segment;
+    uint32_t m_segmentOffset;
+    NV_GLsync m_fences[MAX_RING_SEGMENTS];
+    bool m_ringFailed;
+
+    // sampler state
+    uint32_t m_minFilter;
+    uint32_t m_magFilter;
+    uint32_t m_wrap;
+
+    // texture being uploaded
+    GLuint m_texID;
+    GLenum m_target;
+    uint32_t m_flags;
+    bool m_immutable;
+    bool m_streaming;
+};
+
+#endif
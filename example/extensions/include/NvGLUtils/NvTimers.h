@@ -118,7 +118,16 @@ public:
     /// \param[in] api the OpenGL extensions retrieval interface object
     static void globalInit(NvGLExtensionsAPI& api);
 
+    /// Whether #globalInit found timestamp queries; without them the timers
+    /// never produce results
+    /// \return true if GPU timing is available
+    static bool isSupported() {
+        return ms_supported;
+    }
+
 protected:
+    friend class NvGPUFrameTimer;
+
     /// \privatesection
     void getResults() {
         // Make a pass over all timers - if any are pending results ("in flight"), then
@@ -174,6 +183,7 @@ protected:
     static NV_PFNGLQUERYCOUNTERPROC        m_glQueryCounter;
     static NV_PFNGLGETQUERYOBJECTUIVPROC   m_glGetQueryObjectuiv;
     static NV_PFNGLGETQUERYOBJECTUI64VPROC m_glGetQueryObjectui64v;
+    static bool ms_supported;
 
     const static unsigned int TIMER_COUNT = 4;
     enum {
@@ -216,6 +226,98 @@ struct NvGPUTimerScope {
     NvGPUTimer *m_timer;
 };
 
+/// Times whole frames on the GPU, one start/stop pair per frame.  Unlike
+/// NvGPUTimer, which accumulates whatever results happen to be ready, every
+/// frame's queries are read back exactly LATENCY frames after they were
+/// issued, so each result is the time of one known frame.  By then the GPU
+/// has normally finished the frame and the read does not stall; if it has
+/// not, the read waits for it rather than skipping or reusing the queries.
+class NvGPUFrameTimer
+{
+public:
+    /// The number of frames between timing a frame and reading its result
+    const static int32_t LATENCY = 3;
+
+    /// Creates a timer with no frames in flight; need not be called with a
+    /// bound OpenGL context
+    NvGPUFrameTimer()
+    : m_oldest(0)
+    , m_pending(0) {
+        for (int32_t i = 0; i < SLOT_COUNT; i++)
+            m_frames[i] = -1;
+    }
+
+    /// Initializes the OpenGL parts of the timer.  This function must be
+    /// called from a thread that has the OpenGL context to be used bound
+    void init() {
+        NvGPUTimer::m_glGenQueries(SLOT_COUNT * NvGPUTimer::TIMESTAMP_QUERY_COUNT, m_queries[0]);
+    }
+
+    /// Starts timing a frame.  Results that have not been read by now are
+    /// dropped, since their queries are reused.
+    /// This must be called from a thread with the OpenGL context bound
+    /// \param[in] frame the index the result is returned with
+    void start(int32_t frame) {
+        if (!NvGPUTimer::isSupported())
+            return;
+
+        if (m_pending == SLOT_COUNT) {
+            m_oldest = (m_oldest + 1) % SLOT_COUNT;
+            m_pending--;
+        }
+
+        const int32_t slot = (m_oldest + m_pending) % SLOT_COUNT;
+        m_frames[slot] = frame;
+        NvGPUTimer::m_glQueryCounter(m_queries[slot][NvGPUTimer::TIMESTAMP_QUERY_BEGIN], NvGPUTimer::NV_TIMESTAMP);
+    }
+
+    /// Stops timing the frame passed to #start.
+    /// This must be called from a thread with the OpenGL context bound
+    void stop() {
+        if (!NvGPUTimer::isSupported())
+            return;
+
+        const int32_t slot = (m_oldest + m_pending) % SLOT_COUNT;
+        NvGPUTimer::m_glQueryCounter(m_queries[slot][NvGPUTimer::TIMESTAMP_QUERY_END], NvGPUTimer::NV_TIMESTAMP);
+        m_pending++;
+    }
+
+    /// Reads the result of the oldest frame in flight once LATENCY newer
+    /// frames have been stopped, or at any age when flushing, e.g. at the end
+    /// of a benchmark case.  Call in a loop until it returns false.
+    /// This must be called from a thread with the OpenGL context bound
+    /// \param[out] frame the index passed to #start for the frame
+    /// \param[out] ms the GPU time of the frame in milliseconds
+    /// \param[in] flush true to read every frame still in flight
+    /// \return true if a result was read
+    bool getResult(int32_t& frame, float& ms, bool flush = false) {
+        if ((m_pending == 0) || (!flush && (m_pending <= LATENCY)))
+            return false;
+
+        uint64_t timeStart = 0, timeEnd = 0;
+        NvGPUTimer::m_glGetQueryObjectui64v(m_queries[m_oldest][NvGPUTimer::TIMESTAMP_QUERY_BEGIN], NvGPUTimer::NV_QUERY_RESULT, &timeStart);
+        NvGPUTimer::m_glGetQueryObjectui64v(m_queries[m_oldest][NvGPUTimer::TIMESTAMP_QUERY_END], NvGPUTimer::NV_QUERY_RESULT, &timeEnd);
+
+        frame = m_frames[m_oldest];
+        ms = float(double(timeEnd - timeStart) * 1.e-6);
+
+        m_oldest = (m_oldest + 1) % SLOT_COUNT;
+        m_pending--;
+        return true;
+    }
+
+protected:
+    /// \privatesection
+    // one more than LATENCY, so the frame being timed never shares queries
+    // with the one being read
+    const static int32_t SLOT_COUNT = LATENCY + 1;
+
+    GLuint m_queries[SLOT_COUNT][NvGPUTimer::TIMESTAMP_QUERY_COUNT];
+    int32_t m_frames[SLOT_COUNT];
+    int32_t m_oldest;
+    int32_t m_pending;
+};
+
 /// A CPU timer class
 class NvCPUTimer
 {
@@ -57,6 +57,45 @@ struct NvModelPrimType {
     };
 };
 
+/// Post-transform vertex cache statistics of a triangle list.
+struct NvModelCacheStats {
+    NvModelCacheStats() : acmr(0.0f), atvr(0.0f) {}
+    float acmr; ///< average cache miss ratio: vertex shader runs per triangle, 0.5 at best and 3 at worst
+    float atvr; ///< average transform to vertex ratio: vertex shader runs per referenced vertex, 1 at best
+};
+
+/// A range of compiled triangles with the bounds to cull it as a whole.
+struct NvModelCluster {
+    NvModelCluster() : firstIndex(0), indexCount(0), vertexCount(0), radius(0.0f), coneCutoff(1.0f) {}
+    int32_t firstIndex; ///< offset of the first index in the compiled triangle list
+    int32_t indexCount; ///< number of indices, 3 per triangle
+    int32_t vertexCount; ///< number of distinct vertices the triangles use
+    nv::vec3f center; ///< center of the bounding sphere, in model space
+    float radius; ///< radius of the bounding sphere
+    nv::vec3f coneAxis; ///< mean direction of the triangle normals, zero when there is no cone
+    float coneCutoff; ///< sine of the angle from coneAxis to the farthest triangle normal, 1 when there is no cone
+};
+
+/// Storage type of a quantized vertex attribute.
+struct NvModelAttribType {
+    NvModelAttribType() {}
+    enum Enum {
+        NONE = 0, ///< the attribute is not present
+        UNORM16, ///< unsigned 16-bit integers normalized to [0, 1]
+        SNORM16, ///< signed 16-bit integers normalized to [-1, 1]
+        HALF, ///< 16-bit floats
+        UNORM8 ///< unsigned 8-bit integers normalized to [0, 1]
+    };
+};
+
+/// Layout of one attribute within a quantized vertex.
+struct NvModelAttribFormat {
+    NvModelAttribFormat() : type(NvModelAttribType::NONE), size(0), offset(-1) {}
+    NvModelAttribType::Enum type; ///< storage type of each component
+    int32_t size; ///< number of components the attribute is read with
+    int32_t offset; ///< offset in bytes from the start of the vertex, -1 if not present
+};
+
 /// Non-rendering geometry model.
 /// Graphics-API-agnostic geometric model class, including model loading from
 /// OBJ file data, optimization, bounding volumes and rescaling.  
@@ -88,7 +127,9 @@ public:
     ///  combination of position, normal, tex coords, etc that are
     ///  used in the model. The prim parameter, tells the model
     ///  what type of index list to compile. By default it compiles
-    ///  a simple triangle mesh with no connectivity. 
+    ///  a simple triangle mesh with no connectivity. The quantized
+    ///  vertices, levels of detail and clusters of an earlier
+    ///  compilation are discarded.
     /// \param[in] prim the desired primitive type that will be used for rendering;
     /// the target of the compilation operation
     void compileModel( NvModelPrimType::Enum prim = NvModelPrimType::TRIANGLES);
@@ -135,14 +176,16 @@ public:
     /// be used before compiling a model into a HW friendly form.
     /// This can cause model expansion, since it can keep vertices
     /// from being shared.  Thus it should be used only when the results
-    /// are required by the rendering method
+    /// are required by the rendering method.  Large models are processed
+    /// on the shared NvTaskPool, with the same results as the serial path.
     void computeTangents();
 
     /// Compute per-vertex normals.
     /// This function computes vertex normals for a model
     /// which did not have them. It computes them on the raw
     /// data, so it should be done before compiling the model
-    /// into a HW friendly format.
+    /// into a HW friendly format.  Large models are processed on the
+    /// shared NvTaskPool, with the same results as the serial path.
     void computeNormals();
 
     /// Remove zero-area/length primitives.
@@ -256,6 +299,137 @@ public:
 
     int32_t getOpenEdgeCount() const;
 
+    /// Compile a compressed copy of the compiled vertices.
+    /// Positions are stored as 16-bit unsigned normalized offsets within the bounding box,
+    /// to be expanded with getQuantizedPositionScale and getQuantizedPositionBias; normals
+    /// and tangents as 2-component octahedral 16-bit signed normalized vectors; texture
+    /// coordinates as half floats; colors as 8-bit unsigned normalized values.  Each attribute
+    /// starts on a 4-byte boundary.  The w of 4-component positions is not kept.  The float
+    /// vertices are kept as they are.  Call after compileModel and optimizeCompiledModel, both
+    /// of which discard the quantized copy.  Uses the Half library, which applications calling
+    /// this must link.
+    void compileQuantizedVertices();
+
+    /// Get the array of quantized vertices.
+    /// \return the pointer to the start of the first vertex, or NULL if
+    /// compileQuantizedVertices has not been called since the model was compiled
+    const uint8_t* getQuantizedVertices() const;
+
+    /// Get the size of a quantized vertex.
+    /// \return the size of the quantized vertex (in bytes); there are getCompiledVertexCount() of them
+    int32_t getQuantizedVertexSize() const;
+
+    ///@{
+    /// Get the layout of each attrib within the quantized vertex.
+    /// \return the type, component count and byte offset of the attrib
+    NvModelAttribFormat getQuantizedPositionFormat() const;
+    NvModelAttribFormat getQuantizedNormalFormat() const;
+    NvModelAttribFormat getQuantizedTexCoordFormat() const;
+    NvModelAttribFormat getQuantizedTangentFormat() const;
+    NvModelAttribFormat getQuantizedColorFormat() const;
+    ///@}
+
+    ///@{
+    /// Get the transform from quantized to model space positions.
+    /// A model space position is bias + scale * the normalized quantized position
+    /// \return the per-axis scale and bias
+    nv::vec3f getQuantizedPositionScale() const;
+    nv::vec3f getQuantizedPositionBias() const;
+    ///@}
+
+    /// Reorder the compiled model for the GPU.
+    /// Reorders the compiled triangles for the post-transform vertex cache (Forsyth's
+    /// linear-speed optimizer), then splits that order into clusters wherever the cache
+    /// restarts anyway and sorts the clusters so that outward-facing ones draw first,
+    /// which cuts overdraw.  Finally renumbers the compiled vertices in the order the
+    /// triangles first use them, so vertex fetch walks memory forward.  Edge and adjacency
+    /// index lists are kept consistent, and the input triangle order is kept when the optimizer
+    /// cannot beat it.  Best called after compileModel and before computeLods; levels of
+    /// detail computed earlier are kept, with level 0 rewritten to the new triangle order.
+    /// \param[in] cacheSize the FIFO cache size the statistics and clusters are simulated with
+    /// \param[in] overdrawThreshold how much the cluster sort may raise the ACMR over the best
+    /// cache order; at 1 the sort is only kept where it costs no cache misses
+    /// \param[out] before if not NULL, the cache statistics of the triangles as compiled
+    /// \param[out] after if not NULL, the cache statistics of the reordered triangles
+    void optimizeCompiledModel( int32_t cacheSize = 16, float overdrawThreshold = 1.05f,
+        NvModelCacheStats* before = NULL, NvModelCacheStats* after = NULL);
+
+    /// Measure the compiled triangles against a FIFO vertex cache.
+    /// \param[in] cacheSize the number of entries in the simulated cache
+    /// \return the cache statistics of the compiled triangle list
+    NvModelCacheStats getCacheStats( int32_t cacheSize = 16) const;
+
+    /// Generate simplified levels of detail.
+    /// Simplifies the compiled triangle list with quadric error metric edge collapses.
+    /// Every collapse moves a vertex onto one of its neighbors, so all levels index the
+    /// same compiled vertex array; where a position has several compiled vertices (normal
+    /// or texture seams) the one with the closest normal is kept.  Level 0 is the compiled
+    /// triangle list itself.  Must be called after compileModel with TRIANGLES.
+    /// \param[in] lodCount the number of levels wanted, including level 0
+    /// \param[in] reduction the fraction of triangles each level keeps of the level before it
+    /// \return the number of levels generated; fewer than lodCount when the mesh stops
+    /// simplifying before the last level
+    int32_t computeLods( int32_t lodCount, float reduction = 0.5f);
+
+    /// The number of levels of detail.
+    /// \return 1 until computeLods has been called
+    int32_t getLodCount() const;
+
+    /// Get the indices of all levels of detail, back to back.
+    /// Level 0 comes first, so an index buffer made from this array can also be drawn
+    /// as the plain compiled triangle list
+    /// \return pointer to the array of indices
+    const uint32_t* getCompiledLodIndices() const;
+
+    /// The length of the array returned by getCompiledLodIndices.
+    /// \return the number of indices of all levels together
+    int32_t getCompiledLodIndexCount() const;
+
+    ///@{
+    /// Index range of one level within getCompiledLodIndices.
+    /// \param[in] lod the level, from 0 to getLodCount() - 1
+    /// \return the offset of the level's first index and its number of indices
+    int32_t getLodFirstIndex( int32_t lod) const;
+    int32_t getLodIndexCount( int32_t lod) const;
+    ///@}
+
+    /// Geometric error of a level of detail.
+    /// \param[in] lod the level, from 0 to getLodCount() - 1
+    /// \return the root mean square distance, in model units, between the simplified surface
+    /// and the planes of the original triangles, for the worst collapse made so far; 0 for level 0
+    float getLodError( int32_t lod) const;
+
+    /// Group the compiled triangles into clusters for culling.
+    /// Each cluster grows across shared vertices, always taking the triangle that adds
+    /// the fewest vertices and lies closest, until it uses maxVertices distinct vertices
+    /// or holds maxTriangles triangles.  The triangles are then reordered so that every
+    /// cluster is one index range; level 0 of the levels of detail and the adjacency
+    /// list follow.  Call after optimizeCompiledModel, which discards the clusters along
+    /// with compileModel.  Each cluster gets a bounding sphere and a cone around its
+    /// triangle normals: seen from an eye position e, every triangle of the cluster
+    /// faces away when
+    /// dot(center - e, coneAxis) >= coneCutoff * length(center - e) + radius * (1 + coneCutoff)
+    /// \param[in] maxVertices the most distinct vertices of one cluster, at least 3
+    /// \param[in] maxTriangles the most triangles of one cluster
+    /// \return the number of clusters
+    int32_t computeClusters( int32_t maxVertices = 64, int32_t maxTriangles = 124);
+
+    /// The number of clusters.
+    /// \return 0 until computeClusters has been called
+    int32_t getClusterCount() const;
+
+    /// Get the clusters, in the order of their index ranges.
+    /// \return pointer to the array of clusters
+    const NvModelCluster* getClusters() const;
+
+    /// Self-checks of the mesh processing, run on small generated meshes.
+    /// Checks that the parallel normal and tangent paths give bitwise the same results as
+    /// the serial ones, that every cluster sphere contains its triangles and that no eye
+    /// position passing the cluster cone test sees a front-facing triangle of the cluster.
+    /// Failures are logged.
+    /// \return true if every check passed
+    static bool runChecks();
+
 protected:
     /// \privatesection
     static const int32_t NumPrimTypes = 4;
@@ -290,7 +464,38 @@ protected:
 
     int32_t _openEdges;
 
+    //quantized copy of the compiled vertices, empty until compileQuantizedVertices is called
+    std::vector<uint8_t> _qVertices;
+    int32_t _qVtxSize;
+    NvModelAttribFormat _qPosition;
+    NvModelAttribFormat _qNormal;
+    NvModelAttribFormat _qTexCoord;
+    NvModelAttribFormat _qTangent;
+    NvModelAttribFormat _qColor;
+    nv::vec3f _qPosScale;
+    nv::vec3f _qPosBias;
+
+    //levels of detail, empty until computeLods is called
+    std::vector<uint32_t> _lodIndices;
+    std::vector<int32_t> _lodFirstIndex;
+    std::vector<int32_t> _lodIndexCount;
+    std::vector<float> _lodError;
+
+    //clusters of the compiled triangles, empty until computeClusters is called
+    std::vector<NvModelCluster> _clusters;
+
+    //models with at least this many triangles compute normals and tangents in parallel
+    static const int32_t ParallelTriangleCount = 1 << 16;
+
+    void computeTangentsSerial();
+    void computeNormalsSerial();
+    void computeTangentsParallel();
+    void computeNormalsParallel();
+
     static bool loadObjFromFileData( char *fileData, NvModel &m);
+
+    //copies the triangles of indices (or adjacency triangles, with stride 6) in the given order
+    static void gatherTriangles( const std::vector<uint32_t> &indices, const std::vector<uint32_t> &order, uint32_t stride, std::vector<uint32_t> &gathered);
 };
 
 #endif
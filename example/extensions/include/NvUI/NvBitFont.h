@@ -58,6 +58,7 @@
         <li> Optionally embed special escape codes for on-the-fly color or style changes </li>
         <li> Given screen size (and rotation), can automatically re-scale and rotate text output </li>
         <li> Allow overriding the default matrix calc to apply custom transformations to text </li>
+        <li> In NV_USE_FREETYPE builds, render TrueType/OpenType fonts at any size, shaped with HarfBuzz </li>
     </ul>
  */
 
@@ -172,6 +173,9 @@ struct BFVert;
 
     @param count total fonts to load
     @param filename array of two char* .fnt font descriptor files.  In case bold style is supported, second is the bold .fnt variant -- note that the bold.fnt file MUST refer to the same texture/bitmap files as the normal/base did (we only support when bold is embedded in same texture).
+    In builds with NV_USE_FREETYPE defined, a .ttf or .otf file may be given instead, for a dynamic font that is
+    rasterized on demand at any size, and shaped with HarfBuzz so that UTF-8 strings in non-Latin scripts lay out
+    properly.  Bold is then synthesized, and the second filename is ignored.
     @return zero if initialized fine, one if failed anywhere during init process.
  */
 int32_t NvBFInitialize(uint8_t count, const char* filename[][2]);
@@ -362,7 +366,10 @@ public:
     /* @} */
 
 private:
-    void AdjustGlyphsForAlignment();
+    void AdjustGlyphsForAlignment(BFVert *verts);
+    void RebuildDynamicGlyphs(); // only with NV_USE_FREETYPE builds.
+    void NoteAtlasShelf(int32_t shelf, uint32_t generation);
+    void StoreCacheKey(uint32_t key, int32_t keyBytes);
     void TrackOutputLines(float lineWidth);
     void UpdateTextPosition();
 
@@ -374,8 +381,15 @@ protected:
     int32_t m_stringCharsOut; // since string can have escape codes, need a sep count of REAL to output.
     int32_t m_drawnChars; // allowing 'clamping' the number of chars to actually draw.
 
-    BFVert *m_data;
-    uint32_t m_vbo;
+    int32_t m_quadFirst; // first quad of our block in the shared text vertex buffer.
+    int32_t m_quadMax; // size of our block, in quads.
+    uint32_t m_cacheKey; // hash of the font, size, string and style the block was built from.
+    int32_t m_cacheKeyBytes; // those inputs end to end, to confirm a hash match.
+    int32_t m_cacheKeyMax;
+    uint8_t *m_cacheKeyData;
+    uint32_t *m_atlasShelves; // (shelf, generation) of each dynamic font atlas shelf the block draws from.
+    int32_t m_atlasShelfCount;
+    int32_t m_atlasShelfMax;
     
     int32_t m_numLines;
     int32_t m_calcLinesMax; // size of buffers allocated.
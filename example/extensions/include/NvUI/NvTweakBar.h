@@ -38,6 +38,8 @@
 #include "NvUI/NvUI.h"
 #include "NvUI/NvTweakVar.h"
 
+#include <vector>
+
 /** @file NvTweakBar.h
     Implements a UI system for sample applications to display visual widgets
     for interacting with the C variables that control the application, using
@@ -220,6 +222,8 @@ private:
     NvPackedColor m_labelColor;
     NvPackedColor m_valueColor;
 
+    std::vector<NvTweakVarBase*> m_vars; // settable variables, for findVar
+
     NvUIGraphic *MakeFocusFrame();
     NvUIPopup *MakeStdPopup(const char* name, NvTweakEnumVar<uint32_t> &refvar, const NvTweakEnum<uint32_t> values[], uint32_t valueCount, uint32_t actionCode=0);
     NvUIButton *MakeStdButton(const char* name, bool val, NvUIButtonType::Enum type=NvUIButtonType::CHECK, uint32_t code=0, uint32_t subcode=0);
@@ -291,6 +295,14 @@ public:
     */
     void syncValue(NvTweakVarBase* var);
 
+    /** Method to look up a variable added to the Tweakbar by its name.
+        Names are compared with NvTweakNameMatches, so "drawmode" finds "Draw Mode:".
+        Readouts and buttons are not included.
+        @param name The name of the variable.
+        @return the variable, or NULL if there is no such variable.
+    */
+    NvTweakVarBase* findVar(const char* name);
+
     /** Method to request the Tweakbar try to use more compact versions
         of widgets, and spacing between widgets, when possible.
         @param compact Pass in true to enable compact layout logic.
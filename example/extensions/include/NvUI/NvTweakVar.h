@@ -46,6 +46,11 @@
     without any of them knowing directly of the bound variable.
 */
 
+/** Compare two variable or enumerant names, ignoring case and anything that is
+    not a letter or digit, so "Draw Mode:" can be given as "drawmode" on a command line.
+*/
+bool NvTweakNameMatches(const char *name, const char *str);
+
 /** This is an abstract base class for indirectly referencing app variables.
 */
 struct NvTweakVarBase {
@@ -85,6 +90,13 @@ public:
     virtual bool equals(uint32_t val) = 0;
     /** @} */
 
+    /** Set the variable from a string, as given on a command line or in a script.
+        Clamped variables are clamped to their range.
+        @param str The value as text; "true"/"false" or 1/0 for bools.
+        @return false if the string could not be parsed as our type.
+    */
+    virtual bool setFromString(const char *str) = 0;
+
     /** Accessor to retrieve pointer to the name string. */
     const char *getName() { return mName; }
     /** Accessor to retrieve pointer to the description string. */
@@ -209,6 +221,9 @@ public:
     virtual bool equals(float val);
     /** Specific implementation of equals that each templated type must override appropriately. */
     virtual bool equals(uint32_t val);
+
+    /** Specific implementation of setFromString for the templated datatype. */
+    virtual bool setFromString(const char *str);
 };
 
 
@@ -291,6 +306,24 @@ public:
             m_enumIndex--;
         this->mValRef = m_enumVals[m_enumIndex];
     }
+
+    /** Implementation of setFromString that accepts either the name or the value of an enumerant. */
+    virtual bool setFromString(const char *str) {
+        for (uint32_t i=0; i<m_enumValCount; i++) {
+            if (NvTweakNameMatches(m_enumVals[i].m_name, str)) {
+                m_enumIndex = i;
+                this->mValRef = m_enumVals[m_enumIndex];
+                return true;
+            }
+        }
+        if (!NvTweakVar<T>::setFromString(str))
+            return false;
+        for (uint32_t i=0; i<m_enumValCount; i++) {
+            if (m_enumVals[i].m_value == this->mValRef)
+                m_enumIndex = i;
+        }
+        return true;
+    }
 };
 
 
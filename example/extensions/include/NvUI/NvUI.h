@@ -997,10 +997,89 @@ public:
     virtual void Draw(const NvUIDrawState &drawState); // Override parent class drawing
 
 private:
+    void DrawBatched(const NvUIDrawState &drawState, float myAlpha);
     bool StaticInit();
     void StaticCleanup();
 };
 
+//=============================================================================
+//=============================================================================
+class NvUIText;
+/** Collects the textured quads of UI graphics into a single streaming vertex
+    buffer, so that a whole UI hierarchy renders with a few draw calls.
+
+    NvUIWindow opens a batch around the traversal of its children.  While a
+    batch is open, NvUIGraphic and NvUIGraphicFrame transform their quads to
+    clip space on the CPU and queue them instead of drawing.  When the batch is
+    closed, the quads are grouped by texture and blend state, uploaded at once,
+    and drawn with one glDrawElements per group.
+
+    A quad is only moved into an earlier group with the same state if it does
+    not overlap anything queued after that group, so the result is the same as
+    drawing in traversal order.  Text is rendered by NvBitFont outside the batch:
+    NvUIText elements are queued as deferred draws, which keep their place in
+    the order and only hold back the quads they overlap.
+
+    Outside of an open batch, graphics draw immediately as before.
+*/
+class NvUIBatch
+{
+public:
+    /** A vertex of a queued quad. */
+    struct Vertex
+    {
+        float x, y; /**< Clip-space position */
+        float s, t; /**< Texture coordinate */
+        uint8_t color[4]; /**< RGBA modulation color */
+    };
+
+    /** Opens a batch.  Batches nest; only the outermost End draws. */
+    static void Begin();
+    /** Closes a batch, drawing everything queued since the outermost Begin. */
+    static void End();
+    /** Whether a batch is open, and graphics should queue their quads. */
+    static bool IsActive();
+
+    /** Queues quads sharing a texture and blend state.
+        @param texID GL texture object to sample
+        @param blend Whether the quads are alpha-blended
+        @param count Number of quads
+        @param bounds UI-space rectangle covering the quads, used to preserve draw order
+        @return Storage for 4 vertices per quad, to be filled with @ref SetQuad before
+        the next call into the batch.
+    */
+    static Vertex* AddQuads(uint32_t texID, bool blend, int32_t count, const NvUIRect& bounds);
+
+    /** Queues a text element, which is rendered in order when the batch is drawn.
+        @param text The text element, drawn with @ref NvUIText::DrawImmediate
+        @param drawState The draw state to render the text with
+        @param bounds UI-space rectangle covering the rendered text, used to preserve draw order
+    */
+    static void AddText(NvUIText* text, const NvUIDrawState& drawState, const NvUIRect& bounds);
+
+    /** Computes the transform from the unit square to clip space for an element rectangle,
+        matching the pixel-to-clip matrix of the immediate drawing path.
+        @param drawState The current draw state, for the design size and rotation
+        @param rect The element rectangle in UI space
+        @param xform Receives the 2x3 transform as x axis, y axis and origin
+    */
+    static void ComputeTransform(const NvUIDrawState& drawState, const NvUIRect& rect, float xform[6]);
+
+    /** Fills the 4 vertices of a quad.
+        @param v The vertices, as returned by @ref AddQuads
+        @param xform The transform from @ref ComputeTransform
+        @param x0,y0,x1,y1 The quad corners in unit space, y pointing up
+        @param s0,t0,s1,t1 The texture coordinates at the corners
+        @param color The RGBA modulation color
+    */
+    static void SetQuad(Vertex* v, const float xform[6],
+        float x0, float y0, float x1, float y1,
+        float s0, float t0, float s1, float t1, const uint8_t color[4]);
+
+    /** Releases the GL objects of the batch renderer.  Called when the last graphic is destroyed. */
+    static void StaticCleanup();
+};
+
 //=============================================================================
 //=============================================================================
 /** Default font families you may reference.
@@ -1113,9 +1192,13 @@ public:
     /** Override so if a box has been set, we update the width and height with these values. */
     virtual void SetDimensions(float w, float h);
 
-    /** Make proper calls to the text rendering system to draw our text to the viewport. */
+    /** Make proper calls to the text rendering system to draw our text to the viewport.
+        Inside an open NvUIBatch, the text is queued and drawn when the batch is. */
     virtual void Draw(const NvUIDrawState &drawState); // leaf, needs to implement!
 
+    /** Renders our text immediately, regardless of any open NvUIBatch. */
+    void DrawImmediate(const NvUIDrawState &drawState);
+
     /** Set the string to be drawn. */
     void SetString(const char* in);
     /** Set the font size to use for our text. */
@@ -36,6 +36,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 #include <vector>
 
 #include <time.h>
@@ -123,6 +125,7 @@ NvInputCallbacks* sCallbacks = NULL;
 extern void setInputCallbacksGLFW(GLFWwindow *window);
 
 static bool sWindowIsFocused = true;
+static bool sHeadless = false;
 static bool sHasResized = true;
 static int32_t sForcedRenderCount = 0;
 
@@ -336,6 +339,8 @@ int32_t main(int32_t argc, char *argv[])
     // add command line arguments
     for (int i = 1; i < argc; i++) {
         platform->m_commandLine.push_back(argv[i]);
+        if (0 == strcmp(argv[i], "-headless"))
+            sHeadless = true;
     }
 
     sApp = NvAppFactory(platform);
@@ -354,6 +359,12 @@ int32_t main(int32_t argc, char *argv[])
 
     NvGLLinuxAppContext* context = new NvGLLinuxAppContext(config);
 
+    // Headless runs still need a GL context, but never show the window;
+    // NvSampleApp renders them into its offscreen FBO pair instead.  With
+    // Mesa's software rasterizer under Xvfb, this works on GPU-less hosts
+    if (sHeadless)
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
     window = glfwCreateWindow( 1280, 720, "Linux SDK Application", NULL, NULL );
     if (!window)
     {
@@ -432,12 +443,131 @@ bool NvAppBase::showDialog(const char* title, const char *text, bool exitApp) {
         exit(-1);
     return true;
 }
-bool NvAppBase::writeScreenShot(int32_t, int32_t, const uint8_t*, const std::string&) {
-    return false;
+// PNG output with no zlib dependency: the image rows are wrapped in
+// 'stored' (uncompressed) deflate blocks, which every PNG reader accepts
+static uint32_t pngCrc(uint32_t crc, const uint8_t* data, size_t len) {
+    static uint32_t table[256];
+    static bool tableInit = false;
+    if (!tableInit) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[n] = c;
+        }
+        tableInit = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
 }
 
-bool NvAppBase::writeLogFile(const std::string&, bool, const char*, ...) {
-    return false;
+static void pngPutU32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+static void pngPutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    pngPutU32(out, (uint32_t)data.size());
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    pngPutU32(out, pngCrc(0, &out[start], out.size() - start));
+}
+
+bool NvAppBase::writeScreenShot(int32_t width, int32_t height, const uint8_t* data, const std::string& path) {
+    // GL rows are bottom-up, PNG rows are top-down, each prefixed with a
+    // filter type byte (0 = none).  Alpha is dropped, as in the BMP writer
+    const uint32_t rowBytes = width * 3 + 1;
+    const uint32_t rawSize = rowBytes * height;
+    std::vector<uint8_t> raw(rawSize);
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* dest = &raw[y * rowBytes];
+        const uint8_t* src = data + (height - 1 - y) * width * 4;
+        *(dest++) = 0;
+        for (int32_t x = 0; x < width; x++) {
+            *(dest++) = src[0];
+            *(dest++) = src[1];
+            *(dest++) = src[2];
+            src += 4;
+        }
+    }
+
+    // zlib stream of stored blocks, of up to 65535 bytes each
+    std::vector<uint8_t> idat;
+    idat.reserve(2 + rawSize + 5 * (rawSize / 65535 + 1) + 4);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    uint32_t pos = 0;
+    do {
+        const uint32_t len = (rawSize - pos > 65535) ? 65535 : (rawSize - pos);
+        idat.push_back((pos + len == rawSize) ? 1 : 0); // final block flag
+        idat.push_back((uint8_t)len);
+        idat.push_back((uint8_t)(len >> 8));
+        idat.push_back((uint8_t)~len);
+        idat.push_back((uint8_t)(~len >> 8));
+        if (len)
+            idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < rawSize);
+
+    uint32_t a = 1, b = 0;
+    for (uint32_t i = 0; i < rawSize; ) {
+        // 5552 bytes is the most we can sum before the 32-bit b overflows
+        const uint32_t end = (rawSize - i > 5552) ? i + 5552 : rawSize;
+        for (; i < end; i++) {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    pngPutU32(idat, (b << 16) | a);
+
+    std::vector<uint8_t> ihdr;
+    pngPutU32(ihdr, width);
+    pngPutU32(ihdr, height);
+    ihdr.push_back(8); // bit depth
+    ihdr.push_back(2); // color type: RGB
+    ihdr.push_back(0); // compression
+    ihdr.push_back(0); // filter
+    ihdr.push_back(0); // interlace
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> file(signature, signature + 8);
+    pngPutChunk(file, "IHDR", ihdr);
+    pngPutChunk(file, "IDAT", idat);
+    pngPutChunk(file, "IEND", std::vector<uint8_t>());
+
+    std::string filename = path + ".png";
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    const bool written = (fwrite(&file[0], file.size(), 1, fp) == 1);
+    fclose(fp);
+    return written;
+}
+
+bool NvAppBase::writeLogFile(const std::string& path, bool append, const char* fmt, ...) {
+    va_list ap;
+
+    std::string filename = path + ".txt";
+    FILE* fp = fopen(filename.c_str(), append ? "a" : "w");
+    if (!fp)
+        return false;
+
+    va_start(ap, fmt);
+    vfprintf(fp, fmt, ap);
+    fprintf(fp, "\n");
+    va_end(ap);
+
+    fclose(fp);
+    return true;
 }
 
 void NvAppBase::forceLinkHack() {
@@ -0,0 +1,287 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvBenchmark.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Per-frame benchmark statistics */
+#include <NvAppBase/NvBenchmark.h>
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+static const char* s_statNames[] = { "count", "mean", "stddev", "min", "p50", "p95", "p99", "max" };
+
+NvBenchmark::NvBenchmark(int32_t capacity, int32_t warmupFrames) {
+    m_capacity = (capacity > 0) ? capacity : 1;
+    m_warmupFrames = (warmupFrames > 0) ? warmupFrames : 0;
+
+    m_names[0] = "cpuMs";
+    m_names[1] = "gpuMs";
+    m_metricCount = 2;
+    for (int32_t i = 0; i < MAX_METRICS; i++)
+        m_current[i] = 0.0f;
+
+    // everything recordFrame touches is allocated here
+    m_samples = new float[m_capacity * MAX_METRICS];
+    m_scratch = new float[m_capacity];
+    m_frameTags = new int32_t[m_capacity];
+    m_head = 0;
+    m_count = 0;
+    m_warmupLeft = m_warmupFrames;
+    m_started = false;
+    m_keepLog = false;
+}
+
+NvBenchmark::~NvBenchmark() {
+    delete[] m_samples;
+    delete[] m_scratch;
+    delete[] m_frameTags;
+}
+
+int32_t NvBenchmark::addCounter(const char* name) {
+    if (m_started || m_metricCount >= MAX_METRICS)
+        return -1;
+    m_names[m_metricCount] = name;
+    return m_metricCount++;
+}
+
+void NvBenchmark::beginCase(const std::string& label) {
+    m_label = label;
+    m_head = 0;
+    m_count = 0;
+    m_warmupLeft = m_warmupFrames;
+}
+
+bool NvBenchmark::recordFrame(float cpuMs, float gpuMs, int32_t frame) {
+    m_started = true;
+
+    if (m_warmupLeft > 0) {
+        m_warmupLeft--;
+        return false;
+    }
+
+    m_current[0] = cpuMs;
+    m_current[1] = gpuMs;
+    for (int32_t i = 0; i < m_metricCount; i++)
+        m_samples[i * m_capacity + m_head] = m_current[i];
+    m_frameTags[m_head] = frame;
+
+    // the log grows as it goes; it is only kept for offline runs
+    if (m_keepLog) {
+        m_logTags.push_back((int32_t)m_results.size());
+        m_logTags.push_back(frame);
+        m_log.insert(m_log.end(), m_current, m_current + m_metricCount);
+    }
+
+    m_head = (m_head + 1 == m_capacity) ? 0 : m_head + 1;
+    if (m_count < m_capacity)
+        m_count++;
+
+    return m_count == m_capacity;
+}
+
+void NvBenchmark::setGPUTime(int32_t frame, float gpuMs) {
+    if ((m_count == 0) || (frame < 0))
+        return;
+
+    // the frames of a case are recorded back to back, so the slot is as far
+    // behind the newest one as the frame is
+    const int32_t newest = (m_head == 0) ? m_capacity - 1 : m_head - 1;
+    const int32_t back = m_frameTags[newest] - frame;
+    if ((back < 0) || (back >= m_count))
+        return;
+
+    const int32_t slot = (newest - back + m_capacity) % m_capacity;
+    if (m_frameTags[slot] != frame)
+        return;
+
+    m_samples[1 * m_capacity + slot] = gpuMs;
+
+    if (m_keepLog) {
+        const int32_t caseIndex = (int32_t)m_results.size();
+        for (size_t i = m_logTags.size() / 2; i > 0; i--) {
+            const int32_t* tags = &m_logTags[2 * (i - 1)];
+            if ((tags[0] != caseIndex) || (tags[1] < frame))
+                break;
+            if (tags[1] == frame) {
+                m_log[(i - 1) * m_metricCount + 1] = gpuMs;
+                break;
+            }
+        }
+    }
+}
+
+void NvBenchmark::endCase() {
+    CaseResult result;
+    result.label = m_label;
+    result.frames = m_count;
+    for (int32_t i = 0; i < m_metricCount; i++)
+        computeStats(i, result.stats[i]);
+    m_results.push_back(result);
+
+    beginCase("");
+}
+
+void NvBenchmark::computeStats(int32_t metric, Stats& stats) {
+    // negative values mark frames with no value (e.g. the GPU timer had no result)
+    const float* samples = m_samples + metric * m_capacity;
+    int32_t n = 0;
+    double sum = 0.0;
+    for (int32_t i = 0; i < m_count; i++) {
+        if (samples[i] >= 0.0f) {
+            m_scratch[n++] = samples[i];
+            sum += samples[i];
+        }
+    }
+
+    stats.count = n;
+    if (n == 0) {
+        stats.mean = stats.stddev = stats.min = stats.max = 0.0f;
+        stats.p50 = stats.p95 = stats.p99 = 0.0f;
+        return;
+    }
+
+    const double mean = sum / n;
+    double var = 0.0;
+    for (int32_t i = 0; i < n; i++)
+        var += (m_scratch[i] - mean) * (m_scratch[i] - mean);
+
+    std::sort(m_scratch, m_scratch + n);
+
+    // nearest-rank percentiles
+    stats.mean = (float)mean;
+    stats.stddev = (float)sqrt(var / n);
+    stats.min = m_scratch[0];
+    stats.p50 = m_scratch[std::max(0, (int32_t)ceil(0.50 * n) - 1)];
+    stats.p95 = m_scratch[std::max(0, (int32_t)ceil(0.95 * n) - 1)];
+    stats.p99 = m_scratch[std::max(0, (int32_t)ceil(0.99 * n) - 1)];
+    stats.max = m_scratch[n - 1];
+}
+
+static void writeJSONString(FILE* fp, const std::string& str) {
+    fputc('"', fp);
+    for (size_t i = 0; i < str.size(); i++) {
+        const char c = str[i];
+        if (c == '"' || c == '\\')
+            fputc('\\', fp);
+        if ((unsigned char)c >= 0x20)
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+bool NvBenchmark::writeJSON(const std::string& path) const {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "{\n  \"warmupFrames\": %d,\n  \"cases\": [", m_warmupFrames);
+    for (size_t c = 0; c < m_results.size(); c++) {
+        const CaseResult& result = m_results[c];
+        fprintf(fp, "%s\n    {\n      \"label\": ", c ? "," : "");
+        writeJSONString(fp, result.label);
+        fprintf(fp, ",\n      \"frames\": %d", result.frames);
+        for (int32_t i = 0; i < m_metricCount; i++) {
+            const Stats& s = result.stats[i];
+            fprintf(fp, ",\n      ");
+            writeJSONString(fp, m_names[i]);
+            fprintf(fp, ": { \"count\": %d, \"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f, "
+                "\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+                s.count, s.mean, s.stddev, s.min, s.p50, s.p95, s.p99, s.max);
+        }
+        fprintf(fp, "\n    }");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    return fclose(fp) == 0;
+}
+
+bool NvBenchmark::writeCSV(const std::string& path) const {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    const int32_t statCount = sizeof(s_statNames) / sizeof(s_statNames[0]);
+
+    fprintf(fp, "label,frames");
+    for (int32_t i = 0; i < m_metricCount; i++) {
+        for (int32_t j = 0; j < statCount; j++)
+            fprintf(fp, ",%s_%s", m_names[i].c_str(), s_statNames[j]);
+    }
+    fprintf(fp, "\n");
+
+    for (size_t c = 0; c < m_results.size(); c++) {
+        const CaseResult& result = m_results[c];
+        // labels are quoted, with quotes doubled
+        fputc('"', fp);
+        for (size_t k = 0; k < result.label.size(); k++) {
+            if (result.label[k] == '"')
+                fputc('"', fp);
+            fputc(result.label[k], fp);
+        }
+        fprintf(fp, "\",%d", result.frames);
+        for (int32_t i = 0; i < m_metricCount; i++) {
+            const Stats& s = result.stats[i];
+            fprintf(fp, ",%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f",
+                s.count, s.mean, s.stddev, s.min, s.p50, s.p95, s.p99, s.max);
+        }
+        fprintf(fp, "\n");
+    }
+
+    return fclose(fp) == 0;
+}
+
+bool NvBenchmark::writeFrameLog(const std::string& path) const {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    // case labels are listed up front so the rows stay plain numbers
+    for (size_t c = 0; c < m_results.size(); c++)
+        fprintf(fp, "# case %d: %s\n", (int32_t)c, m_results[c].label.c_str());
+
+    fprintf(fp, "# case frame");
+    for (int32_t i = 0; i < m_metricCount; i++)
+        fprintf(fp, " %s", m_names[i].c_str());
+    fprintf(fp, "\n");
+
+    const size_t rows = m_logTags.size() / 2;
+    for (size_t r = 0; r < rows; r++) {
+        fprintf(fp, "%d %d", m_logTags[2 * r], m_logTags[2 * r + 1]);
+        for (int32_t i = 0; i < m_metricCount; i++)
+            fprintf(fp, " %.4f", m_log[r * m_metricCount + i]);
+        fprintf(fp, "\n");
+    }
+
+    return fclose(fp) == 0;
+}
@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvMathBenchmark.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Microbenchmarks for the matrix library */
+#include <NvAppBase/NvMathBenchmark.h>
+#include <NvAppBase/NvBenchmark.h>
+#include <NV/NvLogs.h>
+#include <NV/NvMath.h>
+#include <NV/NvStopWatch.h>
+
+#include <vector>
+
+struct MathBenchData {
+    int32_t count;
+    std::vector<nv::matrix4f> matrices;
+    std::vector<nv::matrix4f> matrixResults;
+    std::vector<nv::vec4f> vectors;
+    std::vector<nv::vec4f> vectorResults;
+    std::vector<nv::vec3f> points;
+    std::vector<nv::vec3f> pointResults;
+};
+
+typedef void (*MathBenchOp)(MathBenchData& d);
+
+static void benchMultiply(MathBenchData& d) {
+    for (int32_t i = 0; i < d.count; i++)
+        d.matrixResults[i] = d.matrices[i] * d.matrices[d.count - 1 - i];
+}
+
+static void benchInverse(MathBenchData& d) {
+    for (int32_t i = 0; i < d.count; i++)
+        d.matrixResults[i] = nv::inverse(d.matrices[i]);
+}
+
+static void benchTranspose(MathBenchData& d) {
+    for (int32_t i = 0; i < d.count; i++)
+        d.matrixResults[i] = nv::transpose(d.matrices[i]);
+}
+
+static void benchMatrixVector(MathBenchData& d) {
+    for (int32_t i = 0; i < d.count; i++)
+        d.vectorResults[i] = d.matrices[i] * d.vectors[i];
+}
+
+static void benchMultiplyMatrices(MathBenchData& d) {
+    nv::multiplyMatrices(d.matrices[0], &d.matrices[0], &d.matrixResults[0], d.count);
+}
+
+static void benchTransformPoints(MathBenchData& d) {
+    nv::transformPoints(d.matrices[0], &d.points[0], &d.pointResults[0], d.count);
+}
+
+static void benchTransformVectors(MathBenchData& d) {
+    nv::transformVectors(d.matrices[0], &d.vectors[0], &d.vectorResults[0], d.count);
+}
+
+struct MathBenchCase {
+    const char* name;
+    MathBenchOp op;
+};
+
+static const MathBenchCase s_cases[] = {
+    { "matrix4f * matrix4f", benchMultiply },
+    { "inverse", benchInverse },
+    { "transpose", benchTranspose },
+    { "matrix4f * vec4f", benchMatrixVector },
+    { "multiplyMatrices", benchMultiplyMatrices },
+    { "transformPoints", benchTransformPoints },
+    { "transformVectors", benchTransformVectors },
+};
+
+// read back the results so the compiler cannot drop the work
+static volatile float s_sink;
+
+static void consume(const MathBenchData& d) {
+    float sum = 0.0f;
+    for (int32_t i = 0; i < d.count; i++)
+        sum += d.matrixResults[i]._11 + d.vectorResults[i].x + d.pointResults[i].x;
+    s_sink = sum;
+}
+
+void NvRunMathBenchmarks(NvBenchmark& bench, NvStopWatch* timer, int32_t batchSize) {
+    MathBenchData d;
+    d.count = (batchSize > 0) ? batchSize : 1;
+    d.matrices.resize(d.count);
+    d.matrixResults.resize(d.count);
+    d.vectors.resize(d.count);
+    d.vectorResults.resize(d.count);
+    d.points.resize(d.count);
+    d.pointResults.resize(d.count);
+
+    // scaled, rotated and translated, like object world matrices
+    for (int32_t i = 0; i < d.count; i++) {
+        const float f = (float)i / (float)d.count;
+        nv::matrix4f scale;
+        scale.set_scale(0.5f + f);
+        nv::rotationYawPitchRoll(d.matrices[i], f * NV_PI, f * 0.5f * NV_PI, f * 0.25f * NV_PI);
+        d.matrices[i] *= scale;
+        d.matrices[i].set_translate(nv::vec3f(f, 2.0f * f, -f));
+        d.points[i] = nv::vec3f(f, 1.0f - f, 0.5f * f);
+        d.vectors[i] = nv::vec4f(d.points[i], 1.0f);
+    }
+
+    const int32_t caseCount = sizeof(s_cases) / sizeof(s_cases[0]);
+    for (int32_t c = 0; c < caseCount; c++) {
+        bench.beginCase(std::string(s_cases[c].name) + " (" NV_MATH_SIMD_NAME ")");
+
+        bool full = false;
+        while (!full) {
+            timer->reset();
+            timer->start();
+            s_cases[c].op(d);
+            timer->stop();
+            full = bench.recordFrame(timer->getTime() * 1000.0f, -1.0f);
+        }
+        consume(d);
+
+        bench.endCase();
+
+        const NvBenchmark::CaseResult& result = bench.getResults().back();
+        const float nsPerOp = 1.0e6f / (float)d.count;
+        LOGI("%s: %d batches of %d, ns per op: mean %.2f p50 %.2f p95 %.2f min %.2f",
+            result.label.c_str(), result.frames, d.count,
+            result.stats[0].mean * nsPerOp, result.stats[0].p50 * nsPerOp,
+            result.stats[0].p95 * nsPerOp, result.stats[0].min * nsPerOp);
+    }
+}
@@ -34,19 +34,93 @@
 #include "NvAppBase/NvSampleApp.h"
 #include "NV/NvLogs.h"
 #include "NV/NvPlatformGL.h"
+#include "NvAppBase/NvBenchmark.h"
+#include "NvAppBase/NvFramePacket.h"
 #include "NvAppBase/NvFramerateCounter.h"
 #include "NvAppBase/NvInputTransformer.h"
+#include "NvAppBase/NvMathBenchmark.h"
+#include "NvGLUtils/NvGLSLProgram.h"
 #include "NvGLUtils/NvImage.h"
 #include "NvGLUtils/NvSimpleFBO.h"
 #include "NvGLUtils/NvTimers.h"
+#include "NvGLUtils/NvTextureUploader.h"
 #include "NvUI/NvGestureDetector.h"
 #include "NvUI/NvTweakBar.h"
+#include "NV/NvSPSCQueue.h"
 #include "NV/NvString.h"
+#include "NV/NvThread.h"
 #include "NV/NvTokenizer.h"
 
+#include <errno.h>
 #include <stdarg.h>
+#include <iomanip>
 #include <sstream>
 
+#ifdef WIN32
+#include <direct.h>
+#define NV_MKDIR(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define NV_MKDIR(path) mkdir(path, 0755)
+#endif
+
+// Transformer input recorded on the main thread for the simulation thread
+struct NvSampleApp::SimulationInput {
+    enum Type { POINTER, KEY, GAMEPAD, RESIZE };
+    static const int32_t MAX_POINTS = 4;
+
+    Type type;
+    NvInputDeviceType::Enum device;
+    NvPointerActionType::Enum pointerAction;
+    uint32_t modifiers;
+    int32_t count;
+    NvPointerEvent points[MAX_POINTS];
+    uint32_t code;
+    NvKeyActionType::Enum keyAction;
+    uint32_t padFlags;
+    NvGamepad::State pads[NvGamepad::MAX_GAMEPADS];
+    int32_t width;
+    int32_t height;
+};
+
+// Hands gamepad state sampled on the main thread to NvInputTransformer::processGamepad
+class NvRecordedGamepad : public NvGamepad {
+public:
+    NvRecordedGamepad(const NvGamepad::State* states) : m_states(states) { }
+
+    virtual bool getState(int32_t padID, State& state) {
+        if (padID < 0 || padID >= MAX_GAMEPADS)
+            return false;
+        state = m_states[padID];
+        return true;
+    }
+    virtual void setMaxGamepadCount(int32_t max) { }
+    virtual int32_t getMaxGamepadCount() { return MAX_GAMEPADS; }
+
+private:
+    const NvGamepad::State* m_states;
+};
+
+// State shared between the render (main) thread and the simulation thread.
+// Packets and input move through lock-free queues; the signals are only
+// used to sleep while a queue is empty or full.
+struct NvSampleApp::Simulation {
+    static const uint32_t INPUT_QUEUE_SIZE = 256;
+
+    NvSampleApp* app;
+    NvThread thread;
+    NvSignal packetReady; // set by the simulation thread when a packet is published
+    NvSignal slotFree; // set by the render thread when a packet is released
+    NvSPSCQueue<NvFramePacket, NvFramePacket::SLOT_COUNT> packets;
+    NvSPSCQueue<SimulationInput, INPUT_QUEUE_SIZE> input;
+    NvInputTransformer transformer; // only touched by the simulation thread while it runs
+    NvStopWatch* stepTimer;
+    bool fixedStep;
+    int64_t frame;
+    double time;
+    volatile uint32_t quit;
+};
+
 NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) : 
     NvAppBase(platform, appTitle)
     , mFramerate(0L)
@@ -67,6 +141,19 @@ NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) :
     , mTestMode(false)
     , mTestDuration(0.0f)
     , mTestRepeatFrames(1)
+    , mHeadless(false)
+    , mFrameLimit(0)
+    , mBenchmark(NULL)
+    , mBenchGPUTimer(NULL)
+    , mBenchFrames(0)
+    , mBenchWarmup(-1)
+    , mBenchCase(-1)
+    , mBenchCaseCount(1)
+    , mMathBench(false)
+    , mDXTBench(false)
+    , mThreaded(false)
+    , mPaceInterval(0.0f)
+    , mSimulation(NULL)
     , m_testModeIssues(TEST_MODE_ISSUE_NONE)
 {
     m_transformer = new NvInputTransformer;
@@ -83,6 +170,13 @@ NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) :
     mFBOPair[0] = NULL;
     mFBOPair[1] = NULL;
 
+    mSerialPacket = new NvFramePacket;
+    mSerialPacket->frame = 0;
+    mSerialPacket->slot = 0;
+    mSerialPacket->delta = 0.0f;
+    mSerialPacket->time = 0.0;
+    mFramePacket = mSerialPacket;
+
     const std::vector<std::string>& cmd = platform->getCommandLine();
     std::vector<std::string>::const_iterator iter = cmd.begin();
 
@@ -108,9 +202,134 @@ NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) :
             std::stringstream(*iter) >> m_fboWidth;
             iter++;
             std::stringstream(*iter) >> m_fboHeight;
+        } else if (0==(*iter).compare("-headless")) {
+            mHeadless = true;
+        } else if (0==(*iter).compare("-frames")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-frames expects a frame count");
+                break;
+            }
+            iter++;
+            std::stringstream(*iter) >> mFrameLimit;
+        } else if (0==(*iter).compare("-capture")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-capture expects a directory");
+                break;
+            }
+            iter++;
+            mCaptureDir = (*iter); // both std::string
+        } else if (0==(*iter).compare("-threaded")) {
+            mThreaded = true;
+        } else if (0==(*iter).compare("-targetfps")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-targetfps expects a frame rate");
+                break;
+            }
+            iter++;
+            float fps = 0.0f;
+            std::stringstream(*iter) >> fps;
+            mPaceInterval = (fps > 0.0f) ? (1.0f / fps) : 0.0f;
+        } else if (0==(*iter).compare("-bench")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-bench expects a frame count");
+                break;
+            }
+            iter++;
+            std::stringstream(*iter) >> mBenchFrames;
+        } else if (0==(*iter).compare("-warmup")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-warmup expects a frame count");
+                break;
+            }
+            iter++;
+            std::stringstream(*iter) >> mBenchWarmup;
+        } else if (0==(*iter).compare("-benchout")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-benchout expects a file name");
+                break;
+            }
+            iter++;
+            mBenchOut = (*iter); // both std::string
+        } else if (0==(*iter).compare("-sweep")) {
+            if (iter + 1 == cmd.end()) {
+                LOGE("-sweep expects var=value,value,...");
+                break;
+            }
+            // var=a,b,c
+            iter++;
+            const std::string& spec = *iter;
+            const size_t eq = spec.find('=');
+            if (eq != std::string::npos && eq + 1 < spec.size()) {
+                BenchmarkSweep sweep;
+                sweep.name = spec.substr(0, eq);
+                size_t start = eq + 1;
+                while (start <= spec.size()) {
+                    size_t comma = spec.find(',', start);
+                    if (comma == std::string::npos)
+                        comma = spec.size();
+                    if (comma > start)
+                        sweep.values.push_back(spec.substr(start, comma - start));
+                    start = comma + 1;
+                }
+                if (!sweep.values.empty()) {
+                    mBenchCaseCount *= (int32_t)sweep.values.size();
+                    mBenchSweeps.push_back(sweep);
+                }
+            } else {
+                LOGE("-sweep expects var=value,value,... but got %s", spec.c_str());
+            }
+        } else if (0==(*iter).compare("-mathbench")) {
+            mMathBench = true;
+        } else if (0==(*iter).compare("-benchmarkdxt")) {
+            mDXTBench = true;
         }
         iter++;
     }
+
+    // the platform hides the window when headless, and the contents of a
+    // hidden window's framebuffer are undefined, so render offscreen.
+    if (mHeadless && !mUseFBOPair) {
+        mUseFBOPair = true;
+        m_fboWidth = m_desiredWidth ? m_desiredWidth : 1280;
+        m_fboHeight = m_desiredHeight ? m_desiredHeight : 720;
+    }
+
+    // the captures and the default benchmark output are written into the
+    // directory, so it has to exist before the first frame
+    if (!mCaptureDir.empty() && NV_MKDIR(mCaptureDir.c_str()) != 0 && errno != EEXIST)
+        LOGE("Could not create capture directory %s", mCaptureDir.c_str());
+
+    // frame statistics are kept whenever the run is scripted.  -bench runs a
+    // fixed number of frames per case; otherwise there is one case that the ring
+    // buffer covers the end of.
+    if (mTestMode || (mFrameLimit > 0) || (mBenchFrames > 0)) {
+        int32_t capacity = BENCHMARK_RING_FRAMES;
+        if (mBenchFrames > 0)
+            capacity = mBenchFrames;
+        else if (mFrameLimit > 0)
+            capacity = mFrameLimit;
+
+        if (mBenchWarmup < 0)
+            mBenchWarmup = (mTestMode || (mBenchFrames > 0)) ? TESTMODE_WARMUP_FRAMES : 0;
+
+        if (mBenchOut.empty()) {
+            if (mTestMode)
+                mBenchOut = mTestName;
+            else if (!mCaptureDir.empty())
+                mBenchOut = mCaptureDir + "/benchmark";
+            else
+                mBenchOut = "benchmark";
+        }
+
+        mBenchmark = new NvBenchmark(capacity, mBenchWarmup);
+        if (!mCaptureDir.empty())
+            mBenchmark->setKeepFrameLog(true);
+    }
+
+    if (mMathBench)
+        runMathBenchmark();
+    if (mDXTBench)
+        runDXTBenchmark();
     NvCPUTimer::globalInit(this);
 }
 
@@ -121,6 +340,12 @@ NvSampleApp::~NvSampleApp()
     delete mEventTickTimer;
     delete mAutoRepeatTimer;
 
+    delete mBenchmark;
+    delete mBenchGPUTimer;
+
+    stopSimulation();
+    delete mSerialPacket;
+
     delete m_transformer;
 }
 
@@ -130,6 +355,14 @@ void NvSampleApp::baseInitRendering(void) {
     LOGI("GL_VENDOR     = %s", (char *) glGetString(GL_VENDOR));
 
     NvGPUTimer::globalInit(*getGLContext());
+    NvTextureUploader::globalInit(*getGLContext());
+    NvGLSLProgram::globalInit(*getGLContext());
+
+    if (mBenchmark) {
+        delete mBenchGPUTimer;
+        mBenchGPUTimer = new NvGPUFrameTimer;
+        mBenchGPUTimer->init();
+    }
 
     if (mUseFBOPair) {
         // clear the main framebuffer to black for later testing
@@ -261,12 +494,23 @@ void NvSampleApp::baseReshape(int32_t w, int32_t h) {
         mUIWindow->HandleReshape((float)w, (float)h);
 
     m_transformer->setScreenSize(w, h);
+    if (mSimulation) {
+        SimulationInput input;
+        input.type = SimulationInput::RESIZE;
+        input.width = w;
+        input.height = h;
+        queueSimulationInput(input);
+    }
 
     reshape(w, h);
 }
 
 void NvSampleApp::baseUpdate(void) {
-    update();
+    // serial model: the simulation steps on the main thread, just before drawing
+    mSerialPacket->frame++;
+    mSerialPacket->delta = mFrameDelta;
+    mSerialPacket->time += mFrameDelta;
+    simulate(*mSerialPacket);
 }
 
 void NvSampleApp::baseDraw(void) {
@@ -387,7 +631,16 @@ bool NvSampleApp::pointerInput(NvInputDeviceType::Enum device, NvPointerActionTy
     // TODO: might add support for passing gesture events instead.
     if (handlePointerInput(device, action, modifiers, count, points))
         return true;
-    else
+    else if (mSimulation) {
+        SimulationInput input;
+        input.type = SimulationInput::POINTER;
+        input.device = device;
+        input.pointerAction = action;
+        input.modifiers = modifiers;
+        input.count = (count < SimulationInput::MAX_POINTS) ? count : SimulationInput::MAX_POINTS;
+        memcpy(input.points, points, input.count * sizeof(NvPointerEvent));
+        return queueSimulationInput(input);
+    } else
         return m_transformer->processPointer(device, action, modifiers, count, points);
 }
 
@@ -514,6 +767,13 @@ bool NvSampleApp::keyInput(uint32_t code, NvKeyActionType::Enum action) {
         return true;
 
     // give last shot to transformer.
+    if (mSimulation) {
+        SimulationInput input;
+        input.type = SimulationInput::KEY;
+        input.code = code;
+        input.keyAction = action;
+        return queueSimulationInput(input);
+    }
     return m_transformer->processKey(code, action);
 }
 
@@ -696,6 +956,16 @@ bool NvSampleApp::gamepadChanged(uint32_t changedPadFlags) {
     }
 
     // give last shot to transformer.  not sure how we 'consume' input though.
+    if (mSimulation) {
+        SimulationInput input;
+        input.type = SimulationInput::GAMEPAD;
+        input.padFlags = changedPadFlags;
+        for (i = 0; i < NvGamepad::MAX_GAMEPADS; i++) {
+            if (changedPadFlags & (1<<i))
+                pad->getState(i, input.pads[i]);
+        }
+        return queueSimulationInput(input);
+    }
     return m_transformer->processGamepad(changedPadFlags, *pad);
 }
 
@@ -706,6 +976,11 @@ void NvSampleApp::mainLoop() {
     int32_t testModeFrames = -TESTMODE_WARMUP_FRAMES;
     float totalTime = -1e6f; // don't exit during startup
 
+    // scripted runs step time at a fixed rate and skip the UI, so that
+    // frame N always renders the same image
+    const bool fixedStep = mTestMode || (mFrameLimit > 0) || (mBenchFrames > 0);
+    int32_t framesRendered = 0;
+
     if (mTestMode) {
         writeLogFile(mTestName, false, "*** Starting Test\n");
     }
@@ -718,6 +993,9 @@ void NvSampleApp::mainLoop() {
     mDrawTimeFrames = 0;
     mDrawRate = 0.0f;
     NvStopWatch* drawTime = createStopWatch();
+    NvStopWatch* captureTime = createStopWatch();
+    NvStopWatch* paceTimer = createStopWatch();
+    paceTimer->start();
 
     // TBD - WAR for Android lifecycle change; this will be reorganized in the next release
 #ifdef ANDROID
@@ -731,7 +1009,9 @@ void NvSampleApp::mainLoop() {
 
         NvPlatformContext* ctx = getPlatformContext();
 
-        baseUpdate();
+        // with a simulation thread, the step for this frame is already done
+        if (!mSimulation)
+            baseUpdate();
 
         // If the context has been lost and graphics resources are still around,
         // signal for them to be deleted
@@ -769,9 +1049,24 @@ void NvSampleApp::mainLoop() {
                 baseReshape(getGLContext()->width(), getGLContext()->height());
             }
 
+            // the first case is set up once the tweakbar exists, so sweeps can find their variables
+            if (mBenchmark && (mBenchCase < 0) && !isExiting())
+                beginBenchmarkCase(0);
+
+            // the simulation thread starts from the state that initialization left
+            if (mThreaded && !mSimulation && !isExiting()) {
+                if (!supportsThreadedUpdate()) {
+                    LOGI("-threaded: this app does not support threaded update, running serially");
+                    mThreaded = false;
+                } else if (!startSimulation()) {
+                    LOGE("-threaded: could not start the simulation thread, running serially");
+                    mThreaded = false;
+                }
+            }
+
             mFrameTimer->stop();
 
-            if (mTestMode) {
+            if (fixedStep) {
                 // Simulate 60fps
                 mFrameDelta = 1.0f / 60.0f;
 
@@ -782,7 +1077,8 @@ void NvSampleApp::mainLoop() {
                 // just an estimate
                 totalTime += mFrameDelta;
             }
-            m_transformer->update(mFrameDelta);
+            if (!mSimulation)
+                m_transformer->update(mFrameDelta);
             mFrameTimer->reset();
 
             // initialization may cause the app to want to exit
@@ -805,11 +1101,27 @@ void NvSampleApp::mainLoop() {
                     }
                 }
 
+                // draw the step the simulation thread finished last; it moves
+                // on to the next one while this frame renders
+                NvFramePacket* packet = NULL;
+                if (mSimulation) {
+                    while ((packet = mSimulation->packets.beginRead()) == NULL)
+                        mSimulation->packetReady.wait();
+                    *m_transformer = packet->transformer;
+                    mFrameDelta = packet->delta;
+                    mFramePacket = packet;
+                }
+
+                // only timed while statistics are being recorded
+                NvGPUFrameTimer* gpuTimer = mBenchmark ? mBenchGPUTimer : NULL;
+
                 drawTime->start();
+                if (gpuTimer)
+                    gpuTimer->start(framesRendered);
 
                 baseDraw();
                 CHECK_GL_ERROR(); // sanity catch errors
-                if (!mTestMode) {
+                if (!fixedStep) {
                     baseDrawUI();
                     CHECK_GL_ERROR(); // sanity catch errors
                 }
@@ -817,8 +1129,10 @@ void NvSampleApp::mainLoop() {
                 if (mTestMode && (mTestRepeatFrames > 1)) {
                     // repeat frame so that we can simulate a heavier workload
                     for (int i = 1; i < mTestRepeatFrames; i++) {
-                        baseUpdate();
-                        m_transformer->update(mFrameDelta);
+                        if (!mSimulation) {
+                            baseUpdate();
+                            m_transformer->update(mFrameDelta);
+                        }
                         baseDraw();
                     }
                 }
@@ -834,10 +1148,44 @@ void NvSampleApp::mainLoop() {
                         m_testModeIssues |= TEST_MODE_FBO_ISSUE;
                 }
 
+                if (gpuTimer)
+                    gpuTimer->stop();
+
+                // capture before the swap; the readback is not counted as draw time.
+                float captureSecs = 0.0f;
+                if (!mCaptureDir.empty()) {
+                    captureTime->start();
+                    captureFrame(framesRendered);
+                    captureTime->stop();
+                    captureSecs = captureTime->getTime();
+                }
+
                 SwapBuffers();
 
+                if (packet) {
+                    mSimulation->packets.endRead();
+                    mSimulation->slotFree.set();
+                }
+
                 drawTime->stop();
-                mSumDrawTime += drawTime->getTime();
+                mSumDrawTime += drawTime->getTime() - captureSecs;
+                if (mBenchmark && (mBenchCase >= 0) && (mBenchCase < mBenchCaseCount)) {
+                    const float cpuMs = (drawTime->getTime() - captureSecs) * 1000.0f;
+                    // the GPU time is filled in once its result is read back,
+                    // NvGPUFrameTimer::LATENCY frames later
+                    const bool caseDone = mBenchmark->recordFrame(cpuMs, -1.0f, framesRendered) && (mBenchFrames > 0);
+                    readBenchmarkGPUTimes(caseDone);
+                    if (caseDone) {
+                        mBenchmark->endCase();
+                        if (!beginBenchmarkCase(mBenchCase + 1)) {
+                            // test mode still runs for its duration and logs at the end
+                            if (!mTestMode) {
+                                finishBenchmark();
+                                appRequestExit();
+                            }
+                        }
+                    }
+                }
                 drawTime->reset();
 
                 mDrawTimeFrames++;
@@ -854,6 +1202,15 @@ void NvSampleApp::mainLoop() {
                     LOGI("fps: %.2f", mFramerate->getMeanFramerate());
 #endif
                 }
+
+                framesRendered++;
+                if ((mFrameLimit > 0) && (framesRendered >= mFrameLimit)) {
+                    finishBenchmark();
+                    appRequestExit();
+                }
+
+                if (mPaceInterval > 0.0f)
+                    paceFrame(paceTimer);
             }
 
             if (mTestMode) {
@@ -868,6 +1225,7 @@ void NvSampleApp::mainLoop() {
                     testModeTimer->stop();
                     double frameRate = testModeFrames / testModeTimer->getTime();
                     logTestResults((float)frameRate, testModeFrames);
+                    stopSimulation();
                     exit(0);
 //                    appRequestExit();
                 }
@@ -883,6 +1241,11 @@ void NvSampleApp::mainLoop() {
     // mainloop exiting, clean up things created in mainloop lifespan.
     delete mFramerate;
     mFramerate = NULL;
+
+    delete drawTime;
+    delete captureTime;
+    delete paceTimer;
+    delete testModeTimer;
 }
 
 bool NvSampleApp::requireExtension(const char* ext, bool exitOnFailure) {
@@ -968,9 +1331,14 @@ void NvSampleApp::SwapBuffers() {
 }
 
 void NvSampleApp::baseShutdownRendering(void) {
+    stopSimulation();
+
     delete mFBOPair[0];
     delete mFBOPair[1];
 
+    delete mBenchGPUTimer;
+    mBenchGPUTimer = NULL;
+
     // clean up UI elements.
     delete mUIWindow; // note it holds all our UI, so just null other ptrs.
     mUIWindow = NULL;
@@ -981,9 +1349,289 @@ void NvSampleApp::baseShutdownRendering(void) {
     shutdownRendering();
 }
 
+bool NvSampleApp::startSimulation() {
+    Simulation* sim = new Simulation;
+    sim->app = this;
+    sim->transformer = *m_transformer;
+    sim->stepTimer = createStopWatch();
+    sim->fixedStep = mTestMode || (mFrameLimit > 0) || (mBenchFrames > 0);
+    sim->frame = 0;
+    sim->time = 0.0;
+    sim->quit = 0;
+
+    sim->stepTimer->start();
+    if (!sim->thread.start(simulationThread, sim)) {
+        delete sim->stepTimer;
+        delete sim;
+        return false;
+    }
+
+    mSimulation = sim;
+    return true;
+}
+
+void NvSampleApp::stopSimulation() {
+    if (!mSimulation)
+        return;
+
+    NvStoreRelease(&mSimulation->quit, 1);
+    mSimulation->slotFree.set();
+    mSimulation->thread.join();
+
+    // the main thread owns the camera again
+    *m_transformer = mSimulation->transformer;
+    mFramePacket = mSerialPacket;
+
+    delete mSimulation->stepTimer;
+    delete mSimulation;
+    mSimulation = NULL;
+}
+
+bool NvSampleApp::queueSimulationInput(const SimulationInput& input) {
+    SimulationInput* slot = mSimulation->input.beginWrite();
+    if (!slot) {
+        LOGE("Simulation input queue is full, dropping input");
+        return false;
+    }
+    *slot = input;
+    mSimulation->input.endWrite();
+    return true;
+}
+
+void NvSampleApp::simulationThread(void* data) {
+    Simulation* sim = (Simulation*)data;
+
+    while (!NvLoadAcquire(&sim->quit)) {
+        // apply the input recorded since the last step
+        for (SimulationInput* in; (in = sim->input.beginRead()) != NULL; sim->input.endRead()) {
+            switch (in->type) {
+                case SimulationInput::POINTER:
+                    sim->transformer.processPointer(in->device, in->pointerAction, in->modifiers, in->count, in->points);
+                    break;
+                case SimulationInput::KEY:
+                    sim->transformer.processKey(in->code, in->keyAction);
+                    break;
+                case SimulationInput::GAMEPAD: {
+                    NvRecordedGamepad pad(in->pads);
+                    sim->transformer.processGamepad(in->padFlags, pad);
+                    break;
+                }
+                case SimulationInput::RESIZE:
+                    sim->transformer.setScreenSize(in->width, in->height);
+                    break;
+            }
+        }
+
+        // both packets in use: one is being drawn and the other is waiting to be
+        NvFramePacket* packet = sim->packets.beginWrite();
+        if (!packet) {
+            sim->slotFree.wait();
+            continue;
+        }
+
+        float delta = sim->stepTimer->getTime();
+        sim->stepTimer->start();
+        if (sim->fixedStep)
+            delta = 1.0f / 60.0f;
+
+        packet->frame = ++sim->frame;
+        packet->slot = (int32_t)sim->packets.getWriteSlot();
+        packet->delta = delta;
+        sim->time += delta;
+        packet->time = sim->time;
+
+        sim->transformer.update(delta);
+        sim->app->simulate(*packet);
+        packet->transformer = sim->transformer;
+
+        sim->packets.endWrite();
+        sim->packetReady.set();
+    }
+}
+
+void NvSampleApp::paceFrame(NvStopWatch* paceTimer) {
+    // sleep off most of what is left of the interval, then yield through the
+    // rest, since a sleep can overshoot by a scheduler quantum
+    const float remaining = mPaceInterval - paceTimer->getTime();
+    if (remaining > 0.002f)
+        NvThread::sleep(remaining - 0.0015f);
+    while (paceTimer->getTime() < mPaceInterval)
+        NvThread::yield();
+    paceTimer->start();
+}
+
+void NvSampleApp::captureFrame(int32_t frame) {
+    uint8_t* data = new uint8_t[4 * m_width * m_height];
+
+    // the app may have left one of its own framebuffers bound; the frame that
+    // is about to be presented is in the main FBO when rendering offscreen
+    if (mUseFBOPair)
+        glBindFramebuffer(GL_FRAMEBUFFER, getMainFBO());
+
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)data);
+
+    std::ostringstream path;
+    path << mCaptureDir << "/frame" << std::setw(5) << std::setfill('0') << frame;
+    if (!writeScreenShot(m_width, m_height, data, path.str()))
+        LOGE("Could not write frame capture %s", path.str().c_str());
+
+    delete[] data;
+}
+
+int32_t NvSampleApp::addBenchmarkCounter(const char* name) {
+    return mBenchmark ? mBenchmark->addCounter(name) : -1;
+}
+
+void NvSampleApp::setBenchmarkCounter(int32_t counter, float value) {
+    if (mBenchmark)
+        mBenchmark->setCounter(counter, value);
+}
+
+bool NvSampleApp::beginBenchmarkCase(int32_t index) {
+    mBenchCase = index;
+    if (index >= mBenchCaseCount)
+        return false;
+
+    // the sweeps form a grid; the first sweep varies fastest
+    std::string label;
+    int32_t stride = 1;
+    for (size_t i = 0; i < mBenchSweeps.size(); i++) {
+        const BenchmarkSweep& sweep = mBenchSweeps[i];
+        const std::string& value = sweep.values[(index / stride) % sweep.values.size()];
+        stride *= (int32_t)sweep.values.size();
+
+        NvTweakVarBase* var = mTweakBar ? mTweakBar->findVar(sweep.name.c_str()) : NULL;
+        if (!var) {
+            LOGE("-sweep: no tweak variable named %s", sweep.name.c_str());
+        } else if (!var->setFromString(value.c_str())) {
+            LOGE("-sweep: cannot set %s to %s", sweep.name.c_str(), value.c_str());
+        } else {
+            syncValue(var);
+        }
+
+        if (!label.empty())
+            label += " ";
+        label += sweep.name + "=" + value;
+    }
+    if (label.empty())
+        label = mAppTitle.empty() ? "default" : mAppTitle;
+
+    LOGI("Benchmark case %d of %d: %s", index + 1, mBenchCaseCount, label.c_str());
+    mBenchmark->beginCase(label);
+    return true;
+}
+
+void NvSampleApp::readBenchmarkGPUTimes(bool flush) {
+    if (!mBenchmark || !mBenchGPUTimer)
+        return;
+
+    int32_t frame;
+    float gpuMs;
+    while (mBenchGPUTimer->getResult(frame, gpuMs, flush))
+        mBenchmark->setGPUTime(frame, gpuMs);
+}
+
+void NvSampleApp::finishBenchmark() {
+    if (!mBenchmark)
+        return;
+
+    if ((mBenchCase >= 0) && (mBenchCase < mBenchCaseCount)) {
+        readBenchmarkGPUTimes(true);
+        mBenchmark->endCase();
+    }
+
+    const std::vector<NvBenchmark::CaseResult>& results = mBenchmark->getResults();
+    for (size_t i = 0; i < results.size(); i++) {
+        const NvBenchmark::Stats& cpu = results[i].stats[0];
+        const NvBenchmark::Stats& gpu = results[i].stats[1];
+        LOGI("%s: %d frames\n"
+            "    cpu ms: mean %.3f sd %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n"
+            "    gpu ms: mean %.3f sd %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f",
+            results[i].label.c_str(), results[i].frames,
+            cpu.mean, cpu.stddev, cpu.p50, cpu.p95, cpu.p99, cpu.max,
+            gpu.mean, gpu.stddev, gpu.p50, gpu.p95, gpu.p99, gpu.max);
+
+        if (mTestMode) {
+            writeLogFile(mTestName, true, "\n%s (%d frames)\n"
+                "cpu ms: mean %.3f sd %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n"
+                "gpu ms: mean %.3f sd %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+                results[i].label.c_str(), results[i].frames,
+                cpu.mean, cpu.stddev, cpu.p50, cpu.p95, cpu.p99, cpu.max,
+                gpu.mean, gpu.stddev, gpu.p50, gpu.p95, gpu.p99, gpu.max);
+        }
+    }
+
+    if (!mBenchmark->writeJSON(mBenchOut + ".json") ||
+        !mBenchmark->writeCSV(mBenchOut + ".csv"))
+        LOGE("Could not write benchmark results to %s", mBenchOut.c_str());
+
+    if (!mCaptureDir.empty() && !mBenchmark->writeFrameLog(mCaptureDir + "/frametimes.txt"))
+        LOGE("Could not write frame times to %s", mCaptureDir.c_str());
+
+    // stop recording; any later frames are not part of the results
+    delete mBenchmark;
+    mBenchmark = NULL;
+}
+
+void NvSampleApp::runMathBenchmark() {
+    NvBenchmark bench(MATH_BENCHMARK_BATCHES, TESTMODE_WARMUP_FRAMES);
+    NvStopWatch* timer = createStopWatch();
+    NvRunMathBenchmarks(bench, timer, MATH_BENCHMARK_BATCH_SIZE);
+    delete timer;
+
+    // the cases are per operation, not per frame, so keep them apart from -benchout
+    const std::string path = mBenchOut.empty() ? std::string("mathbench") : (mBenchOut + "_math");
+    if (!bench.writeJSON(path + ".json") || !bench.writeCSV(path + ".csv"))
+        LOGE("Could not write math benchmark results to %s", path.c_str());
+}
+
+void NvSampleApp::runDXTBenchmark() {
+    static const struct {
+        uint32_t format;
+        const char* name;
+    } formats[] = {
+        { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, "DXT1" },
+        { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, "DXT3" },
+        { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, "DXT5" },
+        { GL_COMPRESSED_RED_RGTC1, "RGTC1" },
+        { GL_COMPRESSED_RG_RGTC2, "RGTC2" },
+    };
+
+    // one expansion of the whole image is one "frame" of the case
+    NvBenchmark bench(DXT_BENCHMARK_BATCHES, TESTMODE_WARMUP_FRAMES);
+    const float megapixels = (float)DXT_BENCHMARK_SIZE * DXT_BENCHMARK_SIZE / 1.0e6f;
+
+    const int32_t formatCount = sizeof(formats) / sizeof(formats[0]);
+    for (int32_t f = 0; f < formatCount; f++) {
+        bench.beginCase(std::string(formats[f].name) + " (" + NvImage::GetDXTExpansionPath() + ")");
+
+        bool full = false;
+        while (!full) {
+            const float mpps = NvImage::BenchmarkDXTExpansion(formats[f].format,
+                DXT_BENCHMARK_SIZE, DXT_BENCHMARK_SIZE, 1);
+            full = bench.recordFrame((mpps > 0.0f) ? (megapixels * 1000.0f / mpps) : -1.0f, -1.0f);
+        }
+
+        bench.endCase();
+
+        const NvBenchmark::CaseResult& result = bench.getResults().back();
+        if (result.stats[0].count > 0) {
+            LOGI("%s: %d expansions of %dx%d, MPixels/s: mean %.1f p50 %.1f max %.1f",
+                result.label.c_str(), result.frames, DXT_BENCHMARK_SIZE, DXT_BENCHMARK_SIZE,
+                megapixels * 1000.0f / result.stats[0].mean, megapixels * 1000.0f / result.stats[0].p50,
+                megapixels * 1000.0f / result.stats[0].min);
+        }
+    }
+
+    const std::string path = mBenchOut.empty() ? std::string("dxtbench") : (mBenchOut + "_dxt");
+    if (!bench.writeJSON(path + ".json") || !bench.writeCSV(path + ".csv"))
+        LOGE("Could not write DXT benchmark results to %s", path.c_str());
+}
+
 void NvSampleApp::logTestResults(float frameRate, int32_t frames) {
     LOGI("Test Frame Rate = %lf (frames = %d)\n", frameRate, frames);
     writeLogFile(mTestName, true, "\n%s %lf fps (%d frames)\n", mTestName.c_str(), frameRate, frames);
+    finishBenchmark();
     if (mUseFBOPair) {
         writeLogFile(mTestName, true, "\nOffscreen Mode: FBO Size %d x %d\n", m_width, m_height);
     } else {
@@ -36,6 +36,108 @@
 
 #include <string>
 
+#ifndef ANDROID
+
+#include "NvAssetLoader/NvAssetPack.h"
+#include <vector>
+
+struct MountedPack {
+    std::string searchPath;
+    NvAssetPack* pack;
+};
+
+// packs are consulted in mount order before any directory is probed
+static std::vector<MountedPack> s_packs;
+
+static bool isPackPath(const char *path)
+{
+    size_t len = strlen(path);
+    size_t extLen = strlen(NV_ASSET_PACK_EXTENSION);
+    return (len > extLen) && !strcmp(path + len - extLen, NV_ASSET_PACK_EXTENSION);
+}
+
+static bool mountPack(const char *path)
+{
+    std::vector<MountedPack>::iterator src = s_packs.begin();
+
+    while (src != s_packs.end()) {
+        if (!(*src).searchPath.compare(path))
+            return true;
+        src++;
+    }
+
+    // the pack itself is located the same way as the assets tree
+    NvAssetPack* pack = new NvAssetPack;
+    std::string upPath;
+    for (int32_t i = 0; i < 10; i++) {
+        std::string fullPath(upPath);
+        fullPath.append(path);
+
+        if (pack->open(fullPath.c_str())) {
+            MountedPack mounted;
+            mounted.searchPath = path;
+            mounted.pack = pack;
+            s_packs.push_back(mounted);
+            return true;
+        }
+
+        upPath.append("../");
+    }
+
+    delete pack;
+    fprintf(stderr, "Error opening asset pack '%s'\n", path);
+    return false;
+}
+
+static void unmountPack(const char *path)
+{
+    std::vector<MountedPack>::iterator src = s_packs.begin();
+
+    while (src != s_packs.end()) {
+        if (!(*src).searchPath.compare(path)) {
+            delete (*src).pack;
+            s_packs.erase(src);
+            return;
+        }
+        src++;
+    }
+}
+
+static void unmountAllPacks()
+{
+    for (size_t i = 0; i < s_packs.size(); i++)
+        delete s_packs[i].pack;
+    s_packs.clear();
+}
+
+static char *readFromPacks(const char *filePath, int32_t &length)
+{
+    for (size_t i = 0; i < s_packs.size(); i++) {
+        const NvAssetPack* pack = s_packs[i].pack;
+        const NvAssetPackEntry* entry = pack->find(filePath);
+        if (!entry)
+            continue;
+
+        char *data = new char [entry->size + 1];
+        if (!pack->read(entry, (uint8_t*)data)) {
+            fprintf(stderr, "Error reading '%s' from asset pack '%s'\n", filePath, pack->getPath().c_str());
+            delete[] data;
+            return NULL;
+        }
+        data[entry->size] = '\0';
+        length = entry->size;
+
+#ifdef DEBUG
+        fprintf(stderr, "Read file '%s' from pack '%s', %d bytes\n", filePath, pack->getPath().c_str(), length);
+#endif
+        return data;
+    }
+
+    return NULL;
+}
+
+#endif
+
 #ifdef ANDROID
 
 #include <android/asset_manager.h>
@@ -115,11 +217,15 @@ bool NvAssetLoaderInit(void*)
 bool NvAssetLoaderShutdown()
 {
     s_searchPath.clear();
+    unmountAllPacks();
     return true;
 }
 
 bool NvAssetLoaderAddSearchPath(const char *path)
 {
+    if (isPackPath(path))
+        return mountPack(path);
+
     std::vector<std::string>::iterator src = s_searchPath.begin();
 
     while (src != s_searchPath.end()) {
@@ -134,6 +240,11 @@ bool NvAssetLoaderAddSearchPath(const char *path)
 
 bool NvAssetLoaderRemoveSearchPath(const char *path)
 {
+    if (isPackPath(path)) {
+        unmountPack(path);
+        return true;
+    }
+
     std::vector<std::string>::iterator src = s_searchPath.begin();
 
     while (src != s_searchPath.end()) {
@@ -148,6 +259,10 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
 
 char *NvAssetLoaderRead(const char *filePath, int32_t &length)
 {
+    char *packed = readFromPacks(filePath, length);
+    if (packed)
+        return packed;
+
     FILE *fp = NULL;
     // loop N times up the hierarchy, testing at each level
     std::string upPath;
@@ -226,11 +341,15 @@ bool NvAssetLoaderInit(void*)
 bool NvAssetLoaderShutdown()
 {
     s_searchPath.clear();
+    unmountAllPacks();
     return true;
 }
 
 bool NvAssetLoaderAddSearchPath(const char *path)
 {
+    if (isPackPath(path))
+        return mountPack(path);
+
     std::vector<std::string>::iterator src = s_searchPath.begin();
 
     while (src != s_searchPath.end()) {
@@ -245,6 +364,11 @@ bool NvAssetLoaderAddSearchPath(const char *path)
 
 bool NvAssetLoaderRemoveSearchPath(const char *path)
 {
+    if (isPackPath(path)) {
+        unmountPack(path);
+        return true;
+    }
+
     std::vector<std::string>::iterator src = s_searchPath.begin();
 
     while (src != s_searchPath.end()) {
@@ -259,6 +383,10 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
 
 char *NvAssetLoaderRead(const char *filePath, int32_t &length)
 {
+    char *packed = readFromPacks(filePath, length);
+    if (packed)
+        return packed;
+
     FILE *fp = NULL;
     // loop N times up the hierarchy, testing at each level
     std::string upPath;
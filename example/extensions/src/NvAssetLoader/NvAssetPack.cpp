@@ -0,0 +1,566 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetPack.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+#include "NvAssetLoader/NvAssetPack.h"
+#include "NV/NvLogs.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+uint64_t NvAssetPackHash(const char* name, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        char c = (name[i] == '\\') ? '/' : name[i];
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool namesEqual(const char* a, const char* b, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        char ca = (a[i] == '\\') ? '/' : a[i];
+        char cb = (b[i] == '\\') ? '/' : b[i];
+        if (ca != cb)
+            return false;
+    }
+    return true;
+}
+
+//
+// LZ4 block format
+//
+//////////////////////////////////////////////////////////////
+
+static const size_t LZ4_MIN_MATCH = 4;
+static const size_t LZ4_LAST_LITERALS = 5;
+static const size_t LZ4_MF_LIMIT = 12;
+static const uint32_t LZ4_HASH_BITS = 12;
+
+static inline uint32_t lz4Read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint8_t* lz4WriteLength(uint8_t* op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static size_t lz4CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+// Greedy single-probe compressor; the output is a valid LZ4 block
+// but makes no attempt to match the ratio of the reference encoder
+static size_t lz4Compress(const uint8_t* src, size_t srcSize, uint8_t* dst)
+{
+    uint32_t table[1 << LZ4_HASH_BITS];
+    memset(table, 0xff, sizeof(table));
+
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    if (srcSize > LZ4_MF_LIMIT) {
+        const size_t matchLimit = srcSize - LZ4_LAST_LITERALS;
+        const size_t ipLimit = srcSize - LZ4_MF_LIMIT;
+
+        while (ip < ipLimit) {
+            uint32_t seq = lz4Read32(src + ip);
+            uint32_t h = (seq * 2654435761U) >> (32 - LZ4_HASH_BITS);
+            uint32_t ref = table[h];
+            table[h] = (uint32_t)ip;
+
+            if (ref == 0xffffffff || ip - ref > 65535 || lz4Read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t matchLength = LZ4_MIN_MATCH;
+            while (ip + matchLength < matchLimit && src[ref + matchLength] == src[ip + matchLength])
+                matchLength++;
+
+            size_t literalLength = ip - anchor;
+            uint8_t* token = op++;
+            if (literalLength >= 15) {
+                *token = 15 << 4;
+                op = lz4WriteLength(op, literalLength - 15);
+            } else {
+                *token = (uint8_t)(literalLength << 4);
+            }
+            memcpy(op, src + anchor, literalLength);
+            op += literalLength;
+
+            size_t offset = ip - ref;
+            *op++ = (uint8_t)(offset & 0xff);
+            *op++ = (uint8_t)(offset >> 8);
+
+            size_t extra = matchLength - LZ4_MIN_MATCH;
+            if (extra >= 15) {
+                *token |= 15;
+                op = lz4WriteLength(op, extra - 15);
+            } else {
+                *token |= (uint8_t)extra;
+            }
+
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    size_t literalLength = srcSize - anchor;
+    uint8_t* token = op++;
+    if (literalLength >= 15) {
+        *token = 15 << 4;
+        op = lz4WriteLength(op, literalLength - 15);
+    } else {
+        *token = (uint8_t)(literalLength << 4);
+    }
+    memcpy(op, src + anchor, literalLength);
+    op += literalLength;
+
+    return op - dst;
+}
+
+static bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dstSize;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend)
+                    return false;
+                b = *ip++;
+                literalLength += b;
+            } while (b == 255);
+        }
+
+        if ((size_t)(iend - ip) < literalLength || (size_t)(oend - op) < literalLength)
+            return false;
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // the last sequence carries literals only
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend)
+                    return false;
+                b = *ip++;
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+
+        if ((size_t)(oend - op) < matchLength)
+            return false;
+
+        // matches may overlap their own output, so copy bytewise
+        const uint8_t* match = op - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            op[i] = match[i];
+        op += matchLength;
+    }
+
+    return op == oend;
+}
+
+//
+// NvAssetPack
+//
+//////////////////////////////////////////////////////////////
+
+NvAssetPack::NvAssetPack()
+    : m_base(NULL)
+    , m_size(0)
+    , m_entries(NULL)
+    , m_entryCount(0)
+    , m_names(NULL)
+#ifdef WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(NULL)
+#endif
+{
+}
+
+NvAssetPack::~NvAssetPack()
+{
+    close();
+}
+
+bool NvAssetPack::open(const char* path)
+{
+    close();
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(NvAssetPackHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_base = (const uint8_t*)base;
+    m_size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(NvAssetPackHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    m_base = (const uint8_t*)base;
+    m_size = st.st_size;
+#endif
+
+    m_path = path;
+
+    const NvAssetPackHeader* header = (const NvAssetPackHeader*)m_base;
+    if (header->magic != NV_ASSET_PACK_MAGIC || header->version != NV_ASSET_PACK_VERSION) {
+        LOGE("Asset pack '%s' has an invalid header", path);
+        close();
+        return false;
+    }
+
+    // offsets are checked before the sizes are compared with the space left
+    // behind them, so that crafted values cannot wrap the sums around
+    const uint64_t packSize = m_size;
+    const uint64_t indexSize = (uint64_t)header->entryCount * sizeof(NvAssetPackEntry);
+    if (header->indexOffset > packSize || indexSize > packSize - header->indexOffset ||
+        header->namesOffset > packSize) {
+        LOGE("Asset pack '%s' is truncated", path);
+        close();
+        return false;
+    }
+
+    m_entries = (const NvAssetPackEntry*)(m_base + header->indexOffset);
+    m_entryCount = header->entryCount;
+    m_names = (const char*)(m_base + header->namesOffset);
+
+    const uint64_t namesSize = packSize - header->namesOffset;
+    for (uint32_t i = 0; i < m_entryCount; i++) {
+        const NvAssetPackEntry& e = m_entries[i];
+        if (e.offset > packSize || e.storedSize > packSize - e.offset ||
+            e.nameOffset > namesSize || e.nameLength > namesSize - e.nameOffset) {
+            LOGE("Asset pack '%s' has an out-of-range entry", path);
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void NvAssetPack::close()
+{
+    if (m_base) {
+#ifdef WIN32
+        UnmapViewOfFile(m_base);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+        m_mapping = NULL;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        munmap((void*)m_base, m_size);
+#endif
+    }
+
+    m_base = NULL;
+    m_size = 0;
+    m_entries = NULL;
+    m_entryCount = 0;
+    m_names = NULL;
+    m_path.clear();
+}
+
+static bool entryHashLess(const NvAssetPackEntry& e, uint64_t hash)
+{
+    return e.hash < hash;
+}
+
+const NvAssetPackEntry* NvAssetPack::find(const char* name) const
+{
+    if (!m_entries)
+        return NULL;
+
+    size_t length = strlen(name);
+    uint64_t hash = NvAssetPackHash(name, length);
+
+    const NvAssetPackEntry* end = m_entries + m_entryCount;
+    const NvAssetPackEntry* e = std::lower_bound(m_entries, end, hash, entryHashLess);
+
+    // walk the (normally single-entry) run of equal hashes
+    for (; e != end && e->hash == hash; e++) {
+        if (e->nameLength == length && namesEqual(m_names + e->nameOffset, name, length))
+            return e;
+    }
+
+    return NULL;
+}
+
+bool NvAssetPack::read(const NvAssetPackEntry* entry, uint8_t* dst) const
+{
+    const uint8_t* src = getStoredData(entry);
+
+    switch (entry->compression) {
+    case NV_ASSET_PACK_STORED:
+        if (entry->storedSize != entry->size)
+            return false;
+        memcpy(dst, src, entry->size);
+        return true;
+    case NV_ASSET_PACK_LZ4:
+        return lz4Decompress(src, entry->storedSize, dst, entry->size);
+    default:
+        LOGE("Asset pack '%s': unsupported compression %d", m_path.c_str(), entry->compression);
+        return false;
+    }
+}
+
+//
+// NvAssetPackWriter
+//
+//////////////////////////////////////////////////////////////
+
+NvAssetPackWriter::NvAssetPackWriter(uint32_t alignment)
+    : m_alignment(alignment ? alignment : 1)
+{
+}
+
+bool NvAssetPackWriter::addAsset(const char* name, const void* data, size_t size,
+    NvAssetPackCompression compression)
+{
+    size_t nameLength = strlen(name);
+    if (!nameLength || nameLength > 0xffff || size > 0xffffffff)
+        return false;
+
+    uint64_t hash = NvAssetPackHash(name, nameLength);
+    for (size_t i = 0; i < m_assets.size(); i++) {
+        if (m_assets[i].hash == hash && m_assets[i].name.size() == nameLength &&
+            namesEqual(m_assets[i].name.c_str(), name, nameLength))
+            return false;
+    }
+
+    Asset asset;
+    asset.name.assign(name, nameLength);
+    std::replace(asset.name.begin(), asset.name.end(), '\\', '/');
+    asset.hash = hash;
+    asset.size = (uint32_t)size;
+    asset.compression = NV_ASSET_PACK_STORED;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    if (compression == NV_ASSET_PACK_LZ4 && size > 0) {
+        asset.data.resize(lz4CompressBound(size));
+        size_t packed = lz4Compress(bytes, size, &asset.data[0]);
+        if (packed < size) {
+            asset.data.resize(packed);
+            asset.compression = NV_ASSET_PACK_LZ4;
+        }
+    } else if (compression != NV_ASSET_PACK_STORED && compression != NV_ASSET_PACK_LZ4) {
+        LOGE("Asset pack compression %d is not supported", compression);
+        return false;
+    }
+
+    if (asset.compression == NV_ASSET_PACK_STORED)
+        asset.data.assign(bytes, bytes + size);
+
+    m_assets.push_back(asset);
+    return true;
+}
+
+bool NvAssetPackWriter::addFile(const char* name, const char* filePath,
+    NvAssetPackCompression compression)
+{
+    FILE* fp = fopen(filePath, "rb");
+    if (!fp) {
+        LOGE("Error opening file '%s'", filePath);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    std::vector<uint8_t> data(length);
+    size_t read = length ? fread(&data[0], 1, length, fp) : 0;
+    fclose(fp);
+
+    if (read != (size_t)length)
+        return false;
+
+    return addAsset(name, length ? &data[0] : NULL, length, compression);
+}
+
+static bool assetHashLess(const NvAssetPackEntry& a, const NvAssetPackEntry& b)
+{
+    return a.hash < b.hash;
+}
+
+bool NvAssetPackWriter::write(const char* path) const
+{
+    const uint32_t count = (uint32_t)m_assets.size();
+
+    NvAssetPackHeader header;
+    header.magic = NV_ASSET_PACK_MAGIC;
+    header.version = NV_ASSET_PACK_VERSION;
+    header.entryCount = count;
+    header.alignment = m_alignment;
+    header.indexOffset = sizeof(NvAssetPackHeader);
+    header.namesOffset = header.indexOffset + count * sizeof(NvAssetPackEntry);
+
+    std::vector<NvAssetPackEntry> entries(count);
+    std::vector<char> names;
+    for (uint32_t i = 0; i < count; i++) {
+        const Asset& asset = m_assets[i];
+        NvAssetPackEntry& e = entries[i];
+        e.hash = asset.hash;
+        e.storedSize = (uint32_t)asset.data.size();
+        e.size = asset.size;
+        e.nameOffset = (uint32_t)names.size();
+        e.nameLength = (uint16_t)asset.name.size();
+        e.compression = asset.compression;
+        names.insert(names.end(), asset.name.begin(), asset.name.end());
+    }
+
+    uint64_t offset = header.namesOffset + names.size();
+    for (uint32_t i = 0; i < count; i++) {
+        offset = (offset + m_alignment - 1) / m_alignment * m_alignment;
+        entries[i].offset = offset;
+        offset += entries[i].storedSize;
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        LOGE("Error creating asset pack '%s'", path);
+        return false;
+    }
+
+    // blobs are laid out in insertion order; only the index is sorted
+    std::vector<NvAssetPackEntry> index(entries);
+    std::stable_sort(index.begin(), index.end(), assetHashLess);
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if (ok && count)
+        ok = fwrite(&index[0], sizeof(NvAssetPackEntry), count, fp) == count;
+    if (ok && !names.empty())
+        ok = fwrite(&names[0], 1, names.size(), fp) == names.size();
+
+    uint64_t written = header.namesOffset + names.size();
+    static const uint8_t zeros[256] = { 0 };
+    for (uint32_t i = 0; ok && i < count; i++) {
+        while (ok && written < entries[i].offset) {
+            size_t pad = (size_t)std::min<uint64_t>(entries[i].offset - written, sizeof(zeros));
+            ok = fwrite(zeros, 1, pad, fp) == pad;
+            written += pad;
+        }
+        const std::vector<uint8_t>& data = m_assets[i].data;
+        if (ok && !data.empty())
+            ok = fwrite(&data[0], 1, data.size(), fp) == data.size();
+        written += data.size();
+    }
+
+    fclose(fp);
+
+    if (!ok)
+        LOGE("Error writing asset pack '%s'", path);
+    return ok;
+}
@@ -0,0 +1,483 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/BlockDXTDecode.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "BlockDXTDecode.h"
+#include "NvGLEnums.h"
+
+#ifdef NV_DXT_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef NV_DXT_DECODE_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace nv;
+
+
+/*----------------------------------------------------------------------------
+    Format queries
+----------------------------------------------------------------------------*/
+
+bool nv::getDXTDecodeFormat(uint32_t glFormat, DXTDecodeFormat& format)
+{
+    switch (glFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            format = DXT_DECODE_BC1;
+            return true;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            format = DXT_DECODE_BC2;
+            return true;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            format = DXT_DECODE_BC3;
+            return true;
+        case GL_COMPRESSED_RED_RGTC1:
+            format = DXT_DECODE_BC4_RED;
+            return true;
+        case GL_COMPRESSED_LUMINANCE_LATC1_EXT:
+            format = DXT_DECODE_BC4_LUMINANCE;
+            return true;
+        case GL_COMPRESSED_RG_RGTC2:
+            format = DXT_DECODE_BC5_RG;
+            return true;
+        case GL_COMPRESSED_LUMINANCE_ALPHA_LATC2_EXT:
+            format = DXT_DECODE_BC5_LUMINANCE_ALPHA;
+            return true;
+    }
+    return false;
+}
+
+uint32_t nv::getDXTDecodeBlockSize(DXTDecodeFormat format)
+{
+    switch (format) {
+        case DXT_DECODE_BC1:
+        case DXT_DECODE_BC4_RED:
+        case DXT_DECODE_BC4_LUMINANCE:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+const char* nv::getDXTDecodePath()
+{
+#if defined(NV_DXT_DECODE_AVX2)
+    return "AVX2";
+#elif defined(NV_DXT_DECODE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+
+/*----------------------------------------------------------------------------
+    Palettes
+----------------------------------------------------------------------------*/
+
+static inline uint32_t packRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Same expansion and interpolation as BlockDXT1::evaluatePalette.  BC2/BC3
+// color blocks are always four-color, so they pass allowThreeColor = false.
+static inline void colorPalette(const uint8_t* block, bool allowThreeColor, uint32_t pal[4])
+{
+    uint32_t c0 = block[0] | (block[1] << 8);
+    uint32_t c1 = block[2] | (block[3] << 8);
+
+    uint32_t r0 = (c0 >> 11) & 0x1f, g0 = (c0 >> 5) & 0x3f, b0 = c0 & 0x1f;
+    uint32_t r1 = (c1 >> 11) & 0x1f, g1 = (c1 >> 5) & 0x3f, b1 = c1 & 0x1f;
+
+    r0 = (r0 << 3) | (r0 >> 2);
+    g0 = (g0 << 2) | (g0 >> 4);
+    b0 = (b0 << 3) | (b0 >> 2);
+    r1 = (r1 << 3) | (r1 >> 2);
+    g1 = (g1 << 2) | (g1 >> 4);
+    b1 = (b1 << 3) | (b1 >> 2);
+
+    pal[0] = packRGBA(r0, g0, b0, 0xff);
+    pal[1] = packRGBA(r1, g1, b1, 0xff);
+
+    if (c0 > c1 || !allowThreeColor) {
+        pal[2] = packRGBA((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 0xff);
+        pal[3] = packRGBA((2 * r1 + r0) / 3, (2 * g1 + g0) / 3, (2 * b1 + b0) / 3, 0xff);
+    } else {
+        pal[2] = packRGBA((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 0xff);
+        pal[3] = 0;
+    }
+}
+
+static inline uint32_t colorIndices(const uint8_t* block)
+{
+    return block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+}
+
+// Same palette as AlphaBlockDXT5::evaluatePalette; shared by BC3 alpha and BC4/BC5
+static inline void decodeInterpolated(const uint8_t* block, uint8_t out[16])
+{
+    uint32_t a0 = block[0];
+    uint32_t a1 = block[1];
+    uint8_t pal[8];
+
+    pal[0] = (uint8_t)a0;
+    pal[1] = (uint8_t)a1;
+    if (a0 > a1) {
+        pal[2] = (uint8_t)((6 * a0 + 1 * a1) / 7);
+        pal[3] = (uint8_t)((5 * a0 + 2 * a1) / 7);
+        pal[4] = (uint8_t)((4 * a0 + 3 * a1) / 7);
+        pal[5] = (uint8_t)((3 * a0 + 4 * a1) / 7);
+        pal[6] = (uint8_t)((2 * a0 + 5 * a1) / 7);
+        pal[7] = (uint8_t)((1 * a0 + 6 * a1) / 7);
+    } else {
+        pal[2] = (uint8_t)((4 * a0 + 1 * a1) / 5);
+        pal[3] = (uint8_t)((3 * a0 + 2 * a1) / 5);
+        pal[4] = (uint8_t)((2 * a0 + 3 * a1) / 5);
+        pal[5] = (uint8_t)((1 * a0 + 4 * a1) / 5);
+        pal[6] = 0x00;
+        pal[7] = 0xff;
+    }
+
+    uint64_t bits = 0;
+    for (int32_t i = 7; i >= 2; i--)
+        bits = (bits << 8) | block[i];
+
+    for (int32_t i = 0; i < 16; i++) {
+        out[i] = pal[bits & 7];
+        bits >>= 3;
+    }
+}
+
+static inline void decodeExplicitAlpha(const uint8_t* block, uint8_t out[16])
+{
+    for (int32_t i = 0; i < 8; i++) {
+        uint8_t lo = block[i] & 0x0f;
+        uint8_t hi = block[i] >> 4;
+        out[2 * i + 0] = (lo << 4) | lo;
+        out[2 * i + 1] = (hi << 4) | hi;
+    }
+}
+
+
+/*----------------------------------------------------------------------------
+    Scalar path
+----------------------------------------------------------------------------*/
+
+static void decodeBlockScalar(DXTDecodeFormat format, const uint8_t* block, uint32_t px[16])
+{
+    uint32_t pal[4];
+    uint8_t c0[16];
+    uint8_t c1[16];
+
+    switch (format) {
+        case DXT_DECODE_BC1: {
+            colorPalette(block, true, pal);
+            uint32_t idx = colorIndices(block);
+            for (int32_t i = 0; i < 16; i++, idx >>= 2)
+                px[i] = pal[idx & 3];
+            break;
+        }
+        case DXT_DECODE_BC2:
+        case DXT_DECODE_BC3: {
+            if (format == DXT_DECODE_BC2)
+                decodeExplicitAlpha(block, c0);
+            else
+                decodeInterpolated(block, c0);
+            colorPalette(block + 8, false, pal);
+            uint32_t idx = colorIndices(block + 8);
+            for (int32_t i = 0; i < 16; i++, idx >>= 2)
+                px[i] = (pal[idx & 3] & 0x00ffffff) | ((uint32_t)c0[i] << 24);
+            break;
+        }
+        case DXT_DECODE_BC4_RED:
+            decodeInterpolated(block, c0);
+            for (int32_t i = 0; i < 16; i++)
+                px[i] = packRGBA(c0[i], 0, 0, 0xff);
+            break;
+        case DXT_DECODE_BC4_LUMINANCE:
+            decodeInterpolated(block, c0);
+            for (int32_t i = 0; i < 16; i++)
+                px[i] = packRGBA(c0[i], c0[i], c0[i], 0xff);
+            break;
+        case DXT_DECODE_BC5_RG:
+            decodeInterpolated(block, c0);
+            decodeInterpolated(block + 8, c1);
+            for (int32_t i = 0; i < 16; i++)
+                px[i] = packRGBA(c0[i], c1[i], 0, 0xff);
+            break;
+        case DXT_DECODE_BC5_LUMINANCE_ALPHA:
+            decodeInterpolated(block, c0);
+            decodeInterpolated(block + 8, c1);
+            for (int32_t i = 0; i < 16; i++)
+                px[i] = packRGBA(c0[i], c0[i], c0[i], c1[i]);
+            break;
+    }
+}
+
+static inline void storeBlock(const uint32_t px[16], uint32_t* dst, int32_t dstPitch,
+    int32_t width, int32_t rows)
+{
+    for (int32_t y = 0; y < rows; y++)
+        memcpy(dst + y * dstPitch, px + 4 * y, width * sizeof(uint32_t));
+}
+
+
+/*----------------------------------------------------------------------------
+    SSE2 path
+----------------------------------------------------------------------------*/
+
+#ifdef NV_DXT_DECODE_SSE2
+
+// Selects the palette entry of each pixel with compare masks; the masks
+// are exclusive, so pal0 ^ (m1 & (pal0^pal1)) ^ ... picks exactly one entry.
+static inline void decodeColorSSE2(const uint8_t* block, bool allowThreeColor, __m128i rows[4])
+{
+    uint32_t pal[4];
+    colorPalette(block, allowThreeColor, pal);
+
+    const __m128i p0 = _mm_set1_epi32(pal[0]);
+    const __m128i d1 = _mm_set1_epi32(pal[0] ^ pal[1]);
+    const __m128i d2 = _mm_set1_epi32(pal[0] ^ pal[2]);
+    const __m128i d3 = _mm_set1_epi32(pal[0] ^ pal[3]);
+
+    const __m128i mask3 = _mm_setr_epi32(0x03, 0x0c, 0x30, 0xc0);
+    const __m128i mask1 = _mm_setr_epi32(0x01, 0x04, 0x10, 0x40);
+    const __m128i mask2 = _mm_setr_epi32(0x02, 0x08, 0x20, 0x80);
+
+    for (int32_t r = 0; r < 4; r++) {
+        __m128i bits = _mm_and_si128(_mm_set1_epi32(block[4 + r]), mask3);
+        __m128i c = p0;
+        c = _mm_xor_si128(c, _mm_and_si128(_mm_cmpeq_epi32(bits, mask1), d1));
+        c = _mm_xor_si128(c, _mm_and_si128(_mm_cmpeq_epi32(bits, mask2), d2));
+        c = _mm_xor_si128(c, _mm_and_si128(_mm_cmpeq_epi32(bits, mask3), d3));
+        rows[r] = c;
+    }
+}
+
+// Zero-extends four consecutive bytes into the four 32 bit lanes
+static inline __m128i expandRowSSE2(const uint8_t values[16], int32_t row)
+{
+    uint32_t four;
+    memcpy(&four, values + 4 * row, sizeof(four));
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_cvtsi32_si128((int)four);
+    v = _mm_unpacklo_epi8(v, zero);
+    return _mm_unpacklo_epi16(v, zero);
+}
+
+static inline void mergeAlphaSSE2(__m128i rows[4], const uint8_t alpha[16])
+{
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+    for (int32_t r = 0; r < 4; r++) {
+        __m128i a = _mm_slli_epi32(expandRowSSE2(alpha, r), 24);
+        rows[r] = _mm_or_si128(_mm_and_si128(rows[r], rgbMask), a);
+    }
+}
+
+static void decodeBlockSSE2(DXTDecodeFormat format, const uint8_t* block, uint32_t* dst, int32_t dstPitch)
+{
+    const __m128i opaque = _mm_set1_epi32((int)0xff000000);
+    __m128i rows[4];
+    uint8_t c0[16];
+    uint8_t c1[16];
+
+    switch (format) {
+        case DXT_DECODE_BC1:
+            decodeColorSSE2(block, true, rows);
+            break;
+        case DXT_DECODE_BC2:
+            decodeColorSSE2(block + 8, false, rows);
+            decodeExplicitAlpha(block, c0);
+            mergeAlphaSSE2(rows, c0);
+            break;
+        case DXT_DECODE_BC3:
+            decodeColorSSE2(block + 8, false, rows);
+            decodeInterpolated(block, c0);
+            mergeAlphaSSE2(rows, c0);
+            break;
+        case DXT_DECODE_BC4_RED:
+            decodeInterpolated(block, c0);
+            for (int32_t r = 0; r < 4; r++)
+                rows[r] = _mm_or_si128(expandRowSSE2(c0, r), opaque);
+            break;
+        case DXT_DECODE_BC4_LUMINANCE:
+            decodeInterpolated(block, c0);
+            for (int32_t r = 0; r < 4; r++) {
+                __m128i l = expandRowSSE2(c0, r);
+                l = _mm_or_si128(l, _mm_or_si128(_mm_slli_epi32(l, 8), _mm_slli_epi32(l, 16)));
+                rows[r] = _mm_or_si128(l, opaque);
+            }
+            break;
+        case DXT_DECODE_BC5_RG:
+            decodeInterpolated(block, c0);
+            decodeInterpolated(block + 8, c1);
+            for (int32_t r = 0; r < 4; r++) {
+                __m128i g = _mm_slli_epi32(expandRowSSE2(c1, r), 8);
+                rows[r] = _mm_or_si128(_mm_or_si128(expandRowSSE2(c0, r), g), opaque);
+            }
+            break;
+        case DXT_DECODE_BC5_LUMINANCE_ALPHA:
+            decodeInterpolated(block, c0);
+            decodeInterpolated(block + 8, c1);
+            for (int32_t r = 0; r < 4; r++) {
+                __m128i l = expandRowSSE2(c0, r);
+                l = _mm_or_si128(l, _mm_or_si128(_mm_slli_epi32(l, 8), _mm_slli_epi32(l, 16)));
+                rows[r] = _mm_or_si128(l, _mm_slli_epi32(expandRowSSE2(c1, r), 24));
+            }
+            break;
+    }
+
+    for (int32_t r = 0; r < 4; r++)
+        _mm_storeu_si128((__m128i*)(dst + r * dstPitch), rows[r]);
+}
+
+#endif // NV_DXT_DECODE_SSE2
+
+
+/*----------------------------------------------------------------------------
+    AVX2 path
+----------------------------------------------------------------------------*/
+
+#ifdef NV_DXT_DECODE_AVX2
+
+// Decodes two horizontally adjacent color blocks at once; each 256 bit row
+// holds four pixels of the first block followed by four of the second, and
+// the palette lookup is a single cross-lane permute per row.
+static inline void decodeColorPairAVX2(const uint8_t* blockA, const uint8_t* blockB,
+    bool allowThreeColor, __m256i rows[4])
+{
+    uint32_t pal[8];
+    colorPalette(blockA, allowThreeColor, pal);
+    colorPalette(blockB, allowThreeColor, pal + 4);
+
+    const __m256i palette = _mm256_loadu_si256((const __m256i*)pal);
+    const uint32_t idxA = colorIndices(blockA);
+    const uint32_t idxB = colorIndices(blockB);
+    const __m256i bits = _mm256_setr_epi32(idxA, idxA, idxA, idxA, idxB, idxB, idxB, idxB);
+
+    const __m256i shift = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i base = _mm256_setr_epi32(0, 0, 0, 0, 4, 4, 4, 4);
+    const __m256i three = _mm256_set1_epi32(3);
+
+    for (int32_t r = 0; r < 4; r++) {
+        __m256i rowShift = _mm256_add_epi32(shift, _mm256_set1_epi32(8 * r));
+        __m256i idx = _mm256_and_si256(_mm256_srlv_epi32(bits, rowShift), three);
+        rows[r] = _mm256_permutevar8x32_epi32(palette, _mm256_add_epi32(idx, base));
+    }
+}
+
+static inline void mergeAlphaPairAVX2(__m256i rows[4], const uint8_t alphaA[16], const uint8_t alphaB[16])
+{
+    const __m256i rgbMask = _mm256_set1_epi32(0x00ffffff);
+    for (int32_t r = 0; r < 4; r++) {
+        uint8_t eight[8];
+        memcpy(eight, alphaA + 4 * r, 4);
+        memcpy(eight + 4, alphaB + 4 * r, 4);
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)eight));
+        rows[r] = _mm256_or_si256(_mm256_and_si256(rows[r], rgbMask), _mm256_slli_epi32(a, 24));
+    }
+}
+
+static void decodeBlockPairAVX2(DXTDecodeFormat format, const uint8_t* blocks, uint32_t blockSize,
+    uint32_t* dst, int32_t dstPitch)
+{
+    const uint8_t* blockA = blocks;
+    const uint8_t* blockB = blocks + blockSize;
+    __m256i rows[4];
+    uint8_t alphaA[16];
+    uint8_t alphaB[16];
+
+    if (format == DXT_DECODE_BC1) {
+        decodeColorPairAVX2(blockA, blockB, true, rows);
+    } else {
+        decodeColorPairAVX2(blockA + 8, blockB + 8, false, rows);
+        if (format == DXT_DECODE_BC2) {
+            decodeExplicitAlpha(blockA, alphaA);
+            decodeExplicitAlpha(blockB, alphaB);
+        } else {
+            decodeInterpolated(blockA, alphaA);
+            decodeInterpolated(blockB, alphaB);
+        }
+        mergeAlphaPairAVX2(rows, alphaA, alphaB);
+    }
+
+    for (int32_t r = 0; r < 4; r++)
+        _mm256_storeu_si256((__m256i*)(dst + r * dstPitch), rows[r]);
+}
+
+#endif // NV_DXT_DECODE_AVX2
+
+
+/*----------------------------------------------------------------------------
+    Row decoder
+----------------------------------------------------------------------------*/
+
+void nv::decodeDXTBlockRow(DXTDecodeFormat format, const uint8_t* blocks,
+    int32_t width, int32_t rows, uint32_t* dst, int32_t dstPitch)
+{
+    const uint32_t blockSize = getDXTDecodeBlockSize(format);
+    const int32_t blockCount = (width + 3) / 4;
+    int32_t i = 0;
+
+    // whole blocks are stored directly; the right and bottom edges of
+    // images that are not a multiple of four go through the scalar path
+    if (rows == 4) {
+        const int32_t fullBlocks = width / 4;
+        (void)fullBlocks;
+
+#ifdef NV_DXT_DECODE_AVX2
+        if (format == DXT_DECODE_BC1 || format == DXT_DECODE_BC2 || format == DXT_DECODE_BC3) {
+            for (; i + 1 < fullBlocks; i += 2)
+                decodeBlockPairAVX2(format, blocks + i * blockSize, blockSize, dst + 4 * i, dstPitch);
+        }
+#endif
+
+#ifdef NV_DXT_DECODE_SSE2
+        for (; i < fullBlocks; i++)
+            decodeBlockSSE2(format, blocks + i * blockSize, dst + 4 * i, dstPitch);
+#endif
+    }
+
+    for (; i < blockCount; i++) {
+        uint32_t px[16];
+        int32_t blockWidth = width - 4 * i;
+        decodeBlockScalar(format, blocks + i * blockSize, px);
+        storeBlock(px, dst + 4 * i, dstPitch, (blockWidth < 4) ? blockWidth : 4, rows);
+    }
+}
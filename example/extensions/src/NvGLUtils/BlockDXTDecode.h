@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/BlockDXTDecode.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_IMAGE_BLOCKDXTDECODE_H
+#define NV_IMAGE_BLOCKDXTDECODE_H
+
+#include <NvFoundation.h>
+
+// The widest instruction set is chosen at compile time; the scalar
+// path is always built and handles partial edge blocks.
+#if defined(__AVX2__)
+#define NV_DXT_DECODE_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NV_DXT_DECODE_SSE2 1
+#endif
+
+namespace nv
+{
+    /// Block formats understood by the row decoder.
+    /// All of them decode to 32 bit RGBA pixels (same layout as Color32).
+    enum DXTDecodeFormat
+    {
+        DXT_DECODE_BC1,             ///< DXT1, 1 bit alpha
+        DXT_DECODE_BC2,             ///< DXT3, explicit 4 bit alpha
+        DXT_DECODE_BC3,             ///< DXT5, interpolated alpha
+        DXT_DECODE_BC4_RED,         ///< RGTC1, decoded to (r, 0, 0, 255)
+        DXT_DECODE_BC4_LUMINANCE,   ///< LATC1, decoded to (l, l, l, 255)
+        DXT_DECODE_BC5_RG,          ///< RGTC2, decoded to (r, g, 0, 255)
+        DXT_DECODE_BC5_LUMINANCE_ALPHA ///< LATC2, decoded to (l, l, l, a)
+    };
+
+    /// Maps an unsigned GL compressed format onto a decoder format.
+    /// \param[in] glFormat the GL format of the compressed image
+    /// \param[out] format the matching decoder format
+    /// \return false if the format cannot be expanded (signed or unknown formats)
+    bool getDXTDecodeFormat(uint32_t glFormat, DXTDecodeFormat& format);
+
+    /// Size in bytes of one 4x4 block of the given format
+    uint32_t getDXTDecodeBlockSize(DXTDecodeFormat format);
+
+    /// Name of the instruction set the decoder was built for
+    const char* getDXTDecodePath();
+
+    /// Decodes one row of 4x4 blocks straight into a RGBA8 image.
+    /// \param[in] format the block format
+    /// \param[in] blocks the first block of the row
+    /// \param[in] width the width of the image in pixels
+    /// \param[in] rows the number of pixel rows covered by this block row (1-4)
+    /// \param[out] dst the top-left pixel of the block row in the destination
+    /// \param[in] dstPitch the destination row pitch in pixels
+    void decodeDXTBlockRow(DXTDecodeFormat format, const uint8_t* blocks,
+        int32_t width, int32_t rows, uint32_t* dst, int32_t dstPitch);
+
+} // nv namespace
+
+#endif // NV_IMAGE_BLOCKDXTDECODE_H
@@ -100,6 +100,11 @@ size_t NvFilePtr::GetSize()
 {
     return _rep->filesize;
 }
+
+size_t NvFilePtr::Tell()
+{
+    return _rep->ptr - _rep->data;
+}
         
 NvFilePtr::~NvFilePtr()
 {
@@ -67,6 +67,7 @@ public:
     int32_t Write( size_t numBytes, const void* data);
     void Flush();
     size_t GetSize();
+    size_t Tell();
         
     virtual ~NvFilePtr();
 };
@@ -34,18 +34,60 @@
 #include "NvGLUtils/NvGLSLProgram.h"
 #include "NvAssetLoader/NvAssetLoader.h"
 #include "NV/NvLogs.h"
+#include "NvGLUtils/NvImage.h"
+#include <stdio.h>
+#include <string.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#ifdef WIN32
+#include <direct.h>
+#define NV_MKDIR(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define NV_MKDIR(path) mkdir(path, 0755)
+#endif
 
 bool NvGLSLProgram::ms_logAllMissing = false;
 const char* NvGLSLProgram::ms_shaderHeader = NULL;
 
+NvGLSLProgram::NV_PFNGLGETPROGRAMBINARYPROC NvGLSLProgram::m_glGetProgramBinary = NULL;
+NvGLSLProgram::NV_PFNGLPROGRAMBINARYPROC NvGLSLProgram::m_glProgramBinary = NULL;
+NvGLSLProgram::NV_PFNGLPROGRAMPARAMETERIPROC NvGLSLProgram::m_glProgramParameteri = NULL;
+NvGLSLProgram::NV_PFNGLMAXSHADERCOMPILERTHREADSPROC NvGLSLProgram::m_glMaxShaderCompilerThreads = NULL;
+NvGLSLProgram::NV_PFNGLGETACTIVEUNIFORMSIVPROC NvGLSLProgram::m_glGetActiveUniformsiv = NULL;
+NvGLSLProgram::NV_PFNGLGETACTIVEUNIFORMBLOCKIVPROC NvGLSLProgram::m_glGetActiveUniformBlockiv = NULL;
+NvGLSLProgram::NV_PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC NvGLSLProgram::m_glGetActiveUniformBlockName = NULL;
+
+// shader files as read from disk, and top-level sources with their includes expanded
+static std::map<std::string, std::string> s_sourceFiles;
+static std::map<std::string, std::string> s_expandedSources;
+
+// directory of the program binary cache; empty if the cache is disabled
+static std::string s_programCacheDir;
+
+// header of a cached program binary file
+struct NvProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x4250564E; // "NVPB"
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
 NvGLSLProgram::NvGLSLProgram()
-    : m_program(0), m_strict(false)
+    : m_program(0), m_strict(false), m_fromCache(false), m_pending(false), m_cacheKey(0)
 {
 }
 
 NvGLSLProgram::~NvGLSLProgram()
 {
+    releasePending();
     //LOGI("glDeleteProgram(%d)", m_program);
     glDeleteProgram(m_program);
     //CHECK_GL_ERROR();
@@ -87,27 +129,136 @@ NvGLSLProgram* NvGLSLProgram::createFromStrings(const char** vertSrcArray, int32
     }
 }
 
-bool NvGLSLProgram::setSourceFromFiles(const char* vertFilename, const char* fragFilename, bool strict)
+static const std::string* readSourceFile(const std::string& path)
 {
+    std::map<std::string, std::string>::iterator it = s_sourceFiles.find(path);
+    if (it != s_sourceFiles.end())
+        return &it->second;
+
     int32_t len;
-    char* vertSrc = NvAssetLoaderRead(vertFilename, len);
-    char* fragSrc = NvAssetLoaderRead(fragFilename, len);
-    if (!vertSrc || !fragSrc) {
-        NvAssetLoaderFree(vertSrc);
-        NvAssetLoaderFree(fragSrc);
+    char* data = NvAssetLoaderRead(path.c_str(), len);
+    if (!data)
+        return NULL;
+
+    std::string& src = s_sourceFiles[path];
+    src.assign(data, len);
+    NvAssetLoaderFree(data);
+
+    return &src;
+}
+
+// Returns true if the line is an #include "name" directive
+static bool parseInclude(const char* line, const char* end, std::string& name)
+{
+    while (line < end && (*line == ' ' || *line == '\t'))
+        line++;
+    if (line == end || *line++ != '#')
+        return false;
+    while (line < end && (*line == ' ' || *line == '\t'))
+        line++;
+    if (end - line < 7 || strncmp(line, "include", 7) != 0)
+        return false;
+    line += 7;
+    while (line < end && (*line == ' ' || *line == '\t'))
+        line++;
+    if (line == end || *line++ != '"')
+        return false;
+
+    const char* nameEnd = line;
+    while (nameEnd < end && *nameEnd != '"')
+        nameEnd++;
+    if (nameEnd == end || nameEnd == line)
+        return false;
+
+    name.assign(line, nameEnd);
+    return true;
+}
+
+// Appends the source of a file to out, replacing each #include line with the
+// included file.  included lists the files already expanded into out.
+static bool expandIncludes(const std::string& path, std::string& out, std::vector<std::string>& included)
+{
+    const std::string* src = readSourceFile(path);
+    if (!src)
         return false;
+
+    int32_t fileIndex = (int32_t)included.size();
+    included.push_back(path);
+
+    std::string dir = path.substr(0, path.find_last_of("/\\") + 1);
+    std::string name;
+    char lineDirective[32];
+
+    size_t pos = 0;
+    int32_t line = 1;
+    while (pos < src->size()) {
+        size_t end = src->find('\n', pos);
+        end = (end == std::string::npos) ? src->size() : end + 1;
+
+        if (!parseInclude(src->c_str() + pos, src->c_str() + end, name)) {
+            out.append(*src, pos, end - pos);
+        } else {
+            std::string includePath = dir + name;
+            if (std::find(included.begin(), included.end(), includePath) == included.end()) {
+                sprintf(lineDirective, "#line 1 %d\n", (int32_t)included.size());
+                out.append(lineDirective);
+
+                if (!expandIncludes(includePath, out, included)) {
+                    LOGE("Error including \"%s\" from %s(%d)", includePath.c_str(), path.c_str(), line);
+                    return false;
+                }
+                if (!out.empty() && out[out.size() - 1] != '\n')
+                    out.append("\n");
+            }
+
+            sprintf(lineDirective, "#line %d %d\n", line + 1, fileIndex);
+            out.append(lineDirective);
+        }
+
+        pos = end;
+        line++;
     }
 
-    bool success = setSourceFromStrings(vertSrc, fragSrc, strict);
+    return true;
+}
+
+const char* NvGLSLProgram::loadSourceFromFile(const char* filename)
+{
+    std::map<std::string, std::string>::iterator it = s_expandedSources.find(filename);
+    if (it != s_expandedSources.end())
+        return it->second.c_str();
+
+    std::string expanded;
+    std::vector<std::string> included;
+    if (!expandIncludes(filename, expanded, included))
+        return NULL;
+
+    std::string& src = s_expandedSources[filename];
+    src.swap(expanded);
 
-    NvAssetLoaderFree(vertSrc);
-    NvAssetLoaderFree(fragSrc);
+    return src.c_str();
+}
 
-    return success;
+void NvGLSLProgram::clearSourceCache()
+{
+    s_sourceFiles.clear();
+    s_expandedSources.clear();
+}
+
+bool NvGLSLProgram::setSourceFromFiles(const char* vertFilename, const char* fragFilename, bool strict)
+{
+    const char* vertSrc = loadSourceFromFile(vertFilename);
+    const char* fragSrc = loadSourceFromFile(fragFilename);
+    if (!vertSrc || !fragSrc)
+        return false;
+
+    return setSourceFromStrings(vertSrc, fragSrc, strict);
 }
 
 bool NvGLSLProgram::setSourceFromStrings(const char* vertSrc, const char* fragSrc, bool strict)
 {
+    releasePending();
+
     if (m_program) {
         glDeleteProgram(m_program);
         m_program = 0;
@@ -115,14 +266,25 @@ bool NvGLSLProgram::setSourceFromStrings(const char* vertSrc, const char* fragSr
 
     m_strict = strict;
 
-    m_program = compileProgram(vertSrc, fragSrc);
+    ShaderSourceItem items[2] = { { vertSrc, GL_VERTEX_SHADER }, { fragSrc, GL_FRAGMENT_SHADER } };
+    uint64_t key;
+    m_program = loadCachedProgram(items, 2, key);
+    m_fromCache = (m_program != 0);
+
+    if (!m_program) {
+        m_program = compileProgram(vertSrc, fragSrc);
+        storeCachedProgram(m_program, key);
+    }
 
+    reflect();
     return m_program != 0;
 }
 
 bool NvGLSLProgram::setSourceFromStrings(const char** vertSrcArray, int32_t vertSrcCount, 
     const char** fragSrcArray, int32_t fragSrcCount, bool strict)
 {
+    releasePending();
+
     if (m_program) {
         glDeleteProgram(m_program);
         m_program = 0;
@@ -130,13 +292,33 @@ bool NvGLSLProgram::setSourceFromStrings(const char** vertSrcArray, int32_t vert
 
     m_strict = strict;
 
-    m_program = compileProgram(vertSrcArray, vertSrcCount, fragSrcArray, fragSrcCount);
+    std::vector<ShaderSourceItem> items;
+    for (int32_t i = 0; i < vertSrcCount; i++) {
+        ShaderSourceItem item = { vertSrcArray[i], GL_VERTEX_SHADER };
+        items.push_back(item);
+    }
+    for (int32_t i = 0; i < fragSrcCount; i++) {
+        ShaderSourceItem item = { fragSrcArray[i], GL_FRAGMENT_SHADER };
+        items.push_back(item);
+    }
+
+    uint64_t key;
+    m_program = loadCachedProgram(items.empty() ? NULL : &items[0], (int32_t)items.size(), key);
+    m_fromCache = (m_program != 0);
+
+    if (!m_program) {
+        m_program = compileProgram(vertSrcArray, vertSrcCount, fragSrcArray, fragSrcCount);
+        storeCachedProgram(m_program, key);
+    }
 
+    reflect();
     return m_program != 0;
 }
 
 bool NvGLSLProgram::setSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict)
 {
+    releasePending();
+
     if (m_program) {
         glDeleteProgram(m_program);
         m_program = 0;
@@ -144,13 +326,339 @@ bool NvGLSLProgram::setSourceFromStrings(ShaderSourceItem* src, int32_t count, b
 
     m_strict = strict;
 
-    m_program = compileProgram(src, count);
+    uint64_t key;
+    m_program = loadCachedProgram(src, count, key);
+    m_fromCache = (m_program != 0);
 
+    if (!m_program) {
+        m_program = compileProgram(src, count);
+        storeCachedProgram(m_program, key);
+    }
+
+    reflect();
     return m_program != 0;
 }
 
+bool NvGLSLProgram::submitSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict)
+{
+    releasePending();
+
+    if (m_program) {
+        glDeleteProgram(m_program);
+        m_program = 0;
+    }
+
+    m_strict = strict;
+
+    m_uniforms.clear();
+    m_uniformBlocks.clear();
+
+    m_program = loadCachedProgram(src, count, m_cacheKey);
+    m_fromCache = (m_program != 0);
+    if (m_program) {
+        reflect();
+        return true;
+    }
+
+    // compile and link without querying any status, so that the driver is
+    // free to build this program while the next ones are submitted
+    m_program = glCreateProgram();
+    if (!m_program)
+        return false;
+
+    for (int32_t i = 0; i < count; i++) {
+        GLuint shader = glCreateShader(src[i].type);
+
+        const char* sourceItems[2];
+        int sourceCount = 0;
+        if (ms_shaderHeader)
+            sourceItems[sourceCount++] = ms_shaderHeader;
+        sourceItems[sourceCount++] = (src[i].src);
+
+        glShaderSource(shader, sourceCount, sourceItems, 0);
+        glCompileShader(shader);
+        glAttachShader(m_program, shader);
+
+        m_pendingShaders.push_back(shader);
+    }
+
+    setBinaryRetrievableHint(m_program);
+    glLinkProgram(m_program);
+
+    m_pending = true;
+    return true;
+}
+
+bool NvGLSLProgram::isBuildComplete()
+{
+    if (!m_pending || !m_glMaxShaderCompilerThreads)
+        return true;
+
+    GLint complete = 0;
+    glGetProgramiv(m_program, NV_COMPLETION_STATUS, &complete);
+    return complete != 0;
+}
+
+bool NvGLSLProgram::finishBuild()
+{
+    if (!m_pending)
+        return m_program != 0;
+
+    m_pending = false;
+
+    // blocks until the link has completed
+    GLint success = 0;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+
+    // report the shader logs (all of them in strict mode, else only failures)
+    bool compiled = true;
+    for (size_t i = 0; i < m_pendingShaders.size(); i++) {
+        GLuint shader = m_pendingShaders[i];
+        GLint type = 0;
+        glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+        glDetachShader(m_program, shader);
+
+        // checkCompileError deletes the shaders that failed
+        if (checkCompileError(shader, type))
+            glDeleteShader(shader);
+        else
+            compiled = false;
+    }
+    m_pendingShaders.clear();
+
+    if (!success)
+    {
+        if (compiled) {
+            GLint bufLength = 0;
+            glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &bufLength);
+            if (bufLength) {
+                char* buf = new char[bufLength];
+                if (buf) {
+                    glGetProgramInfoLog(m_program, bufLength, NULL, buf);
+                    LOGI("Could not link program:\n%s\n", buf);
+                    delete [] buf;
+                }
+            }
+        }
+        glDeleteProgram(m_program);
+        m_program = 0;
+        return false;
+    }
+
+    reflect();
+    storeCachedProgram(m_program, m_cacheKey);
+    return true;
+}
+
+void NvGLSLProgram::releasePending()
+{
+    for (size_t i = 0; i < m_pendingShaders.size(); i++)
+        glDeleteShader(m_pendingShaders[i]);
+    m_pendingShaders.clear();
+    m_pending = false;
+}
+
+void NvGLSLProgram::setProgramCacheDirectory(const char* path)
+{
+    if (!path || !*path) {
+        s_programCacheDir.clear();
+        return;
+    }
+
+    s_programCacheDir = path;
+
+    // fails harmlessly if the directory already exists
+    NV_MKDIR(path);
+}
+
+void NvGLSLProgram::globalInit(NvGLExtensionsAPI& api)
+{
+    const NvGfxAPIVersion& ver = NvImage::getAPIVersion();
+    bool isES = (ver.api == NvGfxAPI::GLES);
+
+    m_glGetProgramBinary = NULL;
+    m_glProgramBinary = NULL;
+    m_glProgramParameteri = NULL;
+
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 4, 1) || (isES && ver.majVersion >= 3) ||
+        api.isExtensionSupported("GL_ARB_get_program_binary")) {
+        m_glGetProgramBinary = (NV_PFNGLGETPROGRAMBINARYPROC)api.getGLProcAddress("glGetProgramBinary");
+        m_glProgramBinary = (NV_PFNGLPROGRAMBINARYPROC)api.getGLProcAddress("glProgramBinary");
+        m_glProgramParameteri = (NV_PFNGLPROGRAMPARAMETERIPROC)api.getGLProcAddress("glProgramParameteri");
+    } else if (api.isExtensionSupported("GL_OES_get_program_binary")) {
+        m_glGetProgramBinary = (NV_PFNGLGETPROGRAMBINARYPROC)api.getGLProcAddress("glGetProgramBinaryOES");
+        m_glProgramBinary = (NV_PFNGLPROGRAMBINARYPROC)api.getGLProcAddress("glProgramBinaryOES");
+    }
+
+    m_glMaxShaderCompilerThreads = NULL;
+    if (api.isExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        m_glMaxShaderCompilerThreads = (NV_PFNGLMAXSHADERCOMPILERTHREADSPROC)api.getGLProcAddress("glMaxShaderCompilerThreadsKHR");
+    } else if (api.isExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        m_glMaxShaderCompilerThreads = (NV_PFNGLMAXSHADERCOMPILERTHREADSPROC)api.getGLProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+
+    m_glGetActiveUniformsiv = NULL;
+    m_glGetActiveUniformBlockiv = NULL;
+    m_glGetActiveUniformBlockName = NULL;
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 3, 1) || (isES && ver.majVersion >= 3) ||
+        api.isExtensionSupported("GL_ARB_uniform_buffer_object")) {
+        m_glGetActiveUniformsiv = (NV_PFNGLGETACTIVEUNIFORMSIVPROC)api.getGLProcAddress("glGetActiveUniformsiv");
+        m_glGetActiveUniformBlockiv = (NV_PFNGLGETACTIVEUNIFORMBLOCKIVPROC)api.getGLProcAddress("glGetActiveUniformBlockiv");
+        m_glGetActiveUniformBlockName = (NV_PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC)api.getGLProcAddress("glGetActiveUniformBlockName");
+        if (!m_glGetActiveUniformBlockiv || !m_glGetActiveUniformBlockName)
+            m_glGetActiveUniformsiv = NULL;
+    }
+
+    // let the driver pick the number of compiler threads
+    if (m_glMaxShaderCompilerThreads)
+        m_glMaxShaderCompilerThreads(0xFFFFFFFF);
+
+    // a driver may expose the entry points without supporting a single format
+    if (m_glGetProgramBinary && m_glProgramBinary) {
+        GLint formats = 0;
+        glGetIntegerv(NV_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0) {
+            m_glGetProgramBinary = NULL;
+            m_glProgramBinary = NULL;
+            m_glProgramParameteri = NULL;
+        }
+    }
+}
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char* str)
+{
+    // include the terminator so that adjacent strings cannot run together
+    return str ? hashBytes(hash, str, strlen(str) + 1) : hashBytes(hash, "", 1);
+}
+
+uint64_t NvGLSLProgram::computeCacheKey(const ShaderSourceItem* src, int32_t count)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    hash = hashString(hash, ms_shaderHeader);
+
+    for (int32_t i = 0; i < count; i++) {
+        hash = hashBytes(hash, &src[i].type, sizeof(src[i].type));
+        hash = hashString(hash, src[i].src);
+    }
+
+    // 0 means "not cached"
+    return hash ? hash : 1;
+}
+
+static std::string getCacheFilename(uint64_t key)
+{
+    char name[32];
+    sprintf(name, "/%08x%08x.bin", (uint32_t)(key >> 32), (uint32_t)key);
+    return s_programCacheDir + name;
+}
+
+GLuint NvGLSLProgram::loadCachedProgram(const ShaderSourceItem* src, int32_t count, uint64_t& key)
+{
+    key = 0;
+    if (s_programCacheDir.empty() || !isProgramBinarySupported())
+        return 0;
+
+    key = computeCacheKey(src, count);
+
+    FILE* fp = fopen(getCacheFilename(key).c_str(), "rb");
+    if (!fp)
+        return 0;
+
+    NvProgramCacheHeader header;
+    std::vector<uint8_t> binary;
+    bool valid = (fread(&header, sizeof(header), 1, fp) == 1) &&
+        (header.magic == PROGRAM_CACHE_MAGIC) && (header.version == PROGRAM_CACHE_VERSION) &&
+        (header.key == key) && (header.length > 0);
+
+    if (valid) {
+        binary.resize(header.length);
+        valid = (fread(&binary[0], 1, header.length, fp) == header.length);
+    }
+    fclose(fp);
+
+    if (!valid)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    m_glProgramBinary(program, header.binaryFormat, &binary[0], header.length);
+
+    // the driver rejects binaries from other driver builds or hardware
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        LOGI("Cached program binary was rejected; recompiling");
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void NvGLSLProgram::storeCachedProgram(GLuint program, uint64_t key)
+{
+    if (!program || !key || !isProgramBinarySupported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, NV_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    NvProgramCacheHeader header;
+    std::vector<uint8_t> binary(length);
+    GLsizei written = 0;
+    GLenum binaryFormat = 0;
+    m_glGetProgramBinary(program, length, &written, &binaryFormat, &binary[0]);
+    if (written <= 0)
+        return;
+
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.length = written;
+
+    std::string filename = getCacheFilename(key);
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        LOGI("Could not write program cache file %s", filename.c_str());
+        return;
+    }
+
+    bool success = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+        (fwrite(&binary[0], 1, written, fp) == (size_t)written);
+    fclose(fp);
+
+    // never leave a partial binary behind
+    if (!success)
+        remove(filename.c_str());
+}
+
+void NvGLSLProgram::setBinaryRetrievableHint(GLuint program)
+{
+    if (m_glProgramParameteri && !s_programCacheDir.empty())
+        m_glProgramParameteri(program, NV_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
 void NvGLSLProgram::enable()
 {
+    if (m_pending)
+        finishBuild();
     glUseProgram(m_program);
 }
 
@@ -226,6 +734,7 @@ GLuint NvGLSLProgram::compileProgram(const char *vsource, const char *fsource)
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    setBinaryRetrievableHint(program);
     glLinkProgram(program);
 
     // check if program linked
@@ -303,6 +812,7 @@ GLuint NvGLSLProgram::compileProgram(
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    setBinaryRetrievableHint(program);
     glLinkProgram(program);
 
     // check if program linked
@@ -355,6 +865,7 @@ GLuint NvGLSLProgram::compileProgram(ShaderSourceItem* src, int32_t count)
         glDeleteShader(shader);
     }
 
+    setBinaryRetrievableHint(program);
     glLinkProgram(program);
 
     // check if program linked
@@ -382,6 +893,14 @@ GLuint NvGLSLProgram::compileProgram(ShaderSourceItem* src, int32_t count)
 
 bool NvGLSLProgram::relink()
 {
+    if (m_pending && !finishBuild())
+        return false;
+
+    if (m_fromCache) {
+        LOGE("Program %d was restored from the program cache and cannot be relinked", m_program);
+        return false;
+    }
+
     glLinkProgram(m_program);
 
     // check if program linked
@@ -402,11 +921,16 @@ bool NvGLSLProgram::relink()
         }
         return false;
     }
+
+    reflect();
     return true;
 }
 
 GLint NvGLSLProgram::getAttribLocation(const char* attribute, bool isOptional)
 {
+    if (m_pending)
+        finishBuild();
+
     GLint result = glGetAttribLocation(m_program, attribute);
 
     if (result == -1)
@@ -426,7 +950,15 @@ GLint NvGLSLProgram::getAttribLocation(const char* attribute, bool isOptional)
 
 GLint NvGLSLProgram::getUniformLocation(const char* uniform, bool isOptional)
 {
-    GLint result = glGetUniformLocation(m_program, uniform);
+    GLint result = -1;
+
+    int32_t index = findUniform(uniform);
+    if (index >= 0) {
+        result = m_uniforms[index].location;
+    } else if (strchr(uniform, '[')) {
+        // the table only holds whole arrays
+        result = glGetUniformLocation(m_program, uniform);
+    }
 
     if (result == -1)
     {
@@ -443,6 +975,150 @@ GLint NvGLSLProgram::getUniformLocation(const char* uniform, bool isOptional)
     return result;
 }
 
+bool NvGLSLProgram::checkUniformBlockLayout(const char* blockName, const UniformBlockMember* members,
+    int32_t count, GLint size)
+{
+    int32_t blockIndex = findUniformBlock(blockName);
+    if (blockIndex < 0)
+        return true;
+
+    bool matches = true;
+
+    const UniformBlockInfo& block = m_uniformBlocks[blockIndex];
+    if (block.dataSize > size) {
+        LOGE("uniform block %s of program %d is %d bytes, but only %d are uploaded",
+            blockName, m_program, block.dataSize, size);
+        matches = false;
+    }
+
+    for (int32_t i = 0; i < count; i++) {
+        // inactive members have no offset
+        int32_t index = findUniform(members[i].name);
+        if (index < 0)
+            continue;
+
+        const UniformInfo& uniform = m_uniforms[index];
+        if (uniform.block != blockIndex) {
+            LOGE("uniform %s of program %d is not a member of block %s", members[i].name, m_program, blockName);
+            matches = false;
+        } else if (uniform.offset != members[i].offset) {
+            LOGE("uniform %s of program %d is at offset %d in the shader, but at %d in the uploaded data",
+                members[i].name, m_program, uniform.offset, members[i].offset);
+            matches = false;
+        }
+    }
+
+    return matches;
+}
+
+static bool uniformNameLess(const NvGLSLProgram::UniformInfo& uniform, const char* name)
+{
+    return strcmp(uniform.name.c_str(), name) < 0;
+}
+
+static bool uniformLess(const NvGLSLProgram::UniformInfo& a, const NvGLSLProgram::UniformInfo& b)
+{
+    return a.name < b.name;
+}
+
+void NvGLSLProgram::reflect()
+{
+    m_uniforms.clear();
+    m_uniformBlocks.clear();
+
+    if (!m_program)
+        return;
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> name(maxLength + 1);
+    std::vector<GLuint> indices(count);
+    m_uniforms.resize(count);
+
+    for (GLint i = 0; i < count; i++) {
+        UniformInfo& uniform = m_uniforms[i];
+        GLsizei length = 0;
+        name[0] = '\0';
+        glGetActiveUniform(m_program, i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, &name[0]);
+
+        uniform.location = glGetUniformLocation(m_program, &name[0]);
+        uniform.block = -1;
+        uniform.offset = -1;
+
+        // arrays are reported by their first element, but looked up by their name
+        if (length > 3 && strcmp(&name[length - 3], "[0]") == 0)
+            length -= 3;
+        uniform.name.assign(&name[0], length);
+
+        indices[i] = i;
+    }
+
+    if (count && m_glGetActiveUniformsiv) {
+        std::vector<GLint> blocks(count);
+        std::vector<GLint> offsets(count);
+        m_glGetActiveUniformsiv(m_program, count, &indices[0], NV_UNIFORM_BLOCK_INDEX, &blocks[0]);
+        m_glGetActiveUniformsiv(m_program, count, &indices[0], NV_UNIFORM_OFFSET, &offsets[0]);
+
+        for (GLint i = 0; i < count; i++) {
+            m_uniforms[i].block = blocks[i];
+            m_uniforms[i].offset = (blocks[i] >= 0) ? offsets[i] : -1;
+        }
+
+        GLint blockCount = 0;
+        glGetProgramiv(m_program, NV_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+        m_uniformBlocks.resize(blockCount);
+
+        for (GLint i = 0; i < blockCount; i++) {
+            UniformBlockInfo& block = m_uniformBlocks[i];
+
+            GLint nameLength = 0;
+            m_glGetActiveUniformBlockiv(m_program, i, NV_UNIFORM_BLOCK_NAME_LENGTH, &nameLength);
+            if (nameLength > 0) {
+                std::vector<GLchar> blockName(nameLength + 1);
+                GLsizei length = 0;
+                m_glGetActiveUniformBlockName(m_program, i, nameLength + 1, &length, &blockName[0]);
+                block.name.assign(&blockName[0], length);
+            }
+
+            block.binding = 0;
+            block.dataSize = 0;
+            m_glGetActiveUniformBlockiv(m_program, i, NV_UNIFORM_BLOCK_BINDING, &block.binding);
+            m_glGetActiveUniformBlockiv(m_program, i, NV_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+        }
+    }
+
+    std::sort(m_uniforms.begin(), m_uniforms.end(), uniformLess);
+}
+
+int32_t NvGLSLProgram::findUniform(const char* name)
+{
+    if (m_pending)
+        finishBuild();
+
+    std::vector<UniformInfo>::const_iterator it =
+        std::lower_bound(m_uniforms.begin(), m_uniforms.end(), name, uniformNameLess);
+    if (it == m_uniforms.end() || it->name != name)
+        return -1;
+
+    return (int32_t)(it - m_uniforms.begin());
+}
+
+int32_t NvGLSLProgram::findUniformBlock(const char* name)
+{
+    if (m_pending)
+        finishBuild();
+
+    for (size_t i = 0; i < m_uniformBlocks.size(); i++) {
+        if (m_uniformBlocks[i].name == name)
+            return (int32_t)i;
+    }
+
+    return -1;
+}
+
 void NvGLSLProgram::bindTexture2D(const char *name, int32_t unit, GLuint tex)
 {
     GLint loc = getUniformLocation(name, false);
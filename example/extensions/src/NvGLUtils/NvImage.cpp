@@ -36,9 +36,12 @@
 #include <algorithm>
 
 #include "NvGLUtils/NvImage.h"
-#include "BlockDXT.h"
+#include "BlockDXTDecode.h"
 
 #include "NvGLEnums.h"
+#include "NV/NvLogs.h"
+#include "NV/NvTime.h"
+#include "NV/NvTaskPool.h"
 
 using std::vector;
 using std::max;
@@ -48,7 +51,9 @@ using std::max;
 #endif
 
 NvImage::FormatInfo NvImage::formatTable[] = {
-    { "dds", NvImage::readDDS, 0}
+    { "dds", NvImage::readDDS, 0},
+    { "ktx", NvImage::readKTX, 0},
+    { "ktx2", NvImage::readKTX2, 0}
 };
 
 bool NvImage::upperLeftOrigin = true;
@@ -66,7 +71,7 @@ void NvImage::UpperLeftOrigin( bool ul) {
 //
 ////////////////////////////////////////////////////////////
 NvImage::NvImage() : _width(0), _height(0), _depth(0), _levelCount(0), _layers(0), _format(GL_RGBA),
-    _internalFormat(GL_RGBA8), _type(GL_UNSIGNED_BYTE), _elementSize(0), _cubeMap(false) {
+    _internalFormat(GL_RGBA8), _type(GL_UNSIGNED_BYTE), _elementSize(0), _cubeMap(false), _arena(NULL) {
 }
 
 //
@@ -80,8 +85,13 @@ NvImage::~NvImage() {
 //
 ////////////////////////////////////////////////////////////
 void NvImage::freeData() {
-    for (vector<uint8_t*>::iterator it = _data.begin(); it != _data.end(); it++) {
-        delete []*it;
+    if (_arena) {
+        delete []_arena;
+        _arena = NULL;
+    } else {
+        for (vector<uint8_t*>::iterator it = _data.begin(); it != _data.end(); it++) {
+            delete []*it;
+        }
     }
     _data.clear();
 }
@@ -194,14 +204,15 @@ void* NvImage::getLayerLevel( int32_t level, int32_t layer) {
 //
 //
 ////////////////////////////////////////////////////////////
-bool NvImage::loadImageFromFileData(const uint8_t* fileData, size_t size, const char* fileExt) {
+bool NvImage::loadImageFromFileData(const uint8_t* fileData, size_t size, const char* fileExt,
+    SurfaceListener* listener) {
     int32_t formatCount = sizeof(NvImage::formatTable) / sizeof(NvImage::FormatInfo);
 
     //try to match by format first
     for ( int32_t ii = 0; ii < formatCount; ii++) {
         if ( ! strcasecmp( formatTable[ii].extension, fileExt)) {
             //extension matches, load it
-            return formatTable[ii].reader( fileData, size, *this);
+            return formatTable[ii].reader( fileData, size, *this, listener);
         }
     }
 
@@ -356,6 +367,10 @@ static inline int32_t min(int32_t a, int32_t b) {
 ////////////////////////////////////////////////////////////
 uint8_t* NvImage::expandDXT(uint8_t *surf, int32_t width, int32_t height, int32_t depth)
 {
+    nv::DXTDecodeFormat format;
+    if (!nv::getDXTDecodeFormat(_format, format))
+        return NULL;
+
     depth = (depth) ? depth : 1;
 
     uint32_t* dest = new uint32_t[width * height * depth];
@@ -363,88 +378,329 @@ uint8_t* NvImage::expandDXT(uint8_t *surf, int32_t width, int32_t height, int32_
 
     int32_t bh = (height + 3) / 4;
     int32_t bw = (width + 3) / 4;
+    uint32_t rowSize = bw * nv::getDXTDecodeBlockSize(format);
+
+    for (int32_t k = 0; k < depth; k++) {
+        for (int32_t j = 0; j < bh; j++) {
+            nv::decodeDXTBlockRow(format, surf, width, min(4, height - 4 * j),
+                plane + 4 * j * width, width);
+            surf += rowSize;
+        }
+
+        plane += width * height;
+    }
+
+    return (uint8_t*)dest;
+}
 
-    if (_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
-        for (int32_t k = 0; k < depth; k++) {
+//
+//
+////////////////////////////////////////////////////////////
+float NvImage::BenchmarkDXTExpansion(uint32_t format, int32_t width, int32_t height, int32_t iterations)
+{
+    nv::DXTDecodeFormat decodeFormat;
+    if (!nv::getDXTDecodeFormat(format, decodeFormat)) {
+        LOGE("BenchmarkDXTExpansion: format 0x%x cannot be expanded", format);
+        return 0.0f;
+    }
 
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4, height - 4 * j);
+    int32_t blockCount = ((width + 3) / 4) * ((height + 3) / 4);
+    int32_t size = blockCount * nv::getDXTDecodeBlockSize(decodeFormat);
 
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT1* block = (nv::BlockDXT1*)surf;
-                    nv::ColorBlock color;
+    // pseudo-random blocks exercise every palette mode and index
+    uint8_t* blocks = new uint8_t[size];
+    uint32_t seed = 0x12345678;
+    for (int32_t b = 0; b < size; b++) {
+        seed = seed * 1664525 + 1013904223;
+        blocks[b] = (uint8_t)(seed >> 24);
+    }
 
-                    block->decodeBlock(&color);
+    NvImage image;
+    image._format = format;
 
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
+    NvUST start = NvTimeGetTime();
+    for (int32_t iter = 0; iter < iterations; iter++)
+        delete[] image.expandDXT(blocks, width, height, 1);
+    float seconds = NvTimeDiffInSecs(NvTimeGetTime(), start);
 
-                    surf += sizeof(nv::BlockDXT1); // 64bits
+    delete[] blocks;
+
+    return (seconds > 0.0f)
+        ? ((float)width * height * iterations) / (seconds * 1.0e6f) : 0.0f;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+const char* NvImage::GetDXTExpansionPath()
+{
+    return nv::getDXTDecodePath();
+}
+
+//
+// Work shared by the tasks that decode the surfaces of one image file.  Each
+// task handles a band of rows of one surface, reading straight from the file
+// data and writing its final pixels into the image arena.
+//////////////////////////////////////////////////////////////////////
+
+// target size of the output of a single task
+const int32_t DECODE_BAND_BYTES = 64 * 1024;
+
+struct DecodeSurface {
+    const uint8_t* src;     // surface in the file data
+    uint8_t* dst;           // surface in the image arena
+    int32_t width;
+    int32_t height;
+    int32_t depth;
+    int32_t firstBand;
+    int32_t bandCount;
+};
+
+struct DecodeBand {
+    int32_t surface;
+    int32_t slice;
+    int32_t firstRow;       // pixel rows, or block rows for compressed data
+    int32_t rowCount;
+};
+
+struct DecodeJob {
+    vector<DecodeSurface> surfaces;
+    vector<DecodeBand> bands;
+    int32_t bandOffset;     // first band of the current batch
+    int32_t elementSize;    // bytes per pixel, or per block for compressed data
+    bool compressed;
+    bool flip;
+    bool swap;
+    bool expand;
+    nv::DXTDecodeFormat decodeFormat;
+    void (*flipBlocks)(uint8_t*, uint32_t);
+};
+
+//
+// decode one band: flip, component swap and DXT expansion in a single pass
+////////////////////////////////////////////////////////////
+void NvImage::decodeSurfaceBand(void* data, int32_t index) {
+    const DecodeJob& job = *(const DecodeJob*)data;
+    const DecodeBand& band = job.bands[job.bandOffset + index];
+    const DecodeSurface& surf = job.surfaces[band.surface];
+    const int32_t lastRow = band.firstRow + band.rowCount;
+
+    if (!job.compressed) {
+        int32_t lineSize = surf.width * job.elementSize;
+        int32_t sliceSize = lineSize * surf.height;
+        const uint8_t* src = surf.src + band.slice * sliceSize;
+        uint8_t* dst = surf.dst + band.slice * sliceSize;
+
+        for (int32_t y = band.firstRow; y < lastRow; y++) {
+            const uint8_t* in = src + ((job.flip) ? (surf.height - 1 - y) : y) * lineSize;
+            uint8_t* out = dst + y * lineSize;
+
+            if (job.swap) {
+                for (int32_t x = 0; x < surf.width; x++) {
+                    out[0] = in[2];
+                    out[1] = in[1];
+                    out[2] = in[0];
+                    if (job.elementSize == 4)
+                        out[3] = in[3];
+                    in += job.elementSize;
+                    out += job.elementSize;
                 }
+            } else {
+                memcpy(out, in, lineSize);
             }
+        }
+        return;
+    }
+
+    int32_t bw = (surf.width + 3) / 4;
+    int32_t bh = (surf.height + 3) / 4;
+    int32_t lineSize = bw * job.elementSize;
+    const uint8_t* src = surf.src + band.slice * bh * lineSize;
 
-            plane += width * height;
+    if (!job.expand) {
+        uint8_t* dst = surf.dst + band.slice * bh * lineSize;
+
+        for (int32_t j = band.firstRow; j < lastRow; j++) {
+            uint8_t* out = dst + j * lineSize;
+            memcpy(out, src + ((job.flip) ? (bh - 1 - j) : j) * lineSize, lineSize);
+            if (job.flip)
+                job.flipBlocks(out, bw);
+        }
+        return;
+    }
+
+    uint32_t* dst = (uint32_t*)surf.dst + band.slice * surf.width * surf.height;
+    uint8_t* flipped = (job.flip) ? new uint8_t[lineSize] : NULL;
+
+    for (int32_t j = band.firstRow; j < lastRow; j++) {
+        const uint8_t* in = src + ((job.flip) ? (bh - 1 - j) : j) * lineSize;
+        if (flipped) {
+            memcpy(flipped, in, lineSize);
+            job.flipBlocks(flipped, bw);
+            in = flipped;
         }
-    } else if (_format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
-        for (int32_t k = 0; k < depth; k++) {
 
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4, height - 4 * j);
+        int32_t rows = surf.height - 4 * j;
+        nv::decodeDXTBlockRow(job.decodeFormat, in, surf.width, (rows < 4) ? rows : 4,
+            dst + 4 * j * surf.width, surf.width);
+    }
 
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT3* block = (nv::BlockDXT3*)surf;
-                    nv::ColorBlock color;
+    delete []flipped;
+}
 
-                    block->decodeBlock(&color);
+//
+// lay out the surfaces in a single arena and decode them into it, applying the
+// flip, component swap and DXT expansion required by the target API
+////////////////////////////////////////////////////////////
+bool NvImage::decodeSurfaces(const vector<const uint8_t*>& sources, bool compressed, bool flip,
+    SurfaceListener* listener) {
+    const NvGfxAPIVersion& api = NvImage::getAPIVersion();
+
+    bool isES = (api.api == NvGfxAPI::GLES);
+    bool mustExpandDXT = m_expandDXT &&
+        ((_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ||
+        (_format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) ||
+        (_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT));
+
+    // ES has no RGTC/LATC; expand the unsigned variants as well
+    bool mustExpandBC45 = m_expandDXT && isES &&
+        ((_format == GL_COMPRESSED_RED_RGTC1) ||
+        (_format == GL_COMPRESSED_RG_RGTC2) ||
+        (_format == GL_COMPRESSED_LUMINANCE_LATC1_EXT) ||
+        (_format == GL_COMPRESSED_LUMINANCE_ALPHA_LATC2_EXT));
+    if (mustExpandBC45)
+        mustExpandDXT = true;
+
+    DecodeJob job;
+    job.bandOffset = 0;
+    job.elementSize = _elementSize;
+    job.compressed = compressed;
+    job.flip = flip;
+    job.swap = isES && !compressed && (_type == GL_UNSIGNED_BYTE) &&
+        ((_format == GL_BGR) || (_format == GL_BGRA));
+    job.expand = mustExpandDXT && nv::getDXTDecodeFormat(_format, job.decodeFormat);
+    job.flipBlocks = NULL;
+
+    if (compressed) {
+        switch (_format)
+        {
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                job.flipBlocks = &NvImage::flip_blocks_dxtc1;
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+                job.flipBlocks = &NvImage::flip_blocks_dxtc3;
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                job.flipBlocks = &NvImage::flip_blocks_dxtc5;
+                break;
+            case GL_COMPRESSED_LUMINANCE_LATC1_EXT:
+            case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1_EXT:
+            case GL_COMPRESSED_RED_RGTC1:
+            case GL_COMPRESSED_SIGNED_RED_RGTC1:
+                job.flipBlocks = &NvImage::flip_blocks_bc4;
+                break;
+            case GL_COMPRESSED_LUMINANCE_ALPHA_LATC2_EXT:
+            case GL_COMPRESSED_SIGNED_LUMINANCE_ALPHA_LATC2_EXT:
+            case GL_COMPRESSED_RG_RGTC2:
+            case GL_COMPRESSED_SIGNED_RG_RGTC2:
+                job.flipBlocks = &NvImage::flip_blocks_bc5;
+                break;
+        }
 
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
+        // formats without a block flip are passed through unflipped
+        job.flip = job.flip && (job.flipBlocks != NULL);
+    }
 
-                    surf += sizeof(nv::BlockDXT3); // 64bits
+    // lay out every face and level in a single arena, split into bands of rows
+    size_t arenaSize = 0;
+    vector<size_t> dstOffsets;
+
+    for (int32_t layer = 0; layer < _layers; layer++) {
+        int32_t w = _width, h = _height, d = (_depth) ? _depth : 1;
+        for (int32_t level = 0; level < _levelCount; level++) {
+            int32_t bw = (compressed) ? (w+3)/4 : w;
+            int32_t bh = (compressed) ? (h+3)/4 : h;
+            size_t size = bw*bh*d*_elementSize;
+
+            DecodeSurface surf;
+            surf.src = sources[layer * _levelCount + level];
+            surf.dst = NULL;
+            surf.width = w;
+            surf.height = h;
+            surf.depth = d;
+            surf.firstBand = (int32_t)job.bands.size();
+
+            int32_t surfaceIndex = (int32_t)job.surfaces.size();
+            job.surfaces.push_back(surf);
+            dstOffsets.push_back(arenaSize);
+
+            int32_t rowBytes = (job.expand) ? w * 4 * 4 : bw * _elementSize;
+            int32_t rowsPerBand = std::max(DECODE_BAND_BYTES / std::max(rowBytes, 1), 1);
+
+            for (int32_t slice = 0; slice < d; slice++) {
+                for (int32_t row = 0; row < bh; row += rowsPerBand) {
+                    DecodeBand band;
+                    band.surface = surfaceIndex;
+                    band.slice = slice;
+                    band.firstRow = row;
+                    band.rowCount = std::min(rowsPerBand, bh - row);
+                    job.bands.push_back(band);
                 }
             }
 
-            plane += width * height;
+            job.surfaces.back().bandCount = (int32_t)job.bands.size() - job.surfaces.back().firstBand;
+
+            arenaSize += (job.expand) ? w*h*d*4 : size;
+            arenaSize = (arenaSize + 15) & ~(size_t)15;
+
+            //reduce mip sizes
+            w = ( w > 1) ? w >> 1 : 1;
+            h = ( h > 1) ? h >> 1 : 1;
+            d = ( d > 1) ? d >> 1 : 1;
         }
-    } else {
-        for (int32_t k = 0; k < depth; k++) {
+    }
 
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4U, height - 4 * j);
+    _arena = new uint8_t[arenaSize];
+    for (size_t s = 0; s < job.surfaces.size(); s++) {
+        job.surfaces[s].dst = _arena + dstOffsets[s];
+        _data.push_back(job.surfaces[s].dst);
+    }
 
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT5* block = (nv::BlockDXT5*)surf;
-                    nv::ColorBlock color;
+    if (job.swap)
+        _format = (_format == GL_BGR) ? GL_RGB : GL_RGBA;
 
-                    block->decodeBlock(&color);
+    if (job.expand) {
+        _format = GL_RGBA;
+        _type = GL_UNSIGNED_BYTE;
+        _elementSize = 4;
+        if (mustExpandBC45)
+            _internalFormat = GL_RGBA8;
+    }
 
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
+    NvTaskPool& pool = NvTaskPool::getShared();
 
-                    surf += sizeof(nv::BlockDXT5); // 64bits
-                }
-            }
+    if (!listener) {
+        pool.parallelFor((int32_t)job.bands.size(), &NvImage::decodeSurfaceBand, &job);
+    } else {
+        if (!listener->imageReady(*this)) {
+            freeData();
+            return false;
+        }
 
-            plane += width * height;
+        // decode one surface at a time, so that the listener can hand each
+        // surface off (e.g. to an asynchronous GL transfer) before the next
+        // one is decoded
+        for (int32_t layer = 0; layer < _layers; layer++) {
+            for (int32_t level = 0; level < _levelCount; level++) {
+                const DecodeSurface& surf = job.surfaces[layer * _levelCount + level];
+                job.bandOffset = surf.firstBand;
+                pool.parallelFor(surf.bandCount, &NvImage::decodeSurfaceBand, &job);
+                listener->surfaceReady(*this, level, layer);
+            }
         }
     }
 
-    return (uint8_t*)dest;
+    return true;
 }
 
 //
@@ -543,7 +799,12 @@ bool NvImage::convertCrossToCubemap() {
     _cubeMap = true;
 
     //delete the old pointer
-    delete []data;
+    if (_arena) {
+        delete []_arena;
+        _arena = NULL;
+    } else {
+        delete []data;
+    }
 
     return true;
 }
@@ -33,6 +33,8 @@
 //----------------------------------------------------------------------------------
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 
 #include "NvGLUtils/NvImage.h"
 #include "NvFilePtr.h"
@@ -684,7 +686,7 @@ bool TranslateDX10Format( const void *ptr, NvImage &i, int32_t &bytesPerElement,
 //
 //
 ////////////////////////////////////////////////////////////
-bool NvImage::readDDS(const uint8_t* data, size_t length, NvImage& i) {
+bool NvImage::readDDS(const uint8_t* data, size_t length, NvImage& i, SurfaceListener* listener) {
 
     // open file
     //FILE *fp = fopen(file, "rb");
@@ -1151,42 +1153,27 @@ bool NvImage::readDDS(const uint8_t* data, size_t length, NvImage& i) {
 
     i._elementSize = bytesPerElement;
 
-    i._data.clear();
+    i.freeData();
 
-    const NvGfxAPIVersion& api = NvImage::getAPIVersion();
-
-    bool isES = (api.api == NvGfxAPI::GLES);
-    bool mustExpandDXT = m_expandDXT &&
-        ((i._format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ||
-        (i._format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) ||
-        (i._format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT));
+    // locate every face and level in the file data
+    vector<const uint8_t*> sources;
+    size_t srcOffset = fp->Tell();
 
     for (int32_t face = 0; face < i._layers; face++) {
         int32_t w = i._width, h = i._height, d = (i._depth) ? i._depth : 1;
         for (int32_t level = 0; level < i._levelCount; level++) {
             int32_t bw = (btcCompressed) ? (w+3)/4 : w;
             int32_t bh = (btcCompressed) ? (h+3)/4 : h;
-            int32_t size = bw*bh*d*bytesPerElement;
-
-            uint8_t *pixels = new uint8_t[size];
-
-            //fread( data, size, 1, fp);
-            fp->Read( size, pixels);
-
-            if ( NvImage::upperLeftOrigin && !i._cubeMap)
-                i.flipSurface( pixels, w, h, d);
-
-            if (isES)
-                i.componentSwapSurface(pixels, w, h, d);
+            size_t size = bw*bh*d*bytesPerElement;
 
-            // do we need to expand DXT?
-            if (mustExpandDXT) {
-                uint8_t* expandedPixels = i.expandDXT(pixels, w, h, d);
-                delete[] pixels;
-                pixels = expandedPixels;
+            if (srcOffset + size > length) {
+                LOGE("DDS data is truncated (%d levels, %d layers expected)", i._levelCount, i._layers);
+                delete fp;
+                return false;
             }
 
-            i._data.push_back(pixels);
+            sources.push_back(data + srcOffset);
+            srcOffset += size;
 
             //reduce mip sizes
             w = ( w > 1) ? w >> 1 : 1;
@@ -1195,14 +1182,11 @@ bool NvImage::readDDS(const uint8_t* data, size_t length, NvImage& i) {
         }
     }
 
-    if (mustExpandDXT) {
-        i._format = GL_RGBA;
-        i._type = GL_UNSIGNED_BYTE;
-    }
+    bool result = i.decodeSurfaces(sources, btcCompressed, NvImage::upperLeftOrigin && !i._cubeMap, listener);
 
     //fclose(fp);
     delete fp;
-    return true;
+    return result;
 }
 
 //
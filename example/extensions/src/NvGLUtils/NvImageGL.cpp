@@ -35,6 +35,8 @@
 #include "NvAssetLoader/NvAssetLoader.h"
 #include "NvGLUtils/NvImage.h"
 
+#include <string.h>
+
 NvImage* NvImage::CreateFromDDSFile(const char* filename) {
     int32_t len;
     char* ddsData = NvAssetLoaderRead(filename, len);
@@ -54,6 +56,42 @@ NvImage* NvImage::CreateFromDDSFile(const char* filename) {
     return image;
 }
 
+NvImage* NvImage::CreateFromFile(const char* filename) {
+    const char* ext = strrchr(filename, '.');
+    if (!ext)
+        return NULL;
+
+    int32_t len;
+    char* fileData = NvAssetLoaderRead(filename, len);
+
+    if (!fileData)
+        return NULL;
+
+    NvImage* image = new NvImage;
+    bool result = image->loadImageFromFileData((const uint8_t*)fileData, len, ext + 1);
+
+    NvAssetLoaderFree(fileData);
+    if (!result) {
+        delete image;
+        image = NULL;
+    }
+
+    return image;
+}
+
+uint32_t NvImage::UploadTextureFromFile(const char* filename) {
+    NvImage* image = CreateFromFile(filename);
+
+    if (!image)
+        return 0;
+
+    GLuint texID = NvImage::UploadTexture(image);
+
+    delete image;
+
+    return texID;
+}
+
 uint32_t NvImage::UploadTextureFromDDSFile(const char* filename) {
     int32_t len;
     char* ddsData = NvAssetLoaderRead(filename, len);
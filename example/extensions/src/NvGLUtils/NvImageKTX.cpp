@@ -0,0 +1,542 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvImageKTX.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "NvGLUtils/NvImage.h"
+#include "NvGLEnums.h"
+#include "NV/NvLogs.h"
+
+#ifdef NV_USE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::vector;
+
+//
+//  Structure defines and constants from the KTX 1.1 and KTX 2.0 specifications
+//
+//////////////////////////////////////////////////////////////////////
+
+static const uint8_t KTX_IDENTIFIER[12] =
+    { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint8_t KTX2_IDENTIFIER[12] =
+    { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+const uint32_t KTX_ENDIAN_REF = 0x04030201;
+
+// KTX2 supercompression schemes
+const uint32_t KTX2_SS_NONE = 0;
+const uint32_t KTX2_SS_BASIS_LZ = 1;
+const uint32_t KTX2_SS_ZSTD = 2;
+const uint32_t KTX2_SS_ZLIB = 3;
+
+struct KTX_HEADER
+{
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// the 64-bit supercompression global data fields are not 8-byte aligned
+// in the file, so they are kept as pairs of 32-bit words
+struct KTX2_HEADER
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint32_t sgdByteOffset[2];
+    uint32_t sgdByteLength[2];
+};
+
+struct KTX2_LEVEL
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// GL description of the formats NvImage can hold, keyed by VkFormat for
+// KTX2 and by compressed internal format for KTX.  Compressed formats keep
+// the linear S3TC/RGTC enum in the format so that they can be flipped and
+// expanded, while the internal format carries the sRGB variant.
+struct KTX_FORMAT
+{
+    uint32_t vkFormat;
+    uint32_t format;
+    uint32_t internalFormat;
+    uint32_t type;
+    int32_t elementSize;    // bytes per pixel, or per 4x4 block
+    bool compressed;
+};
+
+static const KTX_FORMAT KTX_FORMATS[] = {
+    {   9, GL_RED,  GL_R8,           GL_UNSIGNED_BYTE, 1, false }, // R8_UNORM
+    {  16, GL_RG,   GL_RG8,          GL_UNSIGNED_BYTE, 2, false }, // R8G8_UNORM
+    {  23, GL_RGB,  GL_RGB8,         GL_UNSIGNED_BYTE, 3, false }, // R8G8B8_UNORM
+    {  29, GL_RGB,  GL_SRGB8,        GL_UNSIGNED_BYTE, 3, false }, // R8G8B8_SRGB
+    {  30, GL_BGR,  GL_RGB8,         GL_UNSIGNED_BYTE, 3, false }, // B8G8R8_UNORM
+    {  36, GL_BGR,  GL_SRGB8,        GL_UNSIGNED_BYTE, 3, false }, // B8G8R8_SRGB
+    {  37, GL_RGBA, GL_RGBA8,        GL_UNSIGNED_BYTE, 4, false }, // R8G8B8A8_UNORM
+    {  43, GL_RGBA, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE, 4, false }, // R8G8B8A8_SRGB
+    {  44, GL_BGRA, GL_RGBA8,        GL_UNSIGNED_BYTE, 4, false }, // B8G8R8A8_UNORM
+    {  50, GL_BGRA, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE, 4, false }, // B8G8R8A8_SRGB
+    {  76, GL_RED,  GL_R16F,         GL_HALF_FLOAT, 2, false },    // R16_SFLOAT
+    {  83, GL_RG,   GL_RG16F,        GL_HALF_FLOAT, 4, false },    // R16G16_SFLOAT
+    {  90, GL_RGB,  GL_RGB16F,       GL_HALF_FLOAT, 6, false },    // R16G16B16_SFLOAT
+    {  97, GL_RGBA, GL_RGBA16F,      GL_HALF_FLOAT, 8, false },    // R16G16B16A16_SFLOAT
+    { 100, GL_RED,  GL_R32F,         GL_FLOAT, 4, false },         // R32_SFLOAT
+    { 103, GL_RG,   GL_RG32F,        GL_FLOAT, 8, false },         // R32G32_SFLOAT
+    { 106, GL_RGB,  GL_RGB32F,       GL_FLOAT, 12, false },        // R32G32B32_SFLOAT
+    { 109, GL_RGBA, GL_RGBA32F,      GL_FLOAT, 16, false },        // R32G32B32A32_SFLOAT
+    { 131, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 8, true },         // BC1_RGB_UNORM
+    { 132, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 0, 8, true },        // BC1_RGB_SRGB
+    { 133, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 8, true },        // BC1_RGBA_UNORM
+    { 134, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 0, 8, true },  // BC1_RGBA_SRGB
+    { 135, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 16, true },       // BC2_UNORM
+    { 136, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 0, 16, true }, // BC2_SRGB
+    { 137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 16, true },       // BC3_UNORM
+    { 138, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0, 16, true }, // BC3_SRGB
+    { 139, GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RED_RGTC1, 0, 8, true },                          // BC4_UNORM
+    { 140, GL_COMPRESSED_SIGNED_RED_RGTC1, GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 8, true },            // BC4_SNORM
+    { 141, GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RG_RGTC2, 0, 16, true },                           // BC5_UNORM
+    { 142, GL_COMPRESSED_SIGNED_RG_RGTC2, GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 16, true },             // BC5_SNORM
+};
+
+static const int32_t KTX_FORMAT_COUNT = sizeof(KTX_FORMATS) / sizeof(KTX_FORMAT);
+
+static const KTX_FORMAT* findVkFormat(uint32_t vkFormat) {
+    for (int32_t f = 0; f < KTX_FORMAT_COUNT; f++) {
+        if (KTX_FORMATS[f].vkFormat == vkFormat)
+            return KTX_FORMATS + f;
+    }
+    return NULL;
+}
+
+static const KTX_FORMAT* findCompressedFormat(uint32_t internalFormat) {
+    for (int32_t f = 0; f < KTX_FORMAT_COUNT; f++) {
+        if (KTX_FORMATS[f].compressed && KTX_FORMATS[f].internalFormat == internalFormat)
+            return KTX_FORMATS + f;
+    }
+    return NULL;
+}
+
+//
+// find the value of a key in KTX key/value data
+////////////////////////////////////////////////////////////
+static const char* findKTXValue(const uint8_t* kvd, size_t length, const char* key, uint32_t& valueLength) {
+    size_t keyLength = strlen(key) + 1;
+    size_t offset = 0;
+
+    while (offset + 4 <= length) {
+        uint32_t size;
+        memcpy(&size, kvd + offset, 4);
+        offset += 4;
+
+        if (size > length - offset)
+            break;
+
+        const char* entry = (const char*)kvd + offset;
+        if (size >= keyLength && !memcmp(entry, key, keyLength)) {
+            valueLength = size - (uint32_t)keyLength;
+            return entry + keyLength;
+        }
+
+        offset += (size + 3) & ~3;
+    }
+
+    return NULL;
+}
+
+//
+// true if the rows of a KTX file run from the top of the image down
+////////////////////////////////////////////////////////////
+static bool isKTXTopDown(const uint8_t* kvd, size_t length, bool ktx2) {
+    uint32_t valueLength = 0;
+    const char* value = findKTXValue(kvd, length, "KTXorientation", valueLength);
+
+    if (ktx2) {
+        // "rd" unless stated otherwise
+        return !(value && valueLength >= 2 && value[1] == 'u');
+    }
+
+    // "S=r,T=d" or "S=r,T=u"; rows follow glTexImage2D order (bottom up) by default
+    for (uint32_t c = 0; value && c + 2 < valueLength; c++) {
+        if (value[c] == 'T' && value[c + 1] == '=')
+            return value[c + 2] == 'd';
+    }
+    return false;
+}
+
+//
+// bytes per pixel of an uncompressed GL format/type pair
+////////////////////////////////////////////////////////////
+static int32_t getKTXElementSize(uint32_t format, uint32_t type, uint32_t typeSize) {
+    int32_t components = 0;
+
+    switch (format) {
+        case GL_RED:
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+            components = 1;
+            break;
+        case GL_RG:
+        case GL_LUMINANCE_ALPHA:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+            components = 3;
+            break;
+        case GL_RGBA:
+        case GL_BGRA:
+            components = 4;
+            break;
+        default:
+            return 0;
+    }
+
+    switch (type) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+        case GL_HALF_FLOAT:
+            return components * typeSize;
+        default:
+            // packed types hold a whole pixel
+            return typeSize;
+    }
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+bool NvImage::readKTX(const uint8_t* data, size_t length, NvImage& i, SurfaceListener* listener) {
+    if (length < sizeof(KTX_IDENTIFIER) + sizeof(KTX_HEADER) ||
+        memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+        return false;
+
+    KTX_HEADER header;
+    memcpy(&header, data + sizeof(KTX_IDENTIFIER), sizeof(KTX_HEADER));
+
+    if (header.endianness != KTX_ENDIAN_REF) {
+        LOGE("KTX file is big-endian, which is not supported");
+        return false;
+    }
+
+    bool compressed = (header.glType == 0);
+    const KTX_FORMAT* ktxFormat = NULL;
+    int32_t elementSize;
+
+    if (compressed) {
+        ktxFormat = findCompressedFormat(header.glInternalFormat);
+        if (!ktxFormat) {
+            LOGE("KTX compressed format 0x%x is not supported", header.glInternalFormat);
+            return false;
+        }
+        elementSize = ktxFormat->elementSize;
+    } else {
+        elementSize = getKTXElementSize(header.glFormat, header.glType, header.glTypeSize);
+        if (!elementSize) {
+            LOGE("KTX format 0x%x type 0x%x is not supported", header.glFormat, header.glType);
+            return false;
+        }
+    }
+
+    int32_t faces = header.numberOfFaces;
+    int32_t layers = (header.numberOfArrayElements) ? header.numberOfArrayElements : 1;
+    int32_t levels = (header.numberOfMipmapLevels) ? header.numberOfMipmapLevels : 1;
+
+    if ((faces != 1 && faces != 6) || (faces == 6 && layers > 1) || header.pixelWidth == 0 ||
+        (faces == 6 && header.pixelWidth != header.pixelHeight) || levels > 32) {
+        LOGE("KTX layout is not supported (%d faces, %d layers, %d levels)", faces, layers, levels);
+        return false;
+    }
+
+    size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(KTX_HEADER);
+    if (header.bytesOfKeyValueData > length - offset)
+        return false;
+
+    bool topDown = isKTXTopDown(data + offset, header.bytesOfKeyValueData, false);
+    offset += header.bytesOfKeyValueData;
+
+    i.freeData();
+    i._width = header.pixelWidth;
+    i._height = (header.pixelHeight) ? header.pixelHeight : 1;
+    i._depth = header.pixelDepth;
+    i._levelCount = levels;
+    i._layers = faces * layers;
+    i._cubeMap = (faces == 6);
+    i._elementSize = elementSize;
+
+    if (compressed) {
+        i._format = ktxFormat->format;
+        i._internalFormat = ktxFormat->internalFormat;
+        i._type = ktxFormat->format;
+    } else {
+        i._format = header.glFormat;
+        i._internalFormat = header.glInternalFormat;
+        i._type = header.glType;
+    }
+
+    // locate every surface; uncompressed rows are padded to 4 bytes in the
+    // file and are repacked so that the surfaces are tightly packed
+    vector<const uint8_t*> sources(i._layers * levels);
+    vector<vector<uint8_t> > repacked(i._layers * levels);
+
+    int32_t w = i._width, h = i._height, d = (i._depth) ? i._depth : 1;
+
+    for (int32_t level = 0; level < levels; level++) {
+        int32_t bw = (compressed) ? (w+3)/4 : w;
+        int32_t bh = (compressed) ? (h+3)/4 : h;
+        size_t rowSize = (size_t)bw * elementSize;
+        size_t pitch = (rowSize + 3) & ~(size_t)3;
+        size_t surfaceSize = pitch * bh * d;
+
+        if (offset + 4 > length || (size_t)i._layers * surfaceSize > length - offset - 4) {
+            LOGE("KTX data is truncated (%d levels, %d layers expected)", levels, i._layers);
+            i.freeData();
+            return false;
+        }
+
+        const uint8_t* src = data + offset + 4;
+        for (int32_t layer = 0; layer < i._layers; layer++, src += surfaceSize) {
+            int32_t index = layer * levels + level;
+
+            if (pitch == rowSize) {
+                sources[index] = src;
+                continue;
+            }
+
+            vector<uint8_t>& dst = repacked[index];
+            dst.resize(rowSize * bh * d);
+            for (int32_t row = 0; row < bh * d; row++)
+                memcpy(&dst[row * rowSize], src + row * pitch, rowSize);
+            sources[index] = &dst[0];
+        }
+
+        offset = (offset + 4 + i._layers * surfaceSize + 3) & ~(size_t)3;
+
+        //reduce mip sizes
+        w = ( w > 1) ? w >> 1 : 1;
+        h = ( h > 1) ? h >> 1 : 1;
+        d = ( d > 1) ? d >> 1 : 1;
+    }
+
+    bool flip = (topDown == NvImage::upperLeftOrigin) && !i._cubeMap;
+    return i.decodeSurfaces(sources, compressed, flip, listener);
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+bool NvImage::readKTX2(const uint8_t* data, size_t length, NvImage& i, SurfaceListener* listener) {
+    if (length < sizeof(KTX2_IDENTIFIER) + sizeof(KTX2_HEADER) ||
+        memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+        return false;
+
+    KTX2_HEADER header;
+    memcpy(&header, data + sizeof(KTX2_IDENTIFIER), sizeof(KTX2_HEADER));
+
+    if (header.vkFormat == 0) {
+        // VK_FORMAT_UNDEFINED: Basis Universal payloads need a transcoder
+        LOGE("KTX2 file holds Basis Universal data, which cannot be transcoded");
+        return false;
+    }
+
+    const KTX_FORMAT* ktxFormat = findVkFormat(header.vkFormat);
+    if (!ktxFormat) {
+        LOGE("KTX2 VkFormat %d is not supported", header.vkFormat);
+        return false;
+    }
+
+    if (header.supercompressionScheme != KTX2_SS_NONE &&
+        header.supercompressionScheme != KTX2_SS_ZSTD) {
+        LOGE("KTX2 supercompression scheme %d is not supported", header.supercompressionScheme);
+        return false;
+    }
+
+#ifndef NV_USE_ZSTD
+    if (header.supercompressionScheme == KTX2_SS_ZSTD) {
+        LOGE("KTX2 file is zstd supercompressed; build with NV_USE_ZSTD to load it");
+        return false;
+    }
+#endif
+
+    int32_t faces = header.faceCount;
+    int32_t layers = (header.layerCount) ? header.layerCount : 1;
+    int32_t levels = (header.levelCount) ? header.levelCount : 1;
+
+    if ((faces != 1 && faces != 6) || (faces == 6 && layers > 1) || header.pixelWidth == 0 ||
+        (faces == 6 && header.pixelWidth != header.pixelHeight) || levels > 32) {
+        LOGE("KTX2 layout is not supported (%d faces, %d layers, %d levels)", faces, layers, levels);
+        return false;
+    }
+
+    size_t indexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(KTX2_HEADER);
+    if (levels * sizeof(KTX2_LEVEL) > length - indexOffset)
+        return false;
+
+    vector<KTX2_LEVEL> levelIndex(levels);
+    memcpy(&levelIndex[0], data + indexOffset, levels * sizeof(KTX2_LEVEL));
+
+    bool topDown = true;
+    if (header.kvdByteLength && header.kvdByteOffset <= length &&
+        header.kvdByteLength <= length - header.kvdByteOffset)
+        topDown = isKTXTopDown(data + header.kvdByteOffset, header.kvdByteLength, true);
+
+    bool compressed = ktxFormat->compressed;
+
+    i.freeData();
+    i._width = header.pixelWidth;
+    i._height = (header.pixelHeight) ? header.pixelHeight : 1;
+    i._depth = header.pixelDepth;
+    i._levelCount = levels;
+    i._layers = faces * layers;
+    i._cubeMap = (faces == 6);
+    i._elementSize = ktxFormat->elementSize;
+    i._format = ktxFormat->format;
+    i._internalFormat = ktxFormat->internalFormat;
+    i._type = (compressed) ? ktxFormat->format : ktxFormat->type;
+
+    // locate every surface, inflating supercompressed levels first
+    vector<const uint8_t*> sources(i._layers * levels);
+    vector<uint8_t> inflated;
+    vector<size_t> inflatedOffsets(levels, 0);
+
+    if (header.supercompressionScheme == KTX2_SS_ZSTD) {
+        // the inflated lengths come from the file, so each must match the
+        // layout of its level before anything is allocated
+        size_t inflatedSize = 0;
+        int32_t w = i._width, h = i._height, d = (i._depth) ? i._depth : 1;
+
+        for (int32_t level = 0; level < levels; level++) {
+            int32_t bw = (compressed) ? (w+3)/4 : w;
+            int32_t bh = (compressed) ? (h+3)/4 : h;
+            size_t levelSize = (size_t)bw * bh * d * i._elementSize * i._layers;
+
+            if (levelIndex[level].uncompressedByteLength == 0 ||
+                levelIndex[level].uncompressedByteLength != levelSize) {
+                LOGE("KTX2 level %d has an unexpected inflated length", level);
+                i.freeData();
+                return false;
+            }
+
+            inflatedOffsets[level] = inflatedSize;
+            inflatedSize += levelSize;
+
+            //reduce mip sizes
+            w = ( w > 1) ? w >> 1 : 1;
+            h = ( h > 1) ? h >> 1 : 1;
+            d = ( d > 1) ? d >> 1 : 1;
+        }
+        inflated.resize(inflatedSize);
+    }
+
+    int32_t w = i._width, h = i._height, d = (i._depth) ? i._depth : 1;
+
+    for (int32_t level = 0; level < levels; level++) {
+        int32_t bw = (compressed) ? (w+3)/4 : w;
+        int32_t bh = (compressed) ? (h+3)/4 : h;
+        size_t surfaceSize = (size_t)bw * bh * d * i._elementSize;
+        const KTX2_LEVEL& entry = levelIndex[level];
+
+        if (entry.byteOffset > length || entry.byteLength > length - entry.byteOffset) {
+            LOGE("KTX2 data is truncated (%d levels, %d layers expected)", levels, i._layers);
+            i.freeData();
+            return false;
+        }
+
+        const uint8_t* src = data + entry.byteOffset;
+        size_t srcLength = (size_t)entry.byteLength;
+
+#ifdef NV_USE_ZSTD
+        if (header.supercompressionScheme == KTX2_SS_ZSTD) {
+            uint8_t* dst = &inflated[0] + inflatedOffsets[level];
+            size_t dstLength = (size_t)entry.uncompressedByteLength;
+            size_t result = ZSTD_decompress(dst, dstLength, src, srcLength);
+
+            if (ZSTD_isError(result) || result != dstLength) {
+                LOGE("KTX2 level %d could not be inflated", level);
+                i.freeData();
+                return false;
+            }
+
+            src = dst;
+            srcLength = dstLength;
+        }
+#endif
+
+        if (srcLength < i._layers * surfaceSize) {
+            LOGE("KTX2 level %d is too small (%d bytes)", level, (int32_t)srcLength);
+            i.freeData();
+            return false;
+        }
+
+        for (int32_t layer = 0; layer < i._layers; layer++)
+            sources[layer * levels + level] = src + layer * surfaceSize;
+
+        //reduce mip sizes
+        w = ( w > 1) ? w >> 1 : 1;
+        h = ( h > 1) ? h >> 1 : 1;
+        d = ( d > 1) ? d >> 1 : 1;
+    }
+
+    bool flip = (topDown == NvImage::upperLeftOrigin) && !i._cubeMap;
+    return i.decodeSurfaces(sources, compressed, flip, listener);
+}
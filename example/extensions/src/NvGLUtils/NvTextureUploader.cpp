@@ -0,0 +1,513 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvTextureUploader.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <string.h>
+#include <algorithm>
+
+#include "NvGLUtils/NvTextureUploader.h"
+#include "NvAssetLoader/NvAssetLoader.h"
+#include "NvGLEnums.h"
+#include "NV/NvLogs.h"
+
+NvTextureUploader::NV_PFNGLTEXSTORAGE2DPROC          NvTextureUploader::m_glTexStorage2D = NULL;
+NvTextureUploader::NV_PFNGLTEXSTORAGE3DPROC          NvTextureUploader::m_glTexStorage3D = NULL;
+NvTextureUploader::NV_PFNGLTEXSUBIMAGE3DPROC         NvTextureUploader::m_glTexSubImage3D = NULL;
+NvTextureUploader::NV_PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC NvTextureUploader::m_glCompressedTexSubImage3D = NULL;
+NvTextureUploader::NV_PFNGLBUFFERSTORAGEPROC         NvTextureUploader::m_glBufferStorage = NULL;
+NvTextureUploader::NV_PFNGLMAPBUFFERRANGEPROC        NvTextureUploader::m_glMapBufferRange = NULL;
+NvTextureUploader::NV_PFNGLUNMAPBUFFERPROC           NvTextureUploader::m_glUnmapBuffer = NULL;
+NvTextureUploader::NV_PFNGLFENCESYNCPROC             NvTextureUploader::m_glFenceSync = NULL;
+NvTextureUploader::NV_PFNGLCLIENTWAITSYNCPROC        NvTextureUploader::m_glClientWaitSync = NULL;
+NvTextureUploader::NV_PFNGLDELETESYNCPROC            NvTextureUploader::m_glDeleteSync = NULL;
+NvTextureUploader::NV_PFNGLGETTEXTUREHANDLEPROC      NvTextureUploader::m_glGetTextureHandle = NULL;
+NvTextureUploader::NV_PFNGLTEXTUREHANDLERESIDENTPROC NvTextureUploader::m_glMakeTextureHandleResident = NULL;
+NvTextureUploader::NV_PFNGLTEXTUREHANDLERESIDENTPROC NvTextureUploader::m_glMakeTextureHandleNonResident = NULL;
+
+void NvTextureUploader::globalInit(NvGLExtensionsAPI& api) {
+    const NvGfxAPIVersion& ver = NvImage::getAPIVersion();
+    bool isES = (ver.api == NvGfxAPI::GLES);
+
+    m_glTexStorage2D = NULL;
+    m_glTexStorage3D = NULL;
+    m_glTexSubImage3D = NULL;
+    m_glCompressedTexSubImage3D = NULL;
+    m_glBufferStorage = NULL;
+    m_glMapBufferRange = NULL;
+    m_glUnmapBuffer = NULL;
+    m_glFenceSync = NULL;
+    m_glClientWaitSync = NULL;
+    m_glDeleteSync = NULL;
+    m_glGetTextureHandle = NULL;
+    m_glMakeTextureHandleResident = NULL;
+    m_glMakeTextureHandleNonResident = NULL;
+
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 4, 2) || (isES && ver.majVersion >= 3) ||
+        api.isExtensionSupported("GL_ARB_texture_storage")) {
+        m_glTexStorage2D = (NV_PFNGLTEXSTORAGE2DPROC)api.getGLProcAddress("glTexStorage2D");
+        m_glTexStorage3D = (NV_PFNGLTEXSTORAGE3DPROC)api.getGLProcAddress("glTexStorage3D");
+    } else if (api.isExtensionSupported("GL_EXT_texture_storage")) {
+        m_glTexStorage2D = (NV_PFNGLTEXSTORAGE2DPROC)api.getGLProcAddress("glTexStorage2DEXT");
+        m_glTexStorage3D = (NV_PFNGLTEXSTORAGE3DPROC)api.getGLProcAddress("glTexStorage3DEXT");
+    }
+
+    if (ver.api == NvGfxAPI::GL || (isES && ver.majVersion >= 3)) {
+        m_glTexSubImage3D = (NV_PFNGLTEXSUBIMAGE3DPROC)api.getGLProcAddress("glTexSubImage3D");
+        m_glCompressedTexSubImage3D = (NV_PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC)api.getGLProcAddress("glCompressedTexSubImage3D");
+    } else if (api.isExtensionSupported("GL_OES_texture_3D")) {
+        m_glTexSubImage3D = (NV_PFNGLTEXSUBIMAGE3DPROC)api.getGLProcAddress("glTexSubImage3DOES");
+        m_glCompressedTexSubImage3D = (NV_PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC)api.getGLProcAddress("glCompressedTexSubImage3DOES");
+    }
+
+    // layered storage is only usable if its levels can be filled
+    if (!m_glTexSubImage3D || !m_glCompressedTexSubImage3D)
+        m_glTexStorage3D = NULL;
+
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 3, 0) || (isES && ver.majVersion >= 3) ||
+        api.isExtensionSupported("GL_ARB_map_buffer_range")) {
+        m_glMapBufferRange = (NV_PFNGLMAPBUFFERRANGEPROC)api.getGLProcAddress("glMapBufferRange");
+        m_glUnmapBuffer = (NV_PFNGLUNMAPBUFFERPROC)api.getGLProcAddress("glUnmapBuffer");
+    } else if (api.isExtensionSupported("GL_EXT_map_buffer_range")) {
+        m_glMapBufferRange = (NV_PFNGLMAPBUFFERRANGEPROC)api.getGLProcAddress("glMapBufferRangeEXT");
+        m_glUnmapBuffer = (NV_PFNGLUNMAPBUFFERPROC)api.getGLProcAddress("glUnmapBufferOES");
+    }
+
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 3, 2) || (isES && ver.majVersion >= 3) ||
+        api.isExtensionSupported("GL_ARB_sync")) {
+        m_glFenceSync = (NV_PFNGLFENCESYNCPROC)api.getGLProcAddress("glFenceSync");
+        m_glClientWaitSync = (NV_PFNGLCLIENTWAITSYNCPROC)api.getGLProcAddress("glClientWaitSync");
+        m_glDeleteSync = (NV_PFNGLDELETESYNCPROC)api.getGLProcAddress("glDeleteSync");
+    }
+
+    if (ver >= NvGfxAPIVersion(NvGfxAPI::GL, 4, 4) || api.isExtensionSupported("GL_ARB_buffer_storage")) {
+        m_glBufferStorage = (NV_PFNGLBUFFERSTORAGEPROC)api.getGLProcAddress("glBufferStorage");
+    } else if (api.isExtensionSupported("GL_EXT_buffer_storage")) {
+        m_glBufferStorage = (NV_PFNGLBUFFERSTORAGEPROC)api.getGLProcAddress("glBufferStorageEXT");
+    }
+
+    if (api.isExtensionSupported("GL_ARB_bindless_texture")) {
+        m_glGetTextureHandle = (NV_PFNGLGETTEXTUREHANDLEPROC)api.getGLProcAddress("glGetTextureHandleARB");
+        m_glMakeTextureHandleResident = (NV_PFNGLTEXTUREHANDLERESIDENTPROC)api.getGLProcAddress("glMakeTextureHandleResidentARB");
+        m_glMakeTextureHandleNonResident = (NV_PFNGLTEXTUREHANDLERESIDENTPROC)api.getGLProcAddress("glMakeTextureHandleNonResidentARB");
+    } else if (api.isExtensionSupported("GL_NV_bindless_texture")) {
+        m_glGetTextureHandle = (NV_PFNGLGETTEXTUREHANDLEPROC)api.getGLProcAddress("glGetTextureHandleNV");
+        m_glMakeTextureHandleResident = (NV_PFNGLTEXTUREHANDLERESIDENTPROC)api.getGLProcAddress("glMakeTextureHandleResidentNV");
+        m_glMakeTextureHandleNonResident = (NV_PFNGLTEXTUREHANDLERESIDENTPROC)api.getGLProcAddress("glMakeTextureHandleNonResidentNV");
+    }
+
+    if (!m_glGetTextureHandle || !m_glMakeTextureHandleResident || !m_glMakeTextureHandleNonResident) {
+        m_glGetTextureHandle = NULL;
+        m_glMakeTextureHandleResident = NULL;
+        m_glMakeTextureHandleNonResident = NULL;
+    }
+
+    if (!m_glClientWaitSync || !m_glDeleteSync || !m_glUnmapBuffer)
+        m_glFenceSync = NULL;
+}
+
+NvTextureUploader::NvTextureUploader(uint32_t ringSize, int32_t ringSegments) :
+    m_ringBuffer(0),
+    m_ringData(NULL),
+    m_segment(0),
+    m_segmentOffset(0),
+    m_ringFailed(false),
+    m_minFilter(0),
+    m_magFilter(GL_LINEAR),
+    m_wrap(GL_REPEAT),
+    m_texID(0),
+    m_target(GL_TEXTURE_2D),
+    m_flags(0),
+    m_immutable(false),
+    m_streaming(false)
+{
+    m_segmentCount = std::min(std::max(ringSegments, 1), MAX_RING_SEGMENTS);
+    m_segmentSize = (ringSize / m_segmentCount) & ~15U;
+
+    for (int32_t i = 0; i < MAX_RING_SEGMENTS; i++)
+        m_fences[i] = NULL;
+}
+
+NvTextureUploader::~NvTextureUploader() {
+    releaseRing();
+}
+
+//
+// pixel unpack ring
+////////////////////////////////////////////////////////////
+bool NvTextureUploader::initRing() {
+    if (m_ringData)
+        return true;
+    if (m_ringFailed || !isStreamingSupported() || m_segmentSize == 0)
+        return false;
+
+    const GLbitfield flags = NV_MAP_WRITE_BIT | NV_MAP_PERSISTENT_BIT | NV_MAP_COHERENT_BIT;
+    GLsizeiptr size = (GLsizeiptr)m_segmentSize * m_segmentCount;
+
+    glGenBuffers(1, &m_ringBuffer);
+    glBindBuffer(NV_PIXEL_UNPACK_BUFFER, m_ringBuffer);
+    m_glBufferStorage(NV_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+    m_ringData = (uint8_t*)m_glMapBufferRange(NV_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    glBindBuffer(NV_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!m_ringData) {
+        LOGE("NvTextureUploader: could not map a %d byte unpack buffer", (int32_t)size);
+        glDeleteBuffers(1, &m_ringBuffer);
+        m_ringBuffer = 0;
+        m_ringFailed = true;
+        return false;
+    }
+
+    m_segment = 0;
+    m_segmentOffset = 0;
+    return true;
+}
+
+void NvTextureUploader::releaseRing() {
+    if (!m_ringBuffer)
+        return;
+
+    for (int32_t i = 0; i < m_segmentCount; i++)
+        waitSegment(i);
+
+    glBindBuffer(NV_PIXEL_UNPACK_BUFFER, m_ringBuffer);
+    m_glUnmapBuffer(NV_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(NV_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &m_ringBuffer);
+
+    m_ringBuffer = 0;
+    m_ringData = NULL;
+}
+
+void NvTextureUploader::waitSegment(int32_t segment) {
+    NV_GLsync fence = m_fences[segment];
+    if (!fence)
+        return;
+
+    // one second per wait; only give up if the wait itself fails
+    GLenum result;
+    do {
+        result = m_glClientWaitSync(fence, NV_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+    } while (result == NV_TIMEOUT_EXPIRED);
+
+    if (result == NV_WAIT_FAILED)
+        LOGE("NvTextureUploader: waiting for an upload fence failed");
+
+    m_glDeleteSync(fence);
+    m_fences[segment] = NULL;
+}
+
+bool NvTextureUploader::allocRing(uint32_t size, uint32_t& offset) {
+    if (size > m_segmentSize)
+        return false;
+
+    uint32_t start = (m_segmentOffset + 15) & ~15U;
+    if (start + size > m_segmentSize) {
+        // fence the commands reading the current segment and move on to the
+        // next one, waiting for the transfers that last used it
+        if (m_fences[m_segment])
+            m_glDeleteSync(m_fences[m_segment]);
+        m_fences[m_segment] = m_glFenceSync(NV_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_segment = (m_segment + 1) % m_segmentCount;
+        waitSegment(m_segment);
+        start = 0;
+    }
+
+    m_segmentOffset = start + size;
+    offset = m_segment * m_segmentSize + start;
+    return true;
+}
+
+//
+// texture creation
+////////////////////////////////////////////////////////////
+static GLenum getStorageFormat(const NvImage& image) {
+    GLenum internalFormat = image.getInternalFormat();
+    if (image.isCompressed())
+        return internalFormat;
+
+    // expanded DXT images keep their compressed internal format as a hint
+    switch (internalFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return GL_RGBA8;
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return GL_SRGB8_ALPHA8;
+    }
+    return internalFormat;
+}
+
+GLenum NvTextureUploader::getStorageTarget(const NvImage& image) {
+    if (image.isVolume())
+        return NV_TEXTURE_3D;
+    if (image.isCubeMap())
+        return (image.getFaces() > 6) ? NV_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+    return image.isArray() ? NV_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
+
+bool NvTextureUploader::isLayeredTarget(GLenum target) {
+    return (target != GL_TEXTURE_2D) && (target != GL_TEXTURE_CUBE_MAP);
+}
+
+bool NvTextureUploader::createStorage(NvImage& image) {
+    m_target = getStorageTarget(image);
+    m_immutable = false;
+    m_streaming = false;
+
+    bool layered = isLayeredTarget(m_target);
+    if (!(m_flags & IMMUTABLE_STORAGE) || !isImmutableStorageSupported() ||
+        (layered && !m_glTexStorage3D))
+        return false;
+
+    // clear any stale error so that a storage failure can be detected
+    glGetError();
+
+    glGenTextures(1, &m_texID);
+    glBindTexture(m_target, m_texID);
+    if (m_target == NV_TEXTURE_3D) {
+        m_glTexStorage3D(m_target, image.getMipLevels(), getStorageFormat(image),
+            image.getWidth(), image.getHeight(), image.getDepth());
+    } else if (layered) {
+        // cube map arrays count layer-faces, which is what the image stores
+        m_glTexStorage3D(m_target, image.getMipLevels(), getStorageFormat(image),
+            image.getWidth(), image.getHeight(), image.getLayers());
+    } else {
+        m_glTexStorage2D(m_target, image.getMipLevels(), getStorageFormat(image),
+            image.getWidth(), image.getHeight());
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        LOGI("NvTextureUploader: no immutable storage for format 0x%x, using mutable textures",
+            image.getInternalFormat());
+        glBindTexture(m_target, 0);
+        glDeleteTextures(1, &m_texID);
+        m_texID = 0;
+        return false;
+    }
+
+    m_immutable = true;
+    m_streaming = (m_flags & STREAM) && initRing();
+    return true;
+}
+
+void NvTextureUploader::uploadSurface(NvImage& image, int32_t level, int32_t layer) {
+    // cube faces have a target each; volume slices and array layers are addressed by z
+    bool layered = isLayeredTarget(m_target);
+    GLenum target = (m_target == GL_TEXTURE_CUBE_MAP) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer : m_target;
+    const uint8_t* data = (const uint8_t*)image.getLayerLevel(level, layer);
+    bool compressed = image.isCompressed();
+
+    int32_t w = std::max(image.getWidth() >> level, 1);
+    int32_t h = std::max(image.getHeight() >> level, 1);
+    int32_t slices = (m_target == NV_TEXTURE_3D) ? std::max(image.getDepth() >> level, 1) : 1;
+    int32_t rows = compressed ? (h + 3) / 4 : h;
+    uint32_t rowSize = image.getImageSize(level) / (rows * slices);
+
+    // bands of rows that each fit one ring segment
+    bool streaming = m_streaming && rowSize <= m_segmentSize;
+    int32_t bandRows = streaming ? std::max((int32_t)(m_segmentSize / rowSize), 1) : rows;
+
+    if (streaming)
+        glBindBuffer(NV_PIXEL_UNPACK_BUFFER, m_ringBuffer);
+
+    for (int32_t slice = 0; slice < slices; slice++) {
+        int32_t z = (m_target == NV_TEXTURE_3D) ? slice : layer;
+        const uint8_t* sliceData = data + slice * rows * rowSize;
+
+        for (int32_t row = 0; row < rows; row += bandRows) {
+            int32_t count = std::min(bandRows, rows - row);
+            uint32_t size = count * rowSize;
+            const void* pixels = sliceData + row * rowSize;
+
+            if (streaming) {
+                uint32_t offset = 0;
+                allocRing(size, offset);
+                memcpy(m_ringData + offset, pixels, size);
+                pixels = (const void*)(size_t)offset;
+            }
+
+            if (compressed) {
+                int32_t y = row * 4;
+                int32_t bandHeight = std::min(count * 4, h - y);
+                if (layered) {
+                    m_glCompressedTexSubImage3D(target, level, 0, y, z, w, bandHeight, 1,
+                        image.getInternalFormat(), size, pixels);
+                } else {
+                    glCompressedTexSubImage2D(target, level, 0, y, w, bandHeight,
+                        image.getInternalFormat(), size, pixels);
+                }
+            } else if (layered) {
+                m_glTexSubImage3D(target, level, 0, row, z, w, count, 1,
+                    image.getFormat(), image.getType(), pixels);
+            } else {
+                glTexSubImage2D(target, level, 0, row, w, count,
+                    image.getFormat(), image.getType(), pixels);
+            }
+        }
+    }
+
+    if (streaming)
+        glBindBuffer(NV_PIXEL_UNPACK_BUFFER, 0);
+}
+
+uint32_t NvTextureUploader::finishTexture(NvImage& image, uint64_t* bindlessHandle) {
+    GLuint texID = m_texID;
+    m_texID = 0;
+
+    if (bindlessHandle)
+        *bindlessHandle = 0;
+
+    // no immutable storage: fall back to the mutable upload of the whole image,
+    // which only creates 2D textures and cube maps
+    if (!texID) {
+        m_target = image.isCubeMap() ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+        texID = NvImage::UploadTexture(&image);
+        if (!texID)
+            return 0;
+    }
+
+    GLenum minFilter = m_minFilter;
+    if (!minFilter)
+        minFilter = (image.getMipLevels() > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+
+    glBindTexture(m_target, texID);
+    glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(m_target, GL_TEXTURE_MAG_FILTER, m_magFilter);
+    glTexParameteri(m_target, GL_TEXTURE_WRAP_S, m_wrap);
+    glTexParameteri(m_target, GL_TEXTURE_WRAP_T, m_wrap);
+    if (m_target == NV_TEXTURE_3D ||
+        (m_target == GL_TEXTURE_CUBE_MAP && NvImage::getAPIVersion().api == NvGfxAPI::GL))
+        glTexParameteri(m_target, NV_TEXTURE_WRAP_R, m_wrap);
+    glBindTexture(m_target, 0);
+
+    if ((m_flags & BINDLESS) && bindlessHandle && isBindlessSupported()) {
+        *bindlessHandle = m_glGetTextureHandle(texID);
+        m_glMakeTextureHandleResident(*bindlessHandle);
+    }
+
+    return texID;
+}
+
+//
+// listener interface, called by NvImage while DDS data is decoded
+////////////////////////////////////////////////////////////
+bool NvTextureUploader::imageReady(NvImage& image) {
+    createStorage(image);
+    return true;
+}
+
+void NvTextureUploader::surfaceReady(NvImage& image, int32_t level, int32_t layer) {
+    if (m_immutable)
+        uploadSurface(image, level, layer);
+}
+
+//
+// entry points
+////////////////////////////////////////////////////////////
+uint32_t NvTextureUploader::upload(NvImage* image, uint32_t flags, uint64_t* bindlessHandle) {
+    if (!image)
+        return 0;
+
+    m_flags = flags;
+    m_texID = 0;
+
+    if (createStorage(*image)) {
+        GLint alignment = 4;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        for (int32_t layer = 0; layer < image->getLayers(); layer++) {
+            for (int32_t level = 0; level < image->getMipLevels(); level++)
+                uploadSurface(*image, level, layer);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    }
+
+    return finishTexture(*image, bindlessHandle);
+}
+
+uint32_t NvTextureUploader::uploadDDSData(const char* ddsData, int32_t length, uint32_t flags,
+    uint64_t* bindlessHandle) {
+    NvImage image;
+
+    m_flags = flags;
+    m_texID = 0;
+    m_immutable = false;
+
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    bool loaded = image.loadImageFromFileData((const uint8_t*)ddsData, length, "dds", this);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+    if (!loaded) {
+        if (m_texID) {
+            glBindTexture(m_target, 0);
+            glDeleteTextures(1, &m_texID);
+            m_texID = 0;
+        }
+        return 0;
+    }
+
+    return finishTexture(image, bindlessHandle);
+}
+
+uint32_t NvTextureUploader::uploadDDSFile(const char* filename, uint32_t flags,
+    uint64_t* bindlessHandle) {
+    int32_t len;
+    char* ddsData = NvAssetLoaderRead(filename, len);
+
+    if (!ddsData)
+        return 0;
+
+    GLuint result = uploadDDSData(ddsData, len, flags, bindlessHandle);
+
+    NvAssetLoaderFree(ddsData);
+
+    return result;
+}
+
+void NvTextureUploader::deleteTexture(uint32_t texID, uint64_t bindlessHandle) {
+    if (bindlessHandle && m_glMakeTextureHandleNonResident)
+        m_glMakeTextureHandleNonResident(bindlessHandle);
+    if (texID)
+        glDeleteTextures(1, &texID);
+}
@@ -37,6 +37,7 @@ NvGPUTimer::NV_PFNGLGENQUERIESPROC          NvGPUTimer::m_glGenQueries = NULL;
 NvGPUTimer::NV_PFNGLQUERYCOUNTERPROC        NvGPUTimer::m_glQueryCounter = NULL;
 NvGPUTimer::NV_PFNGLGETQUERYOBJECTUIVPROC   NvGPUTimer::m_glGetQueryObjectuiv = NULL;
 NvGPUTimer::NV_PFNGLGETQUERYOBJECTUI64VPROC NvGPUTimer::m_glGetQueryObjectui64v = NULL;
+bool NvGPUTimer::ms_supported = false;
 
 NvStopWatchFactory* NvCPUTimer::ms_factory = NULL;
 
@@ -94,6 +95,8 @@ void NvGPUTimer::globalInit(NvGLExtensionsAPI& api) {
             m_glGetQueryObjectui64v = (NV_PFNGLGETQUERYOBJECTUI64VPROC)api.getGLProcAddress("glGetQueryObjectui64v");
     }
 
+    ms_supported = m_glGenQueries && m_glQueryCounter && m_glGetQueryObjectui64v;
+
     if (!m_glGenQueries)
         m_glGenQueries = (NV_PFNGLGENQUERIESPROC)nullGenQueries;
 
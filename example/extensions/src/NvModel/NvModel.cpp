@@ -121,7 +121,7 @@ NvModel* NvModel::Create() {
 //
 //
 ////////////////////////////////////////////////////////////
-NvModel::NvModel() : _posSize(0), _tcSize(0), _cSize(0), _pOffset(-1), _nOffset(-1), _tcOffset(-1), _sTanOffset(-1), _cOffset(-1), _vtxSize(0), _openEdges(0) {
+NvModel::NvModel() : _posSize(0), _tcSize(0), _cSize(0), _pOffset(-1), _nOffset(-1), _tcOffset(-1), _sTanOffset(-1), _cOffset(-1), _vtxSize(0), _openEdges(0), _qVtxSize(0), _qPosScale(0.0f, 0.0f, 0.0f), _qPosBias(0.0f, 0.0f, 0.0f) {
     //nv::vec2<float> val;
 }
 
@@ -163,6 +163,14 @@ void NvModel::compileModel( NvModelPrimType::Enum prim) {
     }
 
 
+    //a quantized copy of earlier vertices, and clusters and levels of detail of earlier triangles, no longer match
+    _qVertices.clear();
+    _clusters.clear();
+    _lodIndices.clear();
+    _lodFirstIndex.clear();
+    _lodIndexCount.clear();
+    _lodError.clear();
+
     //merge the points
     map<IdxSet, uint32_t> pts;
 
@@ -386,6 +394,18 @@ void NvModel::computeTangents() {
     if ( !hasTexCoords())
         return;
 
+    if ( (int32_t)_pIndex.size() >= ParallelTriangleCount * 3)
+        computeTangentsParallel();
+    else
+        computeTangentsSerial();
+}
+
+//
+// compute tangents in the S direction, one face after another
+//
+//////////////////////////////////////////////////////////////////////
+void NvModel::computeTangentsSerial() {
+
     //alloc memory and initialize to 0
     _tanIndex.reserve( _pIndex.size());
     _sTangents.resize( (_texCoords.size() / _tcSize) * 3, 0.0f);
@@ -498,6 +518,17 @@ void NvModel::computeNormals() {
     if (hasNormals())
         return;
 
+    if ( (int32_t)_pIndex.size() >= ParallelTriangleCount * 3)
+        computeNormalsParallel();
+    else
+        computeNormalsSerial();
+}
+
+//
+//compute vertex normals, one face after another
+//////////////////////////////////////////////////////////////////////
+void NvModel::computeNormalsSerial() {
+
     //allocate and initialize the normal values
     _normals.resize( (_positions.size() / _posSize) * 3, 0.0f);
     _nIndex.reserve( _pIndex.size());
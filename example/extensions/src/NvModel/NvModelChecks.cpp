@@ -0,0 +1,299 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelChecks.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvLogs.h"
+#include "NV/NvMath.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+using namespace nv;
+
+using std::vector;
+using std::string;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local functions
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//
+//  Small deterministic generator, so every run checks the same meshes
+////////////////////////////////////////////////////////////
+struct CheckRandom {
+    uint32_t state;
+
+    CheckRandom( uint32_t seed) : state( seed) {}
+
+    uint32_t next( uint32_t range) {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) % range;
+    }
+
+    //uniform in [lo, hi]
+    float next( float lo, float hi) {
+        return lo + (hi - lo) * (float)next( 1u << 16) / (float)((1u << 16) - 1);
+    }
+};
+
+void appendPosition( string &obj, float x, float y, float z) {
+    char line[128];
+    sprintf( line, "v %f %f %f\n", x, y, z);
+    obj += line;
+}
+
+void appendTexCoord( string &obj, float s, float t) {
+    char line[128];
+    sprintf( line, "vt %f %f\n", s, t);
+    obj += line;
+}
+
+//faces in random order, texture coordinates sharing the position indices
+void appendShuffledFaces( string &obj, const vector<uint32_t> &faces, bool texCoords, CheckRandom &rnd) {
+    uint32_t faceCount = (uint32_t)faces.size() / 3;
+    vector<uint32_t> order( faceCount);
+    for ( uint32_t ii = 0; ii < faceCount; ii++)
+        order[ii] = ii;
+    for ( uint32_t ii = faceCount; ii > 1; ii--)
+        std::swap( order[ii - 1], order[rnd.next( ii)]);
+
+    for ( uint32_t ii = 0; ii < faceCount; ii++) {
+        const uint32_t *f = &faces[order[ii] * 3];
+        char line[128];
+        if ( texCoords)
+            sprintf( line, "f %u/%u %u/%u %u/%u\n", f[0] + 1, f[0] + 1, f[1] + 1, f[1] + 1, f[2] + 1, f[2] + 1);
+        else
+            sprintf( line, "f %u %u %u\n", f[0] + 1, f[1] + 1, f[2] + 1);
+        obj += line;
+    }
+}
+
+//
+//  A grid with random spikes, mirrored texture coordinates, degenerate
+//  triangles and flipped duplicates, faces in random order, so that the
+//  normals and tangents split at creases and seams
+////////////////////////////////////////////////////////////
+string buildSmoothingMesh( int32_t size) {
+    CheckRandom rnd( 1);
+    string obj;
+
+    for ( int32_t ii = 0; ii <= size; ii++) {
+        for ( int32_t jj = 0; jj <= size; jj++) {
+            float height = (rnd.next( 4u) == 0) ? rnd.next( 0.0f, 10.0f) : 0.0f;
+            appendPosition( obj, (float)ii, height, (float)jj);
+        }
+    }
+
+    for ( int32_t ii = 0; ii <= size; ii++) {
+        for ( int32_t jj = 0; jj <= size; jj++) {
+            float mirror = rnd.next( 2u) ? 1.0f : -1.0f;
+            appendTexCoord( obj, mirror * ii / (float)size, jj / (float)size);
+        }
+    }
+
+    vector<uint32_t> faces;
+    for ( int32_t ii = 0; ii < size; ii++) {
+        for ( int32_t jj = 0; jj < size; jj++) {
+            uint32_t a = ii * (size + 1) + jj;
+            uint32_t b = a + 1;
+            uint32_t c = a + size + 1;
+            uint32_t d = c + 1;
+
+            uint32_t quad[6] = { a, c, b, b, c, d };
+            faces.insert( faces.end(), quad, quad + 6);
+
+            if ( rnd.next( 50u) == 0) {
+                uint32_t degenerate[3] = { a, a, b };
+                faces.insert( faces.end(), degenerate, degenerate + 3);
+            }
+            if ( rnd.next( 50u) == 0) {
+                uint32_t flipped[3] = { a, b, c };
+                faces.insert( faces.end(), flipped, flipped + 3);
+            }
+        }
+    }
+
+    appendShuffledFaces( obj, faces, true, rnd);
+
+    return obj;
+}
+
+//
+//  A bumpy closed sphere, faces in random order, so that the clusters
+//  are grown from scattered triangles and have cones of every width
+////////////////////////////////////////////////////////////
+string buildClusterMesh( int32_t rings, int32_t segments) {
+    CheckRandom rnd( 2);
+    string obj;
+
+    for ( int32_t ii = 0; ii <= rings; ii++) {
+        for ( int32_t jj = 0; jj < segments; jj++) {
+            float theta = 3.1415926f * ii / rings;
+            float phi = 2.0f * 3.1415926f * jj / segments;
+            float r = 1.0f + 0.1f * sinf( 5.0f * theta) * cosf( 7.0f * phi);
+            appendPosition( obj, r * sinf( theta) * cosf( phi), r * cosf( theta), r * sinf( theta) * sinf( phi));
+        }
+    }
+
+    vector<uint32_t> faces;
+    for ( int32_t ii = 0; ii < rings; ii++) {
+        for ( int32_t jj = 0; jj < segments; jj++) {
+            uint32_t a = ii * segments + jj;
+            uint32_t b = ii * segments + (jj + 1) % segments;
+            uint32_t c = a + segments;
+            uint32_t d = b + segments;
+
+            //the pole rows hold one triangle per segment
+            if ( ii > 0) {
+                uint32_t upper[3] = { a, c, b };
+                faces.insert( faces.end(), upper, upper + 3);
+            }
+            if ( ii < rings - 1) {
+                uint32_t lower[3] = { b, c, d };
+                faces.insert( faces.end(), lower, lower + 3);
+            }
+        }
+    }
+
+    appendShuffledFaces( obj, faces, false, rnd);
+
+    return obj;
+}
+
+template <class T>
+bool sameBits( const vector<T> &a, const vector<T> &b) {
+    return a.size() == b.size() && (a.empty() || memcmp( &a[0], &b[0], a.size() * sizeof(T)) == 0);
+}
+
+} // namespace
+
+//
+// check the mesh processing on generated meshes
+//
+//////////////////////////////////////////////////////////////////////
+bool NvModel::runChecks() {
+    bool passed = true;
+
+    //the parallel paths must reproduce the serial ones bit for bit
+    {
+        string obj = buildSmoothingMesh( 96);
+        NvModel serial;
+        NvModel parallel;
+        serial.loadModelFromFileDataObj( &obj[0]);
+        parallel.loadModelFromFileDataObj( &obj[0]);
+
+        serial.computeNormalsSerial();
+        serial.computeTangentsSerial();
+        parallel.computeNormalsParallel();
+        parallel.computeTangentsParallel();
+
+        if ( !sameBits( serial._normals, parallel._normals) || !sameBits( serial._nIndex, parallel._nIndex)) {
+            LOGE( "NvModel check failed: parallel normals differ from the serial ones");
+            passed = false;
+        }
+        if ( !sameBits( serial._sTangents, parallel._sTangents) || !sameBits( serial._tanIndex, parallel._tanIndex)) {
+            LOGE( "NvModel check failed: parallel tangents differ from the serial ones");
+            passed = false;
+        }
+    }
+
+    //every cluster must be bounded by its sphere and culled by its cone only when it faces away
+    {
+        string obj = buildClusterMesh( 64, 128);
+        NvModel model;
+        model.loadModelFromFileDataObj( &obj[0]);
+        model.compileModel( NvModelPrimType::TRIANGLES);
+        model.optimizeCompiledModel();
+        model.computeClusters();
+
+        const float *vertices = model.getCompiledVertices();
+        const uint32_t *indices = model.getCompiledIndices();
+        int32_t vtxSize = model.getCompiledVertexSize();
+        int32_t pOffset = model.getCompiledPositionOffset();
+
+        CheckRandom rnd( 3);
+        int32_t outside = 0;
+        int32_t falseCulls = 0;
+
+        for ( int32_t ii = 0; ii < model.getClusterCount(); ii++) {
+            const NvModelCluster &cluster = model.getClusters()[ii];
+            const uint32_t *tri = indices + cluster.firstIndex;
+
+            for ( int32_t jj = 0; jj < cluster.indexCount; jj++) {
+                vec3f p( vertices + tri[jj] * vtxSize + pOffset);
+                if ( length( p - cluster.center) > cluster.radius * 1.0001f + 1e-6f)
+                    outside++;
+            }
+
+            //eyes in a box around the mesh, some inside it
+            for ( int32_t kk = 0; kk < 200; kk++) {
+                vec3f eye( rnd.next( -5.0f, 5.0f), rnd.next( -5.0f, 5.0f), rnd.next( -5.0f, 5.0f));
+                vec3f toCenter = cluster.center - eye;
+
+                if ( dot( toCenter, cluster.coneAxis) < cluster.coneCutoff * length( toCenter) + cluster.radius * (1.0f + cluster.coneCutoff))
+                    continue;
+
+                for ( int32_t jj = 0; jj < cluster.indexCount; jj += 3) {
+                    vec3f p0( vertices + tri[jj] * vtxSize + pOffset);
+                    vec3f p1( vertices + tri[jj + 1] * vtxSize + pOffset);
+                    vec3f p2( vertices + tri[jj + 2] * vtxSize + pOffset);
+                    if ( dot( p0 - eye, cross( p1 - p0, p2 - p0)) < 0.0f)
+                        falseCulls++;
+                }
+            }
+        }
+
+        if ( model.getClusterCount() == 0) {
+            LOGE( "NvModel check failed: no clusters were built");
+            passed = false;
+        }
+        if ( outside) {
+            LOGE( "NvModel check failed: %d cluster vertices lie outside their sphere", outside);
+            passed = false;
+        }
+        if ( falseCulls) {
+            LOGE( "NvModel check failed: the cone test culled %d front-facing triangles", falseCulls);
+            passed = false;
+        }
+    }
+
+    return passed;
+}
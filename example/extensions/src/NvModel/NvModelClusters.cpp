@@ -0,0 +1,315 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelClusters.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvMath.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace nv;
+
+using std::vector;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local functions
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//
+//  Bounding sphere and normal cone of one cluster
+////////////////////////////////////////////////////////////
+void computeClusterBounds( const float *vertices, int32_t vtxSize, int32_t pOffset, const vector<uint32_t> &indices,
+    const vector<uint32_t> &members, NvModelCluster &cluster) {
+
+    //Ritter's sphere: start from a far apart pair, then grow to take in the rest
+    vec3f p0( &vertices[members[0]*vtxSize + pOffset]);
+    vec3f a = p0, b = p0;
+    float best = 0.0f;
+    for (size_t ii = 0; ii < members.size(); ii++) {
+        vec3f p( &vertices[members[ii]*vtxSize + pOffset]);
+        float d = square_norm( p - p0);
+        if (d > best) {
+            best = d;
+            a = p;
+        }
+    }
+    best = 0.0f;
+    for (size_t ii = 0; ii < members.size(); ii++) {
+        vec3f p( &vertices[members[ii]*vtxSize + pOffset]);
+        float d = square_norm( p - a);
+        if (d > best) {
+            best = d;
+            b = p;
+        }
+    }
+
+    vec3f center = (a + b) * 0.5f;
+    float radius = length( b - a) * 0.5f;
+    for (size_t ii = 0; ii < members.size(); ii++) {
+        vec3f p( &vertices[members[ii]*vtxSize + pOffset]);
+        float d = length( p - center);
+        if (d > radius) {
+            float grown = (radius + d) * 0.5f;
+            center += (p - center) * ((grown - radius) / d);
+            radius = grown;
+        }
+    }
+
+    cluster.center = center;
+    cluster.radius = radius;
+
+    //the cone is centered on the mean of the unit triangle normals
+    vector<vec3f> normals;
+    normals.reserve( indices.size() / 3);
+    vec3f sum( 0.0f, 0.0f, 0.0f);
+    for (size_t ii = 0; ii < indices.size(); ii += 3) {
+        const uint32_t *tri = &indices[ii];
+        vec3f v0( &vertices[tri[0]*vtxSize + pOffset]);
+        vec3f v1( &vertices[tri[1]*vtxSize + pOffset]);
+        vec3f v2( &vertices[tri[2]*vtxSize + pOffset]);
+
+        vec3f n = cross( v1 - v0, v2 - v0);
+        if (square_norm( n) > 0.0f) {
+            n = normalize( n);
+            normals.push_back( n);
+            sum += n;
+        }
+    }
+
+    cluster.coneAxis = vec3f( 0.0f, 0.0f, 0.0f);
+    cluster.coneCutoff = 1.0f;
+
+    if (normals.empty() || square_norm( sum) <= 0.0f)
+        return;
+
+    vec3f axis = normalize( sum);
+    float minDot = 1.0f;
+    for (size_t ii = 0; ii < normals.size(); ii++) {
+        float d = dot( axis, normals[ii]);
+        minDot = (d < minDot) ? d : minDot;
+    }
+
+    //normals spread over a hemisphere or more can face the eye from anywhere
+    if (minDot <= 0.0f)
+        return;
+
+    cluster.coneAxis = axis;
+    cluster.coneCutoff = sqrtf( 1.0f - minDot * minDot);
+}
+
+} // namespace
+
+//
+// group the compiled triangles into clusters of bounded size
+//
+//////////////////////////////////////////////////////////////////////
+int32_t NvModel::computeClusters( int32_t maxVertices, int32_t maxTriangles) {
+    _clusters.clear();
+
+    vector<uint32_t> &triangles = _indices[2];
+    if (triangles.empty() || _pOffset < 0 || maxVertices < 3 || maxTriangles < 1)
+        return 0;
+
+    const uint32_t triCount = (uint32_t)triangles.size() / 3;
+    const uint32_t vertexCount = (uint32_t)getCompiledVertexCount();
+
+    //the triangles of each vertex, the first live[v] of them not yet taken
+    vector<uint32_t> triOffsets( vertexCount + 1, 0);
+    for (uint32_t ii = 0; ii < triCount*3; ii++)
+        triOffsets[triangles[ii] + 1]++;
+    for (uint32_t v = 0; v < vertexCount; v++)
+        triOffsets[v + 1] += triOffsets[v];
+
+    vector<uint32_t> triList( triCount*3);
+    vector<uint32_t> live( vertexCount, 0);
+    for (uint32_t ii = 0; ii < triCount*3; ii++) {
+        const uint32_t v = triangles[ii];
+        triList[triOffsets[v] + live[v]++] = ii / 3;
+    }
+
+    vector<vec3f> centroids( triCount);
+    for (uint32_t tri = 0; tri < triCount; tri++) {
+        vec3f v0( &_vertices[triangles[tri*3]*_vtxSize + _pOffset]);
+        vec3f v1( &_vertices[triangles[tri*3+1]*_vtxSize + _pOffset]);
+        vec3f v2( &_vertices[triangles[tri*3+2]*_vtxSize + _pOffset]);
+        centroids[tri] = (v0 + v1 + v2) * (1.0f / 3.0f);
+    }
+
+    //stamps[v] is the number of the last cluster that took in vertex v
+    vector<int32_t> stamps( vertexCount, -1);
+    vector<bool> taken( triCount, false);
+    vector<uint32_t> members;
+    members.reserve( maxVertices);
+    vector<uint32_t> clusterIndices;
+    clusterIndices.reserve( maxTriangles*3);
+
+    vector<uint32_t> order;
+    order.reserve( triCount);
+
+    uint32_t cursor = 0;
+    while (order.size() < triCount) {
+        //each cluster starts next to the one before it, at the triangle with the fewest
+        //neighbors left, so that no small islands are left behind; else at the first
+        //triangle left in the present order
+        uint32_t seed = ~0u;
+        uint32_t seedLive = ~0u;
+        for (size_t mm = 0; mm < members.size(); mm++) {
+            const uint32_t v = members[mm];
+            for (uint32_t kk = 0; kk < live[v]; kk++) {
+                const uint32_t tri = triList[triOffsets[v] + kk];
+                const uint32_t *t = &triangles[tri*3];
+                uint32_t neighbors = live[t[0]] + live[t[1]] + live[t[2]];
+                if (neighbors < seedLive) {
+                    seedLive = neighbors;
+                    seed = tri;
+                }
+            }
+        }
+
+        if (seed == ~0u) {
+            while (taken[cursor])
+                cursor++;
+            seed = cursor;
+        }
+
+        const int32_t stamp = (int32_t)_clusters.size();
+        NvModelCluster cluster;
+        cluster.firstIndex = (int32_t)order.size()*3;
+        members.clear();
+        clusterIndices.clear();
+        vec3f memberSum( 0.0f, 0.0f, 0.0f);
+
+        uint32_t next = seed;
+        int32_t clusterTris = 0;
+
+        while (next != ~0u) {
+            taken[next] = true;
+            order.push_back( next);
+            clusterTris++;
+
+            for (int32_t jj = 0; jj < 3; jj++) {
+                const uint32_t v = triangles[next*3 + jj];
+                clusterIndices.push_back( v);
+
+                //retire the triangle from the live list of its vertex
+                uint32_t *tris = &triList[triOffsets[v]];
+                for (uint32_t kk = 0; kk < live[v]; kk++) {
+                    if (tris[kk] == next) {
+                        tris[kk] = tris[--live[v]];
+                        tris[live[v]] = next;
+                        break;
+                    }
+                }
+
+                if (stamps[v] != stamp) {
+                    stamps[v] = stamp;
+                    members.push_back( v);
+                    memberSum += vec3f( &_vertices[v*_vtxSize + _pOffset]);
+                }
+            }
+
+            if (clusterTris == maxTriangles)
+                break;
+
+            //the next triangle adds the fewest vertices, then lies closest to the cluster
+            const vec3f center = memberSum * (1.0f / (float)members.size());
+            uint32_t bestNew = 4;
+            float bestDist = 0.0f;
+            next = ~0u;
+
+            for (size_t mm = 0; mm < members.size(); mm++) {
+                const uint32_t v = members[mm];
+                const uint32_t *tris = &triList[triOffsets[v]];
+
+                for (uint32_t kk = 0; kk < live[v]; kk++) {
+                    const uint32_t tri = tris[kk];
+                    const uint32_t *t = &triangles[tri*3];
+
+                    uint32_t added = (stamps[t[0]] != stamp) ? 1 : 0;
+                    added += (stamps[t[1]] != stamp && t[1] != t[0]) ? 1 : 0;
+                    added += (stamps[t[2]] != stamp && t[2] != t[0] && t[2] != t[1]) ? 1 : 0;
+
+                    if (added > bestNew || (int32_t)(members.size() + added) > maxVertices)
+                        continue;
+
+                    const float dist = square_norm( centroids[tri] - center);
+                    if (added < bestNew || dist < bestDist) {
+                        bestNew = added;
+                        bestDist = dist;
+                        next = tri;
+                    }
+                }
+            }
+        }
+
+        cluster.indexCount = clusterTris*3;
+        cluster.vertexCount = (int32_t)members.size();
+        computeClusterBounds( &_vertices[0], _vtxSize, _pOffset, clusterIndices, members, cluster);
+        _clusters.push_back( cluster);
+    }
+
+    //the clusters' triangles are made contiguous, in every list that follows the triangle order
+    vector<uint32_t> reordered;
+    gatherTriangles( triangles, order, 3, reordered);
+
+    if (_lodIndices.size() >= triangles.size())
+        std::copy( reordered.begin(), reordered.end(), _lodIndices.begin());
+
+    triangles.swap( reordered);
+
+    if (_indices[3].size() == (size_t)triCount*6) {
+        gatherTriangles( _indices[3], order, 6, reordered);
+        _indices[3].swap( reordered);
+    }
+
+    return (int32_t)_clusters.size();
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getClusterCount() const {
+    return (int32_t)_clusters.size();
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+const NvModelCluster* NvModel::getClusters() const {
+    return _clusters.empty() ? 0 : &_clusters[0];
+}
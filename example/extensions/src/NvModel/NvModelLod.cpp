@@ -0,0 +1,574 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelLod.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvMath.h"
+
+#include <algorithm>
+#include <math.h>
+#include <queue>
+
+using namespace nv;
+
+using std::vector;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local data structures
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//
+//  Sum of weighted squared distances to a set of planes
+////////////////////////////////////////////////////////////
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+
+    Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0) {}
+
+    // the plane is a*x + b*y + c*z + d = 0 with a unit normal
+    void addPlane( double a, double b, double c, double d, double w) {
+        a2 += w*a*a; ab += w*a*b; ac += w*a*c; ad += w*a*d;
+        b2 += w*b*b; bc += w*b*c; bd += w*b*d;
+        c2 += w*c*c; cd += w*c*d;
+        d2 += w*d*d;
+        weight += w;
+    }
+
+    void add( const Quadric &q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+    }
+
+    double evaluate( const vec3f &p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x
+             + b2*y*y + 2.0*bc*y*z + 2.0*bd*y
+             + c2*z*z + 2.0*cd*z
+             + d2;
+    }
+};
+
+//
+//  Candidate half-edge collapse, moving vertex 'from' onto vertex 'to'
+////////////////////////////////////////////////////////////
+struct Collapse {
+    float cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    // std::priority_queue pops the largest, so the cheapest collapse compares largest
+    bool operator< ( const Collapse &rhs) const {
+        return cost > rhs.cost;
+    }
+};
+
+//
+//  Edge collapse state over the compiled triangle list.  Collapses run on
+//  welded positions, so normal and texture seams stay closed; triangles keep
+//  compiled vertex indices for their corners.
+////////////////////////////////////////////////////////////
+class LodBuilder {
+public:
+    LodBuilder( const vector<float> &vertices, int32_t vtxSize, int32_t nOffset, const vector<uint32_t> &indices);
+
+    // collapses edges until at most targetTris triangles are left or no collapse is possible
+    void simplify( uint32_t targetTris);
+
+    void emit( vector<uint32_t> &indices) const;
+
+    uint32_t getTriangleCount() const { return _liveTris; }
+
+    // root mean square distance of the worst collapse so far
+    float getError() const { return sqrtf( _maxCost); }
+
+private:
+    void pushEdge( uint32_t a, uint32_t b);
+    void pushAllEdges();
+    float collapseCost( uint32_t from, uint32_t to) const;
+    bool canCollapse( uint32_t from, uint32_t to);
+    void collapse( uint32_t from, uint32_t to);
+    uint32_t pickVertex( uint32_t corner, uint32_t to) const;
+    bool hasWeld( uint32_t tri, uint32_t w) const;
+
+    const vector<float> &_vertices;
+    int32_t _vtxSize;
+    int32_t _nOffset;
+
+    // welded positions; _weld maps a compiled vertex to its position, _groups lists the compiled vertices of a position
+    vector<vec3f> _positions;
+    vector<uint32_t> _weld;
+    vector<uint32_t> _groupStart;
+    vector<uint32_t> _groups;
+
+    // compiled vertex of each triangle corner
+    vector<uint32_t> _corners;
+    vector<uint8_t> _triAlive;
+    uint32_t _liveTris;
+
+    // per position
+    vector<vector<uint32_t> > _vertexTris;
+    vector<Quadric> _quadrics;
+    vector<uint32_t> _versions;
+
+    vector<uint32_t> _marks;
+    uint32_t _mark;
+
+    std::priority_queue<Collapse> _heap;
+    float _maxCost;
+};
+
+struct PositionLess {
+    const vector<float> *vertices;
+    int32_t vtxSize;
+
+    bool operator() ( uint32_t lhs, uint32_t rhs) const {
+        const float *a = &(*vertices)[lhs*vtxSize];
+        const float *b = &(*vertices)[rhs*vtxSize];
+        if (a[0] != b[0])
+            return a[0] < b[0];
+        if (a[1] != b[1])
+            return a[1] < b[1];
+        return a[2] < b[2];
+    }
+};
+
+static vec3f triangleNormal( const vec3f &p0, const vec3f &p1, const vec3f &p2) {
+    return cross( p1 - p0, p2 - p0);
+}
+
+LodBuilder::LodBuilder( const vector<float> &vertices, int32_t vtxSize, int32_t nOffset, const vector<uint32_t> &indices) :
+    _vertices(vertices), _vtxSize(vtxSize), _nOffset(nOffset), _liveTris(0), _mark(0), _maxCost(0.0f) {
+
+    const uint32_t vertexCount = (uint32_t)(vertices.size() / vtxSize);
+
+    //weld compiled vertices that share a position
+    vector<uint32_t> order( vertexCount);
+    for (uint32_t ii = 0; ii < vertexCount; ii++)
+        order[ii] = ii;
+
+    PositionLess less = { &vertices, vtxSize };
+    std::sort( order.begin(), order.end(), less);
+
+    _weld.resize( vertexCount);
+    _groups.resize( vertexCount);
+    for (uint32_t ii = 0; ii < vertexCount; ii++) {
+        if (ii == 0 || less( order[ii - 1], order[ii])) {
+            _groupStart.push_back( ii);
+            _positions.push_back( vec3f( &vertices[order[ii]*vtxSize]));
+        }
+        _weld[order[ii]] = (uint32_t)_positions.size() - 1;
+        _groups[ii] = order[ii];
+    }
+    _groupStart.push_back( vertexCount);
+
+    const uint32_t positionCount = (uint32_t)_positions.size();
+    _vertexTris.resize( positionCount);
+    _quadrics.resize( positionCount);
+    _versions.resize( positionCount, 0);
+    _marks.resize( positionCount, 0);
+
+    //triangles that are degenerate in position space draw nothing and are dropped
+    _corners = indices;
+    _triAlive.resize( indices.size() / 3, 0);
+
+    for (uint32_t tri = 0; tri < (uint32_t)_triAlive.size(); tri++) {
+        const uint32_t w0 = _weld[_corners[tri*3]], w1 = _weld[_corners[tri*3 + 1]], w2 = _weld[_corners[tri*3 + 2]];
+        if (w0 == w1 || w0 == w2 || w1 == w2)
+            continue;
+
+        _triAlive[tri] = 1;
+        _liveTris++;
+
+        _vertexTris[w0].push_back( tri);
+        _vertexTris[w1].push_back( tri);
+        _vertexTris[w2].push_back( tri);
+
+        //area weighted plane of the triangle
+        vec3f n = triangleNormal( _positions[w0], _positions[w1], _positions[w2]);
+        const float len = length( n);
+        if (len > 0.0f) {
+            n /= len;
+            const double d = -dot( n, _positions[w0]);
+            const double area = 0.5 * len;
+            _quadrics[w0].addPlane( n.x, n.y, n.z, d, area);
+            _quadrics[w1].addPlane( n.x, n.y, n.z, d, area);
+            _quadrics[w2].addPlane( n.x, n.y, n.z, d, area);
+        }
+    }
+
+    //open edges get a plane perpendicular to their triangle, so borders hold their shape
+    vector<uint64_t> edges;
+    edges.reserve( _liveTris * 3);
+    for (uint32_t tri = 0; tri < (uint32_t)_triAlive.size(); tri++) {
+        if (!_triAlive[tri])
+            continue;
+
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t a = _weld[_corners[tri*3 + jj]];
+            const uint32_t b = _weld[_corners[tri*3 + (jj + 1) % 3]];
+            edges.push_back( (uint64_t( std::min( a, b)) << 32) | std::max( a, b));
+        }
+    }
+    std::sort( edges.begin(), edges.end());
+
+    for (uint32_t tri = 0; tri < (uint32_t)_triAlive.size(); tri++) {
+        if (!_triAlive[tri])
+            continue;
+
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t a = _weld[_corners[tri*3 + jj]];
+            const uint32_t b = _weld[_corners[tri*3 + (jj + 1) % 3]];
+            const uint32_t c = _weld[_corners[tri*3 + (jj + 2) % 3]];
+            const uint64_t key = (uint64_t( std::min( a, b)) << 32) | std::max( a, b);
+
+            if (std::upper_bound( edges.begin(), edges.end(), key) - std::lower_bound( edges.begin(), edges.end(), key) != 1)
+                continue;
+
+            const vec3f edge = _positions[b] - _positions[a];
+            vec3f n = cross( edge, triangleNormal( _positions[a], _positions[b], _positions[c]));
+            const float len = length( n);
+            if (len > 0.0f) {
+                n /= len;
+                const double d = -dot( n, _positions[a]);
+                const double weight = 10.0 * dot( edge, edge);
+                _quadrics[a].addPlane( n.x, n.y, n.z, d, weight);
+                _quadrics[b].addPlane( n.x, n.y, n.z, d, weight);
+            }
+        }
+    }
+
+    pushAllEdges();
+}
+
+bool LodBuilder::hasWeld( uint32_t tri, uint32_t w) const {
+    return _weld[_corners[tri*3]] == w || _weld[_corners[tri*3 + 1]] == w || _weld[_corners[tri*3 + 2]] == w;
+}
+
+float LodBuilder::collapseCost( uint32_t from, uint32_t to) const {
+    Quadric q = _quadrics[from];
+    q.add( _quadrics[to]);
+
+    const double cost = q.weight > 0.0 ? q.evaluate( _positions[to]) / q.weight : 0.0;
+    return cost > 0.0 ? (float)cost : 0.0f;
+}
+
+void LodBuilder::pushEdge( uint32_t a, uint32_t b) {
+    const float costAB = collapseCost( a, b);
+    const float costBA = collapseCost( b, a);
+
+    Collapse c;
+    c.cost = std::min( costAB, costBA);
+    c.from = costAB <= costBA ? a : b;
+    c.to = costAB <= costBA ? b : a;
+    c.fromVersion = _versions[c.from];
+    c.toVersion = _versions[c.to];
+    _heap.push( c);
+}
+
+void LodBuilder::pushAllEdges() {
+    _heap = std::priority_queue<Collapse>();
+
+    for (uint32_t tri = 0; tri < (uint32_t)_triAlive.size(); tri++) {
+        if (!_triAlive[tri])
+            continue;
+
+        //every interior edge is shared by two triangles; push it from the one where it runs from the lower position
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t a = _weld[_corners[tri*3 + jj]];
+            const uint32_t b = _weld[_corners[tri*3 + (jj + 1) % 3]];
+            if (a < b)
+                pushEdge( a, b);
+        }
+    }
+}
+
+bool LodBuilder::canCollapse( uint32_t from, uint32_t to) {
+    //link condition: the two positions may only share the neighbors of the triangles on their edge,
+    //otherwise the collapse pinches the surface
+    _mark++;
+
+    uint32_t sharedTris = 0;
+    for (vector<uint32_t>::const_iterator it = _vertexTris[from].begin(); it != _vertexTris[from].end(); ++it) {
+        if (!_triAlive[*it])
+            continue;
+
+        if (hasWeld( *it, to))
+            sharedTris++;
+
+        for (int32_t jj = 0; jj < 3; jj++)
+            _marks[_weld[_corners[*it*3 + jj]]] = _mark;
+    }
+
+    if (sharedTris == 0)
+        return false;
+
+    uint32_t commonNeighbors = 0;
+    const uint32_t counted = ++_mark;
+    for (vector<uint32_t>::const_iterator it = _vertexTris[to].begin(); it != _vertexTris[to].end(); ++it) {
+        if (!_triAlive[*it])
+            continue;
+
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t w = _weld[_corners[*it*3 + jj]];
+            if (w != from && w != to && _marks[w] == counted - 1) {
+                _marks[w] = counted;
+                commonNeighbors++;
+            }
+        }
+    }
+
+    if (commonNeighbors != sharedTris)
+        return false;
+
+    //no triangle around 'from' may flip or collapse to a sliver
+    for (vector<uint32_t>::const_iterator it = _vertexTris[from].begin(); it != _vertexTris[from].end(); ++it) {
+        if (!_triAlive[*it] || hasWeld( *it, to))
+            continue;
+
+        vec3f p[3];
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t w = _weld[_corners[*it*3 + jj]];
+            p[jj] = _positions[w];
+        }
+        const vec3f before = triangleNormal( p[0], p[1], p[2]);
+
+        for (int32_t jj = 0; jj < 3; jj++) {
+            if (_weld[_corners[*it*3 + jj]] == from)
+                p[jj] = _positions[to];
+        }
+        const vec3f after = triangleNormal( p[0], p[1], p[2]);
+
+        if (dot( before, after) <= 0.2f * length( before) * length( after))
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t LodBuilder::pickVertex( uint32_t corner, uint32_t to) const {
+    uint32_t best = _groups[_groupStart[to]];
+    if (_nOffset < 0)
+        return best;
+
+    const vec3f normal( &_vertices[corner*_vtxSize + _nOffset]);
+    float bestDot = -2.0f;
+
+    for (uint32_t ii = _groupStart[to]; ii < _groupStart[to + 1]; ii++) {
+        const float d = dot( normal, vec3f( &_vertices[_groups[ii]*_vtxSize + _nOffset]));
+        if (d > bestDot) {
+            bestDot = d;
+            best = _groups[ii];
+        }
+    }
+
+    return best;
+}
+
+void LodBuilder::collapse( uint32_t from, uint32_t to) {
+    _quadrics[to].add( _quadrics[from]);
+
+    for (vector<uint32_t>::const_iterator it = _vertexTris[from].begin(); it != _vertexTris[from].end(); ++it) {
+        const uint32_t tri = *it;
+        if (!_triAlive[tri])
+            continue;
+
+        if (hasWeld( tri, to)) {
+            _triAlive[tri] = 0;
+            _liveTris--;
+            continue;
+        }
+
+        for (int32_t jj = 0; jj < 3; jj++) {
+            uint32_t &corner = _corners[tri*3 + jj];
+            if (_weld[corner] == from)
+                corner = pickVertex( corner, to);
+        }
+        _vertexTris[to].push_back( tri);
+    }
+
+    vector<uint32_t>().swap( _vertexTris[from]);
+    _versions[from]++;
+    _versions[to]++;
+
+    //drop the dead triangles of 'to' and queue its edges with the new quadric
+    vector<uint32_t> &tris = _vertexTris[to];
+    size_t kept = 0;
+    for (size_t ii = 0; ii < tris.size(); ii++) {
+        if (_triAlive[tris[ii]])
+            tris[kept++] = tris[ii];
+    }
+    tris.resize( kept);
+
+    _mark++;
+    for (vector<uint32_t>::const_iterator it = tris.begin(); it != tris.end(); ++it) {
+        for (int32_t jj = 0; jj < 3; jj++) {
+            const uint32_t w = _weld[_corners[*it*3 + jj]];
+            if (w != to && _marks[w] != _mark) {
+                _marks[w] = _mark;
+                pushEdge( to, w);
+            }
+        }
+    }
+}
+
+void LodBuilder::simplify( uint32_t targetTris) {
+    bool progress = false;
+
+    while (_liveTris > targetTris) {
+        if (_heap.empty()) {
+            //collapses rejected earlier may have become legal; stop once a full pass changes nothing
+            if (!progress)
+                break;
+
+            progress = false;
+            pushAllEdges();
+            continue;
+        }
+
+        const Collapse c = _heap.top();
+        _heap.pop();
+
+        if (c.fromVersion != _versions[c.from] || c.toVersion != _versions[c.to])
+            continue;
+
+        if (!canCollapse( c.from, c.to))
+            continue;
+
+        collapse( c.from, c.to);
+        _maxCost = std::max( _maxCost, c.cost);
+        progress = true;
+    }
+}
+
+void LodBuilder::emit( vector<uint32_t> &indices) const {
+    for (uint32_t tri = 0; tri < (uint32_t)_triAlive.size(); tri++) {
+        if (_triAlive[tri]) {
+            indices.push_back( _corners[tri*3]);
+            indices.push_back( _corners[tri*3 + 1]);
+            indices.push_back( _corners[tri*3 + 2]);
+        }
+    }
+}
+
+} // namespace
+
+//
+// generate levels of detail from the compiled triangles
+//////////////////////////////////////////////////////////////////////
+int32_t NvModel::computeLods( int32_t lodCount, float reduction) {
+    const vector<uint32_t> &triangles = _indices[2];
+
+    _lodIndices = triangles;
+    _lodFirstIndex.assign( 1, 0);
+    _lodIndexCount.assign( 1, (int32_t)triangles.size());
+    _lodError.assign( 1, 0.0f);
+
+    if (lodCount <= 1 || triangles.empty() || _vtxSize == 0)
+        return 1;
+
+    LodBuilder builder( _vertices, _vtxSize, _nOffset, triangles);
+
+    //each level continues collapsing from the one before it
+    uint32_t previousTris = (uint32_t)triangles.size() / 3;
+    for (int32_t lod = 1; lod < lodCount; lod++) {
+        builder.simplify( (uint32_t)(previousTris * reduction));
+
+        //stop when the mesh no longer gets meaningfully smaller
+        if (builder.getTriangleCount() == 0 || builder.getTriangleCount() > previousTris - previousTris / 20)
+            break;
+
+        _lodFirstIndex.push_back( (int32_t)_lodIndices.size());
+        builder.emit( _lodIndices);
+        _lodIndexCount.push_back( (int32_t)_lodIndices.size() - _lodFirstIndex.back());
+        _lodError.push_back( builder.getError());
+
+        previousTris = builder.getTriangleCount();
+    }
+
+    return (int32_t)_lodFirstIndex.size();
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getLodCount() const {
+    return _lodFirstIndex.empty() ? 1 : (int32_t)_lodFirstIndex.size();
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+const uint32_t* NvModel::getCompiledLodIndices() const {
+    if (_lodFirstIndex.empty())
+        return getCompiledIndices( NvModelPrimType::TRIANGLES);
+
+    return (_lodIndices.size() > 0) ? &_lodIndices[0] : 0;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getCompiledLodIndexCount() const {
+    return _lodFirstIndex.empty() ? (int32_t)_indices[2].size() : (int32_t)_lodIndices.size();
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getLodFirstIndex( int32_t lod) const {
+    return _lodFirstIndex.empty() ? 0 : _lodFirstIndex[lod];
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getLodIndexCount( int32_t lod) const {
+    return _lodFirstIndex.empty() ? (int32_t)_indices[2].size() : _lodIndexCount[lod];
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+float NvModel::getLodError( int32_t lod) const {
+    return _lodFirstIndex.empty() ? 0.0f : _lodError[lod];
+}
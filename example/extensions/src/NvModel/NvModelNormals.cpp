@@ -0,0 +1,400 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelNormals.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvMath.h"
+#include "NV/NvTaskPool.h"
+
+#include <math.h>
+
+using namespace nv;
+
+using std::vector;
+
+// The parallel versions make the same decisions as the serial loops in NvModel.cpp, in
+// the same order, so they produce identical arrays.  The serial loops visit the corners
+// in order and each corner only touches the slots of its own vertex, so the corners are
+// gathered per vertex (CSR) and every vertex replays its own corners independently.  The
+// only cross-vertex state is the numbering of split slots, which the serial loops append
+// in corner order; a prefix count over the corners that split rebuilds it.
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local data structures
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const int32_t VerticesPerTask = 4096;
+const int32_t CornersPerTask = 16384;
+const int32_t SlotsPerTask = 16384;
+
+//
+//  face vectors, evaluated exactly as the serial loops do
+////////////////////////////////////////////////////////////
+struct FaceNormal {
+    const float *positions;
+    const uint32_t *pIndex;
+    int32_t posSize;
+
+    // sum is accumulated into the slots, dir is tested for agreement
+    void operator()( int32_t ii, vec3f &sum, vec3f &dir) const {
+        vec3f p0(&positions[pIndex[ii]*posSize]);
+        vec3f p1(&positions[pIndex[ii+1]*posSize]);
+        vec3f p2(&positions[pIndex[ii+2]*posSize]);
+
+        vec3f dp0 = p1 - p0;
+        vec3f dp1 = p2 - p0;
+
+        sum = cross( dp0, dp1);
+        dir = normalize( sum);
+    }
+};
+
+struct FaceTangent {
+    const float *positions;
+    const float *texCoords;
+    const uint32_t *pIndex;
+    const uint32_t *tIndex;
+    int32_t posSize;
+    int32_t tcSize;
+
+    void operator()( int32_t ii, vec3f &sum, vec3f &dir) const {
+        vec3f p0(&positions[pIndex[ii]*posSize]);
+        vec3f p1(&positions[pIndex[ii+1]*posSize]);
+        vec3f p2(&positions[pIndex[ii+2]*posSize]);
+        vec2f st0(&texCoords[tIndex[ii]*tcSize]);
+        vec2f st1(&texCoords[tIndex[ii+1]*tcSize]);
+        vec2f st2(&texCoords[tIndex[ii+2]*tcSize]);
+
+        vec3f dp0 = p1 - p0;
+        vec3f dp1 = p2 - p0;
+        vec2f dst0 = st1 - st0;
+        vec2f dst1 = st2 - st0;
+
+        float factor = 1.0f / (dst0[0] * dst1[1] - dst1[0] * dst0[1]);
+
+        vec3f sTan;
+        sTan[0] = dp0[0] * dst1[1] - dp1[0] * dst0[1];
+        sTan[1] = dp0[1] * dst1[1] - dp1[1] * dst0[1];
+        sTan[2] = dp0[2] * dst1[1] - dp1[2] * dst0[1];
+        sTan *= factor;
+
+        sum = normalize( sTan);
+        dir = sum;
+    }
+};
+
+//
+//  corner to slot assignment shared by normals and tangents
+////////////////////////////////////////////////////////////
+template <class Face>
+struct SmoothJob {
+    Face face;
+    float cosLimit;
+
+    // the vertex of each corner, and the corners of each vertex in corner order
+    const uint32_t *keys;
+    int32_t keyCount;
+    int32_t cornerCount;
+    vector<uint32_t> offsets;
+    vector<uint32_t> corners;
+
+    // corners that start a split slot, and how many of them each corner task holds
+    vector<uint8_t> splits;
+    vector<uint32_t> taskSplits;
+
+    float *slots;
+    int32_t slotCount;
+    uint32_t *slotIndex;
+
+    // replays the serial decisions of a vertex, leaving in slotIndex 0 for its own
+    // slot or k for its k-th split, and the sum of its own slot in slots
+    static void assignVertices( void *data, int32_t index);
+
+    // turns the split marks of a corner range into slot numbers
+    static void countSplits( void *data, int32_t index);
+    static void numberSplits( void *data, int32_t index);
+
+    // writes the final slot of every corner and the sums of the split slots
+    static void resolveVertices( void *data, int32_t index);
+
+    static void normalizeSlots( void *data, int32_t index);
+
+    void run( vector<float> &values, vector<uint32_t> &indices);
+};
+
+template <class Face>
+void SmoothJob<Face>::assignVertices( void *data, int32_t index) {
+    SmoothJob &job = *(SmoothJob*)data;
+    const int32_t first = index * VerticesPerTask;
+    const int32_t last = (first + VerticesPerTask < job.keyCount) ? first + VerticesPerTask : job.keyCount;
+
+    vector<vec3f> collisions;
+
+    for (int32_t v = first; v < last; v++) {
+        vec3f own(&job.slots[v*3]);
+        collisions.clear();
+
+        for (uint32_t jj = job.offsets[v]; jj < job.offsets[v+1]; jj++) {
+            const uint32_t corner = job.corners[jj];
+            vec3f sum, dir;
+            job.face( corner - corner % 3, sum, dir);
+
+            if (own[0] == 0.0f && own[1] == 0.0f && own[2] == 0.0f) {
+                own = sum;
+                job.slotIndex[corner] = 0;
+            }
+            else if (dot( normalize( own), dir) >= job.cosLimit) {
+                own += sum;
+                job.slotIndex[corner] = 0;
+            }
+            else {
+                uint32_t k = 0;
+                while (k < collisions.size() && !(dot( normalize( collisions[k]), dir) >= job.cosLimit))
+                    k++;
+
+                if (k < collisions.size()) {
+                    collisions[k] += sum;
+                }
+                else {
+                    collisions.push_back( sum);
+                    job.splits[corner] = 1;
+                }
+                job.slotIndex[corner] = k + 1;
+            }
+        }
+
+        job.slots[v*3] = own[0];
+        job.slots[v*3+1] = own[1];
+        job.slots[v*3+2] = own[2];
+    }
+}
+
+template <class Face>
+void SmoothJob<Face>::countSplits( void *data, int32_t index) {
+    SmoothJob &job = *(SmoothJob*)data;
+    const int32_t first = index * CornersPerTask;
+    const int32_t last = (first + CornersPerTask < job.cornerCount) ? first + CornersPerTask : job.cornerCount;
+
+    uint32_t count = 0;
+    for (int32_t c = first; c < last; c++)
+        count += job.splits[c];
+
+    job.taskSplits[index] = count;
+}
+
+template <class Face>
+void SmoothJob<Face>::numberSplits( void *data, int32_t index) {
+    SmoothJob &job = *(SmoothJob*)data;
+    const int32_t first = index * CornersPerTask;
+    const int32_t last = (first + CornersPerTask < job.cornerCount) ? first + CornersPerTask : job.cornerCount;
+
+    uint32_t target = job.taskSplits[index];
+    for (int32_t c = first; c < last; c++) {
+        if (job.splits[c])
+            job.slotIndex[c] = target++;
+    }
+}
+
+template <class Face>
+void SmoothJob<Face>::resolveVertices( void *data, int32_t index) {
+    SmoothJob &job = *(SmoothJob*)data;
+    const int32_t first = index * VerticesPerTask;
+    const int32_t last = (first + VerticesPerTask < job.keyCount) ? first + VerticesPerTask : job.keyCount;
+
+    vector<uint32_t> targets;
+
+    for (int32_t v = first; v < last; v++) {
+        targets.clear();
+
+        for (uint32_t jj = job.offsets[v]; jj < job.offsets[v+1]; jj++) {
+            const uint32_t corner = job.corners[jj];
+            const bool split = job.splits[corner] != 0;
+
+            if (!split && job.slotIndex[corner] == 0) {
+                job.slotIndex[corner] = v;
+                continue;
+            }
+
+            vec3f sum, dir;
+            job.face( corner - corner % 3, sum, dir);
+
+            if (split) {
+                const uint32_t target = job.slotIndex[corner];
+                targets.push_back( target);
+                job.slots[target*3] = sum[0];
+                job.slots[target*3+1] = sum[1];
+                job.slots[target*3+2] = sum[2];
+            }
+            else {
+                const uint32_t target = targets[job.slotIndex[corner] - 1];
+                job.slotIndex[corner] = target;
+                job.slots[target*3] += sum[0];
+                job.slots[target*3+1] += sum[1];
+                job.slots[target*3+2] += sum[2];
+            }
+        }
+    }
+}
+
+template <class Face>
+void SmoothJob<Face>::normalizeSlots( void *data, int32_t index) {
+    SmoothJob &job = *(SmoothJob*)data;
+    const int32_t first = index * SlotsPerTask;
+    const int32_t last = (first + SlotsPerTask < job.slotCount) ? first + SlotsPerTask : job.slotCount;
+    int32_t slot = first;
+
+#ifdef NV_MATH_SSE
+    // four slots at a time, with the operations of nv::normalize in the same order
+    const __m128 zero = _mm_setzero_ps();
+    for (; slot + 4 <= last; slot += 4) {
+        float *p = &job.slots[slot*3];
+        __m128 a = _mm_loadu_ps( p);
+        __m128 b = _mm_loadu_ps( p + 4);
+        __m128 c = _mm_loadu_ps( p + 8);
+
+        // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3  ->  xxxx yyyy zzzz
+        __m128 x = _mm_shuffle_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE(3,3,0,0)), _mm_shuffle_ps( b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,2,0));
+        __m128 y = _mm_shuffle_ps( _mm_shuffle_ps( a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps( b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+        __m128 z = _mm_shuffle_ps( _mm_shuffle_ps( a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps( c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+
+        __m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x), _mm_mul_ps( y, y)), _mm_mul_ps( z, z)));
+        __m128 valid = _mm_cmpgt_ps( len, zero);
+        x = _mm_and_ps( _mm_div_ps( x, len), valid);
+        y = _mm_and_ps( _mm_div_ps( y, len), valid);
+        z = _mm_and_ps( _mm_div_ps( z, len), valid);
+
+        // and back
+        _mm_storeu_ps( p, _mm_shuffle_ps( _mm_shuffle_ps( x, y, _MM_SHUFFLE(1,0,1,0)), _mm_shuffle_ps( z, x, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps( p + 4, _mm_shuffle_ps( _mm_shuffle_ps( y, z, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps( x, y, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps( p + 8, _mm_shuffle_ps( _mm_shuffle_ps( z, x, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps( y, z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+    }
+#endif
+
+    for (; slot < last; slot++) {
+        vec3f n = normalize( vec3f( &job.slots[slot*3]));
+        job.slots[slot*3] = n[0];
+        job.slots[slot*3+1] = n[1];
+        job.slots[slot*3+2] = n[2];
+    }
+}
+
+template <class Face>
+void SmoothJob<Face>::run( vector<float> &values, vector<uint32_t> &indices) {
+    NvTaskPool &pool = NvTaskPool::getShared();
+
+    //gather the corners of each vertex, in corner order
+    offsets.assign( keyCount + 1, 0);
+    for (int32_t c = 0; c < cornerCount; c++)
+        offsets[keys[c] + 1]++;
+    for (int32_t v = 0; v < keyCount; v++)
+        offsets[v + 1] += offsets[v];
+
+    corners.resize( cornerCount);
+    {
+        vector<uint32_t> fill( offsets.begin(), offsets.end() - 1);
+        for (int32_t c = 0; c < cornerCount; c++)
+            corners[fill[keys[c]]++] = c;
+    }
+
+    values.assign( keyCount * 3, 0.0f);
+    indices.resize( cornerCount);
+    splits.assign( cornerCount, 0);
+    slots = keyCount ? &values[0] : NULL;
+    slotIndex = cornerCount ? &indices[0] : NULL;
+
+    const int32_t vertexTasks = (keyCount + VerticesPerTask - 1) / VerticesPerTask;
+    pool.parallelFor( vertexTasks, &SmoothJob::assignVertices, this);
+
+    //the split slots follow the vertices, numbered in the order their first corner comes
+    const int32_t cornerTasks = (cornerCount + CornersPerTask - 1) / CornersPerTask;
+    taskSplits.resize( cornerTasks);
+    pool.parallelFor( cornerTasks, &SmoothJob::countSplits, this);
+
+    uint32_t target = (uint32_t)keyCount;
+    for (int32_t t = 0; t < cornerTasks; t++) {
+        uint32_t count = taskSplits[t];
+        taskSplits[t] = target;
+        target += count;
+    }
+    pool.parallelFor( cornerTasks, &SmoothJob::numberSplits, this);
+
+    values.resize( target * 3);
+    slots = target ? &values[0] : NULL;
+    slotCount = (int32_t)target;
+    pool.parallelFor( vertexTasks, &SmoothJob::resolveVertices, this);
+
+    pool.parallelFor( (slotCount + SlotsPerTask - 1) / SlotsPerTask, &SmoothJob::normalizeSlots, this);
+}
+
+} // namespace
+
+//
+// compute tangents in the S direction, vertices in parallel
+//
+//////////////////////////////////////////////////////////////////////
+void NvModel::computeTangentsParallel() {
+    SmoothJob<FaceTangent> job;
+    job.face.positions = &_positions[0];
+    job.face.texCoords = &_texCoords[0];
+    job.face.pIndex = &_pIndex[0];
+    job.face.tIndex = &_tIndex[0];
+    job.face.posSize = _posSize;
+    job.face.tcSize = _tcSize;
+    job.cosLimit = cosf( 3.1415926f * 0.333333f);
+    job.keys = &_tIndex[0];
+    job.keyCount = (int32_t)(_texCoords.size() / _tcSize);
+    job.cornerCount = (int32_t)_pIndex.size();
+
+    job.run( _sTangents, _tanIndex);
+}
+
+//
+// compute vertex normals, vertices in parallel
+//
+//////////////////////////////////////////////////////////////////////
+void NvModel::computeNormalsParallel() {
+    SmoothJob<FaceNormal> job;
+    job.face.positions = &_positions[0];
+    job.face.pIndex = &_pIndex[0];
+    job.face.posSize = _posSize;
+    job.cosLimit = cosf( 3.1415926f * 0.333333f);
+    job.keys = &_pIndex[0];
+    job.keyCount = (int32_t)(_positions.size() / _posSize);
+    job.cornerCount = (int32_t)_pIndex.size();
+
+    job.run( _normals, _nIndex);
+}
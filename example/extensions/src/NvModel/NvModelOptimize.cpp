@@ -0,0 +1,515 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelOptimize.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvMath.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace nv;
+
+using std::vector;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local data structures
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//
+//  FIFO post-transform cache simulation
+////////////////////////////////////////////////////////////
+class CacheSim {
+public:
+    CacheSim( uint32_t vertexCount, uint32_t cacheSize) : _stamps( vertexCount, 0), _time( cacheSize + 1), _cacheSize( cacheSize) {}
+
+    // a vertex is cached while fewer than cacheSize misses have happened since its own miss
+    bool access( uint32_t v) {
+        if (_time - _stamps[v] <= _cacheSize)
+            return false;
+
+        _stamps[v] = _time++;
+        return true;
+    }
+
+    uint32_t accessTriangle( const uint32_t *tri) {
+        return (access( tri[0]) ? 1 : 0) + (access( tri[1]) ? 1 : 0) + (access( tri[2]) ? 1 : 0);
+    }
+
+    // empties the cache without touching the stamps
+    void flush() {
+        _time += _cacheSize + 1;
+    }
+
+private:
+    vector<uint32_t> _stamps;
+    uint32_t _time;
+    uint32_t _cacheSize;
+};
+
+//
+//  Forsyth vertex cache optimization
+////////////////////////////////////////////////////////////
+class ForsythOptimizer {
+public:
+    // the scores model a 32 entry LRU cache, as in Forsyth's paper; hardware FIFOs of other
+    // sizes still benefit from the same order
+    static const int32_t MaxCacheSize = 32;
+
+    ForsythOptimizer( const uint32_t *indices, uint32_t triCount, uint32_t vertexCount);
+
+    void optimize( vector<uint32_t> &order);
+
+private:
+    float vertexScore( uint32_t v) const;
+    void removeTriangle( uint32_t v, uint32_t tri);
+
+    const uint32_t *_indices;
+    uint32_t _triCount;
+
+    //triangles of each vertex, the first _live[v] of them not yet emitted
+    vector<uint32_t> _triOffsets;
+    vector<uint32_t> _triList;
+    vector<uint32_t> _live;
+
+    vector<int32_t> _cachePos;
+    vector<float> _scores;
+    vector<bool> _emitted;
+};
+
+ForsythOptimizer::ForsythOptimizer( const uint32_t *indices, uint32_t triCount, uint32_t vertexCount) :
+    _indices( indices), _triCount( triCount), _triOffsets( vertexCount + 1, 0), _live( vertexCount, 0),
+    _cachePos( vertexCount, -1), _scores( vertexCount, 0.0f), _emitted( triCount, false) {
+
+    //a degenerate triangle is counted once for each distinct vertex
+    for (uint32_t tri = 0; tri < triCount; tri++) {
+        const uint32_t *v = &indices[tri*3];
+        _live[v[0]]++;
+        if (v[1] != v[0])
+            _live[v[1]]++;
+        if (v[2] != v[0] && v[2] != v[1])
+            _live[v[2]]++;
+    }
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+        _triOffsets[v + 1] = _triOffsets[v] + _live[v];
+
+    _triList.resize( _triOffsets[vertexCount]);
+    vector<uint32_t> filled( vertexCount, 0);
+    for (uint32_t tri = 0; tri < triCount; tri++) {
+        const uint32_t *v = &indices[tri*3];
+        _triList[_triOffsets[v[0]] + filled[v[0]]++] = tri;
+        if (v[1] != v[0])
+            _triList[_triOffsets[v[1]] + filled[v[1]]++] = tri;
+        if (v[2] != v[0] && v[2] != v[1])
+            _triList[_triOffsets[v[2]] + filled[v[2]]++] = tri;
+    }
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+        _scores[v] = vertexScore( v);
+}
+
+float ForsythOptimizer::vertexScore( uint32_t v) const {
+    if (_live[v] == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    const int32_t pos = _cachePos[v];
+    if (pos >= 0) {
+        //the vertices of the last triangle get a fixed score, so its neighbors do not win by default
+        if (pos < 3)
+            score = 0.75f;
+        else
+            score = powf( 1.0f - (float)(pos - 3) / (MaxCacheSize - 3), 1.5f);
+    }
+
+    //favor vertices with few triangles left, so that isolated triangles are not left behind
+    return score + 2.0f / sqrtf( (float)_live[v]);
+}
+
+void ForsythOptimizer::removeTriangle( uint32_t v, uint32_t tri) {
+    uint32_t *tris = &_triList[_triOffsets[v]];
+    const uint32_t last = --_live[v];
+
+    for (uint32_t ii = 0; ii <= last; ii++) {
+        if (tris[ii] == tri) {
+            std::swap( tris[ii], tris[last]);
+            break;
+        }
+    }
+}
+
+void ForsythOptimizer::optimize( vector<uint32_t> &order) {
+    order.clear();
+    order.reserve( _triCount);
+
+    vector<uint32_t> cache;
+    vector<uint32_t> nextCache;
+    cache.reserve( MaxCacheSize + 3);
+    nextCache.reserve( MaxCacheSize + 3);
+
+    uint32_t scan = 0;
+    int32_t best = -1;
+
+    while (order.size() < _triCount) {
+        //when no cached vertex has a triangle left, restart at the next triangle in input order
+        if (best < 0) {
+            while (_emitted[scan])
+                scan++;
+            best = (int32_t)scan;
+        }
+
+        const uint32_t *tri = &_indices[best*3];
+        order.push_back( (uint32_t)best);
+        _emitted[best] = true;
+
+        nextCache.clear();
+        for (int32_t jj = 0; jj < 3; jj++) {
+            if (std::find( nextCache.begin(), nextCache.end(), tri[jj]) == nextCache.end()) {
+                removeTriangle( tri[jj], (uint32_t)best);
+                nextCache.push_back( tri[jj]);
+            }
+        }
+
+        for (vector<uint32_t>::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+            if (*it != tri[0] && *it != tri[1] && *it != tri[2])
+                nextCache.push_back( *it);
+        }
+
+        //vertices pushed out of the cache lose their position score
+        for (uint32_t ii = MaxCacheSize; ii < (uint32_t)nextCache.size(); ii++) {
+            _cachePos[nextCache[ii]] = -1;
+            _scores[nextCache[ii]] = vertexScore( nextCache[ii]);
+        }
+
+        if (nextCache.size() > (size_t)MaxCacheSize)
+            nextCache.resize( MaxCacheSize);
+
+        for (uint32_t ii = 0; ii < (uint32_t)nextCache.size(); ii++) {
+            _cachePos[nextCache[ii]] = (int32_t)ii;
+            _scores[nextCache[ii]] = vertexScore( nextCache[ii]);
+        }
+
+        cache.swap( nextCache);
+
+        //only triangles touching the cache can have changed, so the next one is among them
+        best = -1;
+        float bestScore = -1.0f;
+        for (vector<uint32_t>::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+            const uint32_t *tris = &_triList[_triOffsets[*it]];
+            for (uint32_t ii = 0; ii < _live[*it]; ii++) {
+                const uint32_t *candidate = &_indices[tris[ii]*3];
+                const float score = _scores[candidate[0]] + _scores[candidate[1]] + _scores[candidate[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = (int32_t)tris[ii];
+                }
+            }
+        }
+    }
+}
+
+//
+//  Triangle cluster for the overdraw sort
+////////////////////////////////////////////////////////////
+struct Cluster {
+    uint32_t first;
+    uint32_t count;
+    float sortKey;
+
+    bool operator< ( const Cluster &rhs) const {
+        return sortKey > rhs.sortKey;
+    }
+};
+
+//
+// splits the cache order into clusters that can be moved without costing much cache
+////////////////////////////////////////////////////////////
+void findClusters( const vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize, float threshold, vector<uint32_t> &starts) {
+    const uint32_t triCount = (uint32_t)indices.size() / 3;
+    CacheSim sim( vertexCount, cacheSize);
+
+    //a triangle that misses on all three vertices starts the cache over; cutting there is free
+    vector<uint32_t> hard( 1, 0);
+    for (uint32_t tri = 0; tri < triCount; tri++) {
+        if (sim.accessTriangle( &indices[tri*3]) == 3 && tri > 0)
+            hard.push_back( tri);
+    }
+    hard.push_back( triCount);
+
+    //within each of those, cut again as soon as the cluster so far is within threshold of the whole one
+    starts.clear();
+    for (uint32_t ii = 0; ii + 1 < (uint32_t)hard.size(); ii++) {
+        const uint32_t begin = hard[ii];
+        const uint32_t end = hard[ii + 1];
+
+        sim.flush();
+        uint32_t misses = 0;
+        for (uint32_t tri = begin; tri < end; tri++)
+            misses += sim.accessTriangle( &indices[tri*3]);
+
+        const float limit = threshold * (float)misses / (float)(end - begin);
+
+        starts.push_back( begin);
+        sim.flush();
+
+        uint32_t runMisses = 0;
+        uint32_t runTris = 0;
+        for (uint32_t tri = begin; tri < end; tri++) {
+            runMisses += sim.accessTriangle( &indices[tri*3]);
+            runTris++;
+
+            if (tri + 1 < end && (float)runMisses / (float)runTris <= limit) {
+                starts.push_back( tri + 1);
+                sim.flush();
+                runMisses = 0;
+                runTris = 0;
+            }
+        }
+    }
+}
+
+//
+// cache statistics of a triangle list
+////////////////////////////////////////////////////////////
+NvModelCacheStats measureCache( const vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize) {
+    NvModelCacheStats stats;
+    if (indices.empty())
+        return stats;
+
+    CacheSim sim( vertexCount, cacheSize);
+    vector<bool> referenced( vertexCount, false);
+    uint32_t misses = 0;
+    uint32_t unique = 0;
+
+    for (vector<uint32_t>::const_iterator it = indices.begin(); it != indices.end(); ++it) {
+        if (sim.access( *it))
+            misses++;
+
+        if (!referenced[*it]) {
+            referenced[*it] = true;
+            unique++;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indices.size() / 3);
+    stats.atvr = (float)misses / (float)unique;
+    return stats;
+}
+
+} // namespace
+
+//
+// copies the triangles (or adjacency triangles, with stride 6) in the given order
+////////////////////////////////////////////////////////////
+void NvModel::gatherTriangles( const vector<uint32_t> &indices, const vector<uint32_t> &order, uint32_t stride, vector<uint32_t> &gathered) {
+    gathered.resize( order.size()*stride);
+    for (uint32_t ii = 0; ii < (uint32_t)order.size(); ii++)
+        std::copy( &indices[order[ii]*stride], &indices[order[ii]*stride] + stride, &gathered[ii*stride]);
+}
+
+//
+// reorder the compiled triangles and vertices for the vertex cache and overdraw
+//////////////////////////////////////////////////////////////////////
+void NvModel::optimizeCompiledModel( int32_t cacheSize, float overdrawThreshold, NvModelCacheStats* before, NvModelCacheStats* after) {
+    vector<uint32_t> &triangles = _indices[2];
+    const uint32_t triCount = (uint32_t)triangles.size() / 3;
+    const uint32_t vertexCount = (_vtxSize > 0) ? (uint32_t)(_vertices.size() / _vtxSize) : 0;
+
+    cacheSize = std::max( cacheSize, 3);
+
+    const NvModelCacheStats input = measureCache( triangles, vertexCount, cacheSize);
+    if (before)
+        *before = input;
+
+    if (triCount == 0) {
+        if (after)
+            *after = input;
+        return;
+    }
+
+    //cache order
+    vector<uint32_t> order;
+    {
+        ForsythOptimizer optimizer( &triangles[0], triCount, vertexCount);
+        optimizer.optimize( order);
+    }
+
+    vector<uint32_t> cached;
+    gatherTriangles( triangles, order, 3, cached);
+
+    //overdraw order: clusters facing away from the center of the mesh are drawn first
+    vector<uint32_t> starts;
+    findClusters( cached, vertexCount, cacheSize, overdrawThreshold, starts);
+    starts.push_back( triCount);
+
+    vector<vec3f> centroids( starts.size() - 1);
+    vector<vec3f> normals( starts.size() - 1);
+    vec3f meshCentroid( 0.0f, 0.0f, 0.0f);
+    float meshArea = 0.0f;
+
+    for (uint32_t cc = 0; cc + 1 < (uint32_t)starts.size(); cc++) {
+        vec3f centroid( 0.0f, 0.0f, 0.0f);
+        vec3f normal( 0.0f, 0.0f, 0.0f);
+        float area = 0.0f;
+
+        for (uint32_t tri = starts[cc]; tri < starts[cc + 1]; tri++) {
+            const vec3f p0( &_vertices[cached[tri*3]*_vtxSize + _pOffset]);
+            const vec3f p1( &_vertices[cached[tri*3 + 1]*_vtxSize + _pOffset]);
+            const vec3f p2( &_vertices[cached[tri*3 + 2]*_vtxSize + _pOffset]);
+
+            //twice the area weighted normal
+            const vec3f n = cross( p1 - p0, p2 - p0);
+            const float a = length( n);
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        centroids[cc] = (area > 0.0f) ? centroid / area : vec3f( &_vertices[cached[starts[cc]*3]*_vtxSize + _pOffset]);
+        const float nl = length( normal);
+        normals[cc] = (nl > 0.0f) ? normal / nl : normal;
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    vector<Cluster> clusters( starts.size() - 1);
+    for (uint32_t cc = 0; cc < (uint32_t)clusters.size(); cc++) {
+        clusters[cc].first = starts[cc];
+        clusters[cc].count = starts[cc + 1] - starts[cc];
+        clusters[cc].sortKey = dot( centroids[cc] - meshCentroid, normals[cc]);
+    }
+
+    std::stable_sort( clusters.begin(), clusters.end());
+
+    vector<uint32_t> triOrder;
+    triOrder.reserve( triCount);
+    for (vector<Cluster>::const_iterator it = clusters.begin(); it != clusters.end(); ++it) {
+        for (uint32_t tri = it->first; tri < it->first + it->count; tri++)
+            triOrder.push_back( order[tri]);
+    }
+
+    //the cluster sort may cost at most overdrawThreshold times the better of the input and
+    //cache orders; small meshes can come in better ordered than the optimizer leaves them
+    {
+        vector<uint32_t> sorted;
+        gatherTriangles( triangles, triOrder, 3, sorted);
+
+        const float cacheAcmr = measureCache( cached, vertexCount, cacheSize).acmr;
+        const float bestAcmr = std::min( input.acmr, cacheAcmr);
+
+        if (measureCache( sorted, vertexCount, cacheSize).acmr > overdrawThreshold * bestAcmr) {
+            if (input.acmr <= cacheAcmr) {
+                for (uint32_t ii = 0; ii < triCount; ii++)
+                    triOrder[ii] = ii;
+            }
+            else {
+                triOrder = order;
+            }
+        }
+    }
+
+    //apply the triangle order to the triangles and their adjacency
+    {
+        vector<uint32_t> reordered;
+        gatherTriangles( triangles, triOrder, 3, reordered);
+        triangles.swap( reordered);
+
+        if (_indices[3].size() == (size_t)triCount*6) {
+            gatherTriangles( _indices[3], triOrder, 6, reordered);
+            _indices[3].swap( reordered);
+        }
+
+        //level 0 of the levels of detail is the triangle list itself
+        if (_lodIndices.size() >= triangles.size())
+            std::copy( triangles.begin(), triangles.end(), _lodIndices.begin());
+    }
+
+    //vertex fetch order: number the vertices by first use, unreferenced ones last
+    vector<uint32_t> remap( vertexCount, ~0u);
+    uint32_t next = 0;
+    for (vector<uint32_t>::const_iterator it = triangles.begin(); it != triangles.end(); ++it) {
+        if (remap[*it] == ~0u)
+            remap[*it] = next++;
+    }
+    for (uint32_t ii = 0; ii < NumPrimTypes; ii++) {
+        for (vector<uint32_t>::const_iterator it = _indices[ii].begin(); it != _indices[ii].end(); ++it) {
+            if (remap[*it] == ~0u)
+                remap[*it] = next++;
+        }
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == ~0u)
+            remap[v] = next++;
+    }
+
+    {
+        vector<float> vertices( _vertices.size());
+        for (uint32_t v = 0; v < vertexCount; v++)
+            std::copy( &_vertices[v*_vtxSize], &_vertices[v*_vtxSize] + _vtxSize, &vertices[remap[v]*_vtxSize]);
+        _vertices.swap( vertices);
+    }
+
+    for (uint32_t ii = 0; ii < NumPrimTypes; ii++) {
+        for (vector<uint32_t>::iterator it = _indices[ii].begin(); it != _indices[ii].end(); ++it)
+            *it = remap[*it];
+    }
+
+    //the quantized copy is in the old vertex order, and clusters cover the old triangle order
+    _qVertices.clear();
+    _clusters.clear();
+
+    //the coarser levels of detail generated earlier index the same vertices
+    for (vector<uint32_t>::iterator it = _lodIndices.begin(); it != _lodIndices.end(); ++it)
+        *it = remap[*it];
+
+    if (after)
+        *after = measureCache( triangles, vertexCount, cacheSize);
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelCacheStats NvModel::getCacheStats( int32_t cacheSize) const {
+    const uint32_t vertexCount = (_vtxSize > 0) ? (uint32_t)(_vertices.size() / _vtxSize) : 0;
+    return measureCache( _indices[2], vertexCount, std::max( cacheSize, 3));
+}
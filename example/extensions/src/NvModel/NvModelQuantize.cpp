@@ -0,0 +1,247 @@
+//----------------------------------------------------------------------------------
+// File:        NvModel/NvModelQuantize.cpp
+// SDK Version: v2.11
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvModel/NvModel.h"
+#include "NV/NvMath.h"
+#include "Half/half.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace nv;
+
+using std::vector;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Local functions
+//
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//
+//  Rounds v in [0, 1] to an unsigned normalized integer of the given maximum
+////////////////////////////////////////////////////////////
+inline uint32_t toUnorm( float v, uint32_t maxValue) {
+    v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+    return (uint32_t)(v * maxValue + 0.5f);
+}
+
+//
+//  Rounds v in [-1, 1] to a signed normalized 16-bit integer
+////////////////////////////////////////////////////////////
+inline int16_t toSnorm16( float v) {
+    v = (v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v);
+    return (int16_t)floorf( v * 32767.0f + 0.5f);
+}
+
+//
+//  Maps a direction onto the octahedron and unfolds it into the unit square
+////////////////////////////////////////////////////////////
+void encodeOctahedral( const float *n, int16_t *out) {
+    const float l1 = fabsf( n[0]) + fabsf( n[1]) + fabsf( n[2]);
+    if (l1 == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float x = n[0] / l1;
+    float y = n[1] / l1;
+
+    //the lower hemisphere folds over the diagonals
+    if (n[2] < 0.0f) {
+        const float fx = (1.0f - fabsf( y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+        const float fy = (1.0f - fabsf( x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = toSnorm16( x);
+    out[1] = toSnorm16( y);
+}
+
+//
+//  Places an attribute at the end of the vertex, on a 4-byte boundary
+////////////////////////////////////////////////////////////
+NvModelAttribFormat appendAttrib( int32_t &vertexSize, NvModelAttribType::Enum type, int32_t size, int32_t storedBytes) {
+    NvModelAttribFormat format;
+    format.type = type;
+    format.size = size;
+    format.offset = vertexSize;
+    vertexSize += (storedBytes + 3) & ~3;
+    return format;
+}
+
+} // namespace
+
+//
+// compile the compressed vertex layout from the compiled vertices
+//////////////////////////////////////////////////////////////////////
+void NvModel::compileQuantizedVertices() {
+    const int32_t vertexCount = getCompiledVertexCount();
+
+    _qVertices.clear();
+    _qVtxSize = 0;
+    _qPosition = _qNormal = _qTexCoord = _qTangent = _qColor = NvModelAttribFormat();
+
+    //positions keep 3 components, the rest keep their count
+    _qPosition = appendAttrib( _qVtxSize, NvModelAttribType::UNORM16, 3, 3 * sizeof(uint16_t));
+    if (hasNormals())
+        _qNormal = appendAttrib( _qVtxSize, NvModelAttribType::SNORM16, 2, 2 * sizeof(int16_t));
+    if (hasTexCoords())
+        _qTexCoord = appendAttrib( _qVtxSize, NvModelAttribType::HALF, _tcSize, _tcSize * sizeof(half));
+    if (hasTangents())
+        _qTangent = appendAttrib( _qVtxSize, NvModelAttribType::SNORM16, 2, 2 * sizeof(int16_t));
+    if (hasColors())
+        _qColor = appendAttrib( _qVtxSize, NvModelAttribType::UNORM8, _cSize, 4);
+
+    //the bounding box of the compiled vertices spans the 16-bit range
+    vec3f minVal( 0.0f, 0.0f, 0.0f);
+    vec3f maxVal( 0.0f, 0.0f, 0.0f);
+    for (int32_t v = 0; v < vertexCount; v++) {
+        const vec3f p( &_vertices[v*_vtxSize + _pOffset]);
+        minVal = (v == 0) ? p : min( minVal, p);
+        maxVal = (v == 0) ? p : max( maxVal, p);
+    }
+
+    _qPosBias = minVal;
+    _qPosScale = maxVal - minVal;
+
+    _qVertices.assign( vertexCount * _qVtxSize, 0);
+
+    for (int32_t v = 0; v < vertexCount; v++) {
+        const float *src = &_vertices[v*_vtxSize];
+        uint8_t *dst = &_qVertices[v*_qVtxSize];
+
+        uint16_t position[3];
+        for (int32_t ii = 0; ii < 3; ii++) {
+            //flat axes have a scale of 0, and every position sits at the bias
+            const float extent = _qPosScale[ii];
+            const float t = (extent > 0.0f) ? (src[_pOffset + ii] - _qPosBias[ii]) / extent : 0.0f;
+            position[ii] = (uint16_t)toUnorm( t, 0xffff);
+        }
+        memcpy( dst + _qPosition.offset, position, sizeof(position));
+
+        if (hasNormals()) {
+            int16_t normal[2];
+            encodeOctahedral( src + _nOffset, normal);
+            memcpy( dst + _qNormal.offset, normal, sizeof(normal));
+        }
+
+        if (hasTexCoords()) {
+            half texCoord[3];
+            for (int32_t ii = 0; ii < _tcSize; ii++)
+                texCoord[ii] = half( src[_tcOffset + ii]);
+            memcpy( dst + _qTexCoord.offset, texCoord, _tcSize * sizeof(half));
+        }
+
+        if (hasTangents()) {
+            int16_t tangent[2];
+            encodeOctahedral( src + _sTanOffset, tangent);
+            memcpy( dst + _qTangent.offset, tangent, sizeof(tangent));
+        }
+
+        if (hasColors()) {
+            //3-component colors still get an opaque alpha, for readers that fetch 4
+            uint8_t color[4] = { 0, 0, 0, 0xff };
+            for (int32_t ii = 0; ii < _cSize; ii++)
+                color[ii] = (uint8_t)toUnorm( src[_cOffset + ii], 0xff);
+            memcpy( dst + _qColor.offset, color, sizeof(color));
+        }
+    }
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+const uint8_t* NvModel::getQuantizedVertices() const {
+    return (_qVertices.size() > 0) ? &_qVertices[0] : 0;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+int32_t NvModel::getQuantizedVertexSize() const {
+    return _qVtxSize;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelAttribFormat NvModel::getQuantizedPositionFormat() const {
+    return _qPosition;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelAttribFormat NvModel::getQuantizedNormalFormat() const {
+    return _qNormal;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelAttribFormat NvModel::getQuantizedTexCoordFormat() const {
+    return _qTexCoord;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelAttribFormat NvModel::getQuantizedTangentFormat() const {
+    return _qTangent;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+NvModelAttribFormat NvModel::getQuantizedColorFormat() const {
+    return _qColor;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+vec3f NvModel::getQuantizedPositionScale() const {
+    return _qPosScale;
+}
+
+//
+//
+////////////////////////////////////////////////////////////
+vec3f NvModel::getQuantizedPositionBias() const {
+    return _qPosBias;
+}
@@ -0,0 +1,292 @@
+//----------------------------------------------------------------------------------
+// File:        NvThreading/NvTaskPool.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NV/NvTaskPool.h"
+#include "NV/NvLogs.h"
+#include <stdlib.h>
+#include <vector>
+
+#ifdef WIN32
+// condition variables need Vista or later
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Batch currently being worked on; lives on the stack of parallelFor
+struct NvTaskBatch {
+    NvTaskFunction fn;
+    void* data;
+    int32_t count;
+    int32_t next;
+    int32_t done;
+};
+
+#ifdef WIN32
+
+struct NvTaskPool::Impl {
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE wake;
+    CONDITION_VARIABLE finished;
+    std::vector<HANDLE> threads;
+    NvTaskBatch* batch;
+    bool quit;
+
+    Impl() : batch(NULL), quit(false) {
+        InitializeCriticalSection(&lock);
+        InitializeConditionVariable(&wake);
+        InitializeConditionVariable(&finished);
+    }
+    ~Impl() {
+        DeleteCriticalSection(&lock);
+    }
+
+    void acquire() { EnterCriticalSection(&lock); }
+    void release() { LeaveCriticalSection(&lock); }
+    void waitWake() { SleepConditionVariableCS(&wake, &lock, INFINITE); }
+    void waitFinished() { SleepConditionVariableCS(&finished, &lock, INFINITE); }
+    void signalWake() { WakeAllConditionVariable(&wake); }
+    void signalFinished() { WakeConditionVariable(&finished); }
+
+    void run();
+    static DWORD WINAPI threadMain(LPVOID arg) {
+        ((Impl*)arg)->run();
+        return 0;
+    }
+
+    bool start() {
+        HANDLE thread = CreateThread(NULL, 0, threadMain, this, 0, NULL);
+        if (!thread)
+            return false;
+        threads.push_back(thread);
+        return true;
+    }
+    void join() {
+        for (size_t i = 0; i < threads.size(); i++) {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+        threads.clear();
+    }
+};
+
+int32_t NvTaskPool::getProcessorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (int32_t)info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+struct NvTaskPool::Impl {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t finished;
+    std::vector<pthread_t> threads;
+    NvTaskBatch* batch;
+    bool quit;
+
+    Impl() : batch(NULL), quit(false) {
+        pthread_mutex_init(&lock, NULL);
+        pthread_cond_init(&wake, NULL);
+        pthread_cond_init(&finished, NULL);
+    }
+    ~Impl() {
+        pthread_cond_destroy(&finished);
+        pthread_cond_destroy(&wake);
+        pthread_mutex_destroy(&lock);
+    }
+
+    void acquire() { pthread_mutex_lock(&lock); }
+    void release() { pthread_mutex_unlock(&lock); }
+    void waitWake() { pthread_cond_wait(&wake, &lock); }
+    void waitFinished() { pthread_cond_wait(&finished, &lock); }
+    void signalWake() { pthread_cond_broadcast(&wake); }
+    void signalFinished() { pthread_cond_signal(&finished); }
+
+    void run();
+    static void* threadMain(void* arg) {
+        ((Impl*)arg)->run();
+        return NULL;
+    }
+
+    bool start() {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, threadMain, this) != 0)
+            return false;
+        threads.push_back(thread);
+        return true;
+    }
+    void join() {
+        for (size_t i = 0; i < threads.size(); i++)
+            pthread_join(threads[i], NULL);
+        threads.clear();
+    }
+};
+
+int32_t NvTaskPool::getProcessorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int32_t)count : 1;
+}
+
+#endif
+
+// Worker loop: picks up task indices of the current batch until told to quit.
+// Called with the lock released; the lock is held whenever batch state is touched.
+void NvTaskPool::Impl::run() {
+    acquire();
+    for (;;) {
+        while (!quit && (!batch || batch->next >= batch->count))
+            waitWake();
+        if (quit)
+            break;
+
+        NvTaskBatch* b = batch;
+        int32_t index = b->next++;
+        release();
+
+        b->fn(b->data, index);
+
+        acquire();
+        if (++b->done == b->count)
+            signalFinished();
+    }
+    release();
+}
+
+NvTaskPool::NvTaskPool(int32_t threadCount) :
+    m_impl(new Impl),
+    m_threadCount(0)
+{
+    if (threadCount <= 0)
+        threadCount = getProcessorCount() - 1;
+
+    for (int32_t i = 0; i < threadCount; i++) {
+        if (!m_impl->start()) {
+            LOGE("NvTaskPool: could only start %d of %d threads", i, threadCount);
+            break;
+        }
+        m_threadCount++;
+    }
+}
+
+NvTaskPool::~NvTaskPool() {
+    m_impl->acquire();
+    m_impl->quit = true;
+    m_impl->signalWake();
+    m_impl->release();
+    m_impl->join();
+    delete m_impl;
+}
+
+void NvTaskPool::parallelFor(int32_t count, NvTaskFunction fn, void* data) {
+    if (count <= 0)
+        return;
+
+    NvTaskBatch batch;
+    batch.fn = fn;
+    batch.data = data;
+    batch.count = count;
+    batch.next = 0;
+    batch.done = 0;
+
+    // no workers, a single task, or a batch already running: run inline
+    bool inlineBatch = (m_threadCount == 0 || count == 1);
+    if (!inlineBatch) {
+        m_impl->acquire();
+        inlineBatch = (m_impl->batch != NULL);
+        if (inlineBatch)
+            m_impl->release();
+    }
+
+    if (inlineBatch) {
+        for (int32_t i = 0; i < count; i++)
+            fn(data, i);
+        return;
+    }
+
+    m_impl->batch = &batch;
+    m_impl->signalWake();
+
+    // the calling thread works on the batch too
+    while (batch.next < count) {
+        int32_t index = batch.next++;
+        m_impl->release();
+        fn(data, index);
+        m_impl->acquire();
+        batch.done++;
+    }
+
+    while (batch.done < count)
+        m_impl->waitFinished();
+
+    m_impl->batch = NULL;
+    m_impl->release();
+}
+
+// The shared pool is created under a statically initialized lock rather than
+// as a function-local static, whose construction is not thread-safe on older
+// compilers (VS2010/2012).
+static NvTaskPool* s_sharedPool = NULL;
+
+#ifdef WIN32
+static SRWLOCK s_sharedLock = SRWLOCK_INIT;
+static void lockShared() { AcquireSRWLockExclusive(&s_sharedLock); }
+static void unlockShared() { ReleaseSRWLockExclusive(&s_sharedLock); }
+#else
+static pthread_mutex_t s_sharedLock = PTHREAD_MUTEX_INITIALIZER;
+static void lockShared() { pthread_mutex_lock(&s_sharedLock); }
+static void unlockShared() { pthread_mutex_unlock(&s_sharedLock); }
+#endif
+
+static void destroyShared() {
+    delete s_sharedPool;
+    s_sharedPool = NULL;
+}
+
+NvTaskPool& NvTaskPool::getShared() {
+    lockShared();
+    if (!s_sharedPool) {
+        s_sharedPool = new NvTaskPool;
+        atexit(destroyShared);
+    }
+    NvTaskPool* pool = s_sharedPool;
+    unlockShared();
+    return *pool;
+}
@@ -0,0 +1,209 @@
+//----------------------------------------------------------------------------------
+// File:        NvThreading/NvThread.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NV/NvThread.h"
+
+#ifdef WIN32
+// condition variables need Vista or later
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+struct NvThreadStart {
+    NvThreadFunction fn;
+    void* data;
+};
+
+#ifdef WIN32
+
+struct NvThread::Impl {
+    HANDLE thread;
+    NvThreadStart startInfo;
+
+    static DWORD WINAPI threadMain(LPVOID arg) {
+        NvThreadStart* s = (NvThreadStart*)arg;
+        s->fn(s->data);
+        return 0;
+    }
+
+    bool start() {
+        thread = CreateThread(NULL, 0, threadMain, &startInfo, 0, NULL);
+        return thread != NULL;
+    }
+    void join() {
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+};
+
+void NvThread::sleep(float secs) {
+    if (secs > 0.0f)
+        Sleep((DWORD)(secs * 1000.0f));
+}
+
+void NvThread::yield() {
+    SwitchToThread();
+}
+
+struct NvSignal::Impl {
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cond;
+    bool flag;
+
+    Impl() : flag(false) {
+        InitializeCriticalSection(&lock);
+        InitializeConditionVariable(&cond);
+    }
+    ~Impl() {
+        DeleteCriticalSection(&lock);
+    }
+
+    void acquire() { EnterCriticalSection(&lock); }
+    void release() { LeaveCriticalSection(&lock); }
+    void waitCond() { SleepConditionVariableCS(&cond, &lock, INFINITE); }
+    void signalCond() { WakeConditionVariable(&cond); }
+};
+
+#else
+
+struct NvThread::Impl {
+    pthread_t thread;
+    NvThreadStart startInfo;
+
+    static void* threadMain(void* arg) {
+        NvThreadStart* s = (NvThreadStart*)arg;
+        s->fn(s->data);
+        return NULL;
+    }
+
+    bool start() {
+        return pthread_create(&thread, NULL, threadMain, &startInfo) == 0;
+    }
+    void join() {
+        pthread_join(thread, NULL);
+    }
+};
+
+void NvThread::sleep(float secs) {
+    if (secs <= 0.0f)
+        return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)secs;
+    ts.tv_nsec = (long)((secs - (float)ts.tv_sec) * 1.0e9f);
+    nanosleep(&ts, NULL);
+}
+
+void NvThread::yield() {
+    sched_yield();
+}
+
+struct NvSignal::Impl {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool flag;
+
+    Impl() : flag(false) {
+        pthread_mutex_init(&lock, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~Impl() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&lock);
+    }
+
+    void acquire() { pthread_mutex_lock(&lock); }
+    void release() { pthread_mutex_unlock(&lock); }
+    void waitCond() { pthread_cond_wait(&cond, &lock); }
+    void signalCond() { pthread_cond_signal(&cond); }
+};
+
+#endif
+
+NvThread::NvThread() :
+    m_impl(new Impl),
+    m_started(false)
+{
+}
+
+NvThread::~NvThread() {
+    join();
+    delete m_impl;
+}
+
+bool NvThread::start(NvThreadFunction fn, void* data) {
+    if (m_started)
+        return false;
+    m_impl->startInfo.fn = fn;
+    m_impl->startInfo.data = data;
+    m_started = m_impl->start();
+    return m_started;
+}
+
+void NvThread::join() {
+    if (!m_started)
+        return;
+    m_impl->join();
+    m_started = false;
+}
+
+NvSignal::NvSignal() :
+    m_impl(new Impl)
+{
+}
+
+NvSignal::~NvSignal() {
+    delete m_impl;
+}
+
+void NvSignal::set() {
+    m_impl->acquire();
+    m_impl->flag = true;
+    m_impl->signalCond();
+    m_impl->release();
+}
+
+void NvSignal::wait() {
+    m_impl->acquire();
+    while (!m_impl->flag)
+        m_impl->waitCond();
+    m_impl->flag = false;
+    m_impl->release();
+}
@@ -34,6 +34,7 @@
 
 #include "NvUI/NvBitFont.h"
 #include "NvAFont.h" // PRIVATE header for afont structs and parser.
+#include "NvFTFont.h" // PRIVATE header for dynamic fonts.
 
 #include "NvAssetLoader/NvAssetLoader.h"
 #include <NvGLUtils/NvGLSLProgram.h>
@@ -60,6 +61,7 @@
 #include <memory.h>
 #include <string.h>
 #include <string>
+#include <vector>
 
 struct BFVert
 {
@@ -115,6 +117,7 @@ public:
 
     AFont*      m_afont;
     AFont*      m_afontBold; // if we support bold.
+    NvFTFont*   m_ftFont; // dynamic font, in place of the afonts.
 
     float       m_canonPtSize;
 
@@ -206,6 +209,28 @@ static int32_t maxIndexChars = 0;
 static int16_t *masterTextIndexList = NULL;
 static GLuint masterTextIndexVBO = 0;
 
+// the shared vertex buffer holding the glyph quads of ALL bftexts.  each
+// bftext owns a block of quads in it.  we keep a cpu-side copy, so that a
+// rebuilt string only uploads the quads that actually changed, and so that
+// the changes of all strings rebuilt since the last draw go up in one call.
+struct NvBFTextBlock
+{
+    int32_t first;
+    int32_t count;
+};
+static std::vector<NvBFTextBlock> s_textFreeBlocks; // sorted by first quad.
+static BFVert *s_textVerts = NULL; // cpu-side copy of the shared buffer.
+static int32_t s_textQuadsMax = 0; // allocated size of s_textVerts, in quads.
+static int32_t s_textQuadsUsed = 0; // high-water mark of the blocks handed out.
+static int32_t s_textDirtyFirst = 0; // range of quads not yet uploaded.
+static int32_t s_textDirtyLast = -1;
+static GLuint s_textVBO = 0;
+static int32_t s_textVBOQuads = 0; // size of the gl buffer, in quads.
+static BFVert *s_buildVerts = NULL; // scratch output of RebuildCache.
+static int32_t s_buildQuadsMax = 0;
+static uint8_t *s_keyBytes = NULL; // scratch copy of the inputs RebuildCache keys on.
+static int32_t s_keyBytesMax = 0;
+
 static float s_pixelToClipMatrix[4][4];
 static float s_pixelScaleFactorX = 2.0f / 640.0f;
 static float s_pixelScaleFactorY = 2.0f / 480.0f;
@@ -277,6 +302,7 @@ NvBitFont::NvBitFont()
 , m_tex(0)
 , m_afont(NULL)
 , m_afontBold(NULL)
+, m_ftFont(NULL)
 , m_canonPtSize(10)
 , m_next(NULL)
 
@@ -493,6 +519,29 @@ int32_t NvBFInitialize(uint8_t count, const char* filename[][2])
         image = NULL;
         bitfont = NULL;
 
+#ifdef NV_USE_FREETYPE
+        if (0==strcmp(filename[j][0]+flen-3, "ttf")
+        ||  0==strcmp(filename[j][0]+flen-3, "otf"))
+        {
+            NvFTFont *ftfont = NvFTFont::Create(filename[j][0]);
+            if (NULL==ftfont)
+            {
+                ERROR_LOG(">> FAILED TO LOAD dynamic font file: %s...\n", filename[j][0]);
+                continue;
+            }
+            LOGI("!> NvBF loaded dynamic font: [%s]", filename[j][0]);
+
+            bitfont = new NvBitFont();
+            bitfont->m_ftFont = ftfont;
+            bitfont->m_id = bitFontID++;
+            memcpy(bitfont->m_filename, filename[j][0], flen+1); // copy the null!
+            bitfont->m_alpha = true;
+            bitfont->m_tex = ftfont->GetTexture(); // owned by the ftfont.
+            fontsLoaded++;
+            continue;
+        }
+#endif
+
         afont = LoadFontInfo(filename[j][0]);
         if (NULL==afont)
         {
@@ -621,6 +670,11 @@ void NvBFCleanup()
             currFont = bitfont;
             bitfont = bitfont->m_next;
             // delete font texture
+#ifdef NV_USE_FREETYPE
+            if (currFont->m_ftFont)
+                delete currFont->m_ftFont; // takes the atlas texture with it.
+            else
+#endif
             glDeleteTextures( 1, &(currFont->m_tex) );
             // delete new AFont objects
             delete currFont->m_afont;
@@ -639,6 +693,14 @@ void NvBFCleanup()
         free(masterTextIndexList);
         masterTextIndexList = NULL;
         maxIndexChars = 0;
+    // NvFree the shared text vbo.  live bftexts keep their blocks, and
+    // the whole buffer is re-uploaded if rendering starts up again.
+        if (s_textVBO)
+        {
+            glDeleteBuffers(1, &s_textVBO);
+            s_textVBO = 0;
+        }
+        s_textVBOQuads = 0;
     // !!!!TBD
 
         // for safety, we're going to clear _everything_ here to init's
@@ -697,6 +759,190 @@ void NvBFSetScreenRot(float degrees)
 
 typedef uint32_t NvUTF32Char;
 
+//========================================================================
+// hand out a block of quads in the shared text buffer.  returns the
+// first quad of the block, or -1 if we couldn't grow the buffer.
+//========================================================================
+static int32_t AllocTextBlock(int32_t quads)
+{
+    // first fit from the blocks freed by other bftexts...
+    for (size_t i=0; i<s_textFreeBlocks.size(); i++)
+    {
+        NvBFTextBlock &blk = s_textFreeBlocks[i];
+        if (blk.count < quads)
+            continue;
+        const int32_t first = blk.first;
+        blk.first += quads;
+        blk.count -= quads;
+        if (blk.count==0)
+            s_textFreeBlocks.erase(s_textFreeBlocks.begin()+i);
+        return first;
+    }
+
+    // ...else off the end, growing the buffer geometrically so we don't
+    // reallocate every time a string gets a little longer.
+    if (s_textQuadsUsed+quads > s_textQuadsMax)
+    {
+        int32_t newMax = s_textQuadsMax ? s_textQuadsMax : 256;
+        while (newMax < s_textQuadsUsed+quads)
+            newMax *= 2;
+        BFVert *newVerts = (BFVert*)realloc(s_textVerts, newMax*sizeof(BFVert)*VERT_PER_QUAD);
+        if (newVerts==NULL)
+            return -1;
+        memset(newVerts + s_textQuadsMax*VERT_PER_QUAD, 0, (newMax-s_textQuadsMax)*sizeof(BFVert)*VERT_PER_QUAD);
+        s_textVerts = newVerts;
+        s_textQuadsMax = newMax; // gl buffer is respecified at next flush.
+    }
+    const int32_t first = s_textQuadsUsed;
+    s_textQuadsUsed += quads;
+    return first;
+}
+
+
+//========================================================================
+// give a block back, merging it with any free neighbors.
+//========================================================================
+static void FreeTextBlock(int32_t first, int32_t quads)
+{
+    NvBFTextBlock blk = { first, quads };
+    size_t i = 0;
+    while (i<s_textFreeBlocks.size() && s_textFreeBlocks[i].first < first)
+        i++;
+    if (i>0 && s_textFreeBlocks[i-1].first+s_textFreeBlocks[i-1].count == blk.first)
+    {
+        i--;
+        blk.first = s_textFreeBlocks[i].first;
+        blk.count += s_textFreeBlocks[i].count;
+        s_textFreeBlocks.erase(s_textFreeBlocks.begin()+i);
+    }
+    if (i<s_textFreeBlocks.size() && blk.first+blk.count == s_textFreeBlocks[i].first)
+    {
+        blk.count += s_textFreeBlocks[i].count;
+        s_textFreeBlocks.erase(s_textFreeBlocks.begin()+i);
+    }
+
+    if (blk.first+blk.count == s_textQuadsUsed) // trailing block, just pull the end back.
+        s_textQuadsUsed = blk.first;
+    else
+        s_textFreeBlocks.insert(s_textFreeBlocks.begin()+i, blk);
+
+    if (s_textQuadsUsed==0) // last bftext is gone, release everything.
+    {
+        free(s_textVerts);
+        s_textVerts = NULL;
+        s_textQuadsMax = 0;
+        free(s_buildVerts);
+        s_buildVerts = NULL;
+        s_buildQuadsMax = 0;
+        free(s_keyBytes);
+        s_keyBytes = NULL;
+        s_keyBytesMax = 0;
+        s_textDirtyFirst = 0;
+        s_textDirtyLast = -1;
+        if (s_textVBO)
+            glDeleteBuffers(1, &s_textVBO);
+        s_textVBO = 0;
+        s_textVBOQuads = 0;
+    }
+}
+
+
+//========================================================================
+// copy freshly built quads into a block, keeping only the span that
+// differs from what is already there.  strings where just a few digits
+// change each frame thus only dirty those few quads.
+//========================================================================
+static void UpdateTextBlock(int32_t first, const BFVert *verts, int32_t quads)
+{
+    const size_t quadBytes = sizeof(BFVert)*VERT_PER_QUAD;
+    BFVert *dst = s_textVerts + first*VERT_PER_QUAD;
+    int32_t lo = 0, hi = quads-1;
+    while (lo<=hi && 0==memcmp(dst+lo*VERT_PER_QUAD, verts+lo*VERT_PER_QUAD, quadBytes))
+        lo++;
+    while (hi>=lo && 0==memcmp(dst+hi*VERT_PER_QUAD, verts+hi*VERT_PER_QUAD, quadBytes))
+        hi--;
+    if (lo>hi)
+        return; // identical, nothing to upload.
+
+    memcpy(dst+lo*VERT_PER_QUAD, verts+lo*VERT_PER_QUAD, (hi-lo+1)*quadBytes);
+    lo += first;
+    hi += first;
+    if (s_textDirtyFirst > s_textDirtyLast) // nothing pending yet.
+    {
+        s_textDirtyFirst = lo;
+        s_textDirtyLast = hi;
+    }
+    else
+    {
+        if (lo < s_textDirtyFirst)
+            s_textDirtyFirst = lo;
+        if (hi > s_textDirtyLast)
+            s_textDirtyLast = hi;
+    }
+}
+
+
+//========================================================================
+// upload whatever changed since the last flush, in a single call.
+// expects the shared text vbo to be bound.
+//========================================================================
+static void FlushTextBlocks()
+{
+    const size_t quadBytes = sizeof(BFVert)*VERT_PER_QUAD;
+    if (s_textVBOQuads < s_textQuadsMax) // buffer grew (or is new), respecify it whole.
+    {
+        glBufferData(GL_ARRAY_BUFFER, s_textQuadsMax*quadBytes, s_textVerts, GL_DYNAMIC_DRAW);
+        s_textVBOQuads = s_textQuadsMax;
+    }
+    else if (s_textDirtyFirst <= s_textDirtyLast)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, s_textDirtyFirst*quadBytes,
+                        (s_textDirtyLast-s_textDirtyFirst+1)*quadBytes,
+                        s_textVerts + s_textDirtyFirst*VERT_PER_QUAD);
+    }
+    s_textDirtyFirst = 0;
+    s_textDirtyLast = -1;
+}
+
+
+//========================================================================
+// FNV-1a, used to key the glyph run a bftext last built.
+//========================================================================
+static uint32_t HashTextRun(uint32_t hash, const void *data, size_t bytes)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i=0; i<bytes; i++)
+    {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+//========================================================================
+// appends to the key scratch.  the inputs are kept end to end so that a
+// matching hash can be confirmed byte for byte.
+//========================================================================
+static bool AppendTextRunKey(int32_t &used, const void *data, size_t bytes)
+{
+    if (used + (int32_t)bytes > s_keyBytesMax)
+    {
+        int32_t newMax = s_keyBytesMax ? s_keyBytesMax : 256;
+        while (newMax < used + (int32_t)bytes)
+            newMax *= 2;
+        uint8_t *newBytes = (uint8_t*)realloc(s_keyBytes, newMax);
+        if (newBytes==NULL)
+            return false;
+        s_keyBytes = newBytes;
+        s_keyBytesMax = newMax;
+    }
+    memcpy(s_keyBytes+used, data, bytes);
+    used += (int32_t)bytes;
+    return true;
+}
+
+
 //========================================================================
 // !!!!TBD if we want to handle GenBuffers failure, we should have a
 // separate Init method.
@@ -708,8 +954,15 @@ NvBFText::NvBFText()
 , m_stringCharsOut(0)
 , m_drawnChars(-1) // no clamping.
 
-, m_data(NULL)
-, m_vbo(0)
+, m_quadFirst(-1)
+, m_quadMax(0)
+, m_cacheKey(0)
+, m_cacheKeyBytes(0)
+, m_cacheKeyMax(0)
+, m_cacheKeyData(NULL)
+, m_atlasShelves(NULL)
+, m_atlasShelfCount(0)
+, m_atlasShelfMax(0)
     
 , m_numLines(0)
 , m_calcLinesMax(0)
@@ -767,17 +1020,24 @@ NvBFText::~NvBFText()
         free(m_calcLineWidth);
     m_calcLineWidth = NULL;
 
-    if (m_vbo)
-        glDeleteBuffers(1, &(m_vbo));
-    m_vbo = 0;
+    if (m_quadFirst>=0)
+        FreeTextBlock(m_quadFirst, m_quadMax);
+    m_quadFirst = -1;
+    m_quadMax = 0;
 
     if (m_string)
         free(m_string);
     m_string = NULL;
 
-    if (m_data)
-        free(m_data);
-    m_data = NULL;
+    if (m_cacheKeyData)
+        free(m_cacheKeyData);
+    m_cacheKeyData = NULL;
+
+    if (m_atlasShelves)
+        free(m_atlasShelves);
+    m_atlasShelves = NULL;
+    m_atlasShelfCount = 0;
+    m_atlasShelfMax = 0;
 }
 
 
@@ -982,15 +1242,16 @@ void NvBFText::SetString(const char *str)
     if (charsToAlloc > m_stringMax-1) // need to account for null termination and for doubled shadow text
     {
         if (m_stringMax) // allocated, NvFree structs.
-        {
             free(m_string);
-            free(m_data);
-        }
+        if (m_quadFirst>=0)
+            FreeTextBlock(m_quadFirst, m_quadMax);
         // reset max to base chars padded to 16 boundary, PLUS another 16 (8+8) for minor growth.
         m_stringMax = charsToAlloc + 16-((charsToAlloc)%16) + 16;
         m_string = (char*)malloc(m_stringMax*sizeof(char)); // !!!!TBD should use TCHAR size here??
         memset(m_string, 0, m_stringMax*sizeof(char));
-        m_data = (BFVert*)malloc(m_stringMax*sizeof(BFVert)*VERT_PER_QUAD);
+        m_quadMax = m_stringMax;
+        m_quadFirst = AllocTextBlock(m_quadMax);
+        m_cacheKey = 0; // new block, nothing built in it yet.
     }
 
     memcpy(m_string, str, m_stringChars+1); // include the null.
@@ -1046,14 +1307,14 @@ static int32_t UpdateMasterIndexBuffer(int32_t stringMax, bool internalCall)
 
 //========================================================================
 //========================================================================
-void NvBFText::AdjustGlyphsForAlignment()
+void NvBFText::AdjustGlyphsForAlignment(BFVert *verts)
 {
     if (m_hMode==NvBftAlign::LEFT)
         return; // nothing to do.
 
     DEBUG_LOG("Adjusting glyphs for alignment...");
     const bool center = (m_hMode==NvBftAlign::CENTER);
-    BFVert *vp = m_data;
+    BFVert *vp = verts;
     // loop over the lines in this bftext...
     for (int32_t i=0; i<m_numLines; i++)
     {
@@ -1202,6 +1463,28 @@ void NvBFText::TrackOutputLines(float lineWidth)
     m_calcLineWidth[lineNum] = lineWidth;
 }
 
+//========================================================================
+// keeps the inputs of the run just built, from the key scratch.
+//========================================================================
+void NvBFText::StoreCacheKey(uint32_t key, int32_t keyBytes)
+{
+    if (keyBytes > m_cacheKeyMax)
+    {
+        uint8_t *newData = (uint8_t*)realloc(m_cacheKeyData, keyBytes);
+        if (newData==NULL)
+        {
+            m_cacheKey = 0; // can't confirm a hit, so never claim one.
+            return;
+        }
+        m_cacheKeyData = newData;
+        m_cacheKeyMax = keyBytes;
+    }
+    memcpy(m_cacheKeyData, s_keyBytes, keyBytes);
+    m_cacheKeyBytes = keyBytes;
+    m_cacheKey = key;
+}
+
+
 //========================================================================
 // this function rebuilds the VBO/rendercache based on a simplistic
 // ENGLISH char-walk of the string.
@@ -1216,7 +1499,6 @@ void NvBFText::RebuildCache(bool internalCall)
     float left, t, b;
     int32_t n;
     BFVert *vp, *lastvp;
-    GLuint vbmode = GL_STATIC_DRAW /*GL_DYNAMIC_DRAW*/;
     const NvBitFont *bitfont = m_font;
     NvPackedColor color;
     int32_t linesign = 1;
@@ -1234,11 +1516,71 @@ void NvBFText::RebuildCache(bool internalCall)
         return;
     if (!bitfont)
         return;
+    if (m_quadFirst<0) // no block in the shared text buffer.
+        return;
 
     // first, check that our master index buffer is big enough.
     if (UpdateMasterIndexBuffer(m_stringMax, internalCall))
         return; // TODO FIXME error output/handling.
 
+    // key the glyph run on everything that goes into the vertices.  if it
+    // matches what we last built, our block (and line data) is still good.
+    // the hash only screens; a hit is confirmed against the stored inputs.
+    int32_t keyBytes = 0;
+    if (!AppendTextRunKey(keyBytes, &m_fontNum, sizeof(m_fontNum))
+        || !AppendTextRunKey(keyBytes, &m_fontSize, sizeof(m_fontSize))
+        || !AppendTextRunKey(keyBytes, &m_stringChars, sizeof(m_stringChars))
+        || !AppendTextRunKey(keyBytes, m_string, m_stringChars)
+        || !AppendTextRunKey(keyBytes, &m_charColor, sizeof(m_charColor))
+        || !AppendTextRunKey(keyBytes, &m_shadowDir, sizeof(m_shadowDir))
+        || !AppendTextRunKey(keyBytes, &m_shadowColor, sizeof(m_shadowColor))
+        || !AppendTextRunKey(keyBytes, &m_outline, sizeof(m_outline))
+        || !AppendTextRunKey(keyBytes, &m_hasBox, sizeof(m_hasBox))
+        || !AppendTextRunKey(keyBytes, &m_boxWidth, sizeof(m_boxWidth))
+        || !AppendTextRunKey(keyBytes, &m_boxHeight, sizeof(m_boxHeight))
+        || !AppendTextRunKey(keyBytes, &m_boxLines, sizeof(m_boxLines))
+        || !AppendTextRunKey(keyBytes, &m_truncChar, sizeof(m_truncChar))
+        || !AppendTextRunKey(keyBytes, &m_hMode, sizeof(m_hMode)))
+        return; // TODO FIXME error output/handling.
+    uint32_t key = HashTextRun(2166136261u, s_keyBytes, keyBytes);
+    if (key==0)
+        key = 1; // zero means nothing built.
+    if (key==m_cacheKey && keyBytes==m_cacheKeyBytes
+        && 0==memcmp(m_cacheKeyData, s_keyBytes, keyBytes))
+    {
+        float maxWidth = 0;
+        for (int32_t i=0; i<m_numLines; i++)
+            if (maxWidth < m_calcLineWidth[i])
+                maxWidth = m_calcLineWidth[i];
+        m_pixelsWide = maxWidth;
+        m_pixelsHigh = m_fontSize * m_numLines;
+        m_cached = 1;
+        m_posCached = 0;
+        return;
+    }
+
+    // glyphs are built into scratch space, then merged into our block.
+    if (s_buildQuadsMax < m_stringMax)
+    {
+        int32_t newMax = s_buildQuadsMax ? s_buildQuadsMax : 64;
+        while (newMax < m_stringMax)
+            newMax *= 2;
+        BFVert *newVerts = (BFVert*)realloc(s_buildVerts, newMax*sizeof(BFVert)*VERT_PER_QUAD);
+        if (newVerts==NULL)
+            return;
+        s_buildVerts = newVerts;
+        s_buildQuadsMax = newMax;
+    }
+
+#ifdef NV_USE_FREETYPE
+    if (bitfont->m_ftFont)
+    {
+        RebuildDynamicGlyphs();
+        StoreCacheKey(key, keyBytes);
+        return;
+    }
+#endif
+
     // start with normal style
     currFont = bitfont->m_afont;
 
@@ -1264,7 +1606,7 @@ void NvBFText::RebuildCache(bool internalCall)
     float maxWidth = 0;
     t = currFont->m_charCommon.m_baseline * hsizepertex;
     b = t + (linesign * vsize);
-    vp = m_data;
+    vp = s_buildVerts;
     color = m_charColor; // default to set color;
     m_stringCharsOut = 0;
     
@@ -1457,19 +1799,13 @@ void NvBFText::RebuildCache(bool internalCall)
             maxWidth = m_calcLineWidth[i];
 
     // if alignment is not left, we shift each line based on linewidth.
-    AdjustGlyphsForAlignment();
+    AdjustGlyphsForAlignment(s_buildVerts);
     
     //DEBUG_LOG(">> output glyph count = %d, stringMax = %d.", m_stringCharsOut, m_stringMax);
-    
-    if (!internalCall)
-    {
-        if (!m_vbo)
-            glGenBuffers(1, &(m_vbo)); // !!!!TBD TODO error handling.
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    }
-    glBufferData(GL_ARRAY_BUFFER, m_stringCharsOut*sizeof(BFVert)*VERT_PER_QUAD, m_data, vbmode);
-    if (!internalCall)
-        glBindBuffer(GL_ARRAY_BUFFER, 0); // !!!!TBD resetting here, if we're INSIDE the render call, is wasteful... !!!!TBD
+
+    // merge into our block; the upload is deferred to the next Render.
+    UpdateTextBlock(m_quadFirst, s_buildVerts, m_stringCharsOut);
+    StoreCacheKey(key, keyBytes);
 
     m_pixelsWide = maxWidth; // cache the total width in output pixels, for justification and such.
     m_pixelsHigh = vsize * m_numLines;
@@ -1478,6 +1814,210 @@ void NvBFText::RebuildCache(bool internalCall)
 }
 
 
+#ifdef NV_USE_FREETYPE
+//========================================================================
+// a shaped glyph, tagged with the style in effect where it came from.
+//========================================================================
+struct NvBFLaidGlyph
+{
+    uint32_t index; // font glyph index.
+    float advance;
+    float xoff, yoff;
+    NvPackedColor color;
+    bool bold;
+    bool space; // candidate for word wrap.
+    bool newline; // forced line break, nothing to draw.
+};
+static std::vector<NvBFLaidGlyph> s_laidGlyphs;
+
+
+static inline void AddDynamicGlyph(BFVert **vp, const NvFTGlyph &glyph,
+                                   float x, float y, bool outline,
+                                   NvPackedColor color)
+{
+    float s0 = glyph.m_s0, t0 = glyph.m_t0, s1 = glyph.m_s1, t1 = glyph.m_t1;
+    float w = glyph.m_width, h = glyph.m_height;
+    if (outline)
+    { // expand into the clear border, same as the bitmap path does.
+        const float texel = glyph.m_width>0 ? (s1-s0)/glyph.m_width : 0;
+        s0 -= texel; t0 -= texel; s1 += texel; t1 += texel;
+        x -= 1; y -= 1; w += 2; h += 2;
+    }
+    AddGlyphVertex(vp, x, y, s0, t0, color);
+    AddGlyphVertex(vp, x, y + h, s0, t1, color);
+    AddGlyphVertex(vp, x + w, y + h, s1, t1, color);
+    AddGlyphVertex(vp, x + w, y, s1, t0, color);
+}
+
+
+//========================================================================
+// remembers which atlas shelves (at which generation) our glyphs came
+// from, so only evicting one of those makes us rebuild.
+//========================================================================
+void NvBFText::NoteAtlasShelf(int32_t shelf, uint32_t generation)
+{
+    for (int32_t i=0; i<m_atlasShelfCount; i++)
+        if (m_atlasShelves[2*i]==(uint32_t)shelf)
+            return; // a shelf can't be evicted while we pull glyphs this frame.
+
+    if (m_atlasShelfCount==m_atlasShelfMax)
+    {
+        int32_t newMax = m_atlasShelfMax ? 2*m_atlasShelfMax : 16;
+        uint32_t *newShelves = (uint32_t*)realloc(m_atlasShelves, sizeof(uint32_t) * 2 * newMax);
+        if (newShelves==NULL)
+            return; // TODO FIXME error output/handling.
+        m_atlasShelves = newShelves;
+        m_atlasShelfMax = newMax;
+    }
+    m_atlasShelves[2*m_atlasShelfCount] = (uint32_t)shelf;
+    m_atlasShelves[2*m_atlasShelfCount+1] = generation;
+    m_atlasShelfCount++;
+}
+
+
+//========================================================================
+// the dynamic font counterpart of the char-walk in RebuildCache.
+// embedded color/style codes and line breaks split the string into runs,
+// which are shaped by HarfBuzz (so utf8 and complex scripts are handled),
+// then laid out with word wrap, pulling glyphs from the font's atlas.
+//========================================================================
+void NvBFText::RebuildDynamicGlyphs()
+{
+    NvFTFont *ftfont = m_font->m_ftFont;
+    const float vsize = m_fontSize;
+    const uint32_t pixelSize = ftfont->PixelSizeForLineHeight(vsize);
+    const float ascender = ftfont->GetAscender(pixelSize);
+
+    // split & shape.
+    s_laidGlyphs.clear();
+    NvPackedColor color = m_charColor;
+    bool bold = false;
+    int32_t runStart = 0;
+    for (int32_t n=0; n<=m_stringChars; n++)
+    {
+        const uint32_t c = (uint8_t)m_string[n]; // the null at the end flushes the last run.
+        if (c>=0x20 || c=='\t')
+            continue;
+
+        if (n > runStart)
+        {
+            const NvFTRun *run = ftfont->Shape(m_string+runStart, n-runStart, pixelSize);
+            for (size_t g=0; g<run->m_glyphs.size(); g++)
+            {
+                const NvFTShapedGlyph &sg = run->m_glyphs[g];
+                NvBFLaidGlyph lg;
+                lg.index = sg.m_index;
+                lg.advance = sg.m_xAdvance;
+                lg.xoff = sg.m_xOffset;
+                lg.yoff = sg.m_yOffset;
+                lg.color = color;
+                lg.bold = bold;
+                lg.space = (m_string[runStart+sg.m_cluster]==' ');
+                lg.newline = false;
+                s_laidGlyphs.push_back(lg);
+            }
+        }
+        runStart = n+1;
+
+        if (c=='\n' || c=='\r')
+        {
+            NvBFLaidGlyph lg;
+            memset(&lg, 0, sizeof(lg));
+            lg.newline = true;
+            s_laidGlyphs.push_back(lg);
+        }
+        else if (c && c < 0x10) // color table index, 1-based.
+        {
+            if (NvBF_COLORCODE_MAX == c-1)
+                color = m_charColor; // default to set color;
+            else if (c-1 < NvBF_COLORCODE_MAX)
+                color = s_charColorTable[c-1];
+        }
+        else if (c >= NvBftStyle::NORMAL && c < NvBftStyle::MAX)
+            bold = (c > NvBftStyle::NORMAL);
+    }
+
+    // lay out.
+    m_atlasShelfCount = 0;
+    const float soff = ((float)m_shadowDir) * s_bfShadowMultiplier;
+    BFVert *vp = s_buildVerts;
+    BFVert *lastvp = vp;
+    float left = 0, top = 0;
+    int32_t lastspace = -1; // last space on the current line, to wrap at.
+    float lastspaceleft = 0;
+    int32_t lastspaceout = 0;
+    m_stringCharsOut = 0;
+    m_numLines = 1;
+    for (int32_t i=0; i<(int32_t)s_laidGlyphs.size(); i++)
+    {
+        const NvBFLaidGlyph &lg = s_laidGlyphs[i];
+        bool breakline = lg.newline;
+        if (!breakline && !lg.space && m_hasBox && m_doWrap
+        &&  (left + lg.advance > m_boxWidth) && lastspace>=0)
+        { // roll back to the last space, and continue on the next line after it.
+            i = lastspace;
+            vp = lastvp;
+            m_stringCharsOut = lastspaceout;
+            left = lastspaceleft;
+            breakline = true;
+        }
+
+        if (breakline)
+        {
+            if (m_hasBox && (m_boxLines > 0) && ((m_numLines + 1) > m_boxLines))
+                break; // exceeded line cap.
+            TrackOutputLines(left);
+            m_numLines++;
+            top += vsize;
+            left = 0;
+            lastspace = -1;
+            continue;
+        }
+
+        if (lg.space)
+        {
+            lastspace = i;
+            lastspaceleft = left;
+            lastspaceout = m_stringCharsOut;
+            lastvp = vp;
+        }
+
+        const NvFTGlyph *glyph = ftfont->GetGlyph(lg.index, pixelSize, lg.bold);
+        const int32_t quads = m_shadowDir ? 2 : 1;
+        if (glyph && (m_stringCharsOut + quads <= m_stringMax)) // don't overrun our block.
+        {
+            NoteAtlasShelf(glyph->m_shelf, ftfont->GetShelfGeneration(glyph->m_shelf));
+            const float x = left + lg.xoff + glyph->m_left;
+            const float y = top + ascender - lg.yoff - glyph->m_top;
+            if (m_shadowDir)
+            {
+                AddDynamicGlyph(&vp, *glyph, x+soff, y+soff, m_outline, m_shadowColor);
+                m_stringCharsOut++;
+            }
+            AddDynamicGlyph(&vp, *glyph, x, y, m_outline, lg.color);
+            m_stringCharsOut++;
+        }
+        left += lg.advance;
+    }
+
+    TrackOutputLines(left);
+
+    float maxWidth = 0;
+    for (int32_t i=0; i<m_numLines; i++)
+        if (maxWidth < m_calcLineWidth[i])
+            maxWidth = m_calcLineWidth[i];
+
+    AdjustGlyphsForAlignment(s_buildVerts);
+    UpdateTextBlock(m_quadFirst, s_buildVerts, m_stringCharsOut);
+
+    m_pixelsWide = maxWidth;
+    m_pixelsHigh = vsize * m_numLines;
+    m_cached = 1;
+    m_posCached = 0;
+}
+#endif
+
+
 //========================================================================
 float NvBFText::GetWidth()
 {
@@ -1632,6 +2172,10 @@ void NvBFText::RenderPrep()
     if (gSaveRestoreState)
         NvBFSaveGLState();
 
+#ifdef NV_USE_FREETYPE
+    NvFTFont::NextFrame(); // glyphs drawn from here on are kept in the atlases.
+#endif
+
     //lastFontProgram = NULL;
 
     // set up master rendering state
@@ -1791,12 +2335,42 @@ void NvBFText::Render()
         lastFontProgram = prog;
     }
 
+#ifdef NV_USE_FREETYPE
+    if (m_font->m_ftFont)
+    { // a shelf we drew from was evicted since we built, our texcoords are stale.
+        for (int32_t i=0; i<m_atlasShelfCount; i++)
+        {
+            if (m_font->m_ftFont->GetShelfGeneration(m_atlasShelves[2*i]) != m_atlasShelves[2*i+1])
+            {
+                m_cached = 0;
+                m_cacheKey = 0;
+                break;
+            }
+        }
+    }
+#endif
+
+    // rebuild now, so the changes go out with the flush below.
+    if (!m_cached) // need to recache BEFORE we do anything using textwidth, etc.
+        RebuildCache(1);
+    if (m_quadFirst<0)
+        return;
+    if (count > m_stringCharsOut) // recheck count against CharsOut after rebuilding cache
+        count = m_stringCharsOut;
+    if (!m_posCached) // AFTER we may have rebuilt the cache, we check if we recalc pos.
+        UpdateTextPosition();
+
     // set up master rendering state
     {
         uint8_t *offset = NULL;
-        if (!m_vbo)
-            glGenBuffers(1, &(m_vbo)); // !!!!TBD TODO error handling.
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        if (!s_textVBO)
+        {
+            glGenBuffers(1, &s_textVBO); // !!!!TBD TODO error handling.
+            s_textVBOQuads = 0;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, s_textVBO);
+        FlushTextBlocks();
+        offset += m_quadFirst * sizeof(BFVert) * VERT_PER_QUAD; // start of our block.
 
         glVertexAttribPointer(prog->fontProgAttribPos, 2, GL_FLOAT, 0, sizeof(BFVert), (void *)offset);
         glEnableVertexAttribArray(prog->fontProgAttribPos);
@@ -1811,14 +2385,6 @@ void NvBFText::Render()
         offset += sizeof(GLuint);
     }
 
-    // since buffer state is now set, can rebuild cache now without extra calls.
-    if (!m_cached) // need to recache BEFORE we do anything using textwidth, etc.
-        RebuildCache(1);
-    if (count > m_stringCharsOut) // recheck count against CharsOut after rebuilding cache
-        count = m_stringCharsOut;
-    if (!m_posCached) // AFTER we may have rebuilt the cache, we check if we recalc pos.
-        UpdateTextPosition();
-
     // set the model matrix offset for rendering this text based on position & alignment
     // first, do any pre-render position updates
 
@@ -1874,9 +2440,18 @@ void NvBFText::Render()
         lastFontTexture = m_font->m_tex;
 
         if (prog->fontProgLocScale>=0)
+        {
+#ifdef NV_USE_FREETYPE
+            if (m_font->m_ftFont)
+                glUniform2f(prog->fontProgLocScale,
+                            1.0f/m_font->m_ftFont->GetAtlasWidth(),
+                            1.0f/m_font->m_ftFont->GetAtlasHeight());
+            else
+#endif
             glUniform2f(prog->fontProgLocScale,
                         1.0f/m_font->m_afont->m_charCommon.m_pageWidth,
                         1.0f/m_font->m_afont->m_charCommon.m_pageHeight);
+        }
         if (prog->fontProgLocOutlineColor>=0)
             glUniform4f(prog->fontProgLocOutlineColor, 
                     (NV_PC_RED_FLOAT(m_outlineColor)),
@@ -0,0 +1,402 @@
+//----------------------------------------------------------------------------------
+// File:        NvUI/NvFTFont.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvFTFont.h"
+
+#ifdef NV_USE_FREETYPE
+
+#include "NvAssetLoader/NvAssetLoader.h"
+#include "NvGLUtils/NvImage.h"
+#include <NV/NvLogs.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+#include <hb.h>
+#include <hb-ft.h>
+
+#include <string.h>
+
+static FT_Library s_ftLibrary = NULL;
+static int32_t s_ftLibraryRefs = 0;
+
+uint32_t NvFTFont::s_frame = 1;
+
+// not in every GL header we build against.
+static const GLenum NV_R8 = 0x8229;
+static const GLenum NV_RED = 0x1903;
+static const GLenum NV_TEXTURE_SWIZZLE_R = 0x8E42;
+static const GLenum NV_TEXTURE_SWIZZLE_G = 0x8E43;
+static const GLenum NV_TEXTURE_SWIZZLE_B = 0x8E44;
+static const GLenum NV_TEXTURE_SWIZZLE_A = 0x8E45;
+
+
+//========================================================================
+//========================================================================
+NvFTFont::NvFTFont()
+: m_fileData(NULL)
+, m_face(NULL)
+, m_buffer(NULL)
+, m_currSize(0)
+, m_tex(0)
+, m_texFormat(GL_ALPHA)
+, m_shelfBottom(0)
+{
+}
+
+
+//========================================================================
+//========================================================================
+NvFTFont *NvFTFont::Create(const char *filename)
+{
+    if (!s_ftLibrary)
+    {
+        if (FT_Init_FreeType(&s_ftLibrary))
+        {
+            LOGE("NvFTFont: couldn't initialize FreeType");
+            s_ftLibrary = NULL;
+            return NULL;
+        }
+    }
+    s_ftLibraryRefs++;
+
+    NvFTFont *font = new NvFTFont;
+
+    int32_t len = 0;
+    font->m_fileData = NvAssetLoaderRead(filename, len);
+    if (!font->m_fileData)
+    {
+        LOGE("NvFTFont: couldn't read font file %s", filename);
+        delete font;
+        return NULL;
+    }
+
+    FT_Face face;
+    if (FT_New_Memory_Face(s_ftLibrary, (const FT_Byte*)font->m_fileData, len, 0, &face))
+    {
+        LOGE("NvFTFont: couldn't parse font file %s", filename);
+        delete font;
+        return NULL;
+    }
+    font->m_face = face;
+    if (!FT_IS_SCALABLE(face))
+    {
+        LOGE("NvFTFont: font file %s isn't scalable", filename);
+        delete font;
+        return NULL;
+    }
+    FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+
+    font->m_buffer = hb_buffer_create();
+
+    // single-channel atlas, filled on demand.  the font shaders read coverage
+    // from alpha; core profiles (and ES3) have no GL_ALPHA textures, so there
+    // the atlas is red and swizzled to look like one.  ES2 keeps GL_ALPHA.
+    const NvGfxAPIVersion &api = NvImage::getAPIVersion();
+    const bool redAtlas = (api.api == NvGfxAPI::GLES) ? (api.majVersion >= 3)
+        : (api >= NvGfxAPIVersion(NvGfxAPI::GL, 3, 3));
+    font->m_texFormat = redAtlas ? NV_RED : GL_ALPHA;
+    glGenTextures(1, &font->m_tex);
+    glBindTexture(GL_TEXTURE_2D, font->m_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, redAtlas ? NV_R8 : GL_ALPHA, ATLAS_SIZE, ATLAS_SIZE, 0,
+        font->m_texFormat, GL_UNSIGNED_BYTE, NULL);
+    if (redAtlas)
+    {
+        glTexParameteri(GL_TEXTURE_2D, NV_TEXTURE_SWIZZLE_R, GL_ZERO);
+        glTexParameteri(GL_TEXTURE_2D, NV_TEXTURE_SWIZZLE_G, GL_ZERO);
+        glTexParameteri(GL_TEXTURE_2D, NV_TEXTURE_SWIZZLE_B, GL_ZERO);
+        glTexParameteri(GL_TEXTURE_2D, NV_TEXTURE_SWIZZLE_A, NV_RED);
+    }
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return font;
+}
+
+
+//========================================================================
+//========================================================================
+NvFTFont::~NvFTFont()
+{
+    std::map<uint32_t, hb_font_t*>::iterator it;
+    for (it = m_hbFonts.begin(); it != m_hbFonts.end(); ++it)
+        hb_font_destroy(it->second);
+    if (m_buffer)
+        hb_buffer_destroy(m_buffer);
+    if (m_face)
+        FT_Done_Face(m_face);
+    if (m_fileData)
+        NvAssetLoaderFree(m_fileData);
+    if (m_tex)
+        glDeleteTextures(1, &m_tex);
+
+    if (--s_ftLibraryRefs == 0)
+    {
+        FT_Done_FreeType(s_ftLibrary);
+        s_ftLibrary = NULL;
+    }
+}
+
+
+//========================================================================
+// BitFont sizes are line heights, so pick the em size that gives the
+// face's line spacing that height.
+//========================================================================
+uint32_t NvFTFont::PixelSizeForLineHeight(float lineHeight) const
+{
+    float px = lineHeight;
+    if (m_face->height > 0)
+        px = lineHeight * m_face->units_per_EM / m_face->height;
+    int32_t size = (int32_t)(px + 0.5f);
+    if (size < 4)
+        size = 4;
+    if (size > 256)
+        size = 256;
+    return (uint32_t)size;
+}
+
+
+//========================================================================
+//========================================================================
+float NvFTFont::GetAscender(uint32_t pixelSize) const
+{
+    return (float)m_face->ascender * pixelSize / m_face->units_per_EM;
+}
+
+
+//========================================================================
+// hb-ft reads the face's scale when the font is made, so we keep one
+// hb font per size, and make sure the face is at that size before use.
+//========================================================================
+hb_font_t *NvFTFont::FontForSize(uint32_t pixelSize)
+{
+    if (m_currSize != pixelSize)
+    {
+        FT_Set_Pixel_Sizes(m_face, 0, pixelSize);
+        m_currSize = pixelSize;
+    }
+
+    std::map<uint32_t, hb_font_t*>::iterator it = m_hbFonts.find(pixelSize);
+    if (it != m_hbFonts.end())
+        return it->second;
+    hb_font_t *font = hb_ft_font_create(m_face, NULL);
+    m_hbFonts[pixelSize] = font;
+    return font;
+}
+
+
+//========================================================================
+//========================================================================
+const NvFTRun *NvFTFont::Shape(const char *utf8, int32_t bytes, uint32_t pixelSize)
+{
+    std::string key((const char*)&pixelSize, sizeof(pixelSize));
+    key.append(utf8, bytes);
+
+    std::map<std::string, NvFTRun>::iterator it = m_runs.find(key);
+    if (it != m_runs.end())
+    {
+        it->second.m_lastUse = s_frame;
+        return &(it->second);
+    }
+
+    // make room by dropping the least recently used run.
+    if ((int32_t)m_runs.size() >= MAX_CACHED_RUNS)
+    {
+        std::map<std::string, NvFTRun>::iterator oldest = m_runs.begin();
+        for (it = m_runs.begin(); it != m_runs.end(); ++it)
+            if (it->second.m_lastUse < oldest->second.m_lastUse)
+                oldest = it;
+        m_runs.erase(oldest);
+    }
+
+    hb_font_t *font = FontForSize(pixelSize);
+    hb_buffer_clear_contents(m_buffer);
+    hb_buffer_add_utf8(m_buffer, utf8, bytes, 0, bytes);
+    hb_buffer_guess_segment_properties(m_buffer);
+    hb_shape(font, m_buffer, NULL, 0);
+
+    uint32_t count = 0;
+    const hb_glyph_info_t *info = hb_buffer_get_glyph_infos(m_buffer, &count);
+    const hb_glyph_position_t *pos = hb_buffer_get_glyph_positions(m_buffer, NULL);
+
+    NvFTRun &run = m_runs[key];
+    run.m_lastUse = s_frame;
+    run.m_glyphs.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        NvFTShapedGlyph &g = run.m_glyphs[i];
+        g.m_index = info[i].codepoint; // glyph index after shaping.
+        g.m_cluster = info[i].cluster;
+        g.m_xAdvance = pos[i].x_advance / 64.0f;
+        g.m_xOffset = pos[i].x_offset / 64.0f;
+        g.m_yOffset = pos[i].y_offset / 64.0f;
+    }
+
+    return &run;
+}
+
+
+//========================================================================
+// shelf packing.  returns the shelf index and x position for a bitmap,
+// reusing the least recently used shelf when the atlas is full.
+//========================================================================
+int32_t NvFTFont::AllocShelf(int32_t width, int32_t height, int32_t &x)
+{
+    // best fit among shelves with room, not wasting too much height.
+    int32_t best = -1;
+    for (int32_t i = 0; i < (int32_t)m_shelves.size(); i++)
+    {
+        const Shelf &shelf = m_shelves[i];
+        if (shelf.m_height < height || shelf.m_height > height + height / 4 + 2)
+            continue;
+        if (shelf.m_x + width > ATLAS_SIZE)
+            continue;
+        if (best < 0 || shelf.m_height < m_shelves[best].m_height)
+            best = i;
+    }
+
+    // new shelf at the bottom.
+    if (best < 0)
+    {
+        const int32_t shelfHeight = (height + 3) & ~3;
+        if (m_shelfBottom + shelfHeight <= ATLAS_SIZE && width <= ATLAS_SIZE)
+        {
+            Shelf shelf = { m_shelfBottom, shelfHeight, 0, s_frame, 0 };
+            m_shelves.push_back(shelf);
+            m_shelfBottom += shelfHeight;
+            best = (int32_t)m_shelves.size() - 1;
+        }
+    }
+
+    // evict the stalest shelf that is tall enough and not in use this frame.
+    if (best < 0)
+    {
+        for (int32_t i = 0; i < (int32_t)m_shelves.size(); i++)
+        {
+            const Shelf &shelf = m_shelves[i];
+            if (shelf.m_height < height || shelf.m_lastUse == s_frame)
+                continue;
+            if (best < 0 || shelf.m_lastUse < m_shelves[best].m_lastUse)
+                best = i;
+        }
+        if (best < 0)
+            return -1;
+        m_shelves[best].m_x = 0;
+        m_shelves[best].m_generation++;
+    }
+
+    Shelf &shelf = m_shelves[best];
+    x = shelf.m_x;
+    shelf.m_x += width;
+    shelf.m_lastUse = s_frame;
+    return best;
+}
+
+
+//========================================================================
+//========================================================================
+const NvFTGlyph *NvFTFont::GetGlyph(uint32_t index, uint32_t pixelSize, bool bold)
+{
+    const uint64_t key = ((uint64_t)(pixelSize | (bold ? 0x80000000 : 0)) << 32) | index;
+    std::map<uint64_t, GlyphEntry>::iterator it = m_glyphs.find(key);
+    if (it != m_glyphs.end())
+    {
+        GlyphEntry &entry = it->second;
+        if (entry.m_shelf < 0)
+            return NULL; // blank glyph.
+        Shelf &shelf = m_shelves[entry.m_shelf];
+        if (shelf.m_generation == entry.m_generation)
+        {
+            shelf.m_lastUse = s_frame;
+            return &entry.m_glyph;
+        }
+        // evicted, rasterize it again.
+    }
+
+    FontForSize(pixelSize);
+    if (FT_Load_Glyph(m_face, index, FT_LOAD_DEFAULT))
+        return NULL;
+    const FT_GlyphSlot slot = m_face->glyph;
+    if (bold) // synthesized, so bold text shares the atlas (and draw) with normal.
+        FT_GlyphSlot_Embolden(slot);
+    if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL))
+        return NULL;
+    const FT_Bitmap &bitmap = slot->bitmap;
+
+    GlyphEntry &entry = m_glyphs[key];
+    entry.m_shelf = -1;
+    entry.m_generation = 0;
+    if (bitmap.width <= 0 || bitmap.rows <= 0 || bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+        return NULL;
+
+    // one texel of clear border, so filtering doesn't pick up neighbors.
+    const int32_t w = bitmap.width + 2;
+    const int32_t h = bitmap.rows + 2;
+    int32_t x = 0;
+    const int32_t shelf = AllocShelf(w, h, x);
+    if (shelf < 0)
+    {
+        m_glyphs.erase(key);
+        return NULL;
+    }
+    const int32_t y = m_shelves[shelf].m_y;
+
+    m_scratch.assign(w * h, 0);
+    for (int32_t row = 0; row < bitmap.rows; row++)
+        memcpy(&m_scratch[(row + 1) * w + 1], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+
+    glBindTexture(GL_TEXTURE_2D, m_tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, m_texFormat, GL_UNSIGNED_BYTE, &m_scratch[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    const float inv = 1.0f / ATLAS_SIZE;
+    entry.m_shelf = shelf;
+    entry.m_generation = m_shelves[shelf].m_generation;
+    entry.m_glyph.m_s0 = (x + 1) * inv;
+    entry.m_glyph.m_t0 = (y + 1) * inv;
+    entry.m_glyph.m_s1 = (x + 1 + bitmap.width) * inv;
+    entry.m_glyph.m_t1 = (y + 1 + bitmap.rows) * inv;
+    entry.m_glyph.m_left = (float)slot->bitmap_left;
+    entry.m_glyph.m_top = (float)slot->bitmap_top;
+    entry.m_glyph.m_width = (float)bitmap.width;
+    entry.m_glyph.m_height = (float)bitmap.rows;
+    entry.m_glyph.m_shelf = shelf;
+    return &entry.m_glyph;
+}
+
+#endif // NV_USE_FREETYPE
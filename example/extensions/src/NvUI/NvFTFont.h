@@ -0,0 +1,149 @@
+//----------------------------------------------------------------------------------
+// File:        NvUI/NvFTFont.h
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef _NV_FTFONT_H
+#define _NV_FTFONT_H
+
+#include <NvFoundation.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "NV/NvPlatformGL.h"
+
+class NvFTFont;
+
+// dynamic (scalable) font support for BitFont, built on FreeType for glyph
+// rasterization and HarfBuzz for shaping.  compiled in only when the build
+// defines NV_USE_FREETYPE and links the freetype and harfbuzz libraries.
+#ifdef NV_USE_FREETYPE
+
+struct FT_FaceRec_;
+struct hb_font_t;
+struct hb_buffer_t;
+
+// a glyph rasterized into the atlas, in pixels relative to the pen position.
+struct NvFTGlyph {
+    float m_s0, m_t0, m_s1, m_t1; // atlas texcoords
+    float m_left, m_top; // bitmap offset from the pen, y up
+    float m_width, m_height;
+    int32_t m_shelf; // atlas shelf holding the bitmap
+};
+
+// one glyph of a shaped run, in pixels.
+struct NvFTShapedGlyph {
+    uint32_t m_index; // font glyph index, NOT a character code
+    uint32_t m_cluster; // byte offset of the source text that made this glyph
+    float m_xAdvance;
+    float m_xOffset, m_yOffset;
+};
+
+// the output of shaping a run of text at a given pixel size.
+struct NvFTRun {
+    std::vector<NvFTShapedGlyph> m_glyphs;
+    uint32_t m_lastUse;
+};
+
+class NvFTFont
+{
+public:
+    // load a truetype/opentype font file.  returns NULL on failure.
+    static NvFTFont *Create(const char *filename);
+    ~NvFTFont();
+
+    // advance the clock used for picking what to evict.  glyphs used
+    // during the current frame are never evicted from the atlas.
+    static void NextFrame() { s_frame++; }
+
+    // the pixel size to rasterize at for text lines 'lineHeight' pixels tall.
+    uint32_t PixelSizeForLineHeight(float lineHeight) const;
+    // distance from the top of a line to the baseline at a pixel size.
+    float GetAscender(uint32_t pixelSize) const;
+
+    // shape a run of utf8 text; runs are cached by string and size.
+    const NvFTRun *Shape(const char *utf8, int32_t bytes, uint32_t pixelSize);
+    // find a glyph in the atlas, rasterizing it if needed.  bold glyphs are
+    // synthesized from the regular outlines.  returns NULL if the glyph has
+    // no bitmap (e.g. spaces) or the atlas is full.
+    const NvFTGlyph *GetGlyph(uint32_t index, uint32_t pixelSize, bool bold);
+
+    GLuint GetTexture() const { return m_tex; }
+    int32_t GetAtlasWidth() const { return ATLAS_SIZE; }
+    int32_t GetAtlasHeight() const { return ATLAS_SIZE; }
+    // bumped whenever a shelf is evicted, invalidating the texcoords of its
+    // glyphs in any vertices built before.
+    uint32_t GetShelfGeneration(int32_t shelf) const { return m_shelves[shelf].m_generation; }
+
+private:
+    NvFTFont();
+    hb_font_t *FontForSize(uint32_t pixelSize);
+    int32_t AllocShelf(int32_t width, int32_t height, int32_t &x);
+
+    static const int32_t ATLAS_SIZE = 1024;
+    static const int32_t MAX_CACHED_RUNS = 256;
+
+    struct Shelf {
+        int32_t m_y, m_height;
+        int32_t m_x; // fill position
+        uint32_t m_lastUse;
+        uint32_t m_generation; // bumped when the shelf is evicted
+    };
+
+    struct GlyphEntry {
+        NvFTGlyph m_glyph;
+        int32_t m_shelf; // -1 for glyphs with no bitmap
+        uint32_t m_generation;
+    };
+
+    static uint32_t s_frame;
+
+    char *m_fileData; // must outlive the face
+    FT_FaceRec_ *m_face;
+    std::map<uint32_t, hb_font_t*> m_hbFonts; // per pixel size
+    hb_buffer_t *m_buffer;
+    uint32_t m_currSize; // size the face is set to
+
+    GLuint m_tex;
+    GLenum m_texFormat; // GL_ALPHA, or red swizzled to alpha where GL_ALPHA is gone
+    std::vector<Shelf> m_shelves;
+    int32_t m_shelfBottom;
+    std::map<uint64_t, GlyphEntry> m_glyphs; // keyed by (bold | size) << 32 | index
+    std::map<std::string, NvFTRun> m_runs; // keyed by size + text
+    std::vector<uint8_t> m_scratch;
+};
+
+#endif // NV_USE_FREETYPE
+
+#endif // _NV_FTFONT_H
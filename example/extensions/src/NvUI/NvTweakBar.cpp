@@ -257,6 +257,19 @@ void NvTweakBar::syncValue(NvTweakVarBase* var)
 }
 
 
+//======================================================================
+//======================================================================
+NvTweakVarBase* NvTweakBar::findVar(const char* name)
+{
+    for (size_t i=0; i<m_vars.size(); i++)
+    {
+        if (NvTweakNameMatches(m_vars[i]->getName(), name))
+            return m_vars[i];
+    }
+    return NULL;
+}
+
+
 //======================================================================
 //======================================================================
 NvUIGraphic *NvTweakBar::MakeFocusFrame()
@@ -622,6 +635,7 @@ NvTweakVarBase* NvTweakBar::addValue(const char *name, bool &var, bool pushButto
 {
     // make a NvTweakVar on the fly. this will leak currently.
     NvTweakVar<bool> *tvar = new NvTweakVar<bool>(var, name);
+    m_vars.push_back(tvar);
     NvUIButton *btn = MakeStdButton(name, var, pushButton?NvUIButtonType::PUSH:NvUIButtonType::CHECK, actionCode, 1);
     AddElement(new NvTweakVarUI<bool>(*tvar, btn, btn->GetActionCode()));
     return tvar;
@@ -640,6 +654,7 @@ NvTweakVarBase* NvTweakBar::addValue(const char *name, float &var, float min, fl
 {
     // make a NvTweakVar on the fly. this will leak currently.
     NvTweakVar<float> *tvar = new NvTweakVar<float>(var, name, min, max, step);
+    m_vars.push_back(tvar);
     NvUISlider *sld = MakeStdSlider(name, var, min, max, step, false, actionCode);
     tvar->setActionCode(sld->GetActionCode());
     NvUIElement *te = new NvTweakVarUI<float>(*tvar, sld, sld->GetActionCode());
@@ -662,6 +677,7 @@ NvTweakVarBase* NvTweakBar::addValue(const char *name, uint32_t &var, uint32_t m
 {
     // make a NvTweakVar on the fly. this will leak currently.
     NvTweakVar<uint32_t> *tvar = new NvTweakVar<uint32_t>(var, name, min, max, step);
+    m_vars.push_back(tvar);
     NvUISlider *sld = MakeStdSlider(name, (float)var, (float)min, (float)max, (float)step, true, actionCode);
     tvar->setActionCode(sld->GetActionCode()); // link the var with the code...
     NvUIElement *te = new NvTweakVarUI<uint32_t>(*tvar, sld, sld->GetActionCode());
@@ -700,6 +716,7 @@ NvTweakVarBase* NvTweakBar::addEnum(const char *name, uint32_t &var, const NvTwe
     // make a NvTweakVar on the fly. this will leak currently.
     NvTweakEnumVar<uint32_t> *tvar = new NvTweakEnumVar<uint32_t>(values, valueCount, var, name, minval, maxval, 0);
     tvar->setValLoop(true);
+    m_vars.push_back(tvar);
 
     // add label
     addLabel(name, false);
@@ -735,6 +752,7 @@ NvTweakVarBase* NvTweakBar::addMenu(const char *name, uint32_t &var, const NvTwe
     // make a NvTweakVar on the fly. this will leak currently.
     NvTweakEnumVar<uint32_t> *tvar = new NvTweakEnumVar<uint32_t>(values, valueCount, var, name, minval, maxval, 0);
     tvar->setValLoop(true);
+    m_vars.push_back(tvar);
 
     NvUIPopup *el = MakeStdPopup(name, *tvar, values, valueCount, actionCode);
     AddElement(el);
@@ -34,6 +34,10 @@
 
 #include "NvUI/NvTweakVar.h"
 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
 template<class T>
 T NvMax(T a, T b)                            { return a<b ? b : a;    }
 
@@ -171,3 +175,61 @@ bool NvTweakVar<uint32_t>::equals(uint32_t val)
 {
     return (mValRef == val);
 }
+
+
+bool NvTweakNameMatches(const char *name, const char *str)
+{
+    if (!name || !str)
+        return false;
+    while (true) {
+        while (*name && !isalnum((unsigned char)*name))
+            name++;
+        while (*str && !isalnum((unsigned char)*str))
+            str++;
+        if (!*name || !*str)
+            return (*name == *str); // both ended together
+        if (tolower((unsigned char)*name) != tolower((unsigned char)*str))
+            return false;
+        name++;
+        str++;
+    }
+}
+
+
+template <>
+bool NvTweakVar<bool>::setFromString(const char *str)
+{
+    if (!strcmp(str, "1") || NvTweakNameMatches("true", str) || NvTweakNameMatches("on", str))
+        mValRef = true;
+    else if (!strcmp(str, "0") || NvTweakNameMatches("false", str) || NvTweakNameMatches("off", str))
+        mValRef = false;
+    else
+        return false;
+    return true;
+}
+
+template <>
+bool NvTweakVar<float>::setFromString(const char *str)
+{
+    char *end;
+    float val = (float)strtod(str, &end);
+    if (end == str || *end)
+        return false;
+    if (mValClamped)
+        val = NvMin(NvMax(val, mValMin), mValMax);
+    mValRef = val;
+    return true;
+}
+
+template <>
+bool NvTweakVar<uint32_t>::setFromString(const char *str)
+{
+    char *end;
+    uint32_t val = (uint32_t)strtoul(str, &end, 0);
+    if (end == str || *end)
+        return false;
+    if (mValClamped)
+        val = NvMin(NvMax(val, mValMin), mValMax);
+    mValRef = val;
+    return true;
+}
@@ -0,0 +1,452 @@
+//----------------------------------------------------------------------------------
+// File:        NvUI/NvUIBatch.cpp
+// SDK Version: v2.11 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014-2015, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NvUI/NvUI.h"
+
+#include "NV/NvPlatformGL.h"
+#include <NvGLUtils/NvGLSLProgram.h>
+#include "NV/NvLogs.h"
+
+#include <math.h>
+#include <vector>
+
+
+//======================================================================
+//======================================================================
+const static char s_batchVertShader[] =
+"#version 100\n"
+"attribute vec2 position;\n"
+"attribute vec2 tex;\n"
+"attribute vec4 color;\n"
+"varying vec2 tex_coord;\n"
+"varying vec4 tex_color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(position, 0, 1);\n"
+"    tex_coord = tex;\n"
+"    tex_color = color;\n"
+"}\n";
+
+const static char s_batchFragShader[] =
+"#version 100\n"
+"precision mediump float;\n"
+"varying vec2 tex_coord;\n"
+"varying vec4 tex_color;\n"
+"uniform sampler2D sampler;\n"
+"void main()\n"
+"{\n"
+"    gl_FragColor = texture2D(sampler, tex_coord) * tex_color;\n"
+"}\n";
+
+// Quads per draw call; keeps the shared indices within 16 bits.
+static const int32_t MAX_BATCH_QUADS = 4096;
+
+// How many groups a quad may be moved back past to join one with the same state.
+static const int32_t MAX_BATCH_LOOKBACK = 16;
+
+/** A run of quads sharing a texture and blend state, or a deferred text draw. */
+struct NvUIBatchGroup
+{
+    uint32_t texID;
+    bool blend;
+    int32_t text; // index into s_texts, or -1 for quads
+    NvUIRect bounds;
+    std::vector<NvUIBatch::Vertex> verts;
+};
+
+/** A text element queued with the draw state it was drawn with. */
+struct NvUIBatchText
+{
+    NvUIText* text;
+    NvUIDrawState drawState;
+
+    NvUIBatchText(NvUIText* t, const NvUIDrawState& ds) : text(t), drawState(ds) {}
+};
+
+static int32_t s_depth = 0;
+
+// groups are reused from frame to frame, so their vertex storage is too
+static std::vector<NvUIBatchGroup> s_groups;
+static int32_t s_groupCount = 0;
+static std::vector<NvUIBatchText> s_texts;
+
+static NvGLSLProgram* s_program = NULL;
+static GLint s_positionIndex = -1;
+static GLint s_uvIndex = -1;
+static GLint s_colorIndex = -1;
+static GLuint s_vbo = 0;
+static GLuint s_ibo = 0;
+
+
+//======================================================================
+//======================================================================
+static bool Overlaps(const NvUIRect& a, const NvUIRect& b)
+{
+    return a.left < b.left + b.width && b.left < a.left + a.width
+        && a.top < b.top + b.height && b.top < a.top + a.height;
+}
+
+static void Union(NvUIRect& a, const NvUIRect& b)
+{
+    float right = a.left + a.width;
+    float bottom = a.top + a.height;
+    if (b.left + b.width > right)
+        right = b.left + b.width;
+    if (b.top + b.height > bottom)
+        bottom = b.top + b.height;
+    if (b.left < a.left)
+        a.left = b.left;
+    if (b.top < a.top)
+        a.top = b.top;
+    a.width = right - a.left;
+    a.height = bottom - a.top;
+}
+
+static NvUIBatchGroup& NewGroup()
+{
+    if (s_groupCount == (int32_t)s_groups.size())
+        s_groups.resize(s_groups.size() + 1);
+
+    NvUIBatchGroup& group = s_groups[s_groupCount++];
+    group.verts.clear();
+    return group;
+}
+
+
+//======================================================================
+//======================================================================
+static bool InitResources()
+{
+    if (s_program)
+        return true;
+
+    s_program = NvGLSLProgram::createFromStrings(s_batchVertShader, s_batchFragShader);
+    CHECK_GL_ERROR();
+    if (!s_program)
+        return false;
+
+    s_program->enable();
+    s_positionIndex = s_program->getAttribLocation("position");
+    s_uvIndex = s_program->getAttribLocation("tex");
+    s_colorIndex = s_program->getAttribLocation("color");
+    s_program->setUniform1i(s_program->getUniformLocation("sampler"), 0); // texunit index zero.
+    s_program->disable();
+
+    std::vector<uint16_t> indices(MAX_BATCH_QUADS * 6);
+    for (int32_t i = 0; i < MAX_BATCH_QUADS; i++)
+    {
+        uint16_t pos = (uint16_t)(i * 4);
+        indices[i*6+0] = pos;
+        indices[i*6+1] = pos+1;
+        indices[i*6+2] = pos+3;
+        indices[i*6+3] = pos+3;
+        indices[i*6+4] = pos+1;
+        indices[i*6+5] = pos+2;
+    }
+
+    glGenBuffers(1, &s_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &s_vbo);
+
+    CHECK_GL_ERROR();
+    return true;
+}
+
+void NvUIBatch::StaticCleanup()
+{
+    if (s_program)
+    {
+        delete s_program;
+        s_program = NULL;
+
+        glDeleteBuffers(1, &s_vbo);
+        glDeleteBuffers(1, &s_ibo);
+        s_vbo = 0;
+        s_ibo = 0;
+    }
+
+    s_groups.clear();
+    s_texts.clear();
+    s_groupCount = 0;
+}
+
+
+//======================================================================
+//======================================================================
+void NvUIBatch::Begin()
+{
+    s_depth++;
+}
+
+bool NvUIBatch::IsActive()
+{
+    return s_depth > 0;
+}
+
+NvUIBatch::Vertex* NvUIBatch::AddQuads(uint32_t texID, bool blend, int32_t count, const NvUIRect& bounds)
+{
+    // look for an earlier group with our state that nothing queued since covers
+    NvUIBatchGroup* target = NULL;
+    int32_t last = (s_groupCount > MAX_BATCH_LOOKBACK) ? s_groupCount - MAX_BATCH_LOOKBACK : 0;
+    for (int32_t i = s_groupCount - 1; i >= last; i--)
+    {
+        NvUIBatchGroup& group = s_groups[i];
+        if (group.text < 0 && group.texID == texID && group.blend == blend)
+        {
+            target = &group;
+            break;
+        }
+        if (Overlaps(group.bounds, bounds))
+            break;
+    }
+
+    if (target)
+    {
+        Union(target->bounds, bounds);
+    }
+    else
+    {
+        target = &NewGroup();
+        target->texID = texID;
+        target->blend = blend;
+        target->text = -1;
+        target->bounds = bounds;
+    }
+
+    size_t first = target->verts.size();
+    target->verts.resize(first + count * 4);
+    return &target->verts[first];
+}
+
+void NvUIBatch::AddText(NvUIText* text, const NvUIDrawState& drawState, const NvUIRect& bounds)
+{
+    NvUIBatchGroup& group = NewGroup();
+    group.texID = 0;
+    group.blend = true;
+    group.text = (int32_t)s_texts.size();
+    group.bounds = bounds;
+
+    s_texts.push_back(NvUIBatchText(text, drawState));
+}
+
+
+//======================================================================
+//======================================================================
+void NvUIBatch::ComputeTransform(const NvUIDrawState& drawState, const NvUIRect& rect, float xform[6])
+{
+    int32_t designWidth, designHeight;
+    if (drawState.designWidth)
+    {
+        designWidth = drawState.designWidth;
+        designHeight = drawState.designHeight;
+    }
+    else
+    {
+        designWidth = drawState.width;
+        designHeight = drawState.height;
+    }
+
+    const float wNorm = 2.0f / designWidth;
+    const float hNorm = 2.0f / designHeight;
+
+    float rad = (float)(drawState.rotation / 180.0f * 3.14159f); // [-1,2]=>[-90,180] in radians...
+    float cosf = (float)cos(rad);
+    float sinf = (float)sin(rad);
+
+    xform[0] = wNorm * rect.width  * cosf;
+    xform[1] = wNorm * rect.width  * sinf;
+    xform[2] = hNorm * rect.height * -sinf;
+    xform[3] = hNorm * rect.height * cosf;
+    xform[4] = ( wNorm * rect.left - 1) * cosf
+             - ( 1 - hNorm * (rect.top + rect.height))  * sinf;
+    xform[5] = ( wNorm * rect.left - 1 ) * sinf
+             + ( 1 - hNorm * (rect.top + rect.height))  * cosf;
+}
+
+void NvUIBatch::SetQuad(Vertex* v, const float xform[6],
+    float x0, float y0, float x1, float y1,
+    float s0, float t0, float s1, float t1, const uint8_t color[4])
+{
+    // same corner order as the static NvUIGraphic quad
+    const float x[4] = { x0, x0, x1, x1 };
+    const float y[4] = { y1, y0, y0, y1 };
+    const float s[4] = { s0, s0, s1, s1 };
+    const float t[4] = { t1, t0, t0, t1 };
+
+    for (int32_t i = 0; i < 4; i++)
+    {
+        v[i].x = xform[0] * x[i] + xform[2] * y[i] + xform[4];
+        v[i].y = xform[1] * x[i] + xform[3] * y[i] + xform[5];
+        v[i].s = s[i];
+        v[i].t = t[i];
+        memcpy(v[i].color, color, 4);
+    }
+}
+
+
+//======================================================================
+//======================================================================
+static void BindBatchState()
+{
+    s_program->enable();
+
+    glBindBuffer(GL_ARRAY_BUFFER, s_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_ibo);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnableVertexAttribArray(s_positionIndex);
+    glEnableVertexAttribArray(s_uvIndex);
+    glEnableVertexAttribArray(s_colorIndex);
+
+    // Alpha sums in the destination channel to ensure that
+    // partially-opaque items do not decrease the destination
+    // alpha and thus "cut holes" in the backdrop
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+        GL_ONE, GL_ONE);
+}
+
+static void UnbindBatchState()
+{
+    glDisableVertexAttribArray(s_positionIndex);
+    glDisableVertexAttribArray(s_uvIndex);
+    glDisableVertexAttribArray(s_colorIndex);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glDisable(GL_BLEND);
+
+    s_program->disable();
+}
+
+static void DrawGroups()
+{
+    size_t vertCount = 0;
+    for (int32_t i = 0; i < s_groupCount; i++)
+        vertCount += s_groups[i].verts.size();
+
+    if (vertCount)
+    {
+        // orphan last frame's storage so the upload does not wait on it
+        glBindBuffer(GL_ARRAY_BUFFER, s_vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertCount * sizeof(NvUIBatch::Vertex), NULL, GL_STREAM_DRAW);
+
+        size_t offset = 0;
+        for (int32_t i = 0; i < s_groupCount; i++)
+        {
+            const std::vector<NvUIBatch::Vertex>& verts = s_groups[i].verts;
+            if (verts.empty())
+                continue;
+            glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(NvUIBatch::Vertex),
+                verts.size() * sizeof(NvUIBatch::Vertex), &verts[0]);
+            offset += verts.size();
+        }
+    }
+
+    bool bound = false;
+    bool blend = false;
+    size_t first = 0;
+    for (int32_t i = 0; i < s_groupCount; i++)
+    {
+        const NvUIBatchGroup& group = s_groups[i];
+
+        if (group.text >= 0)
+        {
+            if (bound)
+            {
+                UnbindBatchState();
+                bound = false;
+            }
+
+            NvUIBatchText& text = s_texts[group.text];
+            text.text->DrawImmediate(text.drawState);
+            continue;
+        }
+
+        if (!bound)
+        {
+            BindBatchState();
+            bound = true;
+            blend = !group.blend; // force the blend state below
+        }
+
+        if (blend != group.blend)
+        {
+            blend = group.blend;
+            if (blend)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, group.texID);
+
+        int32_t quadCount = (int32_t)(group.verts.size() / 4);
+        for (int32_t quad = 0; quad < quadCount; quad += MAX_BATCH_QUADS)
+        {
+            int32_t count = quadCount - quad;
+            if (count > MAX_BATCH_QUADS)
+                count = MAX_BATCH_QUADS;
+
+            // the shared indices start at zero, so point the attributes at the first quad
+            const uint8_t* base = (const uint8_t*)((first + quad * 4) * sizeof(NvUIBatch::Vertex));
+            glVertexAttribPointer(s_positionIndex, 2, GL_FLOAT, GL_FALSE, sizeof(NvUIBatch::Vertex), base);
+            glVertexAttribPointer(s_uvIndex, 2, GL_FLOAT, GL_FALSE, sizeof(NvUIBatch::Vertex), base + 2 * sizeof(float));
+            glVertexAttribPointer(s_colorIndex, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(NvUIBatch::Vertex), base + 4 * sizeof(float));
+
+            glDrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, 0);
+        }
+
+        first += group.verts.size();
+    }
+
+    if (bound)
+        UnbindBatchState();
+
+    CHECK_GL_ERROR();
+}
+
+void NvUIBatch::End()
+{
+    if (s_depth == 0 || --s_depth > 0)
+        return;
+
+    if (s_groupCount && InitResources())
+        DrawGroups();
+
+    s_groupCount = 0;
+    s_texts.clear();
+}
@@ -411,6 +411,8 @@ void NvUIGraphic::StaticCleanup()
         delete ms_shader.m_program;
         ms_shader.m_program = 0;
 
+        NvUIBatch::StaticCleanup();
+
         glDeleteBuffers(1, &ms_vbo);
         glDeleteBuffers(1, &ms_vboFlip);
         glDeleteBuffers(1, &ms_ibo);
@@ -442,6 +444,28 @@ void NvUIGraphic::Draw(const NvUIDrawState &drawState)
     if (drawState.alpha != 1.0f)
         myAlpha *= drawState.alpha;
 
+    if (NvUIBatch::IsActive())
+    {
+        uint8_t color[4] = { 255, 255, 255, (uint8_t)(myAlpha * 255) };
+        if (!NV_PC_IS_WHITE(m_color))
+        {
+            color[0] = (uint8_t)NV_PC_RED(m_color);
+            color[1] = (uint8_t)NV_PC_GREEN(m_color);
+            color[2] = (uint8_t)NV_PC_BLUE(m_color);
+        }
+
+        float xform[6];
+        NvUIBatch::ComputeTransform(drawState, m_rect, xform);
+
+        bool blend = m_tex->GetHasAlpha() || (myAlpha<1.0f);
+        NvUIBatch::Vertex* v = NvUIBatch::AddQuads(m_tex->GetGLTex(), blend, 1, m_rect);
+        if (m_vFlip)
+            NvUIBatch::SetQuad(v, xform, 0, 0, 1, 1, 0, 1, 1, 0, color);
+        else
+            NvUIBatch::SetQuad(v, xform, 0, 0, 1, 1, 0, 0, 1, 1, color);
+        return;
+    }
+
     // pick correct shader based on alpha...
     ms_shader.m_program->enable();
 
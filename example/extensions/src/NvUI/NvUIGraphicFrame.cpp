@@ -321,6 +321,57 @@ void NvUIGraphicFrame::SetDrawCenter(bool drawCenter)
     m_drawCenter = drawCenter;
 }
 
+//======================================================================
+// Emits the 3x3 grid of the frame as quads into the open NvUIBatch,
+// computing on the CPU what the frame vertex shader does.
+//======================================================================
+void NvUIGraphicFrame::DrawBatched(const NvUIDrawState &drawState, float myAlpha)
+{
+    uint8_t color[4] = { 255, 255, 255, (uint8_t)(myAlpha * 255) };
+    if (!NV_PC_IS_WHITE(m_color))
+    {
+        color[0] = (uint8_t)NV_PC_RED(m_color);
+        color[1] = (uint8_t)NV_PC_GREEN(m_color);
+        color[2] = (uint8_t)NV_PC_BLUE(m_color);
+    }
+
+    float xform[6];
+    NvUIBatch::ComputeTransform(drawState, m_rect, xform);
+
+    // border thickness as a fraction of the frame, at most half of it
+    float thicknessX = m_borderThickness.x;
+    float thicknessY = m_borderThickness.y;
+    if (thicknessX > m_rect.width / 2)
+        thicknessX = m_rect.width / 2;
+    if (thicknessY > m_rect.height / 2)
+        thicknessY = m_rect.height / 2;
+    thicknessX /= m_rect.width;
+    thicknessY /= m_rect.height;
+
+    const float texBorderX = m_texBorder.x / m_tex->GetWidth();
+    const float texBorderY = m_texBorder.y / m_tex->GetHeight();
+
+    const float x[4] = { 0, thicknessX, 1 - thicknessX, 1 };
+    const float y[4] = { 0, thicknessY, 1 - thicknessY, 1 };
+    const float s[4] = { 0, texBorderX, 1 - texBorderX, 1 };
+    const float t[4] = { 0, texBorderY, 1 - texBorderY, 1 };
+
+    bool blend = m_tex->GetHasAlpha() || (myAlpha<1.0f);
+    NvUIBatch::Vertex* v = NvUIBatch::AddQuads(m_tex->GetGLTex(), blend, m_drawCenter ? 9 : 8, m_rect);
+
+    for (int32_t row = 0; row < 3; row++)
+    {
+        for (int32_t col = 0; col < 3; col++)
+        {
+            if (row == 1 && col == 1 && !m_drawCenter)
+                continue;
+            NvUIBatch::SetQuad(v, xform, x[col], y[row], x[col+1], y[row+1],
+                s[col], t[row], s[col+1], t[row+1], color);
+            v += 4;
+        }
+    }
+}
+
 //======================================================================
 //======================================================================
 void NvUIGraphicFrame::Draw(const NvUIDrawState &drawState)
@@ -333,6 +384,12 @@ void NvUIGraphicFrame::Draw(const NvUIDrawState &drawState)
     if (drawState.alpha != 1.0f)
         myAlpha *= drawState.alpha;
 
+    if (NvUIBatch::IsActive())
+    {
+        DrawBatched(drawState, myAlpha);
+        return;
+    }
+
     // pick correct shader based on alpha...
     ms_shader.m_program->enable();
 
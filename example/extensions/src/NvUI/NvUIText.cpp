@@ -199,6 +199,34 @@ void NvUIText::SetDimensions(float w, float h)
 //======================================================================
 //======================================================================
 void NvUIText::Draw(const NvUIDrawState &drawState)
+{
+    if (!m_isVisible) return;
+
+    if (NvUIBatch::IsActive())
+    {
+        // only quads overlapping these bounds have to stay behind or in front of us
+        NvUIRect bounds(m_rect);
+        if (bounds.width <= 0)
+        {   // unboxed text may be aligned to either side of the cursor
+            float w = GetStringPixelWidth();
+            bounds.left -= w;
+            bounds.width = 2 * w;
+        }
+        if (bounds.height <= 0)
+            bounds.height = m_size;
+        // leave room for drop shadows and glyphs overhanging the box
+        bounds.Grow(2.0f * DEFAULT_SHADOW_OFFSET + m_size * 0.5f, 2.0f * DEFAULT_SHADOW_OFFSET + m_size * 0.5f);
+
+        NvUIBatch::AddText(this, drawState, bounds);
+        return;
+    }
+
+    DrawImmediate(drawState);
+}
+
+//======================================================================
+//======================================================================
+void NvUIText::DrawImmediate(const NvUIDrawState &drawState)
 {
     if (m_isVisible)
     {
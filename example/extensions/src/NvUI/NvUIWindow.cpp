@@ -99,7 +99,10 @@ void NvUIWindow::Draw(const NvUIDrawState &drawState)
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
 
+    // queue the quads of all children and draw them grouped by texture
+    NvUIBatch::Begin();
     INHERITED::Draw(drawState);
+    NvUIBatch::End();
 
     NvBFRestoreGLState();
 }
\ No newline at end of file
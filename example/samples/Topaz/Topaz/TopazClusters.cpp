@@ -0,0 +1,193 @@
+#include "TopazClusters.h"
+
+TopazClusters::TopazClusters() : indirectBuffer(0), visibleTriangles(0)
+{
+}
+
+void TopazClusters::clear()
+{
+	geometryClusters.clear();
+}
+
+void TopazClusters::setGeometryClusters(uint32_t geometry, const NvModelCluster* clusters, uint32_t count, GLuint firstIndex)
+{
+	if (geometryClusters.size() <= geometry)
+	{
+		geometryClusters.resize(geometry + 1);
+	}
+
+	std::vector<Cluster>& target = geometryClusters[geometry];
+	target.resize(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		target[i].firstIndex = firstIndex + GLuint(clusters[i].firstIndex);
+		target[i].indexCount = GLuint(clusters[i].indexCount);
+		target[i].sphere = nv::vec4f(clusters[i].center, clusters[i].radius);
+	}
+}
+
+void TopazClusters::build(const TopazScene& scene, const TopazInstancing& instancing)
+{
+	const uint32_t groupCount = instancing.getGroupCount();
+
+	commandBases.resize(groupCount);
+	drawCounts.assign(groupCount, -1);
+	visibleTriangles = 0;
+
+	uint32_t commandCount = 0;
+	for (uint32_t group = 0; group < groupCount; group++)
+	{
+		const uint32_t geometry = instancing.getGroup(group).geometry;
+
+		commandBases[group] = commandCount;
+		if (geometry < geometryClusters.size() && scene.getGeometry(geometry).mode == GL_TRIANGLES)
+		{
+			commandCount += uint32_t(geometryClusters[geometry].size());
+		}
+	}
+
+	commands.resize(commandCount);
+
+	if (indirectBuffer)
+	{
+		glDeleteBuffers(1, &indirectBuffer);
+		indirectBuffer = 0;
+	}
+
+	if (!commandCount)
+	{
+		return;
+	}
+
+	glGenBuffers(1, &indirectBuffer);
+	glNamedBufferDataEXT(indirectBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+
+	CHECK_GL_ERROR();
+}
+
+void TopazClusters::cull(const TopazScene& scene, const TopazInstancing& instancing, const std::vector<uint8_t>& visibleNodes,
+	const std::vector<uint32_t>& groupLods, const nv::matrix4f& viewProjection)
+{
+	visibleTriangles = 0;
+
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
+	{
+		drawCounts[group] = -1;
+
+		const TopazInstancing::Group& instances = instancing.getGroup(group);
+		if (instances.geometry >= geometryClusters.size() || groupLods[group] != 0 ||
+			scene.getGeometry(instances.geometry).mode != GL_TRIANGLES)
+		{
+			continue;
+		}
+
+		const std::vector<Cluster>& clusters = geometryClusters[instances.geometry];
+		if (clusters.empty())
+		{
+			continue;
+		}
+
+		clusterVisible.assign(clusters.size(), 0);
+		bool groupVisible = false;
+
+		for (uint32_t instance = instances.firstInstance; instance < instances.firstInstance + instances.instanceCount; instance++)
+		{
+			const uint32_t node = instancing.getInstanceNode(instance);
+			if (!visibleNodes[node])
+			{
+				continue;
+			}
+
+			groupVisible = true;
+
+			// the planes of viewProjection * world are the frustum in model space, where the spheres are
+			const nv::matrix4f modelViewProjection = viewProjection * scene.getWorldMatrix(node);
+
+			nv::vec4f planes[6];
+			for (int32_t p = 0; p < 6; p++)
+			{
+				const int32_t row = p / 2;
+				const float sign = (p & 1) ? -1.0f : 1.0f;
+
+				planes[p] = nv::vec4f(
+					modelViewProjection(3, 0) + sign * modelViewProjection(row, 0),
+					modelViewProjection(3, 1) + sign * modelViewProjection(row, 1),
+					modelViewProjection(3, 2) + sign * modelViewProjection(row, 2),
+					modelViewProjection(3, 3) + sign * modelViewProjection(row, 3));
+
+				// unit normals turn the plane equation into a distance the radius can be compared with
+				const float length = nv::length(nv::vec3f(planes[p].x, planes[p].y, planes[p].z));
+				if (length > 0.0f)
+				{
+					planes[p] *= 1.0f / length;
+				}
+			}
+
+			for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+			{
+				if (clusterVisible[cluster])
+				{
+					continue;
+				}
+
+				const nv::vec4f& sphere = clusters[cluster].sphere;
+
+				uint8_t inside = 1;
+				for (int32_t p = 0; p < 6 && inside; p++)
+				{
+					inside = (planes[p].x * sphere.x + planes[p].y * sphere.y + planes[p].z * sphere.z + planes[p].w >= -sphere.w) ? 1 : 0;
+				}
+
+				clusterVisible[cluster] = inside;
+			}
+		}
+
+		// a group without a visible node is not drawn anyway
+		if (!groupVisible)
+		{
+			continue;
+		}
+
+		// the clusters lie back to back in the ibo, so neighbouring visible ones merge into one command
+		DrawElementsIndirectCommand* groupCommands = &commands[commandBases[group]];
+		GLsizei count = 0;
+
+		for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+		{
+			if (!clusterVisible[cluster])
+			{
+				continue;
+			}
+
+			if (count > 0 && groupCommands[count - 1].firstIndex + groupCommands[count - 1].count == clusters[cluster].firstIndex)
+			{
+				groupCommands[count - 1].count += clusters[cluster].indexCount;
+			}
+			else
+			{
+				groupCommands[count].count = clusters[cluster].indexCount;
+				groupCommands[count].instanceCount = instancing.getVisibleInstanceCount(group);
+				groupCommands[count].firstIndex = clusters[cluster].firstIndex;
+				groupCommands[count].baseVertex = 0;
+				groupCommands[count].baseInstance = 0;
+				count++;
+			}
+
+			visibleTriangles += clusters[cluster].indexCount / 3 * instancing.getVisibleInstanceCount(group);
+		}
+
+		drawCounts[group] = count;
+
+		if (count > 0)
+		{
+			glNamedBufferSubDataEXT(indirectBuffer, getIndirectOffset(group), count * sizeof(DrawElementsIndirectCommand), groupCommands);
+		}
+	}
+}
+
+void TopazClusters::reset()
+{
+	drawCounts.assign(drawCounts.size(), -1);
+	visibleTriangles = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "includeAll.h"
+#include "TopazScene.h"
+#include "TopazInstancing.h"
+
+/*
+	Culls the clusters of large geometries (see NvModel::computeClusters) against
+	the view frustum, so a single huge part only draws the pieces in view.  Every
+	instance group gets a range of DrawElementsIndirectCommands in one indirect
+	buffer, one command per run of neighbouring visible clusters; each command draws
+	the instances TopazInstancing::compact kept for the group, and a cluster is
+	kept while any of them sees it.  Clusters only cover the finest level of
+	detail, so groups drawing a coarser level are drawn whole.
+
+	The normal cones are not tested: the sample draws both faces of its triangles.
+*/
+class TopazClusters
+{
+public:
+	/* geometries with fewer triangles are drawn whole */
+	enum
+	{
+		MIN_TRIANGLES = 2048
+	};
+
+	TopazClusters();
+
+	void clear();
+
+	/* the clusters of the finest level of geometry; firstIndex is where that level starts in the geometry's ibo */
+	void setGeometryClusters(uint32_t geometry, const NvModelCluster* clusters, uint32_t count, GLuint firstIndex);
+
+	/* reserves the commands of every group and (re)creates the indirect buffer */
+	void build(const TopazScene& scene, const TopazInstancing& instancing);
+
+	/*
+		culls the clusters of every group that has a visible node and draws level 0
+		of groupLods; visibleNodes is what instancing was compacted with, and
+		viewProjection maps world to clip space
+	*/
+	void cull(const TopazScene& scene, const TopazInstancing& instancing, const std::vector<uint8_t>& visibleNodes,
+		const std::vector<uint32_t>& groupLods, const nv::matrix4f& viewProjection);
+
+	/* every group is drawn whole until the next cull */
+	void reset();
+
+	/* the number of commands group draws at getIndirectOffset, or -1 when it is drawn whole */
+	GLsizei getDrawCount(uint32_t group) const
+	{
+		return drawCounts[group];
+	}
+
+	GLuint getIndirectBuffer() const
+	{
+		return indirectBuffer;
+	}
+
+	GLintptr getIndirectOffset(uint32_t group) const
+	{
+		return GLintptr(commandBases[group] * sizeof(DrawElementsIndirectCommand));
+	}
+
+	/* triangles the cluster commands drew in the last cull, counting every instance */
+	uint32_t getVisibleTriangleCount() const
+	{
+		return visibleTriangles;
+	}
+
+private:
+	/* the GL layout of glMultiDrawElementsIndirect parameters */
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLuint baseVertex;
+		GLuint baseInstance;
+	};
+
+	/* index range in the geometry's ibo and bounding sphere (xyz center, w radius) in model space */
+	struct Cluster
+	{
+		GLuint    firstIndex;
+		GLuint    indexCount;
+		nv::vec4f sphere;
+	};
+
+	/* clusters by geometry id, empty for geometries drawn whole */
+	std::vector<std::vector<Cluster> > geometryClusters;
+
+	/* first command of each group; a group has room for one command per cluster */
+	std::vector<uint32_t> commandBases;
+	std::vector<GLsizei>  drawCounts;
+
+	/* 1 for each cluster of the group being culled */
+	std::vector<uint8_t>  clusterVisible;
+
+	std::vector<DrawElementsIndirectCommand> commands;
+
+	GLuint   indirectBuffer;
+	uint32_t visibleTriangles;
+};
@@ -0,0 +1,376 @@
+#include "TopazCulling.h"
+#include <algorithm>
+#include <cfloat>
+
+TopazBVH::TopazBVH() : nodeCount(0), transformIncarnation(0)
+{
+}
+
+void TopazBVH::update(const TopazScene& scene)
+{
+	if (scene.getNodeCount() != nodeCount || nodes.empty())
+	{
+		nodeCount = scene.getNodeCount();
+		nodes.clear();
+
+		order.resize(nodeCount);
+		for (uint32_t node = 0; node < nodeCount; node++)
+		{
+			order[node] = node;
+		}
+
+		if (nodeCount == 0)
+		{
+			return;
+		}
+
+		// the root is always an inner node, even for a single scene node
+		build(scene, 0, nodeCount);
+	}
+	else if (scene.getTransformIncarnation() == transformIncarnation)
+	{
+		return;
+	}
+
+	refit(scene);
+	transformIncarnation = scene.getTransformIncarnation();
+}
+
+uint32_t TopazBVH::split(const TopazScene& scene, uint32_t begin, uint32_t end)
+{
+	const std::vector<nv::vec3f>& boundsMin = scene.getWorldBoundsMin();
+	const std::vector<nv::vec3f>& boundsMax = scene.getWorldBoundsMax();
+
+	// box centers are compared doubled, min + max, which orders them the same
+	nv::vec3f centerMin(FLT_MAX), centerMax(-FLT_MAX);
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const nv::vec3f center = boundsMin[order[i]] + boundsMax[order[i]];
+		centerMin = nv::min(centerMin, center);
+		centerMax = nv::max(centerMax, center);
+	}
+
+	const nv::vec3f extent = centerMax - centerMin;
+	const int32_t axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+	const uint32_t middle = begin + (end - begin) / 2;
+	std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+		[&](uint32_t lhs, uint32_t rhs)
+		{
+			return boundsMin[lhs][axis] + boundsMax[lhs][axis] < boundsMin[rhs][axis] + boundsMax[rhs][axis];
+		});
+
+	return middle;
+}
+
+int32_t TopazBVH::build(const TopazScene& scene, uint32_t first, uint32_t count)
+{
+	const int32_t index = int32_t(nodes.size());
+	nodes.push_back(Node());
+
+	// the scene nodes in [groups[i], groups[i + 1]) go below child slot i
+	uint32_t groups[WIDTH + 1];
+	uint32_t groupCount = 0;
+
+	if (count <= WIDTH)
+	{
+		for (uint32_t i = 0; i <= count; i++)
+		{
+			groups[i] = first + i;
+		}
+		groupCount = count;
+	}
+	else
+	{
+		// median split along the widest axis of the box centers, then once more in each half
+		groups[0] = first;
+		groups[4] = first + count;
+		groups[2] = split(scene, groups[0], groups[4]);
+		groups[1] = split(scene, groups[0], groups[2]);
+		groups[3] = split(scene, groups[2], groups[4]);
+		groupCount = WIDTH;
+	}
+
+	for (uint32_t i = 0; i < WIDTH; i++)
+	{
+		int32_t child = EMPTY;
+		if (i < groupCount)
+		{
+			const uint32_t size = groups[i + 1] - groups[i];
+			child = size == 1 ? ~int32_t(order[groups[i]]) : build(scene, groups[i], size);
+		}
+
+		// nodes may have grown while building the child, so the slot is written afterwards
+		nodes[index].children[i] = child;
+	}
+
+	return index;
+}
+
+void TopazBVH::refit(const TopazScene& scene)
+{
+	const std::vector<nv::vec3f>& boundsMin = scene.getWorldBoundsMin();
+	const std::vector<nv::vec3f>& boundsMax = scene.getWorldBoundsMax();
+
+	// inner nodes are created after their parent, so walking backwards refits children first
+	for (size_t index = nodes.size(); index-- > 0;)
+	{
+		Node& node = nodes[index];
+
+		for (int32_t i = 0; i < WIDTH; i++)
+		{
+			nv::vec3f childMin(FLT_MAX), childMax(-FLT_MAX);
+
+			const int32_t child = node.children[i];
+			if (child < 0)
+			{
+				childMin = boundsMin[~child];
+				childMax = boundsMax[~child];
+			}
+			else if (child != EMPTY)
+			{
+				const Node& inner = nodes[child];
+				for (int32_t j = 0; j < WIDTH; j++)
+				{
+					childMin = nv::min(childMin, nv::vec3f(inner.minX[j], inner.minY[j], inner.minZ[j]));
+					childMax = nv::max(childMax, nv::vec3f(inner.maxX[j], inner.maxY[j], inner.maxZ[j]));
+				}
+			}
+
+			node.minX[i] = childMin.x;
+			node.minY[i] = childMin.y;
+			node.minZ[i] = childMin.z;
+			node.maxX[i] = childMax.x;
+			node.maxY[i] = childMax.y;
+			node.maxZ[i] = childMax.z;
+		}
+	}
+}
+
+void TopazBVH::testNode(const Node& node, const Frustum& frustum, int32_t& outside, int32_t& inside)
+{
+#ifdef NV_MATH_SSE
+	const __m128 minX = _mm_loadu_ps(node.minX);
+	const __m128 minY = _mm_loadu_ps(node.minY);
+	const __m128 minZ = _mm_loadu_ps(node.minZ);
+	const __m128 maxX = _mm_loadu_ps(node.maxX);
+	const __m128 maxY = _mm_loadu_ps(node.maxY);
+	const __m128 maxZ = _mm_loadu_ps(node.maxZ);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 isOutside = zero;
+	__m128 isCrossing = zero;
+
+	for (int32_t p = 0; p < 6; p++)
+	{
+		const __m128 a = _mm_set1_ps(frustum.a[p]);
+		const __m128 b = _mm_set1_ps(frustum.b[p]);
+		const __m128 c = _mm_set1_ps(frustum.c[p]);
+		const __m128 d = _mm_set1_ps(frustum.d[p]);
+
+		const __m128 x0 = _mm_mul_ps(a, minX), x1 = _mm_mul_ps(a, maxX);
+		const __m128 y0 = _mm_mul_ps(b, minY), y1 = _mm_mul_ps(b, maxY);
+		const __m128 z0 = _mm_mul_ps(c, minZ), z1 = _mm_mul_ps(c, maxZ);
+
+		// distances of the box corners farthest along and against the plane normal
+		const __m128 farthest = _mm_add_ps(_mm_add_ps(d, _mm_max_ps(x0, x1)), _mm_add_ps(_mm_max_ps(y0, y1), _mm_max_ps(z0, z1)));
+		const __m128 nearest = _mm_add_ps(_mm_add_ps(d, _mm_min_ps(x0, x1)), _mm_add_ps(_mm_min_ps(y0, y1), _mm_min_ps(z0, z1)));
+
+		isOutside = _mm_or_ps(isOutside, _mm_cmplt_ps(farthest, zero));
+		isCrossing = _mm_or_ps(isCrossing, _mm_cmplt_ps(nearest, zero));
+	}
+
+	outside = _mm_movemask_ps(isOutside);
+	inside = ~_mm_movemask_ps(isCrossing) & 0xf;
+#else
+	outside = 0;
+	inside = 0xf;
+
+	for (int32_t i = 0; i < WIDTH; i++)
+	{
+		for (int32_t p = 0; p < 6; p++)
+		{
+			const float x0 = frustum.a[p] * node.minX[i], x1 = frustum.a[p] * node.maxX[i];
+			const float y0 = frustum.b[p] * node.minY[i], y1 = frustum.b[p] * node.maxY[i];
+			const float z0 = frustum.c[p] * node.minZ[i], z1 = frustum.c[p] * node.maxZ[i];
+
+			const float farthest = frustum.d[p] + (x0 > x1 ? x0 : x1) + (y0 > y1 ? y0 : y1) + (z0 > z1 ? z0 : z1);
+			const float nearest = frustum.d[p] + (x0 < x1 ? x0 : x1) + (y0 < y1 ? y0 : y1) + (z0 < z1 ? z0 : z1);
+
+			if (farthest < 0.0f)
+			{
+				outside |= 1 << i;
+			}
+			if (nearest < 0.0f)
+			{
+				inside &= ~(1 << i);
+			}
+		}
+	}
+#endif
+}
+
+void TopazBVH::markSubtree(int32_t child, std::vector<uint8_t>& visible) const
+{
+	if (child < 0)
+	{
+		visible[~child] = 1;
+		return;
+	}
+
+	for (int32_t i = 0; i < WIDTH; i++)
+	{
+		if (nodes[child].children[i] != EMPTY)
+		{
+			markSubtree(nodes[child].children[i], visible);
+		}
+	}
+}
+
+void TopazBVH::cull(const nv::matrix4f& viewProjection, std::vector<uint8_t>& visible) const
+{
+	visible.assign(nodeCount, 0);
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	// clip-space planes -w <= x, y, z <= w, as rows of the matrix (Gribb/Hartmann)
+	Frustum frustum;
+	for (int32_t p = 0; p < 6; p++)
+	{
+		const int32_t row = p / 2;
+		const float sign = (p & 1) ? -1.0f : 1.0f;
+
+		frustum.a[p] = viewProjection(3, 0) + sign * viewProjection(row, 0);
+		frustum.b[p] = viewProjection(3, 1) + sign * viewProjection(row, 1);
+		frustum.c[p] = viewProjection(3, 2) + sign * viewProjection(row, 2);
+		frustum.d[p] = viewProjection(3, 3) + sign * viewProjection(row, 3);
+	}
+
+	// each level pushes at most WIDTH - 1 siblings beyond the one popped next
+	int32_t stack[256];
+	int32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+
+		int32_t outside, inside;
+		testNode(node, frustum, outside, inside);
+
+		for (int32_t i = 0; i < WIDTH; i++)
+		{
+			const int32_t child = node.children[i];
+			if (child == EMPTY || (outside & (1 << i)))
+			{
+				continue;
+			}
+
+			if (child < 0 || (inside & (1 << i)))
+			{
+				// fully inside: nothing below needs another test
+				markSubtree(child, visible);
+			}
+			else
+			{
+				assert(stackSize < 256);
+				stack[stackSize++] = child;
+			}
+		}
+	}
+}
+
+TopazCulledSequence::TopazCulledSequence()
+{
+	clear();
+}
+
+void TopazCulledSequence::clear()
+{
+	ranges.clear();
+	segments.clear();
+	streamEnd = 0;
+}
+
+void TopazCulledSequence::addRange(size_t begin, size_t end, uint32_t node)
+{
+	// tokens between the tagged ranges belong to the segment as a whole
+	if (begin > streamEnd)
+	{
+		Range always = { streamEnd, begin, TopazScene::INVALID_ID };
+		ranges.push_back(always);
+	}
+
+	if (end > begin)
+	{
+		Range range = { begin, end, node };
+		ranges.push_back(range);
+	}
+
+	streamEnd = end;
+}
+
+void TopazCulledSequence::addNodeRange(size_t begin, size_t end, uint32_t node)
+{
+	addRange(begin, end, node);
+}
+
+void TopazCulledSequence::endSegment(size_t end, GLuint fbo, GLuint state)
+{
+	addRange(end, end, TopazScene::INVALID_ID);
+
+	Segment segment;
+	segment.firstRange = segments.empty() ? 0 : segments.back().endRange;
+	segment.endRange = ranges.size();
+	segment.fbo = fbo;
+	segment.state = state;
+	segments.push_back(segment);
+}
+
+void TopazCulledSequence::build(nvtoken::NVTokenSequence& sequence, const std::vector<uint8_t>& visible, GLintptr base) const
+{
+	sequence.offsets.clear();
+	sequence.sizes.clear();
+	sequence.fbos.clear();
+	sequence.states.clear();
+
+	for (size_t s = 0; s < segments.size(); s++)
+	{
+		const Segment& segment = segments[s];
+
+		bool   open = false;
+		size_t runBegin = 0;
+		size_t runEnd = 0;
+
+		for (size_t r = segment.firstRange; r <= segment.endRange; r++)
+		{
+			// one pass beyond the last range flushes the open run
+			const bool last = r == segment.endRange;
+			const bool kept = !last && (ranges[r].node == TopazScene::INVALID_ID || visible[ranges[r].node]);
+
+			if (kept && open && ranges[r].begin == runEnd)
+			{
+				runEnd = ranges[r].end;
+				continue;
+			}
+
+			if (open)
+			{
+				sequence.offsets.push_back(base + GLintptr(runBegin));
+				sequence.sizes.push_back(GLsizei(runEnd - runBegin));
+				sequence.fbos.push_back(segment.fbo);
+				sequence.states.push_back(segment.state);
+			}
+
+			open = kept;
+			if (kept)
+			{
+				runBegin = ranges[r].begin;
+				runEnd = ranges[r].end;
+			}
+		}
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "includeAll.h"
+#include "TopazScene.h"
+
+/*
+	Four-wide bounding volume hierarchy over the world bounds of the scene
+	nodes.  Each BVH node keeps the boxes of its four children side by side
+	(minX[0..3], minY[0..3], ...), so one frustum test checks all four
+	children at once with SSE.
+*/
+class TopazBVH
+{
+public:
+	TopazBVH();
+
+	/* rebuilds the hierarchy when nodes were added, refits it when they moved */
+	void update(const TopazScene& scene);
+
+	/*
+		visible[node] becomes 1 for every scene node whose world box is not
+		completely outside the frustum of viewProjection, 0 for the others.
+		Boxes are in world space, so viewProjection maps world to clip space.
+	*/
+	void cull(const nv::matrix4f& viewProjection, std::vector<uint8_t>& visible) const;
+
+private:
+	enum
+	{
+		WIDTH = 4,
+		EMPTY = 0x7fffffff  // child slot not in use
+	};
+
+	/* children[i] >= 0 is an inner BVH node, ~children[i] a scene node */
+	struct Node
+	{
+		float   minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+		float   maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+		int32_t children[WIDTH];
+	};
+
+	struct Frustum
+	{
+		/* plane i is a[i] * x + b[i] * y + c[i] * z + d[i] >= 0 inside */
+		float a[6], b[6], c[6], d[6];
+	};
+
+	/* sorts order[begin, end) around its median along the widest axis and returns the median's index */
+	uint32_t split(const TopazScene& scene, uint32_t begin, uint32_t end);
+
+	/* creates the inner node over order[first, first + count) and returns its index */
+	int32_t build(const TopazScene& scene, uint32_t first, uint32_t count);
+	void refit(const TopazScene& scene);
+
+	/* bit i of outside/inside: child i is fully outside one plane / fully inside all planes */
+	static void testNode(const Node& node, const Frustum& frustum, int32_t& outside, int32_t& inside);
+
+	void markSubtree(int32_t child, std::vector<uint8_t>& visible) const;
+
+	std::vector<Node>     nodes;
+
+	/* scene node ids, reordered while building */
+	std::vector<uint32_t> order;
+
+	uint32_t nodeCount;
+	uint32_t transformIncarnation;
+};
+
+/*
+	Token sequence whose token ranges can be tied to scene nodes.  The full
+	stream is recorded once; build() then emits only the ranges of visible
+	nodes, merging neighbouring ranges of one segment into a single entry,
+	so culled draws never reach the command list.
+*/
+class TopazCulledSequence
+{
+public:
+	TopazCulledSequence();
+
+	void clear();
+
+	/* the tokens in [begin, end) of the stream are only drawn while visible[node] is set; node can be any index into visible, such as an instance group */
+	void addNodeRange(size_t begin, size_t end, uint32_t node);
+
+	/* closes the segment at end; untagged tokens in it are always drawn */
+	void endSegment(size_t end, GLuint fbo, GLuint state);
+
+	/* fills sequence with the kept ranges; offsets are relative to base */
+	void build(nvtoken::NVTokenSequence& sequence, const std::vector<uint8_t>& visible, GLintptr base) const;
+
+private:
+	struct Range
+	{
+		size_t   begin;
+		size_t   end;
+		uint32_t node;  // TopazScene::INVALID_ID for ranges that are always drawn
+	};
+
+	struct Segment
+	{
+		size_t firstRange;
+		size_t endRange;
+		GLuint fbo;
+		GLuint state;
+	};
+
+	void addRange(size_t begin, size_t end, uint32_t node);
+
+	std::vector<Range>   ranges;
+	std::vector<Segment> segments;
+
+	/* end of the last range added */
+	size_t streamEnd;
+};
@@ -0,0 +1,190 @@
+#include "TopazInstancing.h"
+
+TopazInstancing::TopazInstancing() : instanceBuffer(0), identityRemapBuffer(0), remapBuffer(0), indirectBuffer(0)
+{
+}
+
+void TopazInstancing::build(const TopazScene& scene)
+{
+	const uint32_t nodeCount = scene.getNodeCount();
+
+	groups.clear();
+	nodeGroups.resize(nodeCount);
+
+	// groups are numbered in the order of their first node
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> groupIds;
+	for (uint32_t node = 0; node < nodeCount; node++)
+	{
+		const std::pair<uint32_t, uint32_t> key(scene.getGeometryId(node), scene.getFlags(node));
+
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t>::iterator found = groupIds.find(key);
+		if (found == groupIds.end())
+		{
+			Group group;
+			group.geometry = key.first;
+			group.flags = key.second;
+			group.firstInstance = 0;
+			group.instanceCount = 0;
+
+			found = groupIds.insert(std::make_pair(key, uint32_t(groups.size()))).first;
+			groups.push_back(group);
+		}
+
+		nodeGroups[node] = found->second;
+		groups[found->second].instanceCount++;
+	}
+
+	uint32_t instanceCount = 0;
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		groups[group].firstInstance = instanceCount;
+		instanceCount += groups[group].instanceCount;
+	}
+
+	// nodes are placed in node order within their group, so a group's first node is its first instance
+	std::vector<uint32_t> filled(groups.size(), 0);
+	instanceNodes.resize(nodeCount);
+	nodeInstances.resize(nodeCount);
+	for (uint32_t node = 0; node < nodeCount; node++)
+	{
+		const uint32_t group = nodeGroups[node];
+		const uint32_t instance = groups[group].firstInstance + filled[group]++;
+
+		instanceNodes[instance] = node;
+		nodeInstances[node] = instance;
+	}
+
+	staging.resize(nodeCount);
+
+	// every instance is drawn until the first compact
+	remap.resize(nodeCount);
+	for (uint32_t instance = 0; instance < nodeCount; instance++)
+	{
+		remap[instance] = instance;
+	}
+
+	commands.resize(groups.size());
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		const TopazScene::Geometry& geometry = scene.getGeometry(groups[group].geometry);
+
+		commands[group].count = geometry.indexCount;
+		commands[group].instanceCount = groups[group].instanceCount;
+		commands[group].firstIndex = 0;
+		commands[group].baseVertex = 0;
+		commands[group].baseInstance = 0;
+	}
+
+	if (instanceBuffer)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		glDeleteBuffers(1, &identityRemapBuffer);
+		glDeleteBuffers(1, &remapBuffer);
+		glDeleteBuffers(1, &indirectBuffer);
+		instanceBuffer = identityRemapBuffer = remapBuffer = indirectBuffer = 0;
+	}
+
+	if (!nodeCount)
+	{
+		return;
+	}
+
+	glGenBuffers(1, &instanceBuffer);
+	glGenBuffers(1, &identityRemapBuffer);
+	glGenBuffers(1, &remapBuffer);
+	glGenBuffers(1, &indirectBuffer);
+
+	glNamedBufferDataEXT(instanceBuffer, staging.size() * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+	glNamedBufferStorageEXT(identityRemapBuffer, remap.size() * sizeof(GLuint), &remap[0], 0);
+	glNamedBufferDataEXT(remapBuffer, remap.size() * sizeof(GLuint), &remap[0], GL_DYNAMIC_DRAW);
+	glNamedBufferDataEXT(indirectBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_DYNAMIC_DRAW);
+
+	CHECK_GL_ERROR();
+}
+
+void TopazInstancing::update(const TopazScene& scene, uint32_t firstNode, uint32_t lastNode)
+{
+	uint32_t firstInstance = ~0u;
+	uint32_t lastInstance = 0;
+
+	for (uint32_t node = firstNode; node <= lastNode; node++)
+	{
+		const uint32_t instance = nodeInstances[node];
+
+		staging[instance].worldMatrix = scene.getWorldMatrix(node);
+		staging[instance].color = scene.getColor(node);
+
+		firstInstance = instance < firstInstance ? instance : firstInstance;
+		lastInstance = instance > lastInstance ? instance : lastInstance;
+	}
+
+	if (firstInstance <= lastInstance)
+	{
+		glNamedBufferSubDataEXT(instanceBuffer, firstInstance * sizeof(InstanceData),
+			(lastInstance - firstInstance + 1) * sizeof(InstanceData), &staging[firstInstance]);
+	}
+}
+
+void TopazInstancing::setIndexRange(uint32_t group, GLuint firstIndex, GLuint count)
+{
+	commands[group].firstIndex = firstIndex;
+	commands[group].count = count;
+
+	glNamedBufferSubDataEXT(indirectBuffer, getIndirectOffset(group), sizeof(DrawElementsIndirectCommand), &commands[group]);
+}
+
+void TopazInstancing::bind(GLuint remapBuffer) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_INSTANCE, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_INSTANCE_REMAP, remapBuffer ? remapBuffer : identityRemapBuffer);
+}
+
+void TopazInstancing::compact(const std::vector<uint8_t>& nodeVisible)
+{
+	bool remapChanged = false;
+	bool commandsChanged = false;
+
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		const Group& instances = groups[group];
+
+		// visible instances fill the range from the front, the others from the back
+		GLuint visible = 0;
+		GLuint hidden = instances.instanceCount;
+		for (uint32_t instance = instances.firstInstance; instance < instances.firstInstance + instances.instanceCount; instance++)
+		{
+			const GLuint slot = instances.firstInstance + (nodeVisible[instanceNodes[instance]] ? visible++ : --hidden);
+			if (remap[slot] != instance)
+			{
+				remap[slot] = instance;
+				remapChanged = true;
+			}
+		}
+
+		if (commands[group].instanceCount != visible)
+		{
+			commands[group].instanceCount = visible;
+			commandsChanged = true;
+		}
+	}
+
+	if (remapChanged)
+	{
+		glNamedBufferSubDataEXT(remapBuffer, 0, remap.size() * sizeof(GLuint), &remap[0]);
+	}
+
+	if (commandsChanged)
+	{
+		glNamedBufferSubDataEXT(indirectBuffer, 0, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0]);
+	}
+}
+
+void TopazInstancing::getVisibleGroups(const std::vector<uint8_t>& nodeVisible, std::vector<uint8_t>& groupVisible) const
+{
+	groupVisible.assign(groups.size(), 0);
+
+	for (size_t node = 0; node < nodeGroups.size(); node++)
+	{
+		groupVisible[nodeGroups[node]] |= nodeVisible[node];
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "includeAll.h"
+#include "TopazScene.h"
+
+/*
+	Groups the scene nodes that draw the same geometry with the same flags,
+	so each group is one instanced draw.  Per-node transforms and colors live
+	in an instance storage buffer (SSBO_INSTANCE), ordered group by group;
+	instance k of a group's draw reads instances[remap[firstInstance + k]],
+	where remap (SSBO_INSTANCE_REMAP) is the identity unless a culling pass
+	has packed the visible instances of each group to its front: compact on
+	the CPU, or TopazOcclusion::cull on the GPU.
+
+	The first node of a group is its first instance, so that node's ObjectData
+	(instanceBase = firstInstance) serves the whole group's draw.
+*/
+class TopazInstancing
+{
+public:
+	struct Group
+	{
+		uint32_t geometry;
+		uint32_t flags;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	/* std430 layout of InstanceData in shaders/uniforms.glsl */
+	struct InstanceData
+	{
+		nv::matrix4f worldMatrix;
+		nv::vec4f    color;
+	};
+
+	TopazInstancing();
+
+	/* groups the nodes of scene and (re)creates the instance, remap and indirect buffers */
+	void build(const TopazScene& scene);
+
+	/* uploads the instances of the nodes in [firstNode, lastNode] */
+	void update(const TopazScene& scene, uint32_t firstNode, uint32_t lastNode);
+
+	/* changes the index range the indirect draw of group uses, to switch its level of detail */
+	void setIndexRange(uint32_t group, GLuint firstIndex, GLuint count);
+
+	/* binds the instance buffer and remapBuffer, or the identity remap when it is 0 */
+	void bind(GLuint remapBuffer = 0) const;
+
+	/*
+		packs the instances of the nodes set in nodeVisible to the front of their
+		group's range of the compacted remap buffer, and has each group's indirect
+		draw draw only those; buffers are only uploaded when the result changes
+	*/
+	void compact(const std::vector<uint8_t>& nodeVisible);
+
+	/* the remap written by compact, for bind */
+	GLuint getRemapBuffer() const
+	{
+		return remapBuffer;
+	}
+
+	/* the instances the indirect draw of group draws since the last compact */
+	uint32_t getVisibleInstanceCount(uint32_t group) const
+	{
+		return commands[group].instanceCount;
+	}
+
+	/* groupVisible[group] becomes 1 where any of the group's nodes is visible */
+	void getVisibleGroups(const std::vector<uint8_t>& nodeVisible, std::vector<uint8_t>& groupVisible) const;
+
+	uint32_t getGroupCount() const
+	{
+		return uint32_t(groups.size());
+	}
+
+	const Group& getGroup(uint32_t group) const
+	{
+		return groups[group];
+	}
+
+	uint32_t getInstanceCount() const
+	{
+		return uint32_t(instanceNodes.size());
+	}
+
+	/* the node of instance, and the instance and group of node */
+	uint32_t getInstanceNode(uint32_t instance) const
+	{
+		return instanceNodes[instance];
+	}
+
+	uint32_t getNodeInstance(uint32_t node) const
+	{
+		return nodeInstances[node];
+	}
+
+	uint32_t getNodeGroup(uint32_t node) const
+	{
+		return nodeGroups[node];
+	}
+
+	/* one DrawElementsIndirectCommand per group, drawing every instance */
+	GLuint getIndirectBuffer() const
+	{
+		return indirectBuffer;
+	}
+
+	static GLintptr getIndirectOffset(uint32_t group)
+	{
+		return GLintptr(group * sizeof(DrawElementsIndirectCommand));
+	}
+
+private:
+	/* the GL layout of glDrawElementsIndirect parameters */
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLuint baseVertex;
+		GLuint baseInstance;
+	};
+
+	std::vector<Group>    groups;
+
+	/* instance -> node, grouped; node -> instance and node -> group */
+	std::vector<uint32_t> instanceNodes;
+	std::vector<uint32_t> nodeInstances;
+	std::vector<uint32_t> nodeGroups;
+
+	/* CPU copies of the instance buffer, the compacted remap and the indirect buffer */
+	std::vector<InstanceData> staging;
+	std::vector<GLuint> remap;
+	std::vector<DrawElementsIndirectCommand> commands;
+
+	GLuint instanceBuffer;
+	GLuint identityRemapBuffer;
+	GLuint remapBuffer;
+	GLuint indirectBuffer;
+};
@@ -0,0 +1,394 @@
+#include "TopazOcclusion.h"
+#include <cmath>
+#include <algorithm>
+
+TopazOcclusion::TopazOcclusion() : hizBuildProgram(nullptr), cullProgram(nullptr), hizTexture(0), hizLevels(0), hizValid(false),
+	depthWidth(0), depthHeight(0), objectBuffer(0), groupBuffer(0), countBuffer(0), remapBuffer(0), nopHeader(0), transformIncarnation(0), boundsDirty(false)
+{
+}
+
+void TopazOcclusion::init(NvGLSLProgram* hizBuildProgram, NvGLSLProgram* cullProgram)
+{
+	this->hizBuildProgram = hizBuildProgram;
+	this->cullProgram = cullProgram;
+
+	if (!objectBuffer)
+	{
+		glGenBuffers(1, &objectBuffer);
+		glGenBuffers(1, &groupBuffer);
+		glGenBuffers(1, &countBuffer);
+		glGenBuffers(1, &remapBuffer);
+	}
+}
+
+void TopazOcclusion::deletePyramid()
+{
+	if (hizTexture)
+	{
+		glDeleteTextures(1, &hizTexture);
+		hizTexture = 0;
+	}
+
+	hizLevels = 0;
+	hizValid = false;
+
+	hizLevelData.clear();
+	hizLevelWidths.clear();
+	hizLevelHeights.clear();
+}
+
+void TopazOcclusion::resize(int32_t width, int32_t height)
+{
+	deletePyramid();
+
+	depthWidth = width;
+	depthHeight = height;
+
+	// level 0 is the depth buffer halved, rounding down like every level after it
+	int32_t levelWidth = width / 2 > 1 ? width / 2 : 1;
+	int32_t levelHeight = height / 2 > 1 ? height / 2 : 1;
+
+	for (;;)
+	{
+		hizLevelWidths.push_back(levelWidth);
+		hizLevelHeights.push_back(levelHeight);
+		hizLevels++;
+
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+
+		levelWidth = levelWidth / 2 > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight / 2 > 1 ? levelHeight / 2 : 1;
+	}
+
+	glGenTextures(1, &hizTexture);
+	glBindTexture(GL_TEXTURE_2D, hizTexture);
+
+	glTexStorage2D(GL_TEXTURE_2D, hizLevels, GL_R32F, hizLevelWidths[0], hizLevelHeights[0]);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	CHECK_GL_ERROR();
+}
+
+void TopazOcclusion::setDraws(const TopazScene& scene, const TopazInstancing& instancing, const std::string& tokenData, const std::vector<GLuint>& drawTokenOffsets)
+{
+	nopHeader = nvtoken::NVTokenNop().cmd.header;
+
+	groups.resize(instancing.getGroupCount());
+
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
+	{
+		// the token enqueueGroupDraw wrote, so a fully visible group comes back unchanged
+		const nvtoken::NVTokenDrawElemsInstanced& draw = *reinterpret_cast<const nvtoken::NVTokenDrawElemsInstanced*>(&tokenData[drawTokenOffsets[group]]);
+
+		CullGroup& cullGroup = groups[group];
+		cullGroup.tokenOffset = drawTokenOffsets[group] / sizeof(GLuint);
+		cullGroup.drawHeader = draw.cmd.header;
+		cullGroup.mode = draw.cmd.mode;
+		cullGroup.count = draw.cmd.count;
+		cullGroup.firstIndex = draw.cmd.firstIndex;
+		cullGroup.firstInstance = instancing.getGroup(group).firstInstance;
+	}
+
+	objects.resize(instancing.getInstanceCount());
+	objectNodes.resize(instancing.getInstanceCount());
+
+	for (uint32_t instance = 0; instance < instancing.getInstanceCount(); instance++)
+	{
+		const uint32_t node = instancing.getInstanceNode(instance);
+
+		objectNodes[instance] = node;
+		objects[instance].group = instancing.getNodeGroup(node);
+		objects[instance]._pad[0] = objects[instance]._pad[1] = objects[instance]._pad[2] = 0;
+	}
+
+	glNamedBufferDataEXT(objectBuffer, objects.size() * sizeof(CullObject), nullptr, GL_DYNAMIC_DRAW);
+	glNamedBufferDataEXT(groupBuffer, groups.size() * sizeof(CullGroup), groups.empty() ? nullptr : &groups[0], GL_STATIC_DRAW);
+	glNamedBufferDataEXT(countBuffer, groups.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glNamedBufferDataEXT(remapBuffer, objects.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+	boundsDirty = true;
+	updateBounds(scene);
+}
+
+void TopazOcclusion::setIndexRange(uint32_t group, GLuint firstIndex, GLuint count)
+{
+	groups[group].firstIndex = firstIndex;
+	groups[group].count = count;
+
+	glNamedBufferSubDataEXT(groupBuffer, group * sizeof(CullGroup), sizeof(CullGroup), &groups[group]);
+}
+
+void TopazOcclusion::updateBounds(const TopazScene& scene)
+{
+	if (!boundsDirty && scene.getTransformIncarnation() == transformIncarnation)
+	{
+		return;
+	}
+
+	const std::vector<nv::vec3f>& boundsMin = scene.getWorldBoundsMin();
+	const std::vector<nv::vec3f>& boundsMax = scene.getWorldBoundsMax();
+
+	for (size_t instance = 0; instance < objects.size(); instance++)
+	{
+		objects[instance].boundsMin = nv::vec4f(boundsMin[objectNodes[instance]], 1.0f);
+		objects[instance].boundsMax = nv::vec4f(boundsMax[objectNodes[instance]], 1.0f);
+	}
+
+	if (!objects.empty())
+	{
+		glNamedBufferSubDataEXT(objectBuffer, 0, objects.size() * sizeof(CullObject), &objects[0]);
+	}
+
+	transformIncarnation = scene.getTransformIncarnation();
+	boundsDirty = false;
+}
+
+void TopazOcclusion::buildHiZ(GLuint depthTexture)
+{
+	if (!hizTexture)
+	{
+		return;
+	}
+
+	hizBuildProgram->enable();
+	hizBuildProgram->bindTextureRect("sceneDepth", 0, depthTexture);
+	hizBuildProgram->bindTexture2D("hizSource", 1, hizTexture);
+
+	int32_t sourceWidth = depthWidth;
+	int32_t sourceHeight = depthHeight;
+
+	for (int32_t level = 0; level < hizLevels; level++)
+	{
+		const int32_t targetWidth = hizLevelWidths[level];
+		const int32_t targetHeight = hizLevelHeights[level];
+
+		hizBuildProgram->setUniform1i("sourceLevel", level - 1);
+		hizBuildProgram->setUniform2i("sourceSize", sourceWidth, sourceHeight);
+		hizBuildProgram->setUniform2i("targetSize", targetWidth, targetHeight);
+
+		glBindImageTexture(0, hizTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((targetWidth + 7) / 8, (targetHeight + 7) / 8, 1);
+
+		// the next level reads this one
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+
+	hizBuildProgram->disable();
+
+	hizValid = true;
+
+	CHECK_GL_ERROR();
+}
+
+void TopazOcclusion::cull(const nv::matrix4f& viewProjection, GLuint tokenBuffer)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+
+	nv::matrix4f matrix = viewProjection;
+
+	const GLuint zero = 0;
+	glClearNamedBufferDataEXT(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	cullProgram->enable();
+	cullProgram->setUniformMatrix4fv("viewProjection", matrix._array);
+	glUniform1ui(cullProgram->getUniformLocation("objectCount"), GLuint(objects.size()));
+	glUniform1ui(cullProgram->getUniformLocation("groupCount"), GLuint(groups.size()));
+	glUniform1ui(cullProgram->getUniformLocation("nopHeader"), nopHeader);
+	cullProgram->bindTexture2D("hiz", 0, hizTexture);
+	cullProgram->setUniform1i("hizLevels", hizValid ? hizLevels : 0);
+	cullProgram->setUniform2f("depthSize", float(depthWidth), float(depthHeight));
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tokenBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, groupBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, remapBuffer);
+
+	// pass 0 tests the instances and packs the visible ones, pass 1 writes the group tokens
+	cullProgram->setUniform1i("pass", 0);
+	glDispatchCompute(GLuint((objects.size() + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	cullProgram->setUniform1i("pass", 1);
+	glDispatchCompute(GLuint((groups.size() + 63) / 64), 1, 1);
+
+	// the command processor reads the tokens, the vertex shaders the remap, and the next clear follows the counts
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	for (GLuint binding = 0; binding < 5; binding++)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	cullProgram->disable();
+
+	CHECK_GL_ERROR();
+}
+
+bool TopazOcclusion::isVisible(const CullObject& object, const nv::matrix4f& viewProjection) const
+{
+	nv::vec3f ndcMin(1e30f), ndcMax(-1e30f);
+
+	for (int32_t i = 0; i < 8; i++)
+	{
+		const nv::vec4f corner((i & 1) ? object.boundsMax.x : object.boundsMin.x,
+		                       (i & 2) ? object.boundsMax.y : object.boundsMin.y,
+		                       (i & 4) ? object.boundsMax.z : object.boundsMin.z, 1.0f);
+
+		const nv::vec4f clip = viewProjection * corner;
+
+		// a corner behind the eye has no screen position; keep the object
+		if (clip.w <= 0.0f)
+		{
+			return true;
+		}
+
+		const nv::vec3f ndc = nv::vec3f(clip) / clip.w;
+		ndcMin = nv::min(ndcMin, ndc);
+		ndcMax = nv::max(ndcMax, ndc);
+	}
+
+	for (int32_t i = 0; i < 3; i++)
+	{
+		if (ndcMax[i] < -1.0f || ndcMin[i] > 1.0f)
+		{
+			return false;
+		}
+	}
+
+	if (!hizValid || ndcMin.z < -1.0f)
+	{
+		return true;
+	}
+
+	float rectMin[2], rectMax[2];
+	const float depthSize[2] = { float(depthWidth), float(depthHeight) };
+	for (int32_t i = 0; i < 2; i++)
+	{
+		rectMin[i] = (ndcMin[i] * 0.5f + 0.5f) * depthSize[i];
+		rectMax[i] = (ndcMax[i] * 0.5f + 0.5f) * depthSize[i];
+		rectMin[i] = rectMin[i] < 0.0f ? 0.0f : (rectMin[i] > depthSize[i] - 1.0f ? depthSize[i] - 1.0f : rectMin[i]);
+		rectMax[i] = rectMax[i] < 0.0f ? 0.0f : (rectMax[i] > depthSize[i] - 1.0f ? depthSize[i] - 1.0f : rectMax[i]);
+	}
+	const float nearest = ndcMin.z * 0.5f + 0.5f;
+
+	// the level at which the rectangle spans at most 2x2 texels
+	float extent = 0.5f * ((rectMax[0] - rectMin[0]) > (rectMax[1] - rectMin[1]) ? (rectMax[0] - rectMin[0]) : (rectMax[1] - rectMin[1]));
+	int32_t level = int32_t(ceilf(log2f(extent > 1.0f ? extent : 1.0f)));
+	level = level < 0 ? 0 : (level > hizLevels - 1 ? hizLevels - 1 : level);
+
+	const int32_t width = hizLevelWidths[level];
+	const int32_t height = hizLevelHeights[level];
+	const std::vector<float>& data = hizLevelData[level];
+
+	int32_t x0 = int32_t(rectMin[0]) >> (level + 1), y0 = int32_t(rectMin[1]) >> (level + 1);
+	int32_t x1 = int32_t(rectMax[0]) >> (level + 1), y1 = int32_t(rectMax[1]) >> (level + 1);
+	x0 = x0 < width - 1 ? x0 : width - 1;
+	x1 = x1 < width - 1 ? x1 : width - 1;
+	y0 = y0 < height - 1 ? y0 : height - 1;
+	y1 = y1 < height - 1 ? y1 : height - 1;
+
+	float farthest = data[y0 * width + x0];
+	farthest = data[y0 * width + x1] > farthest ? data[y0 * width + x1] : farthest;
+	farthest = data[y1 * width + x0] > farthest ? data[y1 * width + x0] : farthest;
+	farthest = data[y1 * width + x1] > farthest ? data[y1 * width + x1] : farthest;
+
+	return nearest <= farthest;
+}
+
+void TopazOcclusion::cullSW(const nv::matrix4f& viewProjection, std::vector<uint8_t>& visible)
+{
+	if (hizValid)
+	{
+		// the pyramid was written with image stores
+		glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+		hizLevelData.resize(hizLevels);
+		for (int32_t level = 0; level < hizLevels; level++)
+		{
+			hizLevelData[level].resize(hizLevelWidths[level] * hizLevelHeights[level]);
+			glGetTextureImageEXT(hizTexture, GL_TEXTURE_2D, level, GL_RED, GL_FLOAT, &hizLevelData[level][0]);
+		}
+	}
+
+	visible.resize(objects.size());
+	for (size_t instance = 0; instance < objects.size(); instance++)
+	{
+		visible[objectNodes[instance]] = isVisible(objects[instance], viewProjection) ? 1 : 0;
+	}
+}
+
+void TopazOcclusion::validate(const nv::matrix4f& viewProjection, GLuint tokenBuffer)
+{
+	std::vector<uint8_t> visible;
+	cullSW(viewProjection, visible);
+
+	GLint size = 0;
+	glGetNamedBufferParameterivEXT(tokenBuffer, GL_BUFFER_SIZE, &size);
+
+	std::vector<GLuint> tokens(size / sizeof(GLuint));
+	std::vector<GLuint> counts(groups.size());
+	std::vector<GLuint> remap(objects.size());
+	glGetNamedBufferSubDataEXT(tokenBuffer, 0, tokens.size() * sizeof(GLuint), &tokens[0]);
+	glGetNamedBufferSubDataEXT(countBuffer, 0, counts.size() * sizeof(GLuint), &counts[0]);
+	glGetNamedBufferSubDataEXT(remapBuffer, 0, remap.size() * sizeof(GLuint), &remap[0]);
+
+	int32_t visibleCount = 0;
+	int32_t mismatches = 0;
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		const CullGroup& cullGroup = groups[group];
+
+		// the instances cull kept, in whatever order the atomics handed out the slots
+		const GLuint* packed = &remap[cullGroup.firstInstance];
+		std::vector<GLuint> kept(packed, packed + counts[group]);
+		std::sort(kept.begin(), kept.end());
+
+		std::vector<GLuint> expected;
+		for (size_t instance = cullGroup.firstInstance; instance < objects.size() && objects[instance].group == group; instance++)
+		{
+			if (visible[objectNodes[instance]])
+			{
+				expected.push_back(GLuint(instance));
+			}
+		}
+
+		// DrawElementsInstancedCommandNV: header, mode, count, instanceCount, ...
+		const GLuint* token = &tokens[cullGroup.tokenOffset];
+		const GLuint drawnCount = token[0] == nopHeader ? 0 : token[3];
+
+		visibleCount += int32_t(drawnCount);
+		if (kept != expected || drawnCount != counts[group])
+		{
+			mismatches++;
+		}
+	}
+
+	// isolated differences come from boxes that touch a texel or plane boundary, where GPU and CPU round differently
+	if (mismatches)
+	{
+		LOGE("occlusion culling: %d of %d instance groups differ from the CPU reference (%d instances drawn)", mismatches, int32_t(groups.size()), visibleCount);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "includeAll.h"
+#include "TopazScene.h"
+#include "TopazInstancing.h"
+
+/*
+	GPU occlusion culling that writes the token stream itself.
+
+	After a frame is drawn, buildHiZ reduces its depth buffer into a max-depth
+	pyramid.  Next frame, cull runs one compute thread per instance: the
+	instance's world box is projected with the new view-projection and tested
+	against the frustum and against the pyramid texels under its screen
+	rectangle.  Visible instances are packed to the front of their group's
+	range in the remap buffer, and a second pass rewrites each group's
+	instanced draw token with the number of visible instances, or as NOPs when
+	there are none.  The token buffer can then be submitted with
+	glDrawCommandsStatesAddressNV without the CPU ever looking at the result.
+
+	The pyramid is one frame old, and nothing tests it again once the frame is
+	drawn: an instance that the previous frame's depth hides, but the current
+	view reveals, is skipped for one frame and pops in on the next.  A second
+	test against this frame's depth would close the gap, at the cost of another
+	cull pass and draw per frame.
+
+	cullSW runs the same test on a CPU copy of the pyramid; it stands in for
+	the compute pass without NV_command_list and checks it with -validateocclusion.
+*/
+class TopazOcclusion
+{
+public:
+	TopazOcclusion();
+
+	/* the programs built from shaders/hizBuild.glsl and shaders/occlusionCull.glsl */
+	void init(NvGLSLProgram* hizBuildProgram, NvGLSLProgram* cullProgram);
+
+	/* (re)creates the pyramid for a depth buffer of the given size */
+	void resize(int32_t width, int32_t height);
+
+	/* records the instanced draw token of each group; drawTokenOffsets[group] is a byte offset into tokenData */
+	void setDraws(const TopazScene& scene, const TopazInstancing& instancing, const std::string& tokenData, const std::vector<GLuint>& drawTokenOffsets);
+
+	/* changes the index range written into the draw token of group, to switch its level of detail */
+	void setIndexRange(uint32_t group, GLuint firstIndex, GLuint count);
+
+	/* uploads the world boxes of instances that moved */
+	void updateBounds(const TopazScene& scene);
+
+	/* reduces the depth texture, a GL_TEXTURE_RECTANGLE, into the pyramid */
+	void buildHiZ(GLuint depthTexture);
+
+	/* until the next buildHiZ, nothing is occluded, only frustum culled */
+	void invalidate()
+	{
+		hizValid = false;
+	}
+
+	/* fills the remap buffer and rewrites every recorded draw token in tokenBuffer */
+	void cull(const nv::matrix4f& viewProjection, GLuint tokenBuffer);
+
+	/* the instance remap written by cull, for SSBO_INSTANCE_REMAP */
+	GLuint getRemapBuffer() const
+	{
+		return remapBuffer;
+	}
+
+	/* the CPU version of cull: visible[node] is 1 where cull keeps the instance; reads the pyramid back */
+	void cullSW(const nv::matrix4f& viewProjection, std::vector<uint8_t>& visible);
+
+	/* compares the instances cull kept in the remap buffer and tokenBuffer with cullSW and logs the differences */
+	void validate(const nv::matrix4f& viewProjection, GLuint tokenBuffer);
+
+private:
+	/* std430 layouts of CullObject and CullGroup in occlusionCull.glsl */
+	struct CullObject
+	{
+		nv::vec4f boundsMin;
+		nv::vec4f boundsMax;
+		GLuint    group;
+		GLuint    _pad[3];
+	};
+
+	struct CullGroup
+	{
+		GLuint tokenOffset;  // in 32-bit words
+		GLuint drawHeader;
+		GLuint mode;
+		GLuint count;
+		GLuint firstIndex;
+		GLuint firstInstance;
+	};
+
+	bool isVisible(const CullObject& object, const nv::matrix4f& viewProjection) const;
+
+	void deletePyramid();
+
+	NvGLSLProgram* hizBuildProgram;
+	NvGLSLProgram* cullProgram;
+
+	GLuint  hizTexture;
+	int32_t hizLevels;
+	bool    hizValid;
+
+	/* size of the depth buffer the pyramid reduces */
+	int32_t depthWidth;
+	int32_t depthHeight;
+
+	/* one object per instance, in instance order */
+	std::vector<CullObject> objects;
+	std::vector<uint32_t>   objectNodes;
+	std::vector<CullGroup>  groups;
+
+	GLuint   objectBuffer;
+	GLuint   groupBuffer;
+
+	/* visible instances per group, and the visible instances packed per group */
+	GLuint   countBuffer;
+	GLuint   remapBuffer;
+	GLuint   nopHeader;
+	uint32_t transformIncarnation;
+	bool     boundsDirty;
+
+	/* CPU copy of the pyramid for cullSW, level by level */
+	std::vector<std::vector<float> > hizLevelData;
+	std::vector<int32_t>             hizLevelWidths;
+	std::vector<int32_t>             hizLevelHeights;
+};
@@ -0,0 +1,195 @@
+#include "TopazScene.h"
+
+const uint32_t TopazScene::INVALID_ID;
+
+TopazScene::TopazScene() : transformIncarnation(0)
+{
+	clear();
+}
+
+void TopazScene::clear()
+{
+	geometries.clear();
+
+	parents.clear();
+	firstChildren.clear();
+	nextSiblings.clear();
+	geometryIds.clear();
+	flags.clear();
+	localMatrices.clear();
+	worldMatrices.clear();
+	worldBoundsMin.clear();
+	worldBoundsMax.clear();
+	colors.clear();
+	transformDirty.clear();
+
+	firstTransformDirty = INVALID_ID;
+	firstDirty = INVALID_ID;
+	lastDirty = INVALID_ID;
+}
+
+uint32_t TopazScene::addGeometry(const Geometry& geometry)
+{
+	assert(geometry.lodCount <= MAX_LODS);
+
+	geometries.push_back(geometry);
+
+	Geometry& added = geometries.back();
+	if (added.lodCount == 0)
+	{
+		added.lodCount = 1;
+		added.lodFirstIndex[0] = 0;
+		added.lodIndexCount[0] = added.indexCount;
+		added.lodError[0] = 0.0f;
+	}
+
+	return uint32_t(geometries.size() - 1);
+}
+
+uint32_t TopazScene::addNode(uint32_t parent, uint32_t geometry, const nv::matrix4f& local, const nv::vec4f& color, uint32_t nodeFlags)
+{
+	const uint32_t node = getNodeCount();
+	assert(parent == INVALID_ID || parent < node);
+	assert(geometry < getGeometryCount());
+
+	parents.push_back(parent);
+	firstChildren.push_back(INVALID_ID);
+	nextSiblings.push_back(INVALID_ID);
+	geometryIds.push_back(geometry);
+	flags.push_back(nodeFlags);
+	localMatrices.push_back(local);
+	worldMatrices.push_back(local);
+	worldBoundsMin.push_back(geometries[geometry].boundsMin);
+	worldBoundsMax.push_back(geometries[geometry].boundsMax);
+	colors.push_back(color);
+	transformDirty.push_back(1);
+
+	if (parent != INVALID_ID)
+	{
+		nextSiblings[node] = firstChildren[parent];
+		firstChildren[parent] = node;
+	}
+
+	if (firstTransformDirty == INVALID_ID)
+	{
+		firstTransformDirty = node;
+	}
+
+	return node;
+}
+
+void TopazScene::setLocalMatrix(uint32_t node, const nv::matrix4f& local)
+{
+	localMatrices[node] = local;
+
+	transformDirty[node] = 1;
+	if (firstTransformDirty == INVALID_ID || node < firstTransformDirty)
+	{
+		firstTransformDirty = node;
+	}
+}
+
+void TopazScene::setColor(uint32_t node, const nv::vec4f& color)
+{
+	colors[node] = color;
+	markDirty(node);
+}
+
+void TopazScene::markDirty(uint32_t node)
+{
+	if (firstDirty == INVALID_ID || node < firstDirty)
+	{
+		firstDirty = node;
+	}
+	if (lastDirty == INVALID_ID || node > lastDirty)
+	{
+		lastDirty = node;
+	}
+}
+
+void TopazScene::updateTransforms()
+{
+	if (firstTransformDirty == INVALID_ID)
+	{
+		return;
+	}
+
+	const uint32_t count = getNodeCount();
+
+	// parents come first, so a parent's dirty bit is final by the time its children are reached
+	for (uint32_t node = firstTransformDirty; node < count; node++)
+	{
+		const uint32_t parent = parents[node];
+
+		if (parent != INVALID_ID && transformDirty[parent])
+		{
+			transformDirty[node] = 1;
+		}
+
+		if (!transformDirty[node])
+		{
+			continue;
+		}
+
+		if (parent == INVALID_ID)
+		{
+			worldMatrices[node] = localMatrices[node];
+		}
+		else
+		{
+			nv::matrix4f::multiply(worldMatrices[node], worldMatrices[parent], localMatrices[node]);
+		}
+
+		// world-space box around the transformed local box: the center moves with
+		// the matrix, the half extents with the absolute values of its 3x3 part
+		const Geometry& geometry = geometries[geometryIds[node]];
+		const nv::matrix4f& world = worldMatrices[node];
+		const nv::vec3f center = 0.5f * (geometry.boundsMax + geometry.boundsMin);
+		const nv::vec3f extent = 0.5f * (geometry.boundsMax - geometry.boundsMin);
+
+		nv::vec3f worldCenter, worldExtent;
+		for (int32_t i = 0; i < 3; i++)
+		{
+			worldCenter[i] = world(i, 3);
+			worldExtent[i] = 0.0f;
+			for (int32_t j = 0; j < 3; j++)
+			{
+				worldCenter[i] += world(i, j) * center[j];
+				worldExtent[i] += fabsf(world(i, j)) * extent[j];
+			}
+		}
+
+		worldBoundsMin[node] = worldCenter - worldExtent;
+		worldBoundsMax[node] = worldCenter + worldExtent;
+
+		markDirty(node);
+	}
+
+	std::fill(transformDirty.begin() + firstTransformDirty, transformDirty.end(), 0);
+	firstTransformDirty = INVALID_ID;
+	transformIncarnation++;
+}
+
+bool TopazScene::getDirtyRange(uint32_t& first, uint32_t& last) const
+{
+	first = firstDirty;
+	last = lastDirty;
+	return firstDirty != INVALID_ID;
+}
+
+void TopazScene::markAllDirty()
+{
+	if (getNodeCount() == 0)
+	{
+		return;
+	}
+
+	firstDirty = 0;
+	lastDirty = getNodeCount() - 1;
+}
+
+void TopazScene::clearDirtyRange()
+{
+	firstDirty = INVALID_ID;
+	lastDirty = INVALID_ID;
+}
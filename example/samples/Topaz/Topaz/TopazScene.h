@@ -0,0 +1,183 @@
+#pragma once
+
+#include "includeAll.h"
+
+/*
+	Flat, data-oriented scene.  Every node is one draw of one geometry, and each
+	per-node attribute lives in its own array indexed by node id, so passes that
+	touch one attribute (transforms, bounds, colors) stream through memory.
+
+	A node's parent is always added before the node, so a single front-to-back
+	pass over the arrays propagates transform changes down the hierarchy.
+*/
+class TopazScene
+{
+public:
+	static const uint32_t INVALID_ID = ~0u;
+
+	enum NodeFlags
+	{
+		NODE_TRANSPARENT = 0x1  // drawn by the weighted blended OIT passes
+	};
+
+	enum
+	{
+		MAX_LODS = 4
+	};
+
+	/* GL handles and draw parameters of one vertex/index buffer pair */
+	struct Geometry
+	{
+		Geometry() : positionOffset(0), positionType(GL_FLOAT), positionScale(1.0f, 1.0f, 1.0f), positionBias(0.0f, 0.0f, 0.0f), lodCount(0)
+		{
+		}
+
+		GLuint    vbo;
+		GLuint64  vbo64;
+		GLuint    ibo;
+		GLuint64  ibo64;
+		GLsizei   vertexStride;
+
+		/*
+			byte offset and type of the 3 position components; any type other than
+			GL_FLOAT is normalized, and the shader expands it to model space as
+			positionBias + positionScale * position
+		*/
+		GLuint    positionOffset;
+		GLenum    positionType;
+		nv::vec3f positionScale;
+		nv::vec3f positionBias;
+
+		GLsizei   indexCount;
+		GLenum    mode;
+		nv::vec3f boundsMin;
+		nv::vec3f boundsMax;
+
+		/*
+			index ranges of the levels of detail in ibo, finest first, and their
+			error in model units.  addGeometry fills in level 0 as the whole index
+			range when lodCount is left at 0.
+		*/
+		uint32_t  lodCount;
+		GLuint    lodFirstIndex[MAX_LODS];
+		GLsizei   lodIndexCount[MAX_LODS];
+		float     lodError[MAX_LODS];
+	};
+
+	TopazScene();
+
+	void clear();
+
+	uint32_t addGeometry(const Geometry& geometry);
+
+	/* parent is INVALID_ID for a root node; the local matrix is relative to the parent */
+	uint32_t addNode(uint32_t parent, uint32_t geometry, const nv::matrix4f& local, const nv::vec4f& color, uint32_t flags = 0);
+
+	void setLocalMatrix(uint32_t node, const nv::matrix4f& local);
+	void setColor(uint32_t node, const nv::vec4f& color);
+
+	/* recomputes the world matrices and world bounds of every changed node and its descendants */
+	void updateTransforms();
+
+	/* changes whenever updateTransforms has moved a node's world bounds */
+	uint32_t getTransformIncarnation() const
+	{
+		return transformIncarnation;
+	}
+
+	/* the span of nodes whose world matrix or color changed since the last clearDirtyRange */
+	bool getDirtyRange(uint32_t& first, uint32_t& last) const;
+	void markAllDirty();
+	void clearDirtyRange();
+
+	uint32_t getNodeCount() const
+	{
+		return uint32_t(parents.size());
+	}
+
+	uint32_t getGeometryCount() const
+	{
+		return uint32_t(geometries.size());
+	}
+
+	const Geometry& getGeometry(uint32_t geometry) const
+	{
+		return geometries[geometry];
+	}
+
+	const Geometry& getNodeGeometry(uint32_t node) const
+	{
+		return geometries[geometryIds[node]];
+	}
+
+	uint32_t getGeometryId(uint32_t node) const
+	{
+		return geometryIds[node];
+	}
+
+	uint32_t getParent(uint32_t node) const
+	{
+		return parents[node];
+	}
+
+	/* children are visited with getFirstChild / getNextSibling until INVALID_ID */
+	uint32_t getFirstChild(uint32_t node) const
+	{
+		return firstChildren[node];
+	}
+
+	uint32_t getNextSibling(uint32_t node) const
+	{
+		return nextSiblings[node];
+	}
+
+	uint32_t getFlags(uint32_t node) const
+	{
+		return flags[node];
+	}
+
+	const nv::vec4f& getColor(uint32_t node) const
+	{
+		return colors[node];
+	}
+
+	const nv::matrix4f& getWorldMatrix(uint32_t node) const
+	{
+		return worldMatrices[node];
+	}
+
+	const std::vector<nv::vec3f>& getWorldBoundsMin() const
+	{
+		return worldBoundsMin;
+	}
+
+	const std::vector<nv::vec3f>& getWorldBoundsMax() const
+	{
+		return worldBoundsMax;
+	}
+
+private:
+	void markDirty(uint32_t node);
+
+	std::vector<Geometry> geometries;
+
+	/* node arrays, all getNodeCount() long */
+	std::vector<uint32_t>     parents;
+	std::vector<uint32_t>     firstChildren;
+	std::vector<uint32_t>     nextSiblings;
+	std::vector<uint32_t>     geometryIds;
+	std::vector<uint32_t>     flags;
+	std::vector<nv::matrix4f> localMatrices;
+	std::vector<nv::matrix4f> worldMatrices;
+	std::vector<nv::vec3f>    worldBoundsMin;
+	std::vector<nv::vec3f>    worldBoundsMax;
+	std::vector<nv::vec4f>    colors;
+
+	/* set when a node's local matrix changes; cleared by updateTransforms */
+	std::vector<uint8_t>      transformDirty;
+	uint32_t                  firstTransformDirty;
+	uint32_t                  transformIncarnation;
+
+	uint32_t                  firstDirty;
+	uint32_t                  lastDirty;
+};
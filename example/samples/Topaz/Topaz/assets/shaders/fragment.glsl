@@ -4,14 +4,7 @@
 #extension GL_NV_shadow_samplers_cube : enable
 #extension GL_ARB_bindless_texture : require
 
-#define UBO_OBJECT    1
-
-struct ObjectData
-{
-	vec4 objectID;
-	vec4 objectColor;
-	samplerCube skybox;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
@@ -23,6 +16,7 @@ layout(std140, binding = UBO_OBJECT) uniform objectBuffer
 in Varyings
 {
 	vec3 pos;
+	flat vec4 color;
 } in_varyings;
 
 layout(location = 0, index = 0) out vec4 outColor;
@@ -36,7 +30,7 @@ void main()
 	}
 	else
 	{
-		color = objectData.objectColor;
+		color = in_varyings.color;
 	}
 
 	outColor = color;
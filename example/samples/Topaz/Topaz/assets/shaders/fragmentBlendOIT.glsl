@@ -3,21 +3,7 @@
 #extension GL_ARB_bindless_texture : require
 #extension GL_NV_command_list : enable
 
-#define UBO_SCENE     0
-#define UBO_OBJECT    1
-
-struct ObjectData
-{
-	vec4 objectID;
-	vec4 objectColor;
-	samplerCube skybox;
-};
-
-struct SceneData
-{
-	mat4 modelViewProjection;
-	float depthScale;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
@@ -31,12 +17,18 @@ layout(std140, binding = UBO_OBJECT) uniform objectBuffer
 	ObjectData  objectData;
 };
 
+in Varyings
+{
+	vec3 pos;
+	flat vec4 color;
+} in_varyings;
+
 layout(location = 0) out vec4 oSumColor;
 layout(location = 1) out vec4 oSumWeight;
 
 void main(void)
 {
-    vec4 color = objectData.objectColor;
+    vec4 color = in_varyings.color;
 
     float viewDepth = abs(1.0 / gl_FragCoord.w);
 
@@ -3,22 +3,7 @@
 #extension GL_ARB_bindless_texture : require
 #extension GL_NV_command_list : enable
 
-#define UBO_OBJECT    1
-#define UBO_OIT       2
-
-struct ObjectData
-{
-	vec4 objectID;
-	vec4 objectColor;
-	samplerCube skybox;
-};
-
-struct WeightBlendedData
-{
-	sampler2DRect background;
-	sampler2DRect colorTex0;
-	sampler2DRect colorTex1;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
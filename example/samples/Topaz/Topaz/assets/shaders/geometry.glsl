@@ -1,17 +1,13 @@
 #version 440
 
+#extension GL_ARB_bindless_texture : require
 #extension GL_NV_command_list : enable
 #extension GL_EXT_geometry_shader4 : enable
 
 layout(triangles) in;
 layout(line_strip, max_vertices = 4) out;
 
-#define UBO_SCENE     0
-
-struct SceneData
-{
-	mat4 modelViewProjection;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
@@ -23,6 +19,7 @@ layout(std140, binding = UBO_SCENE) uniform sceneBuffer
 in Varyings 
 {
   vec3 pos;
+  flat vec4 color;
 } in_varyings[];
 
 void main()
@@ -0,0 +1,56 @@
+#version 440
+
+// One level of the max-depth pyramid used by occlusionCull.glsl.  Level 0 reduces
+// the depth buffer, every other level the level before it; each texel keeps the
+// farthest depth of the 2x2 texels it covers.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2DRect sceneDepth;
+uniform sampler2D     hizSource;
+
+// -1 while building level 0 from sceneDepth
+uniform int   sourceLevel;
+uniform ivec2 sourceSize;
+uniform ivec2 targetSize;
+
+layout(r32f, binding = 0) uniform writeonly image2D hizTarget;
+
+float fetchDepth(ivec2 texel)
+{
+	texel = min(texel, sourceSize - 1);
+	return sourceLevel < 0 ? texelFetch(sceneDepth, texel).r : texelFetch(hizSource, texel, sourceLevel).r;
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, targetSize)))
+	{
+		return;
+	}
+
+	ivec2 source = texel * 2;
+	float depth = max(max(fetchDepth(source), fetchDepth(source + ivec2(1, 0))),
+	                  max(fetchDepth(source + ivec2(0, 1)), fetchDepth(source + ivec2(1, 1))));
+
+	// halving rounds down, so the last column and row of an odd-sized source
+	// are folded into the last texel of the target
+	bool extraX = (sourceSize.x & 1) != 0 && texel.x == targetSize.x - 1;
+	bool extraY = (sourceSize.y & 1) != 0 && texel.y == targetSize.y - 1;
+
+	if (extraX)
+	{
+		depth = max(depth, max(fetchDepth(source + ivec2(2, 0)), fetchDepth(source + ivec2(2, 1))));
+	}
+	if (extraY)
+	{
+		depth = max(depth, max(fetchDepth(source + ivec2(0, 2)), fetchDepth(source + ivec2(1, 2))));
+	}
+	if (extraX && extraY)
+	{
+		depth = max(depth, fetchDepth(source + ivec2(2, 2)));
+	}
+
+	imageStore(hizTarget, texel, vec4(depth));
+}
@@ -0,0 +1,159 @@
+#version 440
+
+// Pass 0 tests every instance: its world box may be visible, or it is outside
+// the frustum or behind the depth of the previous frame.  Visible instances are
+// packed to the front of their group's range of the remap buffer.  Pass 1
+// writes each group's instanced draw token with the number of packed
+// instances, or NOP tokens when there are none.  TopazOcclusion::isVisible is
+// the CPU copy of the test; keep the two in step.
+
+layout(local_size_x = 64) in;
+
+struct CullObject
+{
+	vec4 boundsMin;
+	vec4 boundsMax;
+	uint group;
+};
+
+struct CullGroup
+{
+	uint tokenOffset;
+	uint drawHeader;
+	uint mode;
+	uint count;
+	uint firstIndex;
+	uint firstInstance;
+};
+
+layout(std430, binding = 0) readonly buffer cullObjectBuffer
+{
+	CullObject objects[];
+};
+
+layout(std430, binding = 1) buffer tokenBuffer
+{
+	uint tokens[];
+};
+
+layout(std430, binding = 2) readonly buffer cullGroupBuffer
+{
+	CullGroup groups[];
+};
+
+// cleared to zero before pass 0
+layout(std430, binding = 3) buffer countBuffer
+{
+	uint counts[];
+};
+
+layout(std430, binding = 4) buffer remapBuffer
+{
+	uint remap[];
+};
+
+uniform int  pass;
+uniform mat4 viewProjection;
+uniform uint objectCount;
+uniform uint groupCount;
+uniform uint nopHeader;
+
+// max-depth pyramid; level 0 is half the size of the depth buffer
+uniform sampler2D hiz;
+uniform int       hizLevels;
+uniform vec2      depthSize;
+
+bool isVisible(CullObject object)
+{
+	vec3 ndcMin = vec3( 1e30);
+	vec3 ndcMax = vec3(-1e30);
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = vec3((i & 1) != 0 ? object.boundsMax.x : object.boundsMin.x,
+		                   (i & 2) != 0 ? object.boundsMax.y : object.boundsMin.y,
+		                   (i & 4) != 0 ? object.boundsMax.z : object.boundsMin.z);
+
+		vec4 clip = viewProjection * vec4(corner, 1.0);
+
+		// a corner behind the eye has no screen position; keep the object
+		if (clip.w <= 0.0)
+		{
+			return true;
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+
+	if (any(lessThan(ndcMax, vec3(-1.0))) || any(greaterThan(ndcMin, vec3(1.0))))
+	{
+		return false;
+	}
+
+	if (hizLevels == 0 || ndcMin.z < -1.0)
+	{
+		return true;
+	}
+
+	vec2 rectMin = clamp((ndcMin.xy * 0.5 + 0.5) * depthSize, vec2(0.0), depthSize - 1.0);
+	vec2 rectMax = clamp((ndcMax.xy * 0.5 + 0.5) * depthSize, vec2(0.0), depthSize - 1.0);
+	float nearest = ndcMin.z * 0.5 + 0.5;
+
+	// the level at which the rectangle spans at most 2x2 texels
+	vec2 extent = (rectMax - rectMin) * 0.5;
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hizLevels - 1);
+
+	ivec2 levelSize = textureSize(hiz, level);
+	ivec2 texelMin = min(ivec2(rectMin) >> (level + 1), levelSize - 1);
+	ivec2 texelMax = min(ivec2(rectMax) >> (level + 1), levelSize - 1);
+
+	float farthest = max(max(texelFetch(hiz, texelMin, level).r, texelFetch(hiz, ivec2(texelMax.x, texelMin.y), level).r),
+	                     max(texelFetch(hiz, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(hiz, texelMax, level).r));
+
+	return nearest <= farthest;
+}
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+
+	if (pass == 0)
+	{
+		if (id < objectCount && isVisible(objects[id]))
+		{
+			uint group = objects[id].group;
+			remap[groups[group].firstInstance + atomicAdd(counts[group], 1)] = id;
+		}
+		return;
+	}
+
+	if (id >= groupCount)
+	{
+		return;
+	}
+
+	CullGroup group = groups[id];
+	uint offset = group.tokenOffset;
+	uint instanceCount = counts[id];
+
+	// DrawElementsInstancedCommandNV: header, mode, count, instanceCount, firstIndex, baseVertex, baseInstance
+	if (instanceCount > 0)
+	{
+		tokens[offset + 0] = group.drawHeader;
+		tokens[offset + 1] = group.mode;
+		tokens[offset + 2] = group.count;
+		tokens[offset + 3] = instanceCount;
+		tokens[offset + 4] = group.firstIndex;
+		tokens[offset + 5] = 0;
+		tokens[offset + 6] = 0;
+	}
+	else
+	{
+		for (uint i = 0; i < 7; i++)
+		{
+			tokens[offset + i] = nopHeader;
+		}
+	}
+}
@@ -0,0 +1,48 @@
+// Attribute locations, uniform block bindings and uniform block layouts shared
+// by the Topaz shaders.  The matching C++ structs live in topaz.h; their offsets
+// are checked against the linked programs when the shaders are loaded.
+
+#define VERTEX_POS    0
+#define VERTEX_NORMAL 1
+#define VERTEX_UV     2
+
+#define UBO_SCENE     0
+#define UBO_OBJECT    1
+#define UBO_OIT       2
+#define UBO_IDENTITY  3
+
+#define SSBO_INSTANCE       0
+#define SSBO_INSTANCE_REMAP 1
+
+struct SceneData
+{
+	mat4 modelViewProjection;
+	sampler2DRect sceneDepth;
+	float depthScale;
+};
+
+// instanceBase is the node's own instance, or for an instanced draw the group's first;
+// quantized positions become model space positions as positionBias + positionScale * pos
+struct ObjectData
+{
+	vec4 objectID;
+	vec4 positionScale;
+	vec4 positionBias;
+	samplerCube skybox;
+	sampler2DRect pattern;
+	uint instanceBase;
+};
+
+// std430, one per scene node, grouped so that each instanced draw reads a contiguous run
+struct InstanceData
+{
+	mat4 worldMatrix;
+	vec4 color;
+};
+
+struct WeightBlendedData
+{
+	sampler2DRect background;
+	sampler2DRect colorTex0;
+	sampler2DRect colorTex1;
+};
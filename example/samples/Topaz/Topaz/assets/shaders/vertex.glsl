@@ -1,27 +1,9 @@
 #version 440
 
-#define VERTEX_POS    0
-#define VERTEX_NORMAL 1
-#define VERTEX_UV     2
-
-#define UBO_SCENE     0
-#define UBO_OBJECT    1
-
 #extension GL_ARB_bindless_texture : require
 #extension GL_NV_command_list : enable
 
-struct ObjectData
-{
-	vec4 objectID;
-	vec4 objectColor;
-	samplerCube skybox;
-};
-
-struct SceneData
-{
-	mat4 modelViewProjection;
-	float depthScale;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
@@ -35,6 +17,18 @@ layout(std140, binding = UBO_OBJECT) uniform objectBuffer
   	ObjectData  objectData;
 };
 
+layout(std430, binding = SSBO_INSTANCE) readonly buffer instanceBuffer
+{
+	InstanceData instances[];
+};
+
+// instance i of a draw reads instances[instanceRemap[objectData.instanceBase + i]]; the
+// identity, unless occlusion culling has packed the visible instances to the front
+layout(std430, binding = SSBO_INSTANCE_REMAP) readonly buffer instanceRemapBuffer
+{
+	uint instanceRemap[];
+};
+
 in layout(location = VERTEX_POS)    vec3 pos;
 in layout(location = VERTEX_NORMAL) vec3 normal;
 in layout(location = VERTEX_UV)     vec2 uv;
@@ -42,12 +36,17 @@ in layout(location = VERTEX_UV)     vec2 uv;
 out Varyings
 {
 	vec3 pos;
+	flat vec4 color;
 } out_varyings;
 
 void main()
 {
-  gl_Position = sceneData.modelViewProjection * vec4(pos, 1);
-  out_varyings.pos = pos;
+  InstanceData instance = instances[instanceRemap[objectData.instanceBase + gl_InstanceID]];
+  vec3 position = objectData.positionBias.xyz + objectData.positionScale.xyz * pos;
+
+  gl_Position = sceneData.modelViewProjection * (instance.worldMatrix * vec4(position, 1));
+  out_varyings.pos = position;
+  out_varyings.color = instance.color;
 }
 
 
@@ -1,26 +1,9 @@
 #version 440
 
-#define VERTEX_POS    0
-#define VERTEX_NORMAL 1
-#define VERTEX_UV     2
-
-#define UBO_SCENE     0
-#define UBO_OBJECT    1
-
 #extension GL_ARB_bindless_texture : require
 #extension GL_NV_command_list : enable
 
-struct ObjectData
-{
-	vec4 objectID;
-	vec4 objectColor;
-	samplerCube skybox;
-};
-
-struct SceneData
-{
-	mat4 modelViewProjection;
-};
+#include "uniforms.glsl"
 
 layout(commandBindableNV) uniform;
 
@@ -7,6 +7,7 @@
 #include "NvGLUtils/NvGLSLProgram.h"
 #include "NvGLUtils/NvTimers.h"
 #include "NvGLUtils/NvImage.h"
+#include "NvGLUtils/NvTextureUploader.h"
 #include "TopazGLModel.h"
 #include "NvModel/NvModel.h"
 #include "NvModel/NvShapes.h"
@@ -30,4 +31,7 @@
 #define UBO_SCENE     0
 #define UBO_OBJECT    1
 #define UBO_OIT		  2
-#define UBO_IDENTITY  3
\ No newline at end of file
+#define UBO_IDENTITY  3
+
+#define SSBO_INSTANCE       0
+#define SSBO_INSTANCE_REMAP 1
\ No newline at end of file
@@ -413,6 +413,9 @@ namespace nvtoken
   struct NVTokenUbo {
     static const GLenum   ID = GL_UNIFORM_ADDRESS_COMMAND_NV;
 
+    // without bindless addresses the offset is stored in 256 byte units in 16 bits
+    static const GLuint   MAX_EMU_OFFSET = 0xFFFF * 256;
+
     union{
       UniformAddressCommandNV   cmd;
       UniformAddressCommandEMU  cmdEMU;
@@ -427,8 +430,9 @@ namespace nvtoken
         cmd.addressHi = GLuint(address >> 32);
       }
       else{
+        assert(offset <= MAX_EMU_OFFSET);
         cmdEMU.buffer = buffer;
-        cmdEMU.offset256 = (GLushort) offset / 256;
+        cmdEMU.offset256 = (GLushort) (offset / 256);
         cmdEMU.size4     = (GLushort) size / 4;
       }
     }
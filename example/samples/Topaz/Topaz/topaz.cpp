@@ -1,15 +1,43 @@
 #include "topaz.h"
 #include <windows.h>
+#include <sstream>
 
-TopazSample::TopazSample(NvPlatformContext* platform) : NvSampleApp(platform, "Topaz Sample"), drawMode(DRAW_STANDARD)
+TopazSample::TopazSample(NvPlatformContext* platform) : NvSampleApp(platform, "Topaz Sample"), drawMode(DRAW_STANDARD), validateOcclusion(false)
 {
 	oit = std::unique_ptr<WeightedBlendedOIT>(new WeightedBlendedOIT);
+	occlusion = std::unique_ptr<TopazOcclusion>(new TopazOcclusion);
 	brushStyle = std::unique_ptr<BrushStyles>(new BrushStyles);
 
 	isTokenInternalsInited = false;
 
 	sceneBackgroundColor = nv::vec4f(0.2f, 0.2f, 0.2f, 0.0f);
 	m_transformer->setTranslationVec(nv::vec3f(0.f, -0.1f, -2.5f));
+
+	// -drawmode N picks the draw mode at startup, so that headless runs can capture each mode
+	const std::vector<std::string>& cmd = platform->getCommandLine();
+	for (std::vector<std::string>::const_iterator iter = cmd.begin(); iter != cmd.end(); ++iter)
+	{
+		if (0 == (*iter).compare("-drawmode") && (iter + 1) != cmd.end())
+		{
+			++iter;
+			std::stringstream(*iter) >> drawMode;
+			if (drawMode > DRAW_OCCLUSION_TOKEN_BUFFER)
+				drawMode = DRAW_STANDARD;
+		}
+		else if (0 == (*iter).compare("-validateocclusion"))
+		{
+			validateOcclusion = true;
+		}
+		else if (0 == (*iter).compare("-checkmodels"))
+		{
+			// the mesh processing the scene is loaded with, checked on generated meshes
+			if (NvModel::runChecks())
+			{
+				LOGI("NvModel checks passed");
+			}
+		}
+	}
+
 	forceLinkHack();
 }
 
@@ -33,7 +61,8 @@ void TopazSample::initUI()
 			{ "standard", DRAW_STANDARD },
 			{ "nvcmdlist list", DRAW_TOKEN_LIST },
 			{ "weight blended standard", DRAW_WEIGHT_BLENDED_STANDARD },
-			{ "weight blended token list", DRAW_WEIGHT_BLENDED_TOKEN_LIST }
+			{ "weight blended token list", DRAW_WEIGHT_BLENDED_TOKEN_LIST },
+			{ "nvcmdlist gpu occlusion (1 frame lag)", DRAW_OCCLUSION_TOKEN_BUFFER }
 		};
 
 		mTweakBar->addPadding();
@@ -45,6 +74,13 @@ void TopazSample::initUI()
 		mTweakBar->addValue("Opacity:", oit->getOpacity(), 0.0f, 1.0f);
 		mTweakBar->addValue("Weight Parameter:", oit->getWeightParameter(), 0.1f, 1.0f);
 
+		mTweakBar->addValue("Frustum Culling:", visibility.enabled);
+
+		mTweakBar->addValue("Levels of Detail:", lod.enabled);
+		mTweakBar->addValue("LOD Pixel Error:", lod.pixelError, 0.25f, 8.0f);
+
+		mTweakBar->addValue("Cluster Culling:", clusters.enabled);
+
 		mTweakBar->syncValues();
 	}
 }
@@ -66,6 +102,9 @@ void TopazSample::initRendering()
 		exit(EXIT_FAILURE);
 	}
 
+	// warm launches restore the programs from their binaries instead of compiling them
+	NvGLSLProgram::setProgramCacheDirectory("shadercache");
+
 	compileShaders("draw", "shaders/vertex.glsl", "shaders/fragment.glsl");
 	/*
 	If needed geometry shader:
@@ -73,6 +112,15 @@ void TopazSample::initRendering()
 	*/
 	compileShaders("weightBlended", "shaders/vertex.glsl", "shaders/fragmentBlendOIT.glsl");
 	compileShaders("weightBlendedFinal", "shaders/vertexOIT.glsl", "shaders/fragmentFinalOIT.glsl");
+	compileComputeShader("hizBuild", "shaders/hizBuild.glsl");
+	compileComputeShader("occlusionCull", "shaders/occlusionCull.glsl");
+
+	// the expanded sources are only needed until the programs are submitted
+	NvGLSLProgram::clearSourceCache();
+
+	checkUniformLayouts();
+
+	occlusion->init(shaderPrograms["hizBuild"].get(), shaderPrograms["occlusionCull"].get());
 
 	// like as glClearBufferfv for nv_command_list
 	compileShaders("clear", "shaders/vertexOIT.glsl", "shaders/clear.glsl");
@@ -85,7 +133,21 @@ void TopazSample::initRendering()
 
 	loadModel("models/formular.obj", shaderPrograms["draw"]->getProgram());
 
-	textures.skybox = NvImage::UploadTextureFromDDSFile("textures/sky_cube.dds");
+	initSceneGraph();
+
+	visibility.visibleCounter = addBenchmarkCounter("visibleNodes");
+	lod.trianglesCounter = addBenchmarkCounter("lodTriangles");
+	clusters.trianglesCounter = addBenchmarkCounter("clusterTriangles");
+
+	// the skybox handle is resident for the lifetime of the sample, so its
+	// sampler state has to be final before the handle is created
+	{
+		NvTextureUploader uploader;
+		uploader.setFilter(GL_LINEAR, GL_LINEAR);
+		uploader.setWrap(GL_CLAMP_TO_EDGE);
+		textures.skybox = uploader.uploadDDSFile("textures/sky_cube.dds",
+			NvTextureUploader::DEFAULT | NvTextureUploader::BINDLESS, &texturesAddress64.skybox);
+	}
 
 	cmdlist.state.programIncarnation++;
 
@@ -96,6 +158,7 @@ void TopazSample::reshape(int32_t width, int32_t height)
 {
 	initFramebuffers(width, height);
 	oit->InitAccumulationRenderTargets(width, height);
+	occlusion->resize(width, height);
 
 	initScene();
 	initCommandList();
@@ -113,6 +176,36 @@ void TopazSample::draw()
 
 	glNamedBufferSubDataEXT(ubos.sceneUbo, 0, sizeof(SceneData), &sceneData);
 
+	uploadObjectData();
+
+	cullScene();
+
+	selectLods(projection);
+
+	// without NV_command_list the CPU runs the occlusion test, which includes the frustum
+	const bool occlusionSW = drawMode == DRAW_OCCLUSION_TOKEN_BUFFER && !hwsupport;
+	if (occlusionSW)
+	{
+		occlusion->updateBounds(scene);
+		occlusion->cullSW(sceneData.modelViewProjection, visibility.occlusion);
+		instancing.getVisibleGroups(visibility.occlusion, visibility.occlusionGroups);
+	}
+
+	// the instanced draws of the CPU paths read only the visible instances, packed like the GPU pass packs them
+	const std::vector<uint8_t>& drawnNodes = occlusionSW ? visibility.occlusion : visibility.nodes;
+	instancing.compact(drawnNodes);
+
+	// the groups drawGroup draws keep only the clusters of large parts that are in view
+	if (clusters.enabled && (drawMode == DRAW_STANDARD || occlusionSW))
+	{
+		clusters.culling.cull(scene, instancing, drawnNodes, lod.groups, sceneData.modelViewProjection);
+	}
+	else
+	{
+		clusters.culling.reset();
+	}
+	setBenchmarkCounter(clusters.trianglesCounter, float(clusters.culling.getVisibleTriangleCount()));
+
 	glBindFramebuffer(GL_FRAMEBUFFER, fbos.scene);
 
 	glViewport(0, 0, m_width, m_height);
@@ -127,9 +220,14 @@ void TopazSample::draw()
 		updateCommandListState();
 	}
 
+	// every draw reads its transform and color from the instance buffer; the group draws through
+	// the compacted remap, the node draws of the weighted blended modes through the identity
+	const bool groupDraws = drawMode == DRAW_STANDARD || drawMode == DRAW_TOKEN_LIST || occlusionSW;
+	instancing.bind(groupDraws ? instancing.getRemapBuffer() : 0);
+
 	if (drawMode == DRAW_STANDARD)
 	{
-		drawStandard();
+		drawStandard(visibility.groups);
 	}
 	else if (drawMode == DRAW_TOKEN_LIST)
 	{
@@ -141,21 +239,26 @@ void TopazSample::draw()
 	}
 	else if (drawMode == DRAW_WEIGHT_BLENDED_TOKEN_LIST)
 	{
-		for (auto model = models.begin() + 1; model != models.end(); model++)
-		{
-			objectData.objectColor = nv::vec4f(1.0f, 1.0f, 1.0f, oit->getOpacity());
-			glNamedBufferSubDataEXT((*model)->getBufferID("ubo"), 0, sizeof(ObjectData), &objectData);
-
-			objectData.objectColor = nv::vec4f(1.0f, 0.0f, 0.0f, oit->getOpacity());
-			glNamedBufferSubDataEXT((*model)->getCornerBufferID("ubo"), 0, sizeof(ObjectData), &objectData);
-		}
-
 		glBindFramebuffer(GL_FRAMEBUFFER, fbos.scene);
 		glCallCommandListNV(cmdlist.tokenCmdListWeightBlended);
 	}
+	else if (drawMode == DRAW_OCCLUSION_TOKEN_BUFFER)
+	{
+		drawOcclusionCulled();
+	}
+
+	// this frame's depth decides what the next frame draws
+	if (drawMode == DRAW_OCCLUSION_TOKEN_BUFFER)
+	{
+		occlusion->buildHiZ(textures.sceneDepth);
+	}
+	else
+	{
+		occlusion->invalidate();
+	}
 	
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos.scene);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getMainFBO());
 	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 	
 }
@@ -167,12 +270,11 @@ void TopazSample::compileShaders(std::string name,
 {
 	std::unique_ptr<NvGLSLProgram> program(new NvGLSLProgram);
 	
-	int32_t sourceLength;
 	std::vector<NvGLSLProgram::ShaderSourceItem> sources;
 
 	NvGLSLProgram::ShaderSourceItem vertexShader;
 	vertexShader.type = GL_VERTEX_SHADER;
-	vertexShader.src  = NvAssetLoaderRead(vertexShaderFilename, sourceLength);
+	vertexShader.src  = NvGLSLProgram::loadSourceFromFile(vertexShaderFilename);
 
 	sources.push_back(vertexShader);
 
@@ -180,22 +282,76 @@ void TopazSample::compileShaders(std::string name,
 	{
 		NvGLSLProgram::ShaderSourceItem geometryShader;
 		geometryShader.type = GL_GEOMETRY_SHADER;
-		geometryShader.src = NvAssetLoaderRead(geometryShaderFilename, sourceLength);
+		geometryShader.src = NvGLSLProgram::loadSourceFromFile(geometryShaderFilename);
 
 		sources.push_back(geometryShader);
 	}
 
 	NvGLSLProgram::ShaderSourceItem fragmentShader;
 	fragmentShader.type = GL_FRAGMENT_SHADER;
-	fragmentShader.src  = NvAssetLoaderRead(fragmentShaderFilename, sourceLength);
+	fragmentShader.src  = NvGLSLProgram::loadSourceFromFile(fragmentShaderFilename);
 	
 	sources.push_back(fragmentShader);
 
-	program->setSourceFromStrings(sources.data(), sources.size());
+	// the build is only waited for when the program is first used, so the
+	// programs submitted by initRendering compile concurrently
+	program->submitSourceFromStrings(sources.data(), sources.size());
+
+	shaderPrograms[name] = std::move(program);
+}
+
+void TopazSample::compileComputeShader(std::string name, const char* computeShaderFilename)
+{
+	std::unique_ptr<NvGLSLProgram> program(new NvGLSLProgram);
+
+	NvGLSLProgram::ShaderSourceItem computeShader;
+	computeShader.type = GL_COMPUTE_SHADER;
+	computeShader.src  = NvGLSLProgram::loadSourceFromFile(computeShaderFilename);
+
+	program->submitSourceFromStrings(&computeShader, 1);
 
 	shaderPrograms[name] = std::move(program);
 }
 
+void TopazSample::checkUniformLayouts()
+{
+	const NvGLSLProgram::UniformBlockMember sceneMembers[] =
+	{
+		{ "sceneData.modelViewProjection", offsetof(SceneData, modelViewProjection) },
+		{ "sceneData.sceneDepth", offsetof(SceneData, sceneDepthId64) },
+		{ "sceneData.depthScale", offsetof(SceneData, depthScale) }
+	};
+
+	const NvGLSLProgram::UniformBlockMember objectMembers[] =
+	{
+		{ "objectData.objectID", offsetof(ObjectData, objectID) },
+		{ "objectData.positionScale", offsetof(ObjectData, positionScale) },
+		{ "objectData.positionBias", offsetof(ObjectData, positionBias) },
+		{ "objectData.skybox", offsetof(ObjectData, skybox) },
+		{ "objectData.pattern", offsetof(ObjectData, pattern) },
+		{ "objectData.instanceBase", offsetof(ObjectData, instanceBase) }
+	};
+
+	const NvGLSLProgram::UniformBlockMember weightBlendedMembers[] =
+	{
+		{ "weightBlendedData.background", offsetof(WeightBlendedData, background) },
+		{ "weightBlendedData.colorTex0", offsetof(WeightBlendedData, colorTex0) },
+		{ "weightBlendedData.colorTex1", offsetof(WeightBlendedData, colorTex1) }
+	};
+
+	for (auto& program : shaderPrograms)
+	{
+		bool matches = program.second->checkUniformBlockLayout("sceneBuffer", sceneMembers, sizeof(sceneMembers) / sizeof(sceneMembers[0]), sizeof(SceneData));
+		matches &= program.second->checkUniformBlockLayout("objectBuffer", objectMembers, sizeof(objectMembers) / sizeof(objectMembers[0]), sizeof(ObjectData));
+		matches &= program.second->checkUniformBlockLayout("weightBlendedBuffer", weightBlendedMembers, sizeof(weightBlendedMembers) / sizeof(weightBlendedMembers[0]), sizeof(WeightBlendedData));
+
+		if (!matches)
+		{
+			LOGE("Uniform layout of program \"%s\" does not match the application", program.first.c_str());
+		}
+	}
+}
+
 void TopazSample::loadModel(std::string filename, GLuint program, bool calculateCornerPoints)
 {
 	int32_t length;
@@ -247,19 +403,6 @@ void TopazSample::initBuffer(GLenum target, GLuint& buffer, GLuint64& buffer64,
 
 void TopazSample::initScene()
 {
-	// initializate skybox
-	{
-		glBindTexture(GL_TEXTURE_CUBE_MAP, textures.skybox);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-		texturesAddress64.skybox = glGetTextureHandleARB(textures.skybox);
-		glMakeTextureHandleResidentARB(texturesAddress64.skybox);
-	}
-
 	// init fullscreen quad
 	{
 		const float position[] = 
@@ -300,57 +443,452 @@ void TopazSample::initScene()
 
 	brushStyle->brushPattern8to32(QtStyles::Dense1Pattern);
 
-	objectData.objectID = nv::vec4f(0.0);
-	objectData.objectColor = nv::vec4f(1.0f, 1.0f, 1.0f, oit->getOpacity());
-	objectData.skybox = texturesAddress64.skybox;
-	objectData.pattern = brushStyle->getTextureId64();
-
-	for (auto & model : models)
+	// one ObjectData slot per scene node.  Slots are bound by offset, so the stride
+	// honors the uniform buffer offset alignment, and the 256 bytes the emulated
+	// command list tokens address in
 	{
-		model->getModel()->compileModel(NvModelPrimType::TRIANGLES);
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment < 256)
+		{
+			alignment = 256;
+		}
 
-		/* ibo */
-		initBuffer(GL_ELEMENT_ARRAY_BUFFER, model->getBufferID("ibo"), model->getBufferID64("ibo"),
-			model->getModel()->getCompiledIndexCount(NvModelPrimType::TRIANGLES) * sizeof(uint32_t),
-			model->getModel()->getCompiledIndices(NvModelPrimType::TRIANGLES));
+		objectBuffer.stride = ((sizeof(ObjectData) + alignment - 1) / alignment) * alignment;
 
-		/* vbo */
-		initBuffer(GL_ARRAY_BUFFER, model->getBufferID("vbo"), model->getBufferID64("vbo"),
-			model->getModel()->getCompiledVertexCount() * model->getModel()->getCompiledVertexSize() * sizeof(float), 
-			model->getModel()->getCompiledVertices());
-		
-		if (model->cornerPointsExists())
-		{
-			/* ibo corner */
-			initBuffer(GL_ELEMENT_ARRAY_BUFFER, model->getCornerBufferID("ibo"), model->getCornerBufferID64("ibo"),
-				model->getCornerIndices().size() * sizeof(uint32_t), 
-				model->getCornerIndices().data());
-
-			/* vbo corner */
-			initBuffer(GL_ARRAY_BUFFER, model->getCornerBufferID("vbo"), model->getCornerBufferID64("vbo"),
-				model->getCorners().size() * sizeof(nv::vec3f),
-				model->getCorners().data());
-
-			/* ubo corner */
-			ObjectData curObjectData;
-			curObjectData.objectID = nv::vec4f(1.0f);
-			curObjectData.objectColor = nv::vec4f(1.0f, 0.0f, 0.0f, oit->getOpacity());
-			curObjectData.pattern = brushStyle->getTextureId64();
-
-			initBuffer(GL_UNIFORM_BUFFER, model->getCornerBufferID("ubo"), model->getCornerBufferID64("ubo"), 
-				sizeof(ObjectData),
-				&curObjectData, 
-				true); // mutable buffer
-		}
-
-		/* ubo */
-		initBuffer(GL_UNIFORM_BUFFER, model->getBufferID("ubo"), model->getBufferID64("ubo"),
-			sizeof(ObjectData),
-			&objectData,
+		// the emulated tokens cannot address slots past NVTokenUbo::MAX_EMU_OFFSET
+		if (!bindlessVboUbo && scene.getNodeCount() > 0 &&
+			(scene.getNodeCount() - 1) * size_t(objectBuffer.stride) > NVTokenUbo::MAX_EMU_OFFSET)
+		{
+			LOGE("%u scene nodes exceed the %u the command list emulation can address without bindless uniform buffers",
+				scene.getNodeCount(), GLuint(NVTokenUbo::MAX_EMU_OFFSET / objectBuffer.stride + 1));
+		}
+		objectBuffer.staging.assign(objectBuffer.stride * scene.getNodeCount(), 0);
+
+		initBuffer(GL_UNIFORM_BUFFER, objectBuffer.buffer, objectBuffer.buffer64,
+			objectBuffer.staging.size(),
+			nullptr,
 			true); // mutable buffer
 
-		objectData.objectID = nv::vec4f(1.0);
+		// the buffer and the pattern texture are new, so every slot is rewritten
+		scene.markAllDirty();
+		uploadObjectData();
+	}
+}
+
+/* FNV-1a over the compiled vertices and triangle indices of model */
+static uint64_t hashCompiledGeometry(const NvModel& model)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	const GLubyte* bytes = reinterpret_cast<const GLubyte*>(model.getCompiledVertices());
+	size_t size = model.getCompiledVertexCount() * model.getCompiledVertexSize() * sizeof(float);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	bytes = reinterpret_cast<const GLubyte*>(model.getCompiledIndices(NvModelPrimType::TRIANGLES));
+	size = model.getCompiledIndexCount(NvModelPrimType::TRIANGLES) * sizeof(uint32_t);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static bool sameCompiledGeometry(const NvModel& a, const NvModel& b)
+{
+	const size_t vertexFloats = a.getCompiledVertexCount() * a.getCompiledVertexSize();
+	const size_t indexCount = a.getCompiledIndexCount(NvModelPrimType::TRIANGLES);
+
+	return a.getCompiledVertexCount() == b.getCompiledVertexCount() &&
+		a.getCompiledVertexSize() == b.getCompiledVertexSize() &&
+		a.getCompiledIndexCount(NvModelPrimType::TRIANGLES) == b.getCompiledIndexCount(NvModelPrimType::TRIANGLES) &&
+		memcmp(a.getCompiledVertices(), b.getCompiledVertices(), vertexFloats * sizeof(float)) == 0 &&
+		memcmp(a.getCompiledIndices(NvModelPrimType::TRIANGLES), b.getCompiledIndices(NvModelPrimType::TRIANGLES), indexCount * sizeof(uint32_t)) == 0;
+}
+
+void TopazSample::initSceneGraph()
+{
+	scene.clear();
+	clusters.culling.clear();
+
+	/* per model: hash of its compiled geometry, its geometry and its outline geometry */
+	std::vector<uint64_t> hashes(models.size());
+	std::vector<uint32_t> geometries(models.size(), TopazScene::INVALID_ID);
+	std::vector<uint32_t> cornerGeometries(models.size(), TopazScene::INVALID_ID);
+
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		TopazGLModel& model = *models[i];
+		NvModel* nvModel = model.getModel();
+
+		nvModel->compileModel(NvModelPrimType::TRIANGLES);
+
+		// the reordering is deterministic, so models that compiled alike still hash alike
+		nvModel->optimizeCompiledModel();
+
+		// large parts are culled by cluster; grouping the clusters reorders the triangles deterministically too
+		if (nvModel->getCompiledIndexCount(NvModelPrimType::TRIANGLES) / 3 >= TopazClusters::MIN_TRIANGLES)
+		{
+			nvModel->computeClusters();
+		}
+
+		hashes[i] = hashCompiledGeometry(*nvModel);
+
+		// models that compile to the same vertices and indices share one geometry, so their nodes are instanced
+		size_t original = i;
+		for (size_t j = 0; j < i; j++)
+		{
+			if (hashes[j] == hashes[i] && sameCompiledGeometry(*models[j]->getModel(), *nvModel))
+			{
+				original = j;
+				break;
+			}
+		}
+
+		if (original != i)
+		{
+			geometries[i] = geometries[original];
+			cornerGeometries[i] = cornerGeometries[original];
+		}
+		else
+		{
+			// every level of detail indexes the same vertices, so all of them go into one ibo
+			nvModel->computeLods(TopazScene::MAX_LODS);
+
+			/* ibo */
+			initBuffer(GL_ELEMENT_ARRAY_BUFFER, model.getBufferID("ibo"), model.getBufferID64("ibo"),
+				nvModel->getCompiledLodIndexCount() * sizeof(uint32_t),
+				nvModel->getCompiledLodIndices());
+
+			// 16-bit positions within the bounds instead of floats; the vertex shader expands them
+			nvModel->compileQuantizedVertices();
+
+			/* vbo */
+			initBuffer(GL_ARRAY_BUFFER, model.getBufferID("vbo"), model.getBufferID64("vbo"),
+				nvModel->getCompiledVertexCount() * nvModel->getQuantizedVertexSize(),
+				nvModel->getQuantizedVertices());
+
+			TopazScene::Geometry geometry;
+			geometry.vbo = model.getBufferID("vbo");
+			geometry.vbo64 = model.getBufferID64("vbo");
+			geometry.ibo = model.getBufferID("ibo");
+			geometry.ibo64 = model.getBufferID64("ibo");
+			geometry.vertexStride = nvModel->getQuantizedVertexSize();
+			geometry.positionOffset = nvModel->getQuantizedPositionFormat().offset;
+			geometry.positionType = GL_UNSIGNED_SHORT;
+			geometry.positionScale = nvModel->getQuantizedPositionScale();
+			geometry.positionBias = nvModel->getQuantizedPositionBias();
+			geometry.indexCount = nvModel->getCompiledIndexCount(NvModelPrimType::TRIANGLES);
+			geometry.mode = GL_TRIANGLES;
+			nvModel->computeBoundingBox(geometry.boundsMin, geometry.boundsMax);
+
+			geometry.lodCount = nvModel->getLodCount();
+			for (uint32_t level = 0; level < geometry.lodCount; level++)
+			{
+				geometry.lodFirstIndex[level] = nvModel->getLodFirstIndex(level);
+				geometry.lodIndexCount[level] = nvModel->getLodIndexCount(level);
+				geometry.lodError[level] = nvModel->getLodError(level);
+			}
+
+			geometries[i] = scene.addGeometry(geometry);
+
+			clusters.culling.setGeometryClusters(geometries[i], nvModel->getClusters(), nvModel->getClusterCount(), geometry.lodFirstIndex[0]);
+		}
+
+		// the first model is the opaque, skybox textured background; the others are see-through parts
+		const uint32_t node = scene.addNode(TopazScene::INVALID_ID, geometries[i], nv::matrix4f(),
+			nv::vec4f(1.0f, 1.0f, 1.0f, oit->getOpacity()),
+			(i == 0) ? 0 : TopazScene::NODE_TRANSPARENT);
+
+		if (model.cornerPointsExists())
+		{
+			if (cornerGeometries[i] == TopazScene::INVALID_ID)
+			{
+				/* ibo corner */
+				initBuffer(GL_ELEMENT_ARRAY_BUFFER, model.getCornerBufferID("ibo"), model.getCornerBufferID64("ibo"),
+					model.getCornerIndices().size() * sizeof(uint32_t),
+					model.getCornerIndices().data());
+
+				/* vbo corner */
+				initBuffer(GL_ARRAY_BUFFER, model.getCornerBufferID("vbo"), model.getCornerBufferID64("vbo"),
+					model.getCorners().size() * sizeof(nv::vec3f),
+					model.getCorners().data());
+
+				TopazScene::Geometry corners;
+				corners.vbo = model.getCornerBufferID("vbo");
+				corners.vbo64 = model.getCornerBufferID64("vbo");
+				corners.ibo = model.getCornerBufferID("ibo");
+				corners.ibo64 = model.getCornerBufferID64("ibo");
+				corners.vertexStride = sizeof(nv::vec3f);
+				corners.positionOffset = 0;
+				corners.indexCount = GLsizei(model.getCornerIndices().size());
+				corners.mode = GL_LINE_STRIP;
+				corners.boundsMin = corners.boundsMax = model.getCorners().at(0);
+				for (auto & corner : model.getCorners())
+				{
+					corners.boundsMin = nv::min(corners.boundsMin, corner);
+					corners.boundsMax = nv::max(corners.boundsMax, corner);
+				}
+
+				cornerGeometries[i] = scene.addGeometry(corners);
+			}
+
+			/* the outline is a child of its part, so it follows the part's transform */
+			scene.addNode(node, cornerGeometries[i], nv::matrix4f(),
+				nv::vec4f(1.0f, 0.0f, 0.0f, oit->getOpacity()),
+				TopazScene::NODE_TRANSPARENT);
+		}
+	}
+
+	instancing.build(scene);
+	clusters.culling.build(scene, instancing);
+
+	// everything is drawn until the first frame has been culled
+	visibility.nodes.assign(scene.getNodeCount(), 1);
+	visibility.groups.assign(instancing.getGroupCount(), 1);
+
+	lod.groups.assign(instancing.getGroupCount(), 0);
+}
+
+void TopazSample::uploadObjectData()
+{
+	// the see-through nodes follow the opacity slider
+	if (objectBuffer.opacity != oit->getOpacity())
+	{
+		objectBuffer.opacity = oit->getOpacity();
+
+		for (uint32_t node = 0; node < scene.getNodeCount(); node++)
+		{
+			if (scene.getFlags(node) & TopazScene::NODE_TRANSPARENT)
+			{
+				nv::vec4f color = scene.getColor(node);
+				color.w = objectBuffer.opacity;
+				scene.setColor(node, color);
+			}
+		}
+	}
+
+	scene.updateTransforms();
+
+	uint32_t first, last;
+	if (!scene.getDirtyRange(first, last))
+	{
+		return;
+	}
+
+	for (uint32_t node = first; node <= last; node++)
+	{
+		const TopazScene::Geometry& geometry = scene.getNodeGeometry(node);
+
+		ObjectData& data = *reinterpret_cast<ObjectData*>(&objectBuffer.staging[node * objectBuffer.stride]);
+		data.objectID = nv::vec4f((scene.getFlags(node) & TopazScene::NODE_TRANSPARENT) ? 1.0f : 0.0f);
+		data.positionScale = nv::vec4f(geometry.positionScale, 0.0f);
+		data.positionBias = nv::vec4f(geometry.positionBias, 0.0f);
+		data.skybox = texturesAddress64.skybox;
+		data.pattern = brushStyle->getTextureId64();
+		data.instanceBase = instancing.getNodeInstance(node);
+	}
+
+	const GLintptr offset = first * objectBuffer.stride;
+	glNamedBufferSubDataEXT(objectBuffer.buffer, offset, (last - first + 1) * objectBuffer.stride, &objectBuffer.staging[offset]);
+
+	instancing.update(scene, first, last);
+
+	scene.clearDirtyRange();
+}
+
+void TopazSample::setVertexFormat(const TopazScene::Geometry& geometry)
+{
+	glVertexAttribFormat(VERTEX_POS, 3, geometry.positionType, geometry.positionType != GL_FLOAT, geometry.positionOffset);
+	glVertexAttribBinding(VERTEX_POS, 0);
+}
+
+void TopazSample::cullScene()
+{
+	std::vector<uint8_t>& visible = visibility.visibleScratch;
+
+	if (visibility.enabled)
+	{
+		visibility.bvh.update(scene);
+		visibility.bvh.cull(sceneData.modelViewProjection, visible);
+
+		// a visible child keeps its parent, so a part's OIT passes stay around its visible outlines
+		for (uint32_t node = scene.getNodeCount(); node-- > 0;)
+		{
+			const uint32_t parent = scene.getParent(node);
+			if (visible[node] && parent != TopazScene::INVALID_ID)
+			{
+				visible[parent] = 1;
+			}
+		}
+	}
+	else
+	{
+		visible.assign(scene.getNodeCount(), 1);
+	}
+
+	// the command lists are only recompiled when the set of visible nodes changes
+	if (visible != visibility.nodes)
+	{
+		visibility.nodes.swap(visible);
+		instancing.getVisibleGroups(visibility.nodes, visibility.groups);
+		cmdlist.state.visibilityIncarnation++;
+
+		// the group draw tokens draw as many instances as draw() compacts for visibility.nodes
+		for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
+		{
+			NVTokenDrawElemsInstanced& draw = *reinterpret_cast<NVTokenDrawElemsInstanced*>(&cmdlist.tokenData[cmdlist.drawTokenOffsets[group]]);
+			draw.setInstances(countVisibleInstances(group));
+		}
+	}
+
+	uint32_t visibleCount = 0;
+	for (size_t node = 0; node < visibility.nodes.size(); node++)
+	{
+		visibleCount += visibility.nodes[node];
+	}
+	setBenchmarkCounter(visibility.visibleCounter, float(visibleCount));
+}
+
+void TopazSample::selectLods(const nv::matrix4f& projection)
+{
+	const nv::matrix4f view = m_transformer->getModelViewMat();
+
+	// pixels covered by one eye space unit at distance 1
+	const float pixelScale = projection(1, 1) * 0.5f * float(m_height);
+
+	// groups without a visible node keep their level, so culling alone does not recompile the lists
+	lod.selected = lod.groups;
+
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
+	{
+		if (!lod.enabled)
+		{
+			lod.selected[group] = 0;
+			continue;
+		}
+
+		if (!visibility.groups[group])
+		{
+			continue;
+		}
+
+		// all instances share one draw, so the largest one on screen decides
+		const TopazInstancing::Group& instances = instancing.getGroup(group);
+
+		uint32_t level = TopazScene::MAX_LODS;
+		for (uint32_t instance = instances.firstInstance; instance < instances.firstInstance + instances.instanceCount && level > 0; instance++)
+		{
+			const uint32_t node = instancing.getInstanceNode(instance);
+			if (visibility.nodes[node])
+			{
+				const uint32_t nodeLevel = selectNodeLod(node, view, pixelScale);
+				level = nodeLevel < level ? nodeLevel : level;
+			}
+		}
+
+		lod.selected[group] = level;
+	}
+
+	bool changed = false;
+	uint32_t triangles = 0;
+
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
+	{
+		if (lod.selected[group] != lod.groups[group])
+		{
+			setGroupLod(group, lod.selected[group]);
+			changed = true;
+		}
+
+		const TopazInstancing::Group& instances = instancing.getGroup(group);
+		const TopazScene::Geometry& geometry = scene.getGeometry(instances.geometry);
+		if (visibility.groups[group] && geometry.mode == GL_TRIANGLES)
+		{
+			// culled instances are not drawn, as in the visibleNodes and cluster counters
+			triangles += geometry.lodIndexCount[lod.groups[group]] / 3 * countVisibleInstances(group);
+		}
+	}
+
+	if (changed)
+	{
+		cmdlist.state.lodIncarnation++;
 	}
+
+	setBenchmarkCounter(lod.trianglesCounter, float(triangles));
+}
+
+uint32_t TopazSample::selectNodeLod(uint32_t node, const nv::matrix4f& view, float pixelScale) const
+{
+	const TopazScene::Geometry& geometry = scene.getNodeGeometry(node);
+	if (geometry.lodCount < 2)
+	{
+		return 0;
+	}
+
+	const nv::matrix4f modelView = view * scene.getWorldMatrix(node);
+
+	// bounding sphere of the geometry in eye space; the largest axis scale keeps it conservative
+	float scale = 0.0f;
+	for (int32_t column = 0; column < 3; column++)
+	{
+		const float axis = nv::length(nv::vec3f(modelView(0, column), modelView(1, column), modelView(2, column)));
+		scale = axis > scale ? axis : scale;
+	}
+
+	const nv::vec4f center = modelView * nv::vec4f((geometry.boundsMin + geometry.boundsMax) * 0.5f, 1.0f);
+	const float radius = nv::length(geometry.boundsMax - geometry.boundsMin) * 0.5f * scale;
+
+	// the sphere's nearest point sets how many pixels a model unit covers
+	const float distance = -center.z - radius;
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	const float pixelsPerUnit = scale * pixelScale / distance;
+
+	for (uint32_t level = geometry.lodCount - 1; level > 0; level--)
+	{
+		if (geometry.lodError[level] * pixelsPerUnit <= lod.pixelError)
+		{
+			return level;
+		}
+	}
+
+	return 0;
+}
+
+void TopazSample::setGroupLod(uint32_t group, uint32_t level)
+{
+	const TopazInstancing::Group& instances = instancing.getGroup(group);
+	const TopazScene::Geometry& geometry = scene.getGeometry(instances.geometry);
+
+	const GLuint firstIndex = geometry.lodFirstIndex[level];
+	const GLuint count = GLuint(geometry.lodIndexCount[level]);
+
+	lod.groups[group] = level;
+
+	// the client-side streams are compiled into the command lists again by updateCommandListState
+	NVTokenDrawElemsInstanced& draw = *reinterpret_cast<NVTokenDrawElemsInstanced*>(&cmdlist.tokenData[cmdlist.drawTokenOffsets[group]]);
+	draw.setParams(count, firstIndex);
+
+	for (uint32_t instance = instances.firstInstance; instance < instances.firstInstance + instances.instanceCount; instance++)
+	{
+		const GLuint offset = cmdlist.drawTokenOffsetsWeightBlended[instancing.getInstanceNode(instance)];
+		if (offset != TopazScene::INVALID_ID)
+		{
+			NVTokenDrawElems& nodeDraw = *reinterpret_cast<NVTokenDrawElems*>(&cmdlist.tokenDataWeightBlended[offset]);
+			nodeDraw.setParams(count, firstIndex);
+		}
+	}
+
+	instancing.setIndexRange(group, firstIndex, count);
+	occlusion->setIndexRange(group, firstIndex, count);
 }
 
 typedef void(*NVPproc)(void);
@@ -359,42 +897,78 @@ NVPproc sysGetProcAddress(const char* name)
 	return (NVPproc)wglGetProcAddress(name);
 }
 
-void TopazSample::setTokenBuffers(TopazGLModel* model, std::string& stream, bool cornerPoints)
+void TopazSample::setTokenBuffers(uint32_t node, std::string& stream)
 {
-	GLuint vboId = (!cornerPoints) ? model->getBufferID("vbo") : model->getCornerBufferID("vbo");
-	GLuint vboId64 = (!cornerPoints) ? model->getBufferID64("vbo") : model->getCornerBufferID64("vbo");
-
-	GLuint iboId = (!cornerPoints) ? model->getBufferID("ibo") : model->getCornerBufferID("ibo");
-	GLuint iboId64 = (!cornerPoints) ? model->getBufferID64("ibo") : model->getCornerBufferID64("ibo");
-
-	GLuint uboId = (!cornerPoints) ? model->getBufferID("ubo") : model->getCornerBufferID("ubo");
-	GLuint uboId64 = (!cornerPoints) ? model->getBufferID64("ubo") : model->getCornerBufferID64("ubo");
+	const TopazScene::Geometry& geometry = scene.getNodeGeometry(node);
 
 	NVTokenVbo vbo;
 	vbo.setBinding(0);
-	vbo.setBuffer(vboId, vboId64, 0);
+	vbo.setBuffer(geometry.vbo, geometry.vbo64, 0);
 	nvtokenEnqueue(stream, vbo);
 
 	NVTokenIbo ibo;
 	ibo.setType(GL_UNSIGNED_INT);
-	ibo.setBuffer(iboId, iboId64);
+	ibo.setBuffer(geometry.ibo, geometry.ibo64);
 	nvtokenEnqueue(stream, ibo);
 
 	NVTokenUbo ubo;
-	ubo.setBuffer(uboId, uboId64, 0, sizeof(ObjectData));
+	ubo.setBuffer(objectBuffer.buffer, objectBuffer.buffer64, GLuint(node * objectBuffer.stride), sizeof(ObjectData));
 	ubo.setBinding(UBO_OBJECT, NVTOKEN_STAGE_VERTEX);
 	nvtokenEnqueue(stream, ubo);
 	ubo.setBinding(UBO_OBJECT, NVTOKEN_STAGE_FRAGMENT);
 	nvtokenEnqueue(stream, ubo);
 }
 
-void TopazSample::pushTokenParameters(NVTokenSequence& sequence, size_t& offset, std::string& stream, GLuint fbo, GLuint state)
+void TopazSample::enqueueNodeDraw(uint32_t node, std::string& stream)
+{
+	const TopazScene::Geometry& geometry = scene.getNodeGeometry(node);
+	const uint32_t level = lod.groups[instancing.getNodeGroup(node)];
+
+	setTokenBuffers(node, stream);
+
+	NVTokenDrawElems draw;
+	draw.setParams(geometry.lodIndexCount[level], geometry.lodFirstIndex[level]);
+	draw.setMode(geometry.mode);
+	nvtokenEnqueue(stream, draw);
+}
+
+void TopazSample::enqueueGroupDraw(uint32_t group, std::string& stream)
+{
+	const TopazInstancing::Group& instances = instancing.getGroup(group);
+	const TopazScene::Geometry& geometry = scene.getGeometry(instances.geometry);
+	const uint32_t level = lod.groups[group];
+
+	setTokenBuffers(instancing.getInstanceNode(instances.firstInstance), stream);
+
+	NVTokenDrawElemsInstanced draw;
+	draw.setParams(geometry.lodIndexCount[level], geometry.lodFirstIndex[level]);
+	draw.setMode(geometry.mode);
+	draw.setInstances(countVisibleInstances(group));
+	nvtokenEnqueue(stream, draw);
+}
+
+GLuint TopazSample::countVisibleInstances(uint32_t group) const
+{
+	const TopazInstancing::Group& instances = instancing.getGroup(group);
+
+	GLuint count = 0;
+	for (uint32_t instance = instances.firstInstance; instance < instances.firstInstance + instances.instanceCount; instance++)
+	{
+		count += visibility.nodes[instancing.getInstanceNode(instance)];
+	}
+
+	return count;
+}
+
+void TopazSample::pushTokenParameters(NVTokenSequence& sequence, TopazCulledSequence& culled, size_t& offset, std::string& stream, GLuint fbo, GLuint state)
 {
 	sequence.offsets.push_back(offset);
 	sequence.sizes.push_back(GLsizei(stream.size() - offset));
 	sequence.fbos.push_back(fbo);
 	sequence.states.push_back(state);
 
+	culled.endSegment(stream.size(), fbo, state);
+
 	offset = stream.size();
 }
 
@@ -428,9 +1002,16 @@ void TopazSample::initCommandList()
 	}
 
 	NVTokenSequence& seq = cmdlist.tokenSequence;
+	TopazCulledSequence& culled = cmdlist.culledSequence;
 	std::string& stream = cmdlist.tokenData;
 	size_t offset = 0;
 
+	seq = NVTokenSequence();
+	culled.clear();
+	stream.clear();
+
+	cmdlist.drawTokenOffsets.assign(instancing.getGroupCount(), 0);
+
 	{
 		NVTokenUbo  ubo;
 		ubo.setBuffer(ubos.sceneUbo, ubos.sceneUbo64, 0, sizeof(SceneData));
@@ -440,42 +1021,51 @@ void TopazSample::initCommandList()
 		nvtokenEnqueue(stream, ubo);
 	}
 	
-	for (auto & model : models)
+	// one instanced draw per group of nodes sharing geometry and flags
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
 	{
-		setTokenBuffers(model.get(), stream);
-
-		NVTokenDrawElems  draw;
-		draw.setParams(model->getModel()->getCompiledIndexCount(NvModelPrimType::TRIANGLES));
-		draw.setMode(GL_TRIANGLES);
-		nvtokenEnqueue(stream, draw);
+		if (scene.getGeometry(instancing.getGroup(group).geometry).mode == GL_TRIANGLES)
+		{
+			const size_t begin = stream.size();
+			enqueueGroupDraw(group, stream);
+			culled.addNodeRange(begin, stream.size(), group);
+			cmdlist.drawTokenOffsets[group] = GLuint(stream.size() - sizeof(NVTokenDrawElemsInstanced));
+		}
 	}
-	pushTokenParameters(seq, offset, stream, fbos.scene, cmdlist.stateObjects[STATE_DRAW]);
+	pushTokenParameters(seq, culled, offset, stream, fbos.scene, cmdlist.stateObjects[STATE_DRAW]);
 	
-	for (auto & model : models)
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
 	{
-		if (model->cornerPointsExists())
+		if (scene.getGeometry(instancing.getGroup(group).geometry).mode != GL_TRIANGLES)
 		{
-			setTokenBuffers(model.get(), stream, true);
-
-			NVTokenDrawElems drawCorner;
-			drawCorner.setParams(model->getCornerIndices().size());
-			drawCorner.setMode(GL_LINE_STRIP);
-			nvtokenEnqueue(stream, drawCorner);
+			const size_t begin = stream.size();
+			enqueueGroupDraw(group, stream);
+			culled.addNodeRange(begin, stream.size(), group);
+			cmdlist.drawTokenOffsets[group] = GLuint(stream.size() - sizeof(NVTokenDrawElemsInstanced));
 		}
 	}
-	pushTokenParameters(seq, offset, stream, fbos.scene, cmdlist.stateObjects[STATE_LINES_DRAW]);
+	pushTokenParameters(seq, culled, offset, stream, fbos.scene, cmdlist.stateObjects[STATE_LINES_DRAW]);
 
 	if (hwsupport)
 	{
 		glNamedBufferStorageEXT(cmdlist.tokenBuffer, cmdlist.tokenData.size(), &cmdlist.tokenData.at(0), 0);
 
-		cmdlist.tokenSequenceList = cmdlist.tokenSequence;
-		for (size_t i = 0; i < cmdlist.tokenSequenceList.offsets.size(); i++)
+		// the occlusion pass rewrites the draw tokens of this copy in place
+		glGetNamedBufferParameterui64vNV(cmdlist.tokenBuffer, GL_BUFFER_GPU_ADDRESS_NV, &cmdlist.tokenBuffer64);
+		glMakeNamedBufferResidentNV(cmdlist.tokenBuffer, GL_READ_ONLY);
+
+		cmdlist.tokenAddresses.resize(seq.offsets.size());
+		for (size_t i = 0; i < seq.offsets.size(); i++)
 		{
-			cmdlist.tokenSequenceList.offsets[i] += (GLintptr) &cmdlist.tokenData.at(0);
+			cmdlist.tokenAddresses[i] = cmdlist.tokenBuffer64 + seq.offsets[i];
 		}
 	}
 
+	occlusion->setDraws(scene, instancing, stream, cmdlist.drawTokenOffsets);
+
+	// the client-side list is built from the visible groups when the command list is compiled
+	cmdlist.state.visibilityIncarnation++;
+
 	updateCommandListState();
 }
 
@@ -511,9 +1101,16 @@ void TopazSample::initCommandListWeightBlended()
 	}
 
 	NVTokenSequence& seq = cmdlist.tokenSequenceWeightBlended;
+	TopazCulledSequence& culled = cmdlist.culledSequenceWeightBlended;
 	std::string& stream = cmdlist.tokenDataWeightBlended;
 	size_t offset = 0;
 
+	seq = NVTokenSequence();
+	culled.clear();
+	stream.clear();
+
+	cmdlist.drawTokenOffsetsWeightBlended.assign(scene.getNodeCount(), TopazScene::INVALID_ID);
+
 	{
 		NVTokenUbo  ubo;
 		ubo.setBuffer(ubos.sceneUbo, ubos.sceneUbo64, 0, sizeof(SceneData));
@@ -525,20 +1122,31 @@ void TopazSample::initCommandListWeightBlended()
 
 	// 1. render 'background' into framebuffer 'fbos.scene' 
 	{
-		auto& model = models.at(0);
-		setTokenBuffers(model.get(), stream);
-
-		NVTokenDrawElems  draw;
-		draw.setParams(model->getModel()->getCompiledIndexCount(NvModelPrimType::TRIANGLES));
-		draw.setMode(GL_TRIANGLES);
-		nvtokenEnqueue(stream, draw);
+		for (uint32_t node = 0; node < scene.getNodeCount(); node++)
+		{
+			if (!(scene.getFlags(node) & TopazScene::NODE_TRANSPARENT))
+			{
+				const size_t begin = stream.size();
+				enqueueNodeDraw(node, stream);
+				culled.addNodeRange(begin, stream.size(), node);
+				cmdlist.drawTokenOffsetsWeightBlended[node] = GLuint(stream.size() - sizeof(NVTokenDrawElems));
+			}
+		}
 
-		pushTokenParameters(seq, offset, stream, fbos.scene, cmdlist.stateObjectsWeightBlended[STATE_OPAQUE]);
+		pushTokenParameters(seq, culled, offset, stream, fbos.scene, cmdlist.stateObjectsWeightBlended[STATE_OPAQUE]);
 	}
 
 	// 2. geometry pass OIT 
-	for (auto model = models.begin() + 1; model != models.end(); model++)
+	for (uint32_t node = 0; node < scene.getNodeCount(); node++)
 	{
+		if (!(scene.getFlags(node) & TopazScene::NODE_TRANSPARENT) || scene.getNodeGeometry(node).mode != GL_TRIANGLES)
+		{
+			continue;
+		}
+
+		// every pass of the part is left out while the part is culled
+		size_t begin = stream.size();
+
 		// like call glClearBufferfv
 		{
 			NVTokenVbo vbo;
@@ -556,30 +1164,30 @@ void TopazSample::initCommandListWeightBlended()
 			draw.setMode(GL_TRIANGLE_STRIP);
 			nvtokenEnqueue(stream, draw);
 		}
-		pushTokenParameters(seq, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_CLEAR]);
+		culled.addNodeRange(begin, stream.size(), node);
+		pushTokenParameters(seq, culled, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_CLEAR]);
 
 		// 2. geometry pass
 		{
-			setTokenBuffers((*model).get(), stream);
-
-			NVTokenDrawElems  draw;
-			draw.setParams((*model)->getModel()->getCompiledIndexCount(NvModelPrimType::TRIANGLES));
-			draw.setMode(GL_TRIANGLES);
-			nvtokenEnqueue(stream, draw);
+			begin = stream.size();
+			enqueueNodeDraw(node, stream);
+			culled.addNodeRange(begin, stream.size(), node);
+			cmdlist.drawTokenOffsetsWeightBlended[node] = GLuint(stream.size() - sizeof(NVTokenDrawElems));
 		}
-		pushTokenParameters(seq, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_TRANSPARENT]);
+		pushTokenParameters(seq, culled, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_TRANSPARENT]);
 
+		/* the part's outlines */
+		for (uint32_t child = scene.getFirstChild(node); child != TopazScene::INVALID_ID; child = scene.getNextSibling(child))
 		{
-			setTokenBuffers((*model).get(), stream, true);
-
-			NVTokenDrawElems  draw;
-			draw.setParams((*model)->getCornerIndices().size());
-			draw.setMode(GL_LINE_STRIP);
-			nvtokenEnqueue(stream, draw);
+			begin = stream.size();
+			enqueueNodeDraw(child, stream);
+			culled.addNodeRange(begin, stream.size(), child);
+			cmdlist.drawTokenOffsetsWeightBlended[child] = GLuint(stream.size() - sizeof(NVTokenDrawElems));
 		}
-		pushTokenParameters(seq, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_TRASPARENT_LINES]);
+		pushTokenParameters(seq, culled, offset, stream, oit->getFramebufferID(), cmdlist.stateObjectsWeightBlended[STATE_TRASPARENT_LINES]);
 
 		// 3. composite pass
+		begin = stream.size();
 		{
 			NVTokenVbo vbo;
 			vbo.setBinding(0);
@@ -601,23 +1209,19 @@ void TopazSample::initCommandListWeightBlended()
 			draw.setMode(GL_TRIANGLE_STRIP);
 			nvtokenEnqueue(stream, draw);
 		}
-		pushTokenParameters(seq, offset, stream, fbos.scene, cmdlist.stateObjectsWeightBlended[STATE_COMPOSITE]);
+		culled.addNodeRange(begin, stream.size(), node);
+		pushTokenParameters(seq, culled, offset, stream, fbos.scene, cmdlist.stateObjectsWeightBlended[STATE_COMPOSITE]);
 	}
 	
 	if (hwsupport)
 	{
 		glNamedBufferStorageEXT(cmdlist.tokenBufferWeightBlended, cmdlist.tokenDataWeightBlended.size(), &cmdlist.tokenDataWeightBlended.at(0), 0);
-
-		cmdlist.tokenSequenceListWeightBlended = cmdlist.tokenSequenceWeightBlended;
-		for (size_t i = 0; i < cmdlist.tokenSequenceListWeightBlended.offsets.size(); i++)
-		{
-			cmdlist.tokenSequenceListWeightBlended.offsets[i] += (GLintptr)&cmdlist.tokenDataWeightBlended.at(0);
-		}
 	}
 	
+	// the models share one vertex layout; outlines and the fullscreen rectangle have float positions
+	const TopazScene::Geometry& modelGeometry = scene.getNodeGeometry(0);
+
 	glEnableVertexAttribArray(VERTEX_POS);
-	glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, 0);
-	glVertexAttribBinding(VERTEX_POS, 0);
 
 	glEnable(GL_DEPTH_TEST);
 
@@ -627,7 +1231,8 @@ void TopazSample::initCommandListWeightBlended()
 
 		shaderPrograms["draw"]->enable();
 
-		glBindVertexBuffer(0, 0, 0, 9 * sizeof(float));
+		setVertexFormat(modelGeometry);
+		glBindVertexBuffer(0, 0, 0, modelGeometry.vertexStride);
 		glStateCaptureNV(cmdlist.stateObjectsWeightBlended[STATE_OPAQUE], GL_TRIANGLES);
 		
 		shaderPrograms["draw"]->disable();
@@ -646,6 +1251,7 @@ void TopazSample::initCommandListWeightBlended()
 
 		shaderPrograms["clear"]->enable();
 
+		glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, 0);
 		glBindVertexBuffer(0, 0, 0, sizeof(nv::vec3f));
 		glStateCaptureNV(cmdlist.stateObjectsWeightBlended[STATE_CLEAR], GL_TRIANGLES);
 
@@ -672,9 +1278,11 @@ void TopazSample::initCommandListWeightBlended()
 
 		shaderPrograms["weightBlended"]->enable();
 
-		glBindVertexBuffer(0, 0, 0, 9 * sizeof(float));
+		setVertexFormat(modelGeometry);
+		glBindVertexBuffer(0, 0, 0, modelGeometry.vertexStride);
 		glStateCaptureNV(cmdlist.stateObjectsWeightBlended[STATE_TRANSPARENT], GL_TRIANGLES);
 
+		glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, 0);
 		glBindVertexBuffer(0, 0, 0, sizeof(nv::vec3f));
 		glStateCaptureNV(cmdlist.stateObjectsWeightBlended[STATE_TRASPARENT_LINES], GL_LINES);
 
@@ -699,8 +1307,19 @@ void TopazSample::initCommandListWeightBlended()
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
-	// compile command list
+	compileCommandListWeightBlended();
+}
+
+void TopazSample::compileCommandListWeightBlended()
+{
+	if (!hwsupport || cmdlist.tokenDataWeightBlended.empty())
+	{
+		return;
+	}
+
 	NVTokenSequence& sequenceList = cmdlist.tokenSequenceListWeightBlended;
+	cmdlist.culledSequenceWeightBlended.build(sequenceList, visibility.nodes, (GLintptr)&cmdlist.tokenDataWeightBlended.at(0));
+
 	glCommandListSegmentsNV(cmdlist.tokenCmdListWeightBlended, 1);
 	glListDrawCommandsStatesClientNV(cmdlist.tokenCmdListWeightBlended, 0, (const void**)&sequenceList.offsets[0], &sequenceList.sizes[0], &sequenceList.states[0], &sequenceList.fbos[0], int(sequenceList.states.size()));
 	glCompileCommandListNV(cmdlist.tokenCmdListWeightBlended);
@@ -725,11 +1344,13 @@ void TopazSample::updateCommandListState()
 			glEnable(GL_POLYGON_OFFSET_FILL);
 			glPolygonOffset(1, 1);
 
+			// the models share one vertex layout; the outlines have float positions
+			const TopazScene::Geometry& modelGeometry = scene.getNodeGeometry(0);
+
 			glEnableVertexAttribArray(VERTEX_POS);
-			glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, models.at(0)->getModel()->getCompiledPositionOffset());
-			glVertexAttribBinding(VERTEX_POS, 0);
+			setVertexFormat(modelGeometry);
 
-			 glBindVertexBuffer(0, 0, 0, models.at(0)->getModel()->getCompiledVertexSize() * sizeof(float));
+			glBindVertexBuffer(0, 0, 0, modelGeometry.vertexStride);
 
 			if (hwsupport)
 			{
@@ -742,6 +1363,7 @@ void TopazSample::updateCommandListState()
 			shaderPrograms["draw"]->enable();
 			glStateCaptureNV(cmdlist.stateObjects[STATE_DRAW], GL_TRIANGLES);
 
+			glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, 0);
 			glBindVertexBuffer(0, 0, 0, sizeof(nv::vec3f));
 
 			glStateCaptureNV(cmdlist.stateObjects[STATE_LINES_DRAW], GL_LINES);
@@ -754,13 +1376,23 @@ void TopazSample::updateCommandListState()
 
 	if (hwsupport && (
 		cmdlist.state.programIncarnation != cmdlist.captured.programIncarnation ||
-		cmdlist.state.fboIncarnation != cmdlist.captured.fboIncarnation))
+		cmdlist.state.fboIncarnation != cmdlist.captured.fboIncarnation ||
+		cmdlist.state.visibilityIncarnation != cmdlist.captured.visibilityIncarnation ||
+		cmdlist.state.lodIncarnation != cmdlist.captured.lodIncarnation))
 	{
 		NVTokenSequence &seq = cmdlist.tokenSequenceList;
+		cmdlist.culledSequence.build(seq, visibility.groups, (GLintptr)&cmdlist.tokenData.at(0));
+
 		glCommandListSegmentsNV(cmdlist.tokenCmdList, 1);
 		glListDrawCommandsStatesClientNV(cmdlist.tokenCmdList, 0, (const void**)&seq.offsets[0], &seq.sizes[0], &seq.states[0], &seq.fbos[0], int(seq.states.size()));
 		glCompileCommandListNV(cmdlist.tokenCmdList);
 	}
+
+	if (cmdlist.state.visibilityIncarnation != cmdlist.captured.visibilityIncarnation ||
+		cmdlist.state.lodIncarnation != cmdlist.captured.lodIncarnation)
+	{
+		compileCommandListWeightBlended();
+	}
 	
 	cmdlist.captured = cmdlist.state;
 }
@@ -815,7 +1447,7 @@ void TopazSample::initFramebuffers(int32_t width, int32_t height)
 	cmdlist.state.fboIncarnation++;
 }
 
-void TopazSample::drawStandard()
+void TopazSample::drawStandard(const std::vector<uint8_t>& visibleGroups)
 {
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_POLYGON_OFFSET_FILL);
@@ -823,57 +1455,101 @@ void TopazSample::drawStandard()
 
 	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_SCENE, ubos.sceneUbo);
 	
-	shaderPrograms["draw"]->enable();
+	for (uint32_t group = 0; group < instancing.getGroupCount(); group++)
 	{
-		const char* uniformNames[] = { "objectData.objectID", "objectData.objectColor", "objectData.skybox", "objectData.pattern" };
-
-		std::unique_ptr<GLint>  parameters(new GLint[4]);
-		std::unique_ptr<GLuint> uniformIndices(new GLuint[4]);
+		if (visibleGroups[group])
+		{
+			drawGroup(*shaderPrograms["draw"], group);
+		}
+	}
 
-		glGetUniformIndices(shaderPrograms["draw"]->getProgram(), 4, uniformNames, uniformIndices.get());
-		glGetActiveUniformsiv(shaderPrograms["draw"]->getProgram(), 4, uniformIndices.get(), GL_UNIFORM_OFFSET, parameters.get());
+	CHECK_GL_ERROR();
+}
 
-		GLint* offset = parameters.get();
-		CHECK_GL_ERROR();
+void TopazSample::drawOcclusionCulled()
+{
+	if (!hwsupport)
+	{
+		// draw() ran the same test on the CPU and compacted the instances it kept
+		drawStandard(visibility.occlusionGroups);
+		return;
 	}
 
-	for (auto & model : models)
+	occlusion->updateBounds(scene);
+	occlusion->cull(sceneData.modelViewProjection, cmdlist.tokenBuffer);
+
+	// the culled draws read only the instances cull packed
+	instancing.bind(occlusion->getRemapBuffer());
+
+	const NVTokenSequence& seq = cmdlist.tokenSequence;
+	glDrawCommandsStatesAddressNV(&cmdlist.tokenAddresses[0], &seq.sizes[0], &seq.states[0], &seq.fbos[0], GLuint(seq.states.size()));
+
+	if (validateOcclusion)
 	{
-		drawModel(GL_TRIANGLES, *shaderPrograms["draw"], *model);
+		occlusion->validate(sceneData.modelViewProjection, cmdlist.tokenBuffer);
 	}
-
-	CHECK_GL_ERROR();
 }
 
-void TopazSample::drawModel(GLenum mode, NvGLSLProgram& program, TopazGLModel& model)
+void TopazSample::drawNode(NvGLSLProgram& program, uint32_t node)
 {
-	glVertexAttribFormat(VERTEX_POS, 3, GL_FLOAT, GL_FALSE, model.getModel()->getCompiledPositionOffset());
+	const TopazScene::Geometry& geometry = scene.getNodeGeometry(node);
+	const uint32_t level = lod.groups[instancing.getNodeGroup(node)];
 
-	glVertexAttribBinding(VERTEX_POS, 0);
+	setVertexFormat(geometry);
 	glEnableVertexAttribArray(VERTEX_POS);
 
 	program.enable();
 
 	program.bindTextureRect("pattern", 0, brushStyle->getTextureId());
 
-	glBindBufferRange(GL_UNIFORM_BUFFER, UBO_OBJECT, model.getBufferID("ubo"), 0, sizeof(ObjectData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, UBO_OBJECT, objectBuffer.buffer, node * objectBuffer.stride, sizeof(ObjectData));
 
-	glBindVertexBuffer(0, model.getBufferID("vbo"), 0, model.getModel()->getCompiledVertexSize() * sizeof(float));
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.getBufferID("ibo"));
-	glDrawElements(mode, model.getModel()->getCompiledIndexCount(NvModelPrimType::TRIANGLES), GL_UNSIGNED_INT, nullptr);
+	glBindVertexBuffer(0, geometry.vbo, 0, geometry.vertexStride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ibo);
+	glDrawElements(geometry.mode, geometry.lodIndexCount[level], GL_UNSIGNED_INT, (const GLvoid*)(geometry.lodFirstIndex[level] * sizeof(GLuint)));
 	
-	if (model.cornerPointsExists())
-	{
-		glBindBufferRange(GL_UNIFORM_BUFFER, UBO_OBJECT, model.getCornerBufferID("ubo"), 0, sizeof(ObjectData));
+	program.disable();
 
-		glBindVertexBuffer(0, model.getCornerBufferID("vbo"), 0, sizeof(nv::vec3f));
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.getCornerBufferID("ibo"));
+	glDisableVertexAttribArray(VERTEX_POS);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindVertexBuffer(0, 0, 0, 0);
+}
 
-		glDrawElements(GL_LINE_STRIP, model.getCornerIndices().size(), GL_UNSIGNED_INT, nullptr);
+void TopazSample::drawGroup(NvGLSLProgram& program, uint32_t group)
+{
+	const TopazInstancing::Group& instances = instancing.getGroup(group);
+	const TopazScene::Geometry& geometry = scene.getGeometry(instances.geometry);
+	const uint32_t node = instancing.getInstanceNode(instances.firstInstance);
+
+	setVertexFormat(geometry);
+	glEnableVertexAttribArray(VERTEX_POS);
+
+	program.enable();
+
+	program.bindTextureRect("pattern", 0, brushStyle->getTextureId());
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, UBO_OBJECT, objectBuffer.buffer, node * objectBuffer.stride, sizeof(ObjectData));
+
+	glBindVertexBuffer(0, geometry.vbo, 0, geometry.vertexStride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ibo);
+
+	const GLsizei clusterDraws = clusters.culling.getDrawCount(group);
+	if (clusterDraws >= 0)
+	{
+		// one command per run of visible clusters, each drawing every instance
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, clusters.culling.getIndirectBuffer());
+		glMultiDrawElementsIndirect(geometry.mode, GL_UNSIGNED_INT, (const GLvoid*)clusters.culling.getIndirectOffset(group), clusterDraws, 0);
 	}
-	
+	else
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, instancing.getIndirectBuffer());
+		glDrawElementsIndirect(geometry.mode, GL_UNSIGNED_INT, (const GLvoid*)TopazInstancing::getIndirectOffset(group));
+	}
+
 	program.disable();
 
+	// the emulated command list passes its instanced draws to glDrawElementsIndirect from client memory
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	glDisableVertexAttribArray(VERTEX_POS);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexBuffer(0, 0, 0, 0);
@@ -888,15 +1564,25 @@ void TopazSample::renderStandartWeightedBlendedOIT()
 	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_IDENTITY, ubos.identityUbo);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fbos.scene);
-	drawModel(GL_TRIANGLES, *shaderPrograms["draw"], *models.at(0));
+	for (uint32_t node = 0; node < scene.getNodeCount(); node++)
+	{
+		if (!(scene.getFlags(node) & TopazScene::NODE_TRANSPARENT) && visibility.nodes[node])
+		{
+			drawNode(*shaderPrograms["draw"], node);
+		}
+	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	
 	/* first pass oit */
 	glDisable(GL_DEPTH_TEST);
 
-	// TODO : change on transparent list of models
-	for (auto model = models.begin() + 1; model != models.end(); model++)
+	for (uint32_t node = 0; node < scene.getNodeCount(); node++)
 	{
+		if (!(scene.getFlags(node) & TopazScene::NODE_TRANSPARENT) || scene.getNodeGeometry(node).mode != GL_TRIANGLES || !visibility.nodes[node])
+		{
+			continue;
+		}
+
 		/* geometry pass */
 		{
 			glBindFramebuffer(GL_FRAMEBUFFER, oit->getFramebufferID());
@@ -915,13 +1601,15 @@ void TopazSample::renderStandartWeightedBlendedOIT()
 			glBlendFunci(0, GL_ONE, GL_ONE);
 			glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
 
-			objectData.objectColor = nv::vec4f(1.0f, 1.0f, 1.0f, oit->getOpacity());
-			glNamedBufferSubDataEXT((*model)->getBufferID("ubo"), 0, sizeof(ObjectData), &objectData);
-
-			objectData.objectColor = nv::vec4f(1.0f, 0.0f, 0.0f, oit->getOpacity());
-			glNamedBufferSubDataEXT((*model)->getCornerBufferID("ubo"), 0, sizeof(ObjectData), &objectData);
-
-			drawModel(GL_TRIANGLES, *shaderPrograms["weightBlended"], **model);
+			/* the part and its outlines */
+			drawNode(*shaderPrograms["weightBlended"], node);
+			for (uint32_t child = scene.getFirstChild(node); child != TopazScene::INVALID_ID; child = scene.getNextSibling(child))
+			{
+				if (visibility.nodes[child])
+				{
+					drawNode(*shaderPrograms["weightBlended"], child);
+				}
+			}
 
 			glDisable(GL_BLEND);
 			CHECK_GL_ERROR();
@@ -932,19 +1620,6 @@ void TopazSample::renderStandartWeightedBlendedOIT()
 			glBindFramebuffer(GL_FRAMEBUFFER, fbos.scene);
 			glBindBufferRange(GL_UNIFORM_BUFFER, UBO_OIT, ubos.weightBlendedUbo, 0, sizeof(WeightBlendedData));
 
-			// check uniform buffer offset
-			{
-				const char* uniformNames[] = { "weightBlendedData.background", "weightBlendedData.colorTex0", "weightBlendedData.colorTex1" };
-
-				std::unique_ptr<GLint>  parameters(new GLint[3]);
-				std::unique_ptr<GLuint> uniformIndices(new GLuint[3]);
-
-				glGetUniformIndices(shaderPrograms["weightBlendedFinal"]->getProgram(), 3, uniformNames, uniformIndices.get());
-				glGetActiveUniformsiv(shaderPrograms["weightBlendedFinal"]->getProgram(), 3, uniformIndices.get(), GL_UNIFORM_OFFSET, parameters.get());
-
-				GLint* offset = parameters.get();
-			}
-
 			{
 				shaderPrograms["weightBlendedFinal"]->enable();
 
@@ -3,6 +3,11 @@
 #include "includeAll.h"
 #include "WeightedBlendedOIT.h"
 #include "Brush.h"
+#include "TopazScene.h"
+#include "TopazCulling.h"
+#include "TopazOcclusion.h"
+#include "TopazInstancing.h"
+#include "TopazClusters.h"
 
 using namespace nvtoken;
 
@@ -21,6 +26,9 @@ public:
 
 	void configurationCallback(NvEGLConfiguration& config);
 
+	/* no update work; draw() only reads the camera, which the framework hands over per frame */
+	bool supportsThreadedUpdate() { return true; }
+
 	void loadModel(std::string filename, GLuint program, bool calculateCornerPoints = false);
 
 	void compileShaders(std::string name,
@@ -28,29 +36,63 @@ public:
 						const char* fragmentShaderFilename,
 						const char* geometryShaderFilename = nullptr);
 
+	void compileComputeShader(std::string name, const char* computeShaderFilename);
+
 private:
 
+	void initSceneGraph();
 	void initScene();
 	void initCommandList();
 	void initFramebuffers(int32_t width, int32_t height);
 
-	void pushTokenParameters(NVTokenSequence& sequence, size_t& offset, std::string& stream, GLuint fbo, GLuint state);
-	void setTokenBuffers(TopazGLModel* model, std::string& stream, bool cornerPoints = false);
+	/* validates the uniform structs below against the std140 layouts of the shaders */
+	void checkUniformLayouts();
+
+	void pushTokenParameters(NVTokenSequence& sequence, TopazCulledSequence& culled, size_t& offset, std::string& stream, GLuint fbo, GLuint state);
+	void setTokenBuffers(uint32_t node, std::string& stream);
+	void enqueueNodeDraw(uint32_t node, std::string& stream);
+
+	/* one instanced draw of the visible instances of group, with the ObjectData of its first node */
+	void enqueueGroupDraw(uint32_t group, std::string& stream);
+
+	/* the instances of group whose node is set in visibility.nodes */
+	GLuint countVisibleInstances(uint32_t group) const;
 
 	// change
 	void initCommandListWeightBlended();
+	void compileCommandListWeightBlended();
 
 	void updateCommandListState();
 
 	void initBuffer(GLenum target, GLuint& buffer, GLuint64& buffer64, 
 		GLsizeiptr size, const GLvoid* data, bool ismutable = false);
 
-	void drawModel(GLenum mode, NvGLSLProgram& program, TopazGLModel& model);
+	/* packs the ObjectData of changed nodes and uploads them in one range */
+	void uploadObjectData();
+
+	/* points VERTEX_POS at the positions of geometry, on vertex buffer binding 0 */
+	void setVertexFormat(const TopazScene::Geometry& geometry);
+
+	/* frustum culls the scene nodes against sceneData.modelViewProjection */
+	void cullScene();
+
+	/* picks the level of detail of every instance group from the screen size of its visible nodes */
+	void selectLods(const nv::matrix4f& projection);
+	uint32_t selectNodeLod(uint32_t node, const nv::matrix4f& view, float pixelScale) const;
+
+	/* switches group to level, patching the draw tokens and indirect commands that draw it */
+	void setGroupLod(uint32_t group, uint32_t level);
+
+	void drawNode(NvGLSLProgram& program, uint32_t node);
+	void drawGroup(NvGLSLProgram& program, uint32_t group);
+
+	/* culls the draw tokens on the GPU and submits the token buffer directly */
+	void drawOcclusionCulled();
 
 	void renderTokenListWeightedBlendedOIT();
 
-	/* checking result of standart draw ( without command list ) */ 
-	void TopazSample::drawStandard();
+	/* checking result of standart draw ( without command list ); visibleGroups is indexed by instance group */ 
+	void TopazSample::drawStandard(const std::vector<uint8_t>& visibleGroups);
 	void TopazSample::renderStandartWeightedBlendedOIT();
 
 	/* command list inited */
@@ -67,14 +109,20 @@ private:
 		DRAW_STANDARD,
 		DRAW_TOKEN_LIST,
 		DRAW_WEIGHT_BLENDED_STANDARD,
-		DRAW_WEIGHT_BLENDED_TOKEN_LIST
+		DRAW_WEIGHT_BLENDED_TOKEN_LIST,
+
+		/*
+			tests against the previous frame's depth, so parts that come out from
+			behind others appear one frame late; see TopazOcclusion
+		*/
+		DRAW_OCCLUSION_TOKEN_BUFFER
 	};
 
 	uint32_t drawMode;
 
 	struct StateIncarnation 
 	{
-		StateIncarnation() : programIncarnation(0), fboIncarnation(0)
+		StateIncarnation() : programIncarnation(0), fboIncarnation(0), visibilityIncarnation(0), lodIncarnation(0)
 		{
 		}
 
@@ -90,6 +138,8 @@ private:
 
 		GLuint  programIncarnation;
 		GLuint  fboIncarnation;
+		GLuint  visibilityIncarnation;
+		GLuint  lodIncarnation;
 	};
 
 	struct CmdList 
@@ -108,8 +158,18 @@ private:
 		std::map<GLenum, GLuint> stateObjectsWeightBlended;
 
 		GLuint          tokenBuffer;
+		GLuint64        tokenBuffer64;
 		GLuint          tokenCmdList;
 
+		/* byte offset of each instance group's draw token in tokenData and tokenBuffer */
+		std::vector<GLuint>   drawTokenOffsets;
+
+		/* byte offset of each scene node's draw token in tokenDataWeightBlended, TopazScene::INVALID_ID where it has none */
+		std::vector<GLuint>   drawTokenOffsetsWeightBlended;
+
+		/* tokenBuffer64 plus the offsets of tokenSequence, for glDrawCommandsStatesAddressNV */
+		std::vector<GLuint64> tokenAddresses;
+
 		/* tokens weight blended */
 		GLuint			tokenBufferWeightBlended;
 		GLuint			tokenCmdListWeightBlended;
@@ -121,6 +181,10 @@ private:
 		NVTokenSequence tokenSequenceWeightBlended;
 		NVTokenSequence tokenSequenceListWeightBlended;
 
+		/* the sequences above with each token range tied to its instance group, or scene node for the OIT passes */
+		TopazCulledSequence culledSequence;
+		TopazCulledSequence culledSequenceWeightBlended;
+
 		std::string     tokenData;
 
 		/* token data weight blended */
@@ -177,6 +241,7 @@ private:
 
 	} ubos;
 
+	/* uniform block contents, laid out as declared in shaders/uniforms.glsl */
 	struct SceneData
 	{
 		nv::matrix4f modelViewProjection;
@@ -189,19 +254,42 @@ private:
 		nv::matrix4f identity;
 	} identityData;
 
+	/* transforms and colors are per instance, see TopazInstancing::InstanceData */
 	struct ObjectData
 	{
 		nv::vec4f objectID;
-		nv::vec4f objectColor;
+		nv::vec4f positionScale;
+		nv::vec4f positionBias;
 		GLuint64  skybox;
 		GLuint64  pattern;
-	} objectData;
+		GLuint    instanceBase;
+		GLuint    _pad[3];
+	};
+
+	/* one ObjectData per scene node, each at node * stride in a single uniform buffer */
+	struct ObjectBuffer
+	{
+		ObjectBuffer() : buffer(0), buffer64(0), stride(0), opacity(-1.0f)
+		{
+		}
+
+		GLuint   buffer;
+		GLuint64 buffer64;
+		GLsizeiptr stride;
+
+		/* CPU copy of the buffer contents */
+		std::vector<GLubyte> staging;
+
+		/* transparency last written into the transparent nodes' colors */
+		float opacity;
+	} objectBuffer;
 
 	struct WeightBlendedData
 	{
 		GLuint64 background;
 		GLuint64 colorTex0;
 		GLuint64 colorTex1;
+		GLuint64 _pad;
 	} weightBlendedData;
 
 	struct BrushData
@@ -222,7 +310,69 @@ private:
 	std::map<std::string, std::unique_ptr<NvGLSLProgram> > shaderPrograms;
 	std::vector<std::unique_ptr<TopazGLModel> >  models;
 
+	TopazScene scene;
+	TopazInstancing instancing;
+
+	struct Visibility
+	{
+		Visibility() : enabled(true), visibleCounter(-1)
+		{
+		}
+
+		bool     enabled;
+		TopazBVH bvh;
+
+		/* 1 for each node drawn this frame, indexed by node id; the next result is built in visibleScratch */
+		std::vector<uint8_t> nodes;
+		std::vector<uint8_t> visibleScratch;
+
+		/* 1 for each instance group with a visible node; the group draws the instances TopazInstancing::compact kept */
+		std::vector<uint8_t> groups;
+
+		/* result of the CPU occlusion test, when there is no NV_command_list, by node and by group */
+		std::vector<uint8_t> occlusion;
+		std::vector<uint8_t> occlusionGroups;
+
+		int32_t  visibleCounter;
+	} visibility;
+
+	struct Lod
+	{
+		Lod() : enabled(true), pixelError(1.0f), trianglesCounter(-1)
+		{
+		}
+
+		bool     enabled;
+
+		/* the largest geometric error, in pixels, a coarser level may show */
+		float    pixelError;
+
+		/* level of detail of each instance group, as drawn and as picked this frame */
+		std::vector<uint32_t> groups;
+		std::vector<uint32_t> selected;
+
+		int32_t  trianglesCounter;
+	} lod;
+
+	struct Clusters
+	{
+		Clusters() : enabled(true), trianglesCounter(-1)
+		{
+		}
+
+		bool     enabled;
+
+		/* frustum culling of the clusters of large parts, for the draws of drawGroup */
+		TopazClusters culling;
+
+		int32_t  trianglesCounter;
+	} clusters;
+
 	std::unique_ptr<WeightedBlendedOIT> oit;
+	std::unique_ptr<TopazOcclusion> occlusion;
+
+	/* -validateocclusion: compare the GPU culling results with the CPU test every frame */
+	bool validateOcclusion;
 	std::unique_ptr<BrushStyles> brushStyle;
 
 	nv::vec4f sceneBackgroundColor;